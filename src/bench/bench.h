@@ -0,0 +1,138 @@
+// Micro-benchmark harness
+// Should not use pre-compiled headers (for portability)
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include "mj_common.h"
+#include "mj_grid.h"
+
+namespace mj
+{
+  namespace bench
+  {
+    /// <summary>
+    /// Monotonic timestamp in nanoseconds.
+    /// </summary>
+    inline uint64_t Now()
+    {
+      using namespace std::chrono;
+      return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// <summary>
+    /// Prevents the compiler from optimizing away a computed value.
+    /// </summary>
+    template <typename T>
+    inline void DoNotOptimize(const T& value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+      asm volatile("" : : "r,m"(value) : "memory");
+#else
+      const volatile char* p = (const volatile char*)&value;
+      MJ_DISCARD(*p);
+#endif
+    }
+
+    /// <summary>
+    /// Runs fn(i) for i in [0, iterations) a few times and returns the best ns/op.
+    /// Taking the minimum filters out scheduler noise on shared machines.
+    /// </summary>
+    template <typename F>
+    double NsPerOp(uint32_t iterations, F fn)
+    {
+      static constexpr uint32_t NUM_RUNS = 5;
+
+      double best = 1e300;
+      for (uint32_t run = 0; run < NUM_RUNS; run++)
+      {
+        uint64_t begin = Now();
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+          fn(i);
+        }
+        double ns = (double)(Now() - begin) / iterations;
+        if (ns < best)
+        {
+          best = ns;
+        }
+      }
+      return best;
+    }
+
+    /// <summary>
+    /// Small xorshift generator so results are identical across runs and platforms.
+    /// </summary>
+    struct Random
+    {
+      uint32_t state = 0x9E3779B9;
+
+      uint32_t Next()
+      {
+        uint32_t x = this->state;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return (this->state = x);
+      }
+
+      /// <summary>
+      /// Uniform float in [lo, hi)
+      /// </summary>
+      float Range(float lo, float hi)
+      {
+        return lo + (hi - lo) * ((Next() >> 8) * (1.0f / 16777216.0f));
+      }
+    };
+
+    inline void PrintHeader(const char* suite, const char* columns)
+    {
+      printf("\n== %s ==\n%s\n", suite, columns);
+    }
+
+    /// <summary>
+    /// Counts a failed correctness check; the benchmark then exits with a nonzero status.
+    /// </summary>
+    /// <returns>ok</returns>
+    bool Check(bool ok);
+
+    static constexpr uint32_t E1M1_SIZE = 64;
+
+    /// <summary>
+    /// Loads assets/E1M1.bin (64x64 raw blocks), searching upwards from the working directory.
+    /// </summary>
+    /// <returns>False if the file was not found</returns>
+    bool LoadE1M1Blocks(block_t* pBlocks);
+
+    /// <returns>Invalid grid if the file was not found</returns>
+    mj::Grid LoadE1M1();
+
+    /// <summary>
+    /// Random map with a solid border: each cell is a wall with the given probability.
+    /// </summary>
+    mj::Grid GenerateGrid(uint32_t width, uint32_t height, float wallDensity, uint32_t seed);
+
+    /// <summary>
+    /// Perfect maze with one-cell corridors on the odd coordinates. Use odd dimensions.
+    /// </summary>
+    mj::Grid GenerateMaze(uint32_t width, uint32_t height, uint32_t seed);
+
+    // Suites, see bench_main.cpp
+    void RunMath(uint32_t iterations);
+    void RunJobs(uint32_t iterations);
+    void RunCollision(uint32_t iterations);
+    void RunFlowField(uint32_t iterations);
+    void RunPathFinder(uint32_t iterations);
+    void RunClusterGraph(uint32_t iterations);
+    void RunAreas(uint32_t iterations);
+    void RunFieldOfView(uint32_t iterations);
+    void RunLockstep(uint32_t iterations);
+    void RunSnapshot(uint32_t iterations);
+    void RunPrediction(uint32_t iterations);
+    void RunSaveGame(uint32_t iterations);
+    void RunMips(uint32_t iterations);
+    void RunBlockCompression(uint32_t iterations);
+    void RunPack(uint32_t iterations);
+    void RunResidency(uint32_t iterations);
+  } // namespace bench
+} // namespace mj
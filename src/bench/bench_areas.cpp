@@ -0,0 +1,225 @@
+// Sound propagation: which enemies hear a shot
+// The area map (union-find over areas, bitmask cached per queried root) against a flood fill over the blocks per shot.
+// Both must alert the same enemies.
+#include "bench.h"
+#include "mj_areas.h"
+
+static constexpr uint32_t NUM_ENEMIES = 256;
+static constexpr uint32_t NUM_SHOTS   = 4096;
+static constexpr uint32_t NUM_TOGGLES = 1024;
+
+static constexpr block_t WALL  = 0x0001;
+static constexpr block_t DOOR  = 0x005A;
+static constexpr block_t FLOOR = 0x006B;
+
+static mj::bench::Random s_Random;
+
+/// <summary>
+/// Square rooms separated by one-cell walls, with a door in the middle of every wall
+/// </summary>
+static block_t* GenerateRooms(uint32_t numRooms, uint32_t roomSize, uint32_t* pSize)
+{
+  uint32_t size    = numRooms * (roomSize + 1) + 1;
+  block_t* pBlocks = (block_t*)malloc((size_t)size * size * sizeof(block_t));
+  for (uint32_t z = 0; z < size; z++)
+  {
+    for (uint32_t x = 0; x < size; x++)
+    {
+      bool wallX = (x % (roomSize + 1)) == 0;
+      bool wallZ = (z % (roomSize + 1)) == 0;
+      bool door  = (wallX != wallZ) && (x > 0 && z > 0 && x < size - 1 && z < size - 1) &&
+                  ((wallX ? z : x) % (roomSize + 1)) == (roomSize + 1) / 2;
+      pBlocks[z * size + x] = door ? DOOR : ((wallX || wallZ) ? WALL : FLOOR);
+    }
+  }
+  *pSize = size;
+  return pBlocks;
+}
+
+/// <summary>
+/// The per-shot work without precomputation: flood fill through floor and open doors
+/// </summary>
+struct FloodFill
+{
+  const block_t* pBlocks;
+  const uint8_t* pDoorOpen;
+  uint32_t size;
+  uint32_t* pVisited; // Stamp of the last shot that reached the cell
+  uint32_t* pQueue;
+  uint32_t stamp;
+
+  bool IsOpen(uint32_t cell) const
+  {
+    return !IsSolidBlock(this->pBlocks[cell]) || this->pDoorOpen[cell];
+  }
+
+  void Run(int32_t x, int32_t z)
+  {
+    static constexpr int32_t s_Dx[4] = { 1, 0, -1, 0 };
+    static constexpr int32_t s_Dz[4] = { 0, 1, 0, -1 };
+
+    this->stamp++;
+    uint32_t head         = 0;
+    uint32_t tail         = 0;
+    uint32_t start        = z * this->size + x;
+    this->pQueue[tail++]  = start;
+    this->pVisited[start] = this->stamp;
+    while (head < tail)
+    {
+      uint32_t cell = this->pQueue[head++];
+      int32_t cx    = (int32_t)(cell % this->size);
+      int32_t cz    = (int32_t)(cell / this->size);
+      for (uint32_t i = 0; i < 4; i++)
+      {
+        int32_t nx = cx + s_Dx[i];
+        int32_t nz = cz + s_Dz[i];
+        if ((uint32_t)nx >= this->size || (uint32_t)nz >= this->size)
+        {
+          continue;
+        }
+        uint32_t neighbor = nz * this->size + nx;
+        if (this->pVisited[neighbor] != this->stamp && IsOpen(neighbor))
+        {
+          this->pVisited[neighbor] = this->stamp;
+          this->pQueue[tail++]     = neighbor;
+        }
+      }
+    }
+  }
+};
+
+static BlockPos FindFloor(const block_t* pBlocks, uint32_t size)
+{
+  BlockPos position;
+  do
+  {
+    position.x = (int32_t)(s_Random.Next() % size);
+    position.z = (int32_t)(s_Random.Next() % size);
+  } while (IsSolidBlock(pBlocks[position.z * size + position.x]));
+  return position;
+}
+
+static void Run(const char* name, const block_t* pBlocks, uint32_t size, uint32_t numShots)
+{
+  mj::AreaMap areas;
+  if (!areas.Init(pBlocks, size, size))
+  {
+    return;
+  }
+
+  size_t numCells    = (size_t)size * size;
+  uint8_t* pDoorOpen = (uint8_t*)calloc(numCells, 1);
+  FloodFill flood    = { pBlocks, pDoorOpen, size, (uint32_t*)calloc(numCells, sizeof(uint32_t)),
+                      (uint32_t*)malloc(numCells * sizeof(uint32_t)), 0 };
+
+  // Doors to toggle, about half of them open
+  BlockPos* pDoors  = (BlockPos*)malloc(numCells * sizeof(BlockPos));
+  uint32_t numDoors = 0;
+  for (uint32_t cell = 0; cell < numCells; cell++)
+  {
+    if (IsDoorBlock(pBlocks[cell]))
+    {
+      BlockPos door = { (int32_t)(cell % size), (int32_t)(cell / size) };
+      if (areas.SetDoorOpen(door.x, door.z, (s_Random.Next() & 1) != 0))
+      {
+        pDoorOpen[cell]    = areas.IsDoorOpen(door.x, door.z) ? 1 : 0;
+        pDoors[numDoors++] = door;
+      }
+    }
+  }
+
+  BlockPos enemies[NUM_ENEMIES];
+  for (BlockPos& enemy : enemies)
+  {
+    enemy = FindFloor(pBlocks, size);
+  }
+  BlockPos* pShots = (BlockPos*)malloc(numShots * sizeof(BlockPos));
+  for (uint32_t i = 0; i < numShots; i++)
+  {
+    pShots[i] = FindFloor(pBlocks, size);
+  }
+
+  auto alertFlood = [&](uint32_t shot) {
+    flood.Run(pShots[shot].x, pShots[shot].z);
+    uint32_t alerted = 0;
+    for (const BlockPos& enemy : enemies)
+    {
+      alerted += (flood.pVisited[enemy.z * size + enemy.x] == flood.stamp) ? 1 : 0;
+    }
+    return alerted;
+  };
+  auto alertAreas = [&](uint32_t shot) {
+    const uint64_t* pMask = areas.GetAudibleMask(areas.GetArea(pShots[shot].x, pShots[shot].z));
+    uint32_t alerted      = 0;
+    if (!pMask)
+    {
+      return UINT32_MAX;
+    }
+    for (const BlockPos& enemy : enemies)
+    {
+      alerted += mj::AreaMap::IsSet(pMask, areas.GetArea(enemy.x, enemy.z)) ? 1 : 0;
+    }
+    return alerted;
+  };
+
+  // Both must agree, also right after doors change
+  bool match = true;
+  for (uint32_t i = 0; i < numShots; i++)
+  {
+    if (numDoors > 0 && (i % 16) == 0)
+    {
+      const BlockPos& door = pDoors[s_Random.Next() % numDoors];
+      bool open            = !areas.IsDoorOpen(door.x, door.z);
+      areas.SetDoorOpen(door.x, door.z, open);
+      pDoorOpen[door.z * size + door.x] = open ? 1 : 0;
+    }
+    match = match && alertFlood(i) == alertAreas(i);
+  }
+
+  double floodNs = mj::bench::NsPerOp(numShots, [&](uint32_t i) { mj::bench::DoNotOptimize(alertFlood(i)); });
+  double areasNs = mj::bench::NsPerOp(numShots, [&](uint32_t i) { mj::bench::DoNotOptimize(alertAreas(i)); });
+
+  // Door changes, followed by the shot that has to rebuild its mask
+  double toggleNs = 0.0;
+  if (numDoors > 0)
+  {
+    toggleNs = mj::bench::NsPerOp(NUM_TOGGLES, [&](uint32_t i) {
+      const BlockPos& door = pDoors[i % numDoors];
+      areas.SetDoorOpen(door.x, door.z, !areas.IsDoorOpen(door.x, door.z));
+      mj::bench::DoNotOptimize(alertAreas(i % numShots));
+    });
+  }
+
+  printf("%-12s %6u %6u %12.0f %12.0f %9.0fx %14.0f %8s\n", name, areas.GetNumAreas(), areas.GetNumDoors(), floodNs,
+         areasNs, floodNs / areasNs, toggleNs, mj::bench::Check(match) ? "ok" : "MISMATCH");
+
+  free(pShots);
+  free(pDoors);
+  free(flood.pVisited);
+  free(flood.pQueue);
+  free(pDoorOpen);
+  areas.Destroy();
+}
+
+void mj::bench::RunAreas(uint32_t iterations)
+{
+  PrintHeader("Sound propagation",
+              "map           areas  doors flood ns/shot  area ns/shot   speedup  door+shot ns    check");
+
+  uint32_t numShots = iterations < NUM_SHOTS ? iterations : NUM_SHOTS;
+
+  block_t e1m1[E1M1_SIZE * E1M1_SIZE];
+  if (LoadE1M1Blocks(e1m1))
+  {
+    Run("E1M1 64x64", e1m1, E1M1_SIZE, numShots);
+  }
+
+  MJ_UNINITIALIZED uint32_t size;
+  block_t* pRooms = GenerateRooms(16, 7, &size);
+  Run("rooms 129", pRooms, size, numShots);
+  free(pRooms);
+
+  pRooms = GenerateRooms(64, 7, &size);
+  Run("rooms 513", pRooms, size, numShots);
+  free(pRooms);
+}
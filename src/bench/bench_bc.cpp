@@ -0,0 +1,147 @@
+// Block compression: encode time and PSNR of BC1, BC3 and BC7 at every quality
+// The image is a brick wall with per-brick colors, noise and a smooth band, roughly what the texture array
+// holds. Every quality must be at least as good as the one before it. A second table compresses 64 layers
+// one row of blocks per job, as the asset cooker does, against one layer after another.
+#include "bench.h"
+#include "mj_bc.h"
+#include "mj_jobs.h"
+
+#include <stdlib.h>
+
+static constexpr uint32_t SIZE       = 128;
+static constexpr uint32_t NUM_LAYERS = 64;
+static constexpr uint32_t LAYER_SIZE = 64;
+
+static void FillWall(uint8_t* pPixels, uint32_t width, uint32_t height, uint32_t seed)
+{
+  mj::bench::Random random;
+  random.state = seed;
+  for (uint32_t y = 0; y < height; y++)
+  {
+    for (uint32_t x = 0; x < width; x++)
+    {
+      uint8_t* pPixel = pPixels + (y * width + x) * 4;
+      uint32_t row    = y / 16;
+      uint32_t column = (x + (row & 1) * 16) / 32;
+      bool mortar     = (y % 16 == 0) || ((x + (row & 1) * 16) % 32 == 0);
+      if (y >= height - 16)
+      {
+        pPixel[0] = (uint8_t)(x * 255 / width);
+        pPixel[1] = (uint8_t)(64 + y % 16 * 8);
+        pPixel[2] = (uint8_t)(255 - x * 255 / width);
+      }
+      else if (mortar)
+      {
+        pPixel[0] = (uint8_t)(180 + (random.Next() & 15));
+        pPixel[1] = (uint8_t)(176 + (random.Next() & 15));
+        pPixel[2] = (uint8_t)(160 + (random.Next() & 15));
+      }
+      else
+      {
+        uint32_t brick = (row * 7 + column * 13) & 31;
+        pPixel[0]      = (uint8_t)(120 + brick * 2 + (random.Next() & 31));
+        pPixel[1]      = (uint8_t)(48 + brick + (random.Next() & 15));
+        pPixel[2]      = (uint8_t)(32 + (random.Next() & 15));
+      }
+      pPixel[3] = 255;
+    }
+  }
+}
+
+static void RunFormats(uint32_t iterations)
+{
+  struct Variant
+  {
+    const char* pName;
+    mj::dds::Format format;
+  };
+  static const Variant s_Variants[] = {
+    { "bc1", mj::dds::Format::BC1 }, //
+    { "bc3", mj::dds::Format::BC3 }, //
+    { "bc7", mj::dds::Format::BC7 }, //
+  };
+  static const char* s_Qualities[] = { "fast", "normal", "best" };
+
+  size_t imageSize  = (size_t)SIZE * SIZE * 4;
+  uint8_t* pImage   = (uint8_t*)malloc(imageSize);
+  uint8_t* pDecoded = (uint8_t*)malloc(imageSize);
+  uint8_t* pBlocks  = (uint8_t*)malloc(mj::dds::GetMipSize(mj::dds::Format::BC7, SIZE, SIZE));
+  if (pImage && pDecoded && pBlocks)
+  {
+    FillWall(pImage, SIZE, SIZE, 1234);
+    uint32_t numRuns = iterations / (1 << 20) + 1;
+    for (const Variant& variant : s_Variants)
+    {
+      double previousPsnr = 0.0;
+      for (uint32_t q = 0; q < MJ_COUNTOF(s_Qualities); q++)
+      {
+        double ns = mj::bench::NsPerOp(numRuns, [&](uint32_t) {
+          mj::bc::Encode(variant.format, pImage, SIZE, SIZE, (mj::bc::Quality)q, pBlocks);
+          mj::bench::DoNotOptimize(pBlocks[0]);
+        });
+        mj::bc::Decode(variant.format, pBlocks, SIZE, SIZE, pDecoded);
+        double psnr = mj::bc::GetPsnr(mj::bc::GetSquaredError(pImage, pDecoded, imageSize), imageSize);
+
+        // Small slack: least squares minimizes the error of the line, not of the quantized endpoints
+        bool ok = psnr >= previousPsnr - 0.05;
+        printf("%-6s %-7s %10.2f %10.2f %8.2f  %6s\n", variant.pName, s_Qualities[q], ns / 1e6,
+               SIZE * SIZE / ns * 1000.0, psnr, mj::bench::Check(ok) ? "ok" : "FAILED");
+        previousPsnr = psnr;
+      }
+    }
+  }
+  free(pImage);
+  free(pDecoded);
+  free(pBlocks);
+}
+
+static void RunLayers(uint32_t iterations)
+{
+  size_t imageSize = (size_t)LAYER_SIZE * LAYER_SIZE * 4;
+  size_t layerSize = mj::dds::GetMipSize(mj::dds::Format::BC7, LAYER_SIZE, LAYER_SIZE);
+  size_t rowSize   = mj::dds::GetMipSize(mj::dds::Format::BC7, LAYER_SIZE, 1);
+  uint8_t* pImages = (uint8_t*)malloc(imageSize * NUM_LAYERS);
+  uint8_t* pBlocks = (uint8_t*)malloc(layerSize * NUM_LAYERS);
+  if (pImages && pBlocks)
+  {
+    for (uint32_t i = 0; i < NUM_LAYERS; i++)
+    {
+      FillWall(pImages + i * imageSize, LAYER_SIZE, LAYER_SIZE, i + 1);
+    }
+
+    uint32_t numRuns = iterations / (1 << 20) + 1;
+    double serialNs  = mj::bench::NsPerOp(numRuns, [&](uint32_t) {
+      for (uint32_t i = 0; i < NUM_LAYERS; i++)
+      {
+        mj::bc::Encode(mj::dds::Format::BC7, pImages + i * imageSize, LAYER_SIZE, LAYER_SIZE,
+                       mj::bc::Quality::Normal, pBlocks + i * layerSize);
+      }
+    });
+    uint32_t numRows  = NUM_LAYERS * LAYER_SIZE / 4;
+    double parallelNs = mj::bench::NsPerOp(numRuns, [&](uint32_t) {
+      mj::jobs::ParallelFor(numRows, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t row = begin; row < end; row++)
+        {
+          // Layers are stacked, so rows of blocks run on from one layer into the next
+          mj::bc::Encode(mj::dds::Format::BC7, pImages + (size_t)row * 4 * LAYER_SIZE * 4, LAYER_SIZE, 4,
+                         mj::bc::Quality::Normal, pBlocks + row * rowSize);
+        }
+      });
+    });
+    printf("%7u %12.2f %12.2f %8.2f\n", mj::jobs::GetNumThreads(), serialNs / 1e6, parallelNs / 1e6,
+           serialNs / parallelNs);
+  }
+  free(pImages);
+  free(pBlocks);
+}
+
+void mj::bench::RunBlockCompression(uint32_t iterations)
+{
+  PrintHeader("Block compression, 128x128 brick wall", "format quality   image ms   Mtexel/s     PSNR   check");
+  RunFormats(iterations);
+
+  mj::jobs::Init();
+  PrintHeader("Texture array, 64 layers of 64x64, bc7 normal", "threads    serial ms  parallel ms  speedup");
+  RunLayers(iterations);
+  mj::jobs::Shutdown();
+}
@@ -0,0 +1,202 @@
+// Hierarchical path finding: graph build, cluster updates, queries and refinement
+// Queries are compared with optimal Jump Point Search paths, refined paths are walked to check they are legal,
+// and after random door toggles the incrementally updated graph must answer like a fresh build.
+#include "bench.h"
+#include "mj_clustergraph.h"
+#include "mj_jobs.h"
+#include "mj_pathfinder.h"
+
+static constexpr uint32_t NUM_TOGGLES = 256;
+
+static mj::bench::Random s_Random;
+
+struct Query
+{
+  BlockPos start;
+  BlockPos goal;
+};
+
+static BlockPos FindFreeCell(const mj::Grid& grid)
+{
+  BlockPos position;
+  do
+  {
+    position.x = (int32_t)(s_Random.Next() % grid.width);
+    position.z = (int32_t)(s_Random.Next() % grid.height);
+  } while (grid.IsSolid(position.x, position.z));
+  return position;
+}
+
+/// <summary>
+/// Refines every segment and walks the cells
+/// </summary>
+/// <returns>False if a step is illegal, the path does not end at the goal, or the cost differs</returns>
+static bool CheckRefined(const mj::Grid& grid, const mj::ClusterGraph& graph, BlockPos* pCells, uint32_t capacity)
+{
+  const BlockPos* pPath = graph.GetAbstractPath();
+  BlockPos position     = pPath[0];
+  uint32_t cost         = 0;
+  for (uint32_t segment = 0; segment + 1 < graph.GetAbstractPathLength(); segment++)
+  {
+    uint32_t count = graph.RefineSegment(segment, pCells, capacity);
+    for (uint32_t i = 0; i < count; i++)
+    {
+      int32_t dx         = pCells[i].x - position.x;
+      int32_t dz         = pCells[i].z - position.z;
+      uint32_t direction = 0;
+      while (direction < 8 && (mj::NEIGHBOR_DX[direction] != dx || mj::NEIGHBOR_DZ[direction] != dz))
+      {
+        direction++;
+      }
+      if (direction == 8 || !(grid.GetStepMask(position.x, position.z) & (1 << direction)))
+      {
+        return false;
+      }
+      cost += (direction & 1) ? mj::ClusterGraph::DIAGONAL_COST : mj::ClusterGraph::ORTHOGONAL_COST;
+      position = pCells[i];
+    }
+  }
+  const BlockPos& goal = pPath[graph.GetAbstractPathLength() - 1];
+  return position.x == goal.x && position.z == goal.z && cost == graph.GetCost();
+}
+
+static void Run(const char* name, mj::Grid& grid, uint32_t numQueries)
+{
+  mj::ClusterGraph graph;
+  mj::ClusterGraph reference;
+  mj::PathFinder finder;
+  if (!graph.Init(grid.width, grid.height) || !reference.Init(grid.width, grid.height) ||
+      !finder.Init(grid.width, grid.height))
+  {
+    return;
+  }
+
+  // Full build
+  double buildMs = 1e300;
+  for (uint32_t run = 0; run < 5; run++)
+  {
+    uint64_t begin = mj::bench::Now();
+    graph.Build(grid);
+    double ms = (mj::bench::Now() - begin) / 1e6;
+    if (ms < buildMs)
+    {
+      buildMs = ms;
+    }
+  }
+
+  Query* pQueries = (Query*)malloc(numQueries * sizeof(Query));
+  for (uint32_t i = 0; i < numQueries; i++)
+  {
+    pQueries[i].start = FindFreeCell(grid);
+    pQueries[i].goal  = FindFreeCell(grid);
+  }
+
+  // Quality against optimal paths
+  uint32_t capacity = mj::ClusterGraph::CLUSTER_SIZE * mj::ClusterGraph::CLUSTER_SIZE;
+  BlockPos* pCells  = (BlockPos*)malloc(capacity * sizeof(BlockPos));
+  bool match        = true;
+  double ratio      = 0.0;
+  uint32_t numPaths = 0;
+  for (uint32_t i = 0; i < numQueries; i++)
+  {
+    bool found   = graph.FindPath(grid, pQueries[i].start, pQueries[i].goal);
+    bool optimal = finder.FindPath(grid, pQueries[i].start, pQueries[i].goal);
+    if (found != optimal ||
+        (found && (graph.GetCost() < finder.GetCost() || !CheckRefined(grid, graph, pCells, capacity))))
+    {
+      match = false;
+    }
+    if (found && finder.GetCost() > 0)
+    {
+      ratio += (double)graph.GetCost() / finder.GetCost();
+      numPaths++;
+    }
+  }
+
+  // Timing
+  double hpaNs = mj::bench::NsPerOp(numQueries, [&](uint32_t i) {
+    mj::bench::DoNotOptimize(graph.FindPath(grid, pQueries[i].start, pQueries[i].goal));
+  });
+  double refineNs = mj::bench::NsPerOp(numQueries, [&](uint32_t i) {
+    graph.FindPath(grid, pQueries[i].start, pQueries[i].goal);
+    for (uint32_t segment = 0; segment + 1 < graph.GetAbstractPathLength(); segment++)
+    {
+      mj::bench::DoNotOptimize(graph.RefineSegment(segment, pCells, capacity));
+    }
+  });
+  double jpsNs = mj::bench::NsPerOp(numQueries, [&](uint32_t i) {
+    mj::bench::DoNotOptimize(finder.FindPath(grid, pQueries[i].start, pQueries[i].goal));
+  });
+
+  // Incremental: close and reopen random doors
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < NUM_TOGGLES; i++)
+  {
+    BlockPos door = FindFreeCell(grid);
+    for (uint32_t step = 0; step < 2; step++)
+    {
+      grid.SetSolid(door.x, door.z, step == 0);
+      uint64_t begin = mj::bench::Now();
+      graph.OnCellChanged(grid, door.x, door.z);
+      total += mj::bench::Now() - begin;
+    }
+  }
+  double updateUs = total / 1e3 / (2 * NUM_TOGGLES);
+
+  // Leave one door of every toggle closed, then compare with a fresh build
+  for (uint32_t i = 0; i < NUM_TOGGLES / 4; i++)
+  {
+    BlockPos door = FindFreeCell(grid);
+    grid.SetSolid(door.x, door.z, true);
+    graph.OnCellChanged(grid, door.x, door.z);
+  }
+  reference.Build(grid);
+  for (uint32_t i = 0; i < numQueries; i++)
+  {
+    bool found      = graph.FindPath(grid, pQueries[i].start, pQueries[i].goal);
+    uint32_t cost   = graph.GetCost();
+    bool foundFresh = reference.FindPath(grid, pQueries[i].start, pQueries[i].goal);
+    match           = match && found == foundFresh && cost == reference.GetCost();
+  }
+
+  printf("%-12s %6u %9.3f %9.2f %12.0f %12.0f %10.0f %8.3f %8s\n", name, graph.GetNumNodes(), buildMs, updateUs,
+         1e9 / hpaNs, 1e9 / refineNs, 1e9 / jpsNs, numPaths ? ratio / numPaths : 1.0,
+         mj::bench::Check(match) ? "ok" : "MISMATCH");
+
+  free(pCells);
+  free(pQueries);
+  graph.Destroy();
+  reference.Destroy();
+  finder.Destroy();
+}
+
+void mj::bench::RunClusterGraph(uint32_t iterations)
+{
+  mj::jobs::Init();
+  PrintHeader("Hierarchical path finding",
+              "map           nodes  build ms update us  HPA query/s  +refine q/s    JPS q/s    ratio    check");
+
+  // Queries are much more expensive than the other benchmarks' operations
+  uint32_t numQueries = iterations < 1024 ? iterations : 1024;
+
+  mj::Grid e1m1 = LoadE1M1();
+  if (e1m1.IsValid())
+  {
+    Run("E1M1 64x64", e1m1, numQueries);
+    mj::Grid::Free(e1m1);
+  }
+
+  mj::Grid random = GenerateGrid(512, 512, 0.25f, 1234);
+  Run("random 512", random, numQueries);
+  mj::Grid::Free(random);
+
+  random = GenerateGrid(1024, 1024, 0.2f, 1234);
+  Run("random 1024", random, numQueries);
+  mj::Grid::Free(random);
+
+  mj::Grid maze = GenerateMaze(511, 511, 1234);
+  Run("maze 511", maze, numQueries);
+  mj::Grid::Free(maze);
+
+  mj::jobs::Shutdown();
+}
@@ -0,0 +1,135 @@
+// Swept-box collision on E1M1
+// Hundreds of actors wander with random velocities. The swept routine is compared with
+// fixed substeps that test box overlap after every step.
+#include "bench.h"
+#include "mj_collision.h"
+
+#include <math.h>
+
+static constexpr uint32_t NUM_ACTORS = 512;
+static constexpr float RADIUS        = 0.25f;
+static constexpr float TICK_TIME     = 1.0f / 60.0f;
+static constexpr float SUBSTEP       = 0.05f; // Cells per naive step
+
+struct Actor
+{
+  mjm::vec3 position;
+  mjm::vec3 velocity;
+};
+
+static void RandomizeVelocity(mj::bench::Random& random, Actor& actor)
+{
+  // Mostly walking speed, some fast movers to exercise long sweeps
+  float speed    = (random.Next() % 8 == 0) ? random.Range(20.0f, 60.0f) : random.Range(1.0f, 6.0f);
+  float angle    = random.Range(0.0f, 6.2831853f);
+  actor.velocity = mjm::vec3(cosf(angle) * speed, 0.0f, sinf(angle) * speed);
+}
+
+static void Spawn(const mj::Grid& grid, mj::bench::Random& random, Actor* pActors)
+{
+  for (uint32_t i = 0; i < NUM_ACTORS; i++)
+  {
+    Actor& actor = pActors[i];
+    do
+    {
+      actor.position = mjm::vec3(random.Range(0.0f, (float)grid.width), 0.5f, random.Range(0.0f, (float)grid.height));
+    } while (mj::collision::Overlaps(grid, actor.position.x, actor.position.z, RADIUS));
+    RandomizeVelocity(random, actor);
+  }
+}
+
+/// <summary>
+/// Reference: advance in small steps and reject steps that end up overlapping a wall, per axis
+/// </summary>
+static mjm::vec3 MoveSubstep(const mj::Grid& grid, mjm::vec3 position, const mjm::vec3& delta)
+{
+  float length   = sqrtf(delta.x * delta.x + delta.z * delta.z);
+  uint32_t steps = (uint32_t)ceilf(length / SUBSTEP);
+  if (steps == 0)
+  {
+    return position;
+  }
+  float stepX = delta.x / steps;
+  float stepZ = delta.z / steps;
+  for (uint32_t i = 0; i < steps; i++)
+  {
+    if (!mj::collision::Overlaps(grid, position.x + stepX, position.z, RADIUS))
+    {
+      position.x += stepX;
+    }
+    if (!mj::collision::Overlaps(grid, position.x, position.z + stepZ, RADIUS))
+    {
+      position.z += stepZ;
+    }
+  }
+  return position;
+}
+
+template <typename F>
+static void Run(const char* name, const mj::Grid& grid, uint32_t numTicks, F move)
+{
+  mj::bench::Random random;
+  Actor* pActors = (Actor*)malloc(NUM_ACTORS * sizeof(Actor));
+  Spawn(grid, random, pActors);
+
+  uint32_t numBlocked    = 0;
+  uint32_t numViolations = 0;
+  uint64_t begin         = mj::bench::Now();
+  for (uint32_t tick = 0; tick < numTicks; tick++)
+  {
+    for (uint32_t i = 0; i < NUM_ACTORS; i++)
+    {
+      Actor& actor       = pActors[i];
+      mjm::vec3 delta    = actor.velocity * TICK_TIME;
+      mjm::vec3 previous = actor.position;
+      actor.position     = move(actor.position, delta);
+      if (actor.position.x != previous.x + delta.x || actor.position.z != previous.z + delta.z)
+      {
+        // Blocked, pick a new direction
+        numBlocked++;
+        RandomizeVelocity(random, actor);
+      }
+    }
+  }
+  uint64_t elapsed = mj::bench::Now() - begin;
+
+  for (uint32_t i = 0; i < NUM_ACTORS; i++)
+  {
+    if (mj::collision::Overlaps(grid, pActors[i].position.x, pActors[i].position.z, RADIUS))
+    {
+      numViolations++;
+    }
+  }
+
+  double numMoves = (double)numTicks * NUM_ACTORS;
+  printf("%-12s %10.1f %10.2f %10u %10u\n", name, elapsed / numMoves, numMoves / (elapsed / 1e9) / 1e6, numBlocked,
+         numViolations);
+  free(pActors);
+}
+
+void mj::bench::RunCollision(uint32_t iterations)
+{
+  mj::Grid grid = LoadE1M1();
+  if (!grid.IsValid())
+  {
+    return;
+  }
+
+  uint32_t numTicks = iterations / NUM_ACTORS;
+  if (numTicks == 0)
+  {
+    numTicks = 1;
+  }
+
+  char title[64];
+  snprintf(title, sizeof(title), "Collision (%u actors, %u ticks)", NUM_ACTORS, numTicks);
+  PrintHeader(title, "method          ns/move   Mmoves/s    blocked   in walls");
+
+  Run("swept", grid, numTicks, [&grid](const mjm::vec3& position, const mjm::vec3& delta) {
+    return mj::collision::Move(grid, position, delta, RADIUS).position;
+  });
+  Run("substep", grid, numTicks,
+      [&grid](const mjm::vec3& position, const mjm::vec3& delta) { return MoveSubstep(grid, position, delta); });
+
+  mj::Grid::Free(grid);
+}
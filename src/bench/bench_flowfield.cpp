@@ -0,0 +1,125 @@
+// Flow field build, incremental update and sampling
+// Incremental updates toggle random cells (doors) and are checked against a full rebuild.
+#include "bench.h"
+#include "mj_flowfield.h"
+#include "mj_jobs.h"
+
+static constexpr uint32_t NUM_TOGGLES = 256;
+static constexpr uint32_t NUM_CHECKED = 16; // Toggles that are verified individually
+
+static mj::bench::Random s_Random;
+
+static BlockPos FindFreeCell(const mj::Grid& grid)
+{
+  BlockPos position;
+  do
+  {
+    position.x = (int32_t)(s_Random.Next() % grid.width);
+    position.z = (int32_t)(s_Random.Next() % grid.height);
+  } while (grid.IsSolid(position.x, position.z));
+  return position;
+}
+
+static bool Equal(const mj::FlowField& a, const mj::FlowField& b)
+{
+  for (uint32_t z = 0; z < a.GetHeight(); z++)
+  {
+    for (uint32_t x = 0; x < a.GetWidth(); x++)
+    {
+      if (a.GetCost(x, z) != b.GetCost(x, z))
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static void Run(const char* name, mj::Grid& grid, BlockPos goal, uint32_t iterations)
+{
+  MJ_UNINITIALIZED mj::FlowField field, reference;
+  if (!field.Init(grid.width, grid.height) || !reference.Init(grid.width, grid.height))
+  {
+    return;
+  }
+
+  // Full build
+  double buildMs = 1e300;
+  for (uint32_t run = 0; run < 5; run++)
+  {
+    uint64_t begin = mj::bench::Now();
+    field.Build(grid, &goal, 1);
+    double ms = (mj::bench::Now() - begin) / 1e6;
+    if (ms < buildMs)
+    {
+      buildMs = ms;
+    }
+  }
+
+  // Incremental: close and reopen random doors
+  bool match     = true;
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < NUM_TOGGLES; i++)
+  {
+    BlockPos door;
+    do
+    {
+      door = FindFreeCell(grid);
+    } while (door.x == goal.x && door.z == goal.z);
+
+    for (uint32_t step = 0; step < 2; step++)
+    {
+      grid.SetSolid(door.x, door.z, step == 0);
+      uint64_t begin = mj::bench::Now();
+      bool updated   = field.OnCellChanged(grid, door.x, door.z);
+      total += mj::bench::Now() - begin;
+      match = match && updated;
+
+      if (i < NUM_CHECKED)
+      {
+        reference.Build(grid, &goal, 1);
+        match = match && Equal(field, reference);
+      }
+    }
+  }
+  reference.Build(grid, &goal, 1);
+  match           = match && Equal(field, reference);
+  double updateUs = total / 1e3 / (2 * NUM_TOGGLES);
+
+  // Agents sampling the field
+  mjm::vec3* pAgents = (mjm::vec3*)malloc(iterations * sizeof(mjm::vec3));
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    pAgents[i] = mjm::vec3(s_Random.Range(0.0f, (float)grid.width), 0.0f, s_Random.Range(0.0f, (float)grid.height));
+  }
+  double sampleNs =
+      mj::bench::NsPerOp(iterations, [&](uint32_t i) { mj::bench::DoNotOptimize(field.Sample(pAgents[i])); });
+  free(pAgents);
+
+  printf("%-12s %10.3f %12.2f %10.2f %8s\n", name, buildMs, updateUs, sampleNs,
+         mj::bench::Check(match) ? "ok" : "MISMATCH");
+
+  field.Destroy();
+  reference.Destroy();
+}
+
+void mj::bench::RunFlowField(uint32_t iterations)
+{
+  mj::jobs::Init();
+  PrintHeader("Flow field", "map            build ms    update us  sample ns    check");
+
+  mj::Grid e1m1 = LoadE1M1();
+  if (e1m1.IsValid())
+  {
+    // Player spawn
+    BlockPos goal = { 54, 34 };
+    Run("E1M1 64x64", e1m1, goal, iterations);
+    mj::Grid::Free(e1m1);
+  }
+
+  mj::Grid random = GenerateGrid(512, 512, 0.25f, 1234);
+  Run("random 512", random, FindFreeCell(random), iterations);
+  mj::Grid::Free(random);
+
+  mj::jobs::Shutdown();
+}
@@ -0,0 +1,179 @@
+// AI vision: shadowcasting field of view against one ray per cell
+// The ray is the 2D version of Level::FireRay's grid traversal, cast from cell center to cell center.
+// The two methods treat rays grazing wall corners differently, so agreement is reported instead of checked.
+#include "bench.h"
+#include "mj_fov.h"
+
+#include <math.h>
+
+static constexpr uint32_t NUM_ORIGINS = 256;
+static constexpr uint32_t NUM_ENEMIES = 64;
+
+static mj::bench::Random s_Random;
+
+/// <summary>
+/// Level::FireRay on the grid: walks the cells along the ray and stops at the first solid one
+/// </summary>
+/// <returns>True if the target cell is reached</returns>
+static bool CastRay(const mj::Grid& grid, int32_t x0, int32_t z0, int32_t x1, int32_t z1)
+{
+  float directionX = (float)(x1 - x0);
+  float directionZ = (float)(z1 - z0);
+  int32_t stepX    = directionX < 0 ? -1 : 1;
+  int32_t stepZ    = directionZ < 0 ? -1 : 1;
+  float tDeltaX    = fabsf(1.0f / directionX);
+  float tDeltaZ    = fabsf(1.0f / directionZ);
+  float tMaxX      = 0.5f * tDeltaX;
+  float tMaxZ      = 0.5f * tDeltaZ;
+
+  int32_t x = x0;
+  int32_t z = z0;
+  while (x != x1 || z != z1)
+  {
+    if (tMaxX < tMaxZ)
+    {
+      x += stepX;
+      tMaxX += tDeltaX;
+    }
+    else
+    {
+      z += stepZ;
+      tMaxZ += tDeltaZ;
+    }
+    if ((x != x1 || z != z1) && grid.IsSolid(x, z))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static BlockPos FindFreeCell(const mj::Grid& grid)
+{
+  BlockPos position;
+  do
+  {
+    position.x = (int32_t)(s_Random.Next() % grid.width);
+    position.z = (int32_t)(s_Random.Next() % grid.height);
+  } while (grid.IsSolid(position.x, position.z));
+  return position;
+}
+
+static void Run(const char* name, const mj::Grid& grid, int32_t radius, uint32_t numOrigins)
+{
+  mj::FieldOfView fov;
+  if (!fov.Init(radius))
+  {
+    return;
+  }
+
+  BlockPos* pOrigins = (BlockPos*)malloc(numOrigins * sizeof(BlockPos));
+  BlockPos* pEnemies = (BlockPos*)malloc(numOrigins * NUM_ENEMIES * sizeof(BlockPos));
+  for (uint32_t i = 0; i < numOrigins; i++)
+  {
+    pOrigins[i] = FindFreeCell(grid);
+    for (uint32_t j = 0; j < NUM_ENEMIES; j++)
+    {
+      // Enemies somewhere within the radius
+      BlockPos& enemy = pEnemies[i * NUM_ENEMIES + j];
+      do
+      {
+        enemy.x = pOrigins[i].x + (int32_t)(s_Random.Next() % (2 * radius + 1)) - radius;
+        enemy.z = pOrigins[i].z + (int32_t)(s_Random.Next() % (2 * radius + 1)) - radius;
+      } while (grid.IsSolid(enemy.x, enemy.z) ||
+               (enemy.x - pOrigins[i].x) * (enemy.x - pOrigins[i].x) +
+                       (enemy.z - pOrigins[i].z) * (enemy.z - pOrigins[i].z) >
+                   radius * radius);
+    }
+  }
+
+  // The full visible set: every cell in the circle
+  auto allRays = [&](uint32_t i) {
+    uint32_t visible  = 0;
+    const BlockPos& o = pOrigins[i];
+    for (int32_t dz = -radius; dz <= radius; dz++)
+    {
+      for (int32_t dx = -radius; dx <= radius; dx++)
+      {
+        if (dx * dx + dz * dz <= radius * radius)
+        {
+          visible += CastRay(grid, o.x, o.z, o.x + dx, o.z + dz) ? 1 : 0;
+        }
+      }
+    }
+    return visible;
+  };
+
+  uint64_t agree = 0;
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < numOrigins; i++)
+  {
+    const BlockPos& o = pOrigins[i];
+    fov.Compute(grid, o.x, o.z, radius);
+    for (int32_t dz = -radius; dz <= radius; dz++)
+    {
+      for (int32_t dx = -radius; dx <= radius; dx++)
+      {
+        if (dx * dx + dz * dz <= radius * radius)
+        {
+          agree += (CastRay(grid, o.x, o.z, o.x + dx, o.z + dz) == fov.IsVisible(o.x + dx, o.z + dz)) ? 1 : 0;
+          total++;
+        }
+      }
+    }
+  }
+
+  double fovNs = mj::bench::NsPerOp(numOrigins, [&](uint32_t i) {
+    fov.Compute(grid, pOrigins[i].x, pOrigins[i].z, radius);
+    mj::bench::DoNotOptimize(fov.IsVisible(pOrigins[i].x, pOrigins[i].z));
+  });
+  double raysNs = mj::bench::NsPerOp(numOrigins, [&](uint32_t i) { mj::bench::DoNotOptimize(allRays(i)); });
+
+  // Which enemies see the player: one ray per enemy, or one field of view from the player
+  double enemyRaysNs = mj::bench::NsPerOp(numOrigins, [&](uint32_t i) {
+    uint32_t seen = 0;
+    for (uint32_t j = 0; j < NUM_ENEMIES; j++)
+    {
+      const BlockPos& enemy = pEnemies[i * NUM_ENEMIES + j];
+      seen += CastRay(grid, enemy.x, enemy.z, pOrigins[i].x, pOrigins[i].z) ? 1 : 0;
+    }
+    mj::bench::DoNotOptimize(seen);
+  });
+  double enemyFovNs = mj::bench::NsPerOp(numOrigins, [&](uint32_t i) {
+    fov.Compute(grid, pOrigins[i].x, pOrigins[i].z, radius);
+    uint32_t seen = 0;
+    for (uint32_t j = 0; j < NUM_ENEMIES; j++)
+    {
+      const BlockPos& enemy = pEnemies[i * NUM_ENEMIES + j];
+      seen += fov.IsVisible(enemy.x, enemy.z) ? 1 : 0;
+    }
+    mj::bench::DoNotOptimize(seen);
+  });
+
+  printf("%-12s %6d %10.0f %10.0f %8.1fx %12.0f %12.0f %8.1fx %7.2f%%\n", name, radius, fovNs, raysNs, raysNs / fovNs,
+         enemyRaysNs, enemyFovNs, enemyRaysNs / enemyFovNs, 100.0 * agree / total);
+
+  free(pOrigins);
+  free(pEnemies);
+  fov.Destroy();
+}
+
+void mj::bench::RunFieldOfView(uint32_t iterations)
+{
+  PrintHeader("Field of view", "map          radius     fov ns    rays ns  speedup  64 rays ns  fov+64 ns"
+                               "  speedup   agree");
+
+  uint32_t numOrigins = iterations < NUM_ORIGINS ? iterations : NUM_ORIGINS;
+
+  mj::Grid e1m1 = LoadE1M1();
+  if (e1m1.IsValid())
+  {
+    Run("E1M1 64x64", e1m1, 16, numOrigins);
+    mj::Grid::Free(e1m1);
+  }
+
+  mj::Grid random = GenerateGrid(512, 512, 0.1f, 1234);
+  Run("random 512", random, 16, numOrigins);
+  Run("random 512", random, 32, numOrigins);
+  mj::Grid::Free(random);
+}
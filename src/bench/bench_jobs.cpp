@@ -0,0 +1,98 @@
+// Job system scaling
+// Runs the same ParallelFor workload with an increasing amount of worker threads.
+#include "bench.h"
+#include "mj_jobs.h"
+
+#include <math.h>
+#include <thread>
+
+static constexpr uint32_t GRAIN_SIZE = 256;
+static constexpr uint32_t NUM_EMPTY  = 2048;
+
+// Some ALU work per item, roughly comparable to meshing a block or casting a short ray
+static float Work(uint32_t i)
+{
+  float x = (float)i * 0.001f;
+  for (uint32_t j = 0; j < 16; j++)
+  {
+    x = x * 0.999f + sqrtf(x + (float)j);
+  }
+  return x;
+}
+
+void mj::bench::RunJobs(uint32_t iterations)
+{
+  uint32_t numCores = std::thread::hardware_concurrency();
+  if (numCores == 0)
+  {
+    numCores = 1;
+  }
+
+  float* pResults = (float*)malloc(iterations * sizeof(float));
+
+  PrintHeader("Job system", "threads   ParallelFor ms  speedup  efficiency   empty jobs/s");
+
+  double baseline = 0.0;
+  for (uint32_t numThreads = 1; numThreads <= numCores; numThreads *= 2)
+  {
+    mj::jobs::Init(numThreads - 1);
+
+    // ParallelFor, best of a few runs
+    double best = 1e300;
+    for (uint32_t run = 0; run < 5; run++)
+    {
+      uint64_t begin = Now();
+      mj::jobs::ParallelFor(iterations, GRAIN_SIZE, [pResults](uint32_t b, uint32_t e) {
+        for (uint32_t i = b; i < e; i++)
+        {
+          pResults[i] = Work(i);
+        }
+      });
+      double ms = (Now() - begin) / 1e6;
+      if (ms < best)
+      {
+        best = ms;
+      }
+    }
+    if (numThreads == 1)
+    {
+      baseline = best;
+    }
+
+    // Scheduling overhead: empty children of a single root
+    uint64_t begin            = Now();
+    static constexpr int RUNS = 16;
+    for (int run = 0; run < RUNS; run++)
+    {
+      mj::jobs::Job* pRoot = mj::jobs::Create(nullptr);
+      for (uint32_t i = 0; i < NUM_EMPTY; i++)
+      {
+        mj::jobs::Run(mj::jobs::CreateChild(pRoot, nullptr));
+      }
+      mj::jobs::Run(pRoot);
+      mj::jobs::Wait(pRoot);
+      mj::jobs::Drain();
+    }
+    double jobsPerSecond = (double)RUNS * (NUM_EMPTY + 1) / ((Now() - begin) / 1e9);
+
+    mj::jobs::Shutdown();
+
+    double speedup = baseline / best;
+    printf("%7u %16.3f %8.2fx %10.0f%% %14.0f\n", numThreads, best, speedup, 100.0 * speedup / numThreads,
+           jobsPerSecond);
+
+    if (numThreads < numCores && numThreads * 2 > numCores)
+    {
+      numThreads = numCores / 2; // Always include the full core count
+    }
+  }
+
+  // Checksum so the work is not optimized away
+  float sum = 0.0f;
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    sum += pResults[i];
+  }
+  DoNotOptimize(sum);
+  free(pResults);
+}
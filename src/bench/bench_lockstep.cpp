@@ -0,0 +1,198 @@
+// Lockstep determinism: the same inputs must give the same state hash on every tick
+// Random-walking players shoot projectiles for a minute of game time while the inputs and hashes are recorded.
+// The recording is then played back from a reset world, once as is and once with a single body nudged by one ulp,
+// which has to be detected on the tick it happens.
+#include "bench.h"
+#include "mj_jobs.h"
+#include "replay.h"
+
+#include <math.h>
+
+static constexpr uint32_t NUM_TICKS        = 3600; // One minute at 60 Hz
+static constexpr float TICK_TIME           = 1.0f / 60.0f;
+static constexpr float PLAYER_RADIUS       = 0.25f;
+static constexpr float PROJECTILE_RADIUS   = 0.05f;
+static constexpr float PROJECTILE_SPEED    = 6.0f; // Times the player speed
+static constexpr float PROJECTILE_LIFETIME = 1.0f;
+
+struct Match
+{
+  World world;
+  mj::Entity* pPlayers;
+  PlayerInput* pInputs;
+  uint32_t numPlayers;
+  mj::bench::Random random; // Spawns and shots, part of the simulation
+};
+
+static void Start(Match& match, const mj::Grid& grid)
+{
+  match.world.Reset();
+  match.random = mj::bench::Random();
+  for (uint32_t i = 0; i < match.numPlayers; i++)
+  {
+    MJ_UNINITIALIZED uint32_t x, z;
+    do
+    {
+      x = match.random.Next() % grid.width;
+      z = match.random.Next() % grid.height;
+    } while (grid.IsSolid(x, z));
+
+    mjm::vec3 position = mjm::vec3((float)x + 0.5f, 0.5f, (float)z + 0.5f);
+    match.pPlayers[i]  = match.world.Spawn(EntityKind::Player, position, PLAYER_RADIUS);
+    match.world.inputs.Data<0>()[match.world.inputs.Add(match.pPlayers[i])] = PlayerInput{ 0, 0 };
+  }
+}
+
+/// <summary>
+/// New buttons and heading every half second
+/// </summary>
+static void GenerateInputs(Match& match, mj::bench::Random& random)
+{
+  if (match.world.tick % 30 == 0)
+  {
+    for (uint32_t i = 0; i < match.numPlayers; i++)
+    {
+      match.pInputs[i].buttons = (uint16_t)(random.Next() & 0xF);
+      match.pInputs[i].yaw     = (uint16_t)random.Next();
+    }
+  }
+}
+
+/// <summary>
+/// The game rules around World::Tick: apply inputs, moving players sometimes shoot along their velocity
+/// </summary>
+static void Tick(Match& match, const mj::Grid& grid)
+{
+  World& world = match.world;
+  for (uint32_t i = 0; i < match.numPlayers; i++)
+  {
+    world.inputs.Data<0>()[world.inputs.Find(match.pPlayers[i])] = match.pInputs[i];
+  }
+
+  world.Tick(grid, TICK_TIME);
+
+  for (uint32_t i = 0; i < match.numPlayers; i++)
+  {
+    uint32_t body      = world.bodies.Find(match.pPlayers[i]);
+    mjm::vec3 velocity = world.bodies.Data<BODY_VELOCITY>()[body];
+    if ((match.random.Next() % 8) != 0 || (velocity.x == 0.0f && velocity.z == 0.0f))
+    {
+      continue;
+    }
+
+    mjm::vec3 position    = world.bodies.Data<BODY_POSITION>()[body];
+    mj::Entity projectile = world.Spawn(EntityKind::Projectile, position, PROJECTILE_RADIUS);
+    if (projectile != mj::NULL_ENTITY)
+    {
+      world.bodies.Data<BODY_VELOCITY>()[world.bodies.Find(projectile)] = velocity * PROJECTILE_SPEED;
+      world.lifetimes.Data<0>()[world.lifetimes.Add(projectile)]         = PROJECTILE_LIFETIME;
+    }
+  }
+}
+
+/// <summary>
+/// Plays a recording back from the start
+/// </summary>
+/// <param name="nudgeTick">Tick before which one body is moved by one ulp, or UINT32_MAX</param>
+/// <returns>First tick whose hash differs from the recording, or UINT32_MAX</returns>
+static uint32_t PlayBack(Match& match, const mj::Grid& grid, Replay& replay, uint32_t nudgeTick)
+{
+  replay.Rewind();
+  Start(match, grid);
+  for (uint32_t tick = 0; tick < replay.GetNumTicks(); tick++)
+  {
+    memcpy(match.pInputs, replay.GetInputs(tick), match.numPlayers * sizeof(PlayerInput));
+    if (tick == nudgeTick)
+    {
+      // Height is passed through by collision, so the difference cannot be snapped away
+      float& y = match.world.bodies.Data<BODY_POSITION>()[0].y;
+      y        = nextafterf(y, 1.0f);
+    }
+    Tick(match, grid);
+    MJ_DISCARD(replay.Verify(tick, match.world.Hash()));
+  }
+  return replay.GetDesyncTick();
+}
+
+static void Run(const char* name, const mj::Grid& grid, uint32_t numPlayers, uint32_t numTicks)
+{
+  Match match;
+  match.numPlayers = numPlayers;
+  match.pPlayers   = (mj::Entity*)malloc(numPlayers * sizeof(mj::Entity));
+  match.pInputs    = (PlayerInput*)malloc(numPlayers * sizeof(PlayerInput));
+  Replay replay;
+  if (!match.pPlayers || !match.pInputs || !match.world.Init() || !replay.Init(numTicks, numPlayers))
+  {
+    match.world.Destroy();
+    free(match.pPlayers);
+    free(match.pInputs);
+    return;
+  }
+
+  // Record
+  Start(match, grid);
+  mj::bench::Random inputRandom;
+  inputRandom.state    = 1234;
+  uint64_t tickNs      = 0;
+  uint64_t hashNs      = 0;
+  uint64_t numEntities = 0;
+  for (uint32_t tick = 0; tick < numTicks; tick++)
+  {
+    GenerateInputs(match, inputRandom);
+
+    uint64_t begin = mj::bench::Now();
+    Tick(match, grid);
+    uint64_t ticked = mj::bench::Now();
+    uint64_t hash   = match.world.Hash();
+    hashNs += mj::bench::Now() - ticked;
+    tickNs += ticked - begin;
+    numEntities += match.world.entities.GetNumAlive();
+    MJ_DISCARD(replay.Record(match.pInputs, hash));
+  }
+
+  uint32_t desync = PlayBack(match, grid, replay, UINT32_MAX);
+  uint32_t nudge  = numTicks / 2;
+  uint32_t detect = PlayBack(match, grid, replay, nudge);
+  double tickUs   = tickNs / 1000.0 / numTicks;
+  double hashUs   = hashNs / 1000.0 / numTicks;
+  char replayText[32];
+  if (desync == UINT32_MAX)
+  {
+    snprintf(replayText, sizeof(replayText), "bit-exact");
+  }
+  else
+  {
+    snprintf(replayText, sizeof(replayText), "DESYNC %u", desync);
+  }
+
+  printf("%-12s %7u %9.0f %9.2f %9.2f %7.1f%% %12s %8u %8s\n", name, numPlayers, (double)numEntities / numTicks, tickUs,
+         hashUs, 100.0 * hashUs / tickUs, replayText, detect, mj::bench::Check(detect == nudge) ? "ok" : "MISSED");
+
+  replay.Destroy();
+  match.world.Destroy();
+  free(match.pPlayers);
+  free(match.pInputs);
+}
+
+void mj::bench::RunLockstep(uint32_t iterations)
+{
+  mj::jobs::Init();
+  PrintHeader("Lockstep",
+              "map          players  entities   tick us   hash us  hash/tick       replay  nudge@t    check");
+
+  uint32_t numTicks = iterations < NUM_TICKS ? iterations : NUM_TICKS;
+
+  mj::Grid e1m1 = LoadE1M1();
+  if (e1m1.IsValid())
+  {
+    Run("E1M1 64x64", e1m1, 32, numTicks);
+    mj::Grid::Free(e1m1);
+  }
+
+  mj::Grid random = GenerateGrid(512, 512, 0.1f, 1234);
+  Run("random 512", random, 256, numTicks);
+  Run("random 512", random, 1024, numTicks);
+  mj::Grid::Free(random);
+
+  mj::jobs::Shutdown();
+}
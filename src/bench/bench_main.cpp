@@ -0,0 +1,177 @@
+// Benchmark runner
+// Usage: bench [suite] [iterations]
+#include "bench.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct Suite
+{
+  const char* name;
+  void (*pRun)(uint32_t iterations);
+};
+
+static const Suite s_Suites[] = {
+  { "math", mj::bench::RunMath }, //
+  { "jobs", mj::bench::RunJobs }, //
+  { "collision", mj::bench::RunCollision }, //
+  { "flowfield", mj::bench::RunFlowField }, //
+  { "pathfinder", mj::bench::RunPathFinder }, //
+  { "hpa", mj::bench::RunClusterGraph }, //
+  { "areas", mj::bench::RunAreas }, //
+  { "fov", mj::bench::RunFieldOfView }, //
+  { "lockstep", mj::bench::RunLockstep }, //
+  { "snapshot", mj::bench::RunSnapshot }, //
+  { "prediction", mj::bench::RunPrediction }, //
+  { "savegame", mj::bench::RunSaveGame }, //
+  { "mips", mj::bench::RunMips }, //
+  { "bc", mj::bench::RunBlockCompression }, //
+  { "pack", mj::bench::RunPack }, //
+  { "residency", mj::bench::RunResidency }, //
+};
+
+static uint32_t s_NumFailed;
+
+bool mj::bench::Check(bool ok)
+{
+  s_NumFailed += ok ? 0 : 1;
+  return ok;
+}
+
+bool mj::bench::LoadE1M1Blocks(block_t* pBlocks)
+{
+  static const char* s_Paths[] = { "assets/E1M1.bin", "../assets/E1M1.bin", "../../assets/E1M1.bin",
+                                  "../../../assets/E1M1.bin" };
+
+  for (const char* pPath : s_Paths)
+  {
+    FILE* pFile = fopen(pPath, "rb");
+    if (pFile)
+    {
+      size_t numRead = fread(pBlocks, sizeof(block_t), E1M1_SIZE * E1M1_SIZE, pFile);
+      fclose(pFile);
+      if (numRead == E1M1_SIZE * E1M1_SIZE)
+      {
+        return true;
+      }
+    }
+  }
+
+  printf("assets/E1M1.bin not found, run the benchmark from the repository root\n");
+  return false;
+}
+
+mj::Grid mj::bench::LoadE1M1()
+{
+  block_t blocks[E1M1_SIZE * E1M1_SIZE];
+  if (LoadE1M1Blocks(blocks))
+  {
+    return mj::Grid::FromBlocks(blocks, E1M1_SIZE, E1M1_SIZE);
+  }
+  return mj::Grid();
+}
+
+mj::Grid mj::bench::GenerateGrid(uint32_t width, uint32_t height, float wallDensity, uint32_t seed)
+{
+  Random random;
+  random.state  = seed ? seed : 1;
+  mj::Grid grid = mj::Grid::Create(width, height);
+  if (grid.IsValid())
+  {
+    for (uint32_t z = 0; z < height; z++)
+    {
+      for (uint32_t x = 0; x < width; x++)
+      {
+        bool border = (x == 0) || (z == 0) || (x == width - 1) || (z == height - 1);
+        grid.SetSolid(x, z, border || random.Range(0.0f, 1.0f) < wallDensity);
+      }
+    }
+  }
+  return grid;
+}
+
+mj::Grid mj::bench::GenerateMaze(uint32_t width, uint32_t height, uint32_t seed)
+{
+  Random random;
+  random.state  = seed ? seed : 1;
+  mj::Grid grid = mj::Grid::Create(width, height);
+  if (!grid.IsValid())
+  {
+    return grid;
+  }
+  memset(grid.pSolid, 1, (size_t)width * height);
+
+  // Iterative recursive backtracker over the odd cells, walls in between
+  uint32_t* pStack       = (uint32_t*)malloc((size_t)width * height * sizeof(uint32_t));
+  uint32_t stackSize     = 0;
+  pStack[stackSize++]    = width + 1;
+  grid.pSolid[width + 1] = 0;
+  while (stackSize > 0)
+  {
+    uint32_t cell = pStack[stackSize - 1];
+    int32_t x     = (int32_t)(cell % width);
+    int32_t z     = (int32_t)(cell / width);
+
+    MJ_UNINITIALIZED uint32_t candidates[4];
+    uint32_t numCandidates = 0;
+    for (uint32_t i = 0; i < 8; i += 2)
+    {
+      int32_t nx = x + 2 * NEIGHBOR_DX[i];
+      int32_t nz = z + 2 * NEIGHBOR_DZ[i];
+      if (nx > 0 && nz > 0 && nx < (int32_t)width - 1 && nz < (int32_t)height - 1 && grid.IsSolid(nx, nz))
+      {
+        candidates[numCandidates++] = i;
+      }
+    }
+
+    if (numCandidates == 0)
+    {
+      stackSize--;
+      continue;
+    }
+
+    uint32_t i = candidates[random.Next() % numCandidates];
+    grid.SetSolid(x + NEIGHBOR_DX[i], z + NEIGHBOR_DZ[i], false);
+    grid.SetSolid(x + 2 * NEIGHBOR_DX[i], z + 2 * NEIGHBOR_DZ[i], false);
+    pStack[stackSize++] = (z + 2 * NEIGHBOR_DZ[i]) * width + (x + 2 * NEIGHBOR_DX[i]);
+  }
+  free(pStack);
+  return grid;
+}
+
+int main(int argc, char** argv)
+{
+  const char* pFilter = (argc > 1) ? argv[1] : "all";
+  uint32_t iterations = (argc > 2) ? (uint32_t)strtoul(argv[2], nullptr, 10) : (1 << 20);
+  if (iterations == 0)
+  {
+    iterations = 1;
+  }
+
+  bool found = false;
+  for (const Suite& suite : s_Suites)
+  {
+    if (!strcmp(pFilter, "all") || !strcmp(pFilter, suite.name))
+    {
+      found = true;
+      suite.pRun(iterations);
+    }
+  }
+
+  if (!found)
+  {
+    printf("Unknown suite \"%s\". Available: all", pFilter);
+    for (const Suite& suite : s_Suites)
+    {
+      printf(", %s", suite.name);
+    }
+    printf("\n");
+    return 1;
+  }
+
+  if (s_NumFailed > 0)
+  {
+    printf("\n%u check(s) failed\n", s_NumFailed);
+    return 1;
+  }
+  return 0;
+}
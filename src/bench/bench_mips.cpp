@@ -0,0 +1,153 @@
+// Mip chains: cost of the box filter with and without SIMD and of the Kaiser filter, per layer
+// Every mip of a layer is built from the one before it, down to 1x1. The SIMD box filter must match the scalar
+// one exactly, and every filter must keep a flat image flat. A second table builds a texture array of 128
+// layers one layer per job, as the asset cooker does, against one layer after another.
+#include "bench.h"
+#include "mj_image.h"
+#include "mj_jobs.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static constexpr uint32_t NUM_LAYERS = 128;
+
+using Downsample = void (*)(const uint8_t* pSrc, uint32_t width, uint32_t height, uint8_t* pDst);
+
+static void Generate(uint8_t* pChain, uint32_t width, uint32_t height, Downsample downsample)
+{
+  uint32_t numMips = mj::mips::GetNumMips(width, height);
+  for (uint32_t mip = 1; mip < numMips; mip++)
+  {
+    uint8_t* pNext = pChain + (size_t)width * height * 4;
+    downsample(pChain, width, height, pNext);
+    pChain = pNext;
+    width  = width > 1 ? width / 2 : 1;
+    height = height > 1 ? height / 2 : 1;
+  }
+}
+
+/// <summary>
+/// Noise over a few large bright and dark patches, so there is detail at every mip
+/// </summary>
+static void Fill(uint8_t* pPixels, uint32_t width, uint32_t height, uint32_t seed)
+{
+  mj::bench::Random random;
+  random.state = seed;
+  for (uint32_t y = 0; y < height; y++)
+  {
+    for (uint32_t x = 0; x < width; x++)
+    {
+      uint32_t base = ((x / 16 + y / 16) & 1) ? 160 : 64;
+      for (uint32_t c = 0; c < 4; c++)
+      {
+        pPixels[(y * width + x) * 4 + c] = (uint8_t)(base + (random.Next() & 63));
+      }
+    }
+  }
+}
+
+/// <returns>True if every texel of every mip has the value of the first texel</returns>
+static bool IsFlat(const uint8_t* pChain, size_t size)
+{
+  for (size_t i = 4; i < size; i++)
+  {
+    if (pChain[i] != pChain[i & 3])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void Run(uint32_t width, uint32_t height, uint32_t iterations)
+{
+  uint32_t numMips = mj::mips::GetNumMips(width, height);
+  size_t size      = mj::mips::GetChainSize(width, height, numMips);
+  uint8_t* pChain  = (uint8_t*)malloc(size);
+  uint8_t* pCheck  = (uint8_t*)malloc(size);
+  if (!pChain || !pCheck)
+  {
+    free(pChain);
+    free(pCheck);
+    return;
+  }
+
+  struct Variant
+  {
+    const char* pName;
+    Downsample downsample;
+  };
+  static const Variant s_Variants[] = {
+    { "box scalar", mj::mips::DownsampleBoxScalar }, //
+    { "box", mj::mips::DownsampleBox },              //
+    { "kaiser", mj::mips::DownsampleKaiser },        //
+  };
+
+  // Scaled so every size takes about as long
+  uint32_t numTexels = width * height;
+  uint32_t numRuns   = (uint32_t)((uint64_t)iterations * 16 / numTexels) + 1;
+  for (const Variant& variant : s_Variants)
+  {
+    Fill(pChain, width, height, 1234);
+    double ns = mj::bench::NsPerOp(numRuns, [&](uint32_t) {
+      Generate(pChain, width, height, variant.downsample);
+      mj::bench::DoNotOptimize(pChain[size - 1]);
+    });
+
+    Fill(pCheck, width, height, 1234);
+    Generate(pCheck, width, height, mj::mips::DownsampleBoxScalar);
+    bool match = (variant.downsample == mj::mips::DownsampleKaiser) || (memcmp(pChain, pCheck, size) == 0);
+
+    memset(pCheck, 0x5A, (size_t)numTexels * 4);
+    Generate(pCheck, width, height, variant.downsample);
+    bool flat = IsFlat(pCheck, size);
+
+    printf("%4ux%-4u  %5u  %-10s %10.2f %10.1f  %6s\n", width, height, numMips, variant.pName, ns / 1000.0,
+           numTexels / ns * 1000.0, mj::bench::Check(match && flat) ? "ok" : "FAILED");
+  }
+
+  free(pChain);
+  free(pCheck);
+}
+
+void mj::bench::RunMips(uint32_t iterations)
+{
+  PrintHeader("Mip chains", "size       mips  filter       chain us  Mtexel/s   check");
+  Run(64, 64, iterations);
+  Run(256, 256, iterations);
+  Run(1024, 1024, iterations);
+  Run(100, 60, iterations);
+
+  mj::jobs::Init();
+  PrintHeader("Texture array, 128 layers of 64x64, kaiser", "threads    serial ms  parallel ms  speedup");
+  uint32_t numMips = mj::mips::GetNumMips(64, 64);
+  size_t layerSize = mj::mips::GetChainSize(64, 64, numMips);
+  uint8_t* pData   = (uint8_t*)malloc(layerSize * NUM_LAYERS);
+  if (pData)
+  {
+    for (uint32_t i = 0; i < NUM_LAYERS; i++)
+    {
+      Fill(pData + i * layerSize, 64, 64, i + 1);
+    }
+
+    uint32_t numRuns = iterations / 16384 + 1;
+    double serialNs  = mj::bench::NsPerOp(numRuns, [&](uint32_t) {
+      for (uint32_t i = 0; i < NUM_LAYERS; i++)
+      {
+        mj::mips::Generate(pData + i * layerSize, 64, 64, numMips, mj::mips::Filter::Kaiser);
+      }
+    });
+    double parallelNs = mj::bench::NsPerOp(numRuns, [&](uint32_t) {
+      mj::jobs::ParallelFor(NUM_LAYERS, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+          mj::mips::Generate(pData + i * layerSize, 64, 64, numMips, mj::mips::Filter::Kaiser);
+        }
+      });
+    });
+    printf("%7u %12.2f %12.2f %8.2f\n", mj::jobs::GetNumThreads(), serialNs / 1e6, parallelNs / 1e6,
+           serialNs / parallelNs);
+    free(pData);
+  }
+  mj::jobs::Shutdown();
+}
@@ -0,0 +1,445 @@
+// mjm vs glm comparison
+// Times every mjm function against its glm counterpart and reports the largest deviation.
+#include "bench.h"
+#include "mj_math.h"
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/euler_angles.hpp>
+
+#include <math.h>
+
+#ifdef MJ_MATH_GLM
+#error "bench_mjm.cpp compares mjm against glm, build it without MJ_MATH_GLM"
+#endif
+
+// Input set size, must be a power of two
+static constexpr uint32_t NUM_INPUTS = 1024;
+static constexpr uint32_t INPUT_MASK = NUM_INPUTS - 1;
+
+// Same values, stored once per library
+static struct
+{
+  float s[NUM_INPUTS];
+  mjm::vec3 v3a[NUM_INPUTS];
+  mjm::vec3 v3b[NUM_INPUTS];
+  mjm::vec4 v4a[NUM_INPUTS];
+  mjm::vec4 v4b[NUM_INPUTS];
+  mjm::quat qa[NUM_INPUTS];
+  mjm::quat qb[NUM_INPUTS];
+  mjm::mat3 m3[NUM_INPUTS];
+  mjm::mat4 m4a[NUM_INPUTS];
+  mjm::mat4 m4b[NUM_INPUTS];
+} s_Mjm;
+
+static struct
+{
+  float s[NUM_INPUTS];
+  glm::vec3 v3a[NUM_INPUTS];
+  glm::vec3 v3b[NUM_INPUTS];
+  glm::vec4 v4a[NUM_INPUTS];
+  glm::vec4 v4b[NUM_INPUTS];
+  glm::quat qa[NUM_INPUTS];
+  glm::quat qb[NUM_INPUTS];
+  glm::mat3 m3[NUM_INPUTS];
+  glm::mat4 m4a[NUM_INPUTS];
+  glm::mat4 m4b[NUM_INPUTS];
+} s_Glm;
+
+static void InitInputs()
+{
+  mj::bench::Random rng;
+  for (uint32_t i = 0; i < NUM_INPUTS; i++)
+  {
+    float s = rng.Range(0.1f, 4.0f);
+
+    float a[3] = { rng.Range(-10.0f, 10.0f), rng.Range(-10.0f, 10.0f), rng.Range(-10.0f, 10.0f) };
+    float b[3] = { rng.Range(-10.0f, 10.0f), rng.Range(-10.0f, 10.0f), rng.Range(-10.0f, 10.0f) };
+    float w[2] = { rng.Range(-10.0f, 10.0f), rng.Range(-10.0f, 10.0f) };
+
+    // Rotations as unit quaternions (w, x, y, z)
+    float q[2][4];
+    for (auto& quat : q)
+    {
+      float len = 0.0f;
+      for (float& c : quat)
+      {
+        c = rng.Range(-1.0f, 1.0f);
+        len += c * c;
+      }
+      len = sqrtf(len);
+      for (float& c : quat)
+      {
+        c /= len;
+      }
+    }
+
+    s_Mjm.s[i]   = s;
+    s_Mjm.v3a[i] = mjm::vec3(a[0], a[1], a[2]);
+    s_Mjm.v3b[i] = mjm::vec3(b[0], b[1], b[2]);
+    s_Mjm.v4a[i] = mjm::vec4(a[0], a[1], a[2], w[0]);
+    s_Mjm.v4b[i] = mjm::vec4(b[0], b[1], b[2], w[1]);
+    s_Mjm.qa[i]  = mjm::quat(q[0][0], q[0][1], q[0][2], q[0][3]);
+    s_Mjm.qb[i]  = mjm::quat(q[1][0], q[1][1], q[1][2], q[1][3]);
+
+    s_Glm.s[i]   = s;
+    s_Glm.v3a[i] = glm::vec3(a[0], a[1], a[2]);
+    s_Glm.v3b[i] = glm::vec3(b[0], b[1], b[2]);
+    s_Glm.v4a[i] = glm::vec4(a[0], a[1], a[2], w[0]);
+    s_Glm.v4b[i] = glm::vec4(b[0], b[1], b[2], w[1]);
+    s_Glm.qa[i]  = glm::quat(q[0][0], q[0][1], q[0][2], q[0][3]);
+    s_Glm.qb[i]  = glm::quat(q[1][0], q[1][1], q[1][2], q[1][3]);
+
+    // Well-conditioned matrices: camera-like view-projection and rotation-translation
+    glm::mat4 proj = glm::perspectiveLH_ZO(glm::radians(60.0f), 1.6f, 0.01f, 100.0f);
+    glm::mat4 rot  = glm::mat4_cast(s_Glm.qa[i]);
+    s_Glm.m3[i]    = glm::mat3_cast(s_Glm.qb[i]);
+    s_Glm.m4a[i]   = proj * glm::translate(rot, s_Glm.v3a[i]);
+    s_Glm.m4b[i]   = glm::translate(glm::mat4_cast(s_Glm.qb[i]), s_Glm.v3b[i]);
+
+    for (int c = 0; c < 3; c++)
+    {
+      for (int r = 0; r < 3; r++)
+      {
+        s_Mjm.m3[i][c][r] = s_Glm.m3[i][c][r];
+      }
+    }
+    for (int c = 0; c < 4; c++)
+    {
+      for (int r = 0; r < 4; r++)
+      {
+        s_Mjm.m4a[i][c][r] = s_Glm.m4a[i][c][r];
+        s_Mjm.m4b[i][c][r] = s_Glm.m4b[i][c][r];
+      }
+    }
+  }
+}
+
+// Flatten results to floats for comparison
+
+static uint32_t Flatten(float f, float* pOut)
+{
+  pOut[0] = f;
+  return 1;
+}
+
+template <typename V3>
+static uint32_t FlattenVec3(const V3& v, float* pOut)
+{
+  pOut[0] = v.x;
+  pOut[1] = v.y;
+  pOut[2] = v.z;
+  return 3;
+}
+
+template <typename V4>
+static uint32_t FlattenVec4(const V4& v, float* pOut)
+{
+  pOut[0] = v.x;
+  pOut[1] = v.y;
+  pOut[2] = v.z;
+  pOut[3] = v.w;
+  return 4;
+}
+
+template <typename M, int N>
+static uint32_t FlattenMat(const M& m, float* pOut)
+{
+  for (int c = 0; c < N; c++)
+  {
+    for (int r = 0; r < N; r++)
+    {
+      pOut[c * N + r] = m[c][r];
+    }
+  }
+  return N * N;
+}
+
+static uint32_t Flatten(const mjm::vec3& v, float* pOut)
+{
+  return FlattenVec3(v, pOut);
+}
+
+static uint32_t Flatten(const glm::vec3& v, float* pOut)
+{
+  return FlattenVec3(v, pOut);
+}
+
+static uint32_t Flatten(const mjm::vec4& v, float* pOut)
+{
+  return FlattenVec4(v, pOut);
+}
+
+static uint32_t Flatten(const glm::vec4& v, float* pOut)
+{
+  return FlattenVec4(v, pOut);
+}
+
+static uint32_t Flatten(const mjm::quat& q, float* pOut)
+{
+  return FlattenVec4(q, pOut);
+}
+
+static uint32_t Flatten(const glm::quat& q, float* pOut)
+{
+  return FlattenVec4(q, pOut);
+}
+
+static uint32_t Flatten(const mjm::mat3& m, float* pOut)
+{
+  return FlattenMat<mjm::mat3, 3>(m, pOut);
+}
+
+static uint32_t Flatten(const glm::mat3& m, float* pOut)
+{
+  return FlattenMat<glm::mat3, 3>(m, pOut);
+}
+
+static uint32_t Flatten(const mjm::mat4& m, float* pOut)
+{
+  return FlattenMat<mjm::mat4, 4>(m, pOut);
+}
+
+static uint32_t Flatten(const glm::mat4& m, float* pOut)
+{
+  return FlattenMat<glm::mat4, 4>(m, pOut);
+}
+
+static uint32_t s_Iterations;
+static uint32_t s_NumMismatches;
+
+/// <summary>
+/// Times both implementations of one function and compares their output over all inputs.
+/// Error is relative for values larger than 1, absolute otherwise.
+/// </summary>
+template <typename FM, typename FG>
+static void Case(const char* name, FM fnMjm, FG fnGlm)
+{
+  double nsMjm = mj::bench::NsPerOp(s_Iterations, [&](uint32_t i) { mj::bench::DoNotOptimize(fnMjm(i & INPUT_MASK)); });
+  double nsGlm = mj::bench::NsPerOp(s_Iterations, [&](uint32_t i) { mj::bench::DoNotOptimize(fnGlm(i & INPUT_MASK)); });
+
+  float maxError = 0.0f;
+  for (uint32_t i = 0; i < NUM_INPUTS; i++)
+  {
+    float a[16];
+    float b[16];
+    uint32_t n = Flatten(fnMjm(i), a);
+    MJ_DISCARD(Flatten(fnGlm(i), b));
+    for (uint32_t j = 0; j < n; j++)
+    {
+      float scale = fabsf(b[j]) > 1.0f ? fabsf(b[j]) : 1.0f;
+      float error = fabsf(a[j] - b[j]) / scale;
+      if (!(error <= maxError)) // Also catches NaN
+      {
+        maxError = error;
+      }
+    }
+  }
+
+  static constexpr float TOLERANCE = 1e-4f;
+  bool ok                          = mj::bench::Check(maxError <= TOLERANCE);
+  if (!ok)
+  {
+    s_NumMismatches++;
+  }
+
+  printf("%-26s %10.2f %10.2f %8.2fx %12.3g%s\n", name, nsMjm, nsGlm, nsGlm / nsMjm, maxError, ok ? "" : " MISMATCH");
+}
+
+void mj::bench::RunMath(uint32_t iterations)
+{
+  s_Iterations    = iterations;
+  s_NumMismatches = 0;
+  InitInputs();
+
+  auto& m = s_Mjm;
+  auto& g = s_Glm;
+
+  PrintHeader("mjm vs glm", "function                   mjm ns/op  glm ns/op  speedup    max error");
+
+  // vec3
+  Case(
+      "-vec3", [&](uint32_t i) { return -m.v3a[i]; }, [&](uint32_t i) { return -g.v3a[i]; });
+  Case(
+      "vec3 + vec3", [&](uint32_t i) { return m.v3a[i] + m.v3b[i]; }, [&](uint32_t i) { return g.v3a[i] + g.v3b[i]; });
+  Case(
+      "vec3 - vec3", [&](uint32_t i) { return m.v3a[i] - m.v3b[i]; }, [&](uint32_t i) { return g.v3a[i] - g.v3b[i]; });
+  Case(
+      "vec3 += vec3",
+      [&](uint32_t i) {
+        mjm::vec3 v = m.v3a[i];
+        v += m.v3b[i];
+        return v;
+      },
+      [&](uint32_t i) {
+        glm::vec3 v = g.v3a[i];
+        v += g.v3b[i];
+        return v;
+      });
+  Case(
+      "vec3 * vec3", [&](uint32_t i) { return m.v3a[i] * m.v3b[i]; }, [&](uint32_t i) { return g.v3a[i] * g.v3b[i]; });
+  Case(
+      "vec3 * float", [&](uint32_t i) { return m.v3a[i] * m.s[i]; }, [&](uint32_t i) { return g.v3a[i] * g.s[i]; });
+  Case(
+      "float * vec3", [&](uint32_t i) { return m.s[i] * m.v3a[i]; }, [&](uint32_t i) { return g.s[i] * g.v3a[i]; });
+  Case(
+      "dot(vec3)", [&](uint32_t i) { return mjm::dot(m.v3a[i], m.v3b[i]); },
+      [&](uint32_t i) { return glm::dot(g.v3a[i], g.v3b[i]); });
+  Case(
+      "cross", [&](uint32_t i) { return mjm::cross(m.v3a[i], m.v3b[i]); },
+      [&](uint32_t i) { return glm::cross(g.v3a[i], g.v3b[i]); });
+  Case(
+      "normalize(vec3)", [&](uint32_t i) { return mjm::normalize(m.v3a[i]); },
+      [&](uint32_t i) { return glm::normalize(g.v3a[i]); });
+  Case(
+      "cos(vec3)", [&](uint32_t i) { return mjm::cos(m.v3a[i]); }, [&](uint32_t i) { return glm::cos(g.v3a[i]); });
+  Case(
+      "sin(vec3)", [&](uint32_t i) { return mjm::sin(m.v3a[i]); }, [&](uint32_t i) { return glm::sin(g.v3a[i]); });
+  Case(
+      "mix(vec3)", [&](uint32_t i) { return mjm::mix(m.v3a[i], m.v3b[i], m.s[i] * 0.25f); },
+      [&](uint32_t i) { return glm::mix(g.v3a[i], g.v3b[i], g.s[i] * 0.25f); });
+
+  // vec4
+  Case(
+      "vec4 + vec4", [&](uint32_t i) { return m.v4a[i] + m.v4b[i]; }, [&](uint32_t i) { return g.v4a[i] + g.v4b[i]; });
+  Case(
+      "vec4 - vec4", [&](uint32_t i) { return m.v4a[i] - m.v4b[i]; }, [&](uint32_t i) { return g.v4a[i] - g.v4b[i]; });
+  Case(
+      "vec4 * vec4", [&](uint32_t i) { return m.v4a[i] * m.v4b[i]; }, [&](uint32_t i) { return g.v4a[i] * g.v4b[i]; });
+  Case(
+      "vec4 * float", [&](uint32_t i) { return m.v4a[i] * m.s[i]; }, [&](uint32_t i) { return g.v4a[i] * g.s[i]; });
+  Case(
+      "float * vec4", [&](uint32_t i) { return m.s[i] * m.v4a[i]; }, [&](uint32_t i) { return g.s[i] * g.v4a[i]; });
+  Case(
+      "vec4 / float", [&](uint32_t i) { return m.v4a[i] / m.s[i]; }, [&](uint32_t i) { return g.v4a[i] / g.s[i]; });
+  Case(
+      "vec4 /= float",
+      [&](uint32_t i) {
+        mjm::vec4 v = m.v4a[i];
+        v /= m.s[i];
+        return v;
+      },
+      [&](uint32_t i) {
+        glm::vec4 v = g.v4a[i];
+        v /= g.s[i];
+        return v;
+      });
+  Case(
+      "dot(vec4)", [&](uint32_t i) { return mjm::dot(m.v4a[i], m.v4b[i]); },
+      [&](uint32_t i) { return glm::dot(g.v4a[i], g.v4b[i]); });
+  Case(
+      "normalize(vec4)", [&](uint32_t i) { return mjm::normalize(m.v4a[i]); },
+      [&](uint32_t i) { return glm::normalize(g.v4a[i]); });
+
+  // Scalar
+  Case(
+      "inversesqrt", [&](uint32_t i) { return mjm::inversesqrt(m.s[i]); },
+      [&](uint32_t i) { return glm::inversesqrt(g.s[i]); });
+  Case(
+      "radians", [&](uint32_t i) { return mjm::radians(m.v3a[i].x); },
+      [&](uint32_t i) { return glm::radians(g.v3a[i].x); });
+  Case(
+      "degrees", [&](uint32_t i) { return mjm::degrees(m.v3a[i].x); },
+      [&](uint32_t i) { return glm::degrees(g.v3a[i].x); });
+
+  // Quaternion
+  Case(
+      "quat(euler)", [&](uint32_t i) { return mjm::quat(m.v3a[i]); }, [&](uint32_t i) { return glm::quat(g.v3a[i]); });
+  Case(
+      "quat(u, v)", [&](uint32_t i) { return mjm::quat(m.v3a[i], m.v3b[i]); },
+      [&](uint32_t i) { return glm::quat(g.v3a[i], g.v3b[i]); });
+  Case(
+      "quat *= quat",
+      [&](uint32_t i) {
+        mjm::quat q = m.qa[i];
+        q *= m.qb[i];
+        return q;
+      },
+      [&](uint32_t i) {
+        glm::quat q = g.qa[i];
+        q *= g.qb[i];
+        return q;
+      });
+  Case(
+      "quat * quat", [&](uint32_t i) { return m.qa[i] * m.qb[i]; }, [&](uint32_t i) { return g.qa[i] * g.qb[i]; });
+  Case(
+      "quat * vec3", [&](uint32_t i) { return m.qa[i] * m.v3a[i]; }, [&](uint32_t i) { return g.qa[i] * g.v3a[i]; });
+  Case(
+      "dot(quat)", [&](uint32_t i) { return mjm::dot(m.qa[i], m.qb[i]); },
+      [&](uint32_t i) { return glm::dot(g.qa[i], g.qb[i]); });
+  Case(
+      "length(quat)", [&](uint32_t i) { return mjm::length(m.qa[i]); },
+      [&](uint32_t i) { return glm::length(g.qa[i]); });
+  Case(
+      "normalize(quat)", [&](uint32_t i) { return mjm::normalize(m.qa[i]); },
+      [&](uint32_t i) { return glm::normalize(g.qa[i]); });
+  Case(
+      "angleAxis", [&](uint32_t i) { return mjm::angleAxis(m.s[i], mjm::normalize(m.v3a[i])); },
+      [&](uint32_t i) { return glm::angleAxis(g.s[i], glm::normalize(g.v3a[i])); });
+  Case(
+      "quatLookAtLH", [&](uint32_t i) { return mjm::quatLookAtLH(mjm::normalize(m.v3a[i]), mjm::vec3(0, 1, 0)); },
+      [&](uint32_t i) { return glm::quatLookAtLH(glm::normalize(g.v3a[i]), glm::vec3(0, 1, 0)); });
+  Case(
+      "quat_cast(mat3)", [&](uint32_t i) { return mjm::quat_cast(m.m3[i]); },
+      [&](uint32_t i) { return glm::quat_cast(g.m3[i]); });
+  Case(
+      "mat3_cast", [&](uint32_t i) { return mjm::mat3_cast(m.qa[i]); },
+      [&](uint32_t i) { return glm::mat3_cast(g.qa[i]); });
+  Case(
+      "mat4_cast", [&](uint32_t i) { return mjm::mat4_cast(m.qa[i]); },
+      [&](uint32_t i) { return glm::mat4_cast(g.qa[i]); });
+
+  // Matrix
+  Case(
+      "mat4 * mat4", [&](uint32_t i) { return m.m4a[i] * m.m4b[i]; }, [&](uint32_t i) { return g.m4a[i] * g.m4b[i]; });
+  Case(
+      "mat4 *= mat4",
+      [&](uint32_t i) {
+        mjm::mat4 r = m.m4a[i];
+        r *= m.m4b[i];
+        return r;
+      },
+      [&](uint32_t i) {
+        glm::mat4 r = g.m4a[i];
+        r *= g.m4b[i];
+        return r;
+      });
+  Case(
+      "mat4 * float", [&](uint32_t i) { return m.m4a[i] * m.s[i]; }, [&](uint32_t i) { return g.m4a[i] * g.s[i]; });
+  Case(
+      "mat4 * vec4", [&](uint32_t i) { return m.m4a[i] * m.v4a[i]; }, [&](uint32_t i) { return g.m4a[i] * g.v4a[i]; });
+  Case(
+      "identity<mat4>", [&](uint32_t) { return mjm::identity<mjm::mat4>(); },
+      [&](uint32_t) { return glm::identity<glm::mat4>(); });
+  Case(
+      "inverse(mat4)", [&](uint32_t i) { return mjm::inverse(m.m4a[i]); },
+      [&](uint32_t i) { return glm::inverse(g.m4a[i]); });
+  Case(
+      "transpose(mat4)", [&](uint32_t i) { return mjm::transpose(m.m4a[i]); },
+      [&](uint32_t i) { return glm::transpose(g.m4a[i]); });
+  Case(
+      "translate", [&](uint32_t i) { return mjm::translate(m.m4b[i], m.v3a[i]); },
+      [&](uint32_t i) { return glm::translate(g.m4b[i], g.v3a[i]); });
+  Case(
+      "eulerAngleY", [&](uint32_t i) { return mjm::eulerAngleY(m.v3a[i].y); },
+      [&](uint32_t i) { return glm::eulerAngleY(g.v3a[i].y); });
+  Case(
+      "perspectiveLH_ZO", [&](uint32_t i) { return mjm::perspectiveLH_ZO(m.s[i] * 0.5f, 1.6f, 0.01f, 100.0f); },
+      [&](uint32_t i) { return glm::perspectiveLH_ZO(g.s[i] * 0.5f, 1.6f, 0.01f, 100.0f); });
+  Case(
+      "unProjectZO",
+      [&](uint32_t i) {
+        return mjm::unProjectZO(mjm::vec3(800.0f, 500.0f, 0.5f), m.m4b[i], m.m4a[i],
+                                mjm::vec4(0.0f, 0.0f, 1600.0f, 1000.0f));
+      },
+      [&](uint32_t i) {
+        return glm::unProjectZO(glm::vec3(800.0f, 500.0f, 0.5f), g.m4b[i], g.m4a[i],
+                                glm::vec4(0.0f, 0.0f, 1600.0f, 1000.0f));
+      });
+
+  printf("%u function(s) outside tolerance\n", s_NumMismatches);
+}
@@ -0,0 +1,213 @@
+// Asset packs: loading a set of assets from loose files against loading them from one memory-mapped pack
+// Half of the assets look like levels (runs of a few block values, which compress well), half like
+// block-compressed textures (noise, which does not). Each way loads every asset and hashes its bytes, as
+// a consumer would read them, so the hashes must match. Loose files are opened, read and freed one by
+// one; the pack is opened once and its stored entries are used in place. Files are in the page cache, so
+// this measures the per-file overhead and the copies, not the disk.
+#include "bench.h"
+#include "mj_hash.h"
+#include "mj_pack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static constexpr uint32_t NUM_ASSETS              = 64;
+static constexpr const char* STORED_PACK_PATH     = "bench_pack_stored.mjp";
+static constexpr const char* COMPRESSED_PACK_PATH = "bench_pack.mjp";
+
+static void GetName(uint32_t i, char (&name)[32])
+{
+  snprintf(name, sizeof(name), "bench_pack_%02u.bin", i);
+}
+
+static size_t GetSize(uint32_t i)
+{
+  // 4 KB to 256 KB
+  return (size_t)4096 << (i % 7);
+}
+
+static void Fill(uint8_t* pData, size_t size, uint32_t i)
+{
+  mj::bench::Random random;
+  random.state = i + 1;
+  for (size_t j = 0; j < size; j++)
+  {
+    // Levels change block every few bytes, textures every byte
+    pData[j] = (i & 1) ? (uint8_t)random.Next() : (uint8_t)((j / 24 + (j / 2048) * 7) % 5);
+  }
+}
+
+static uint64_t LoadLoose(uint32_t* pNumFailed)
+{
+  uint64_t hash = 0;
+  for (uint32_t i = 0; i < NUM_ASSETS; i++)
+  {
+    char name[32];
+    GetName(i, name);
+    FILE* pFile = fopen(name, "rb");
+    if (!pFile)
+    {
+      (*pNumFailed)++;
+      continue;
+    }
+    size_t size   = GetSize(i);
+    void* pData   = malloc(size);
+    bool complete = pData && (fread(pData, 1, size, pFile) == size);
+    fclose(pFile);
+    hash ^= complete ? mj::Hash64(pData, size, i) : 0;
+    *pNumFailed += complete ? 0 : 1;
+    free(pData);
+  }
+  return hash;
+}
+
+static uint64_t LoadPack(const char* pPath, uint32_t* pNumFailed)
+{
+  mj::pack::Pack pack;
+  if (!pack.Open(pPath))
+  {
+    *pNumFailed += NUM_ASSETS;
+    return 0;
+  }
+  uint64_t hash = 0;
+  for (uint32_t i = 0; i < NUM_ASSETS; i++)
+  {
+    char name[32];
+    GetName(i, name);
+    const mj::pack::Entry* pEntry = pack.Find(name);
+    if (!pEntry)
+    {
+      (*pNumFailed)++;
+    }
+    else if (pEntry->flags & mj::pack::ENTRY_LZ)
+    {
+      void* pData   = malloc(pEntry->rawSize);
+      bool complete = pData && pack.Read(pEntry, pData);
+      hash ^= complete ? mj::Hash64(pData, pEntry->rawSize, i) : 0;
+      *pNumFailed += complete ? 0 : 1;
+      free(pData);
+    }
+    else
+    {
+      hash ^= mj::Hash64(pack.GetData(pEntry), pEntry->size, i);
+    }
+  }
+  return hash;
+}
+
+/// <returns>False if a file could not be written</returns>
+static bool WriteAssets(uint8_t** ppData)
+{
+  mj::pack::Input stored[NUM_ASSETS];
+  mj::pack::Input compressed[NUM_ASSETS];
+  char names[NUM_ASSETS][32];
+  bool success = true;
+  for (uint32_t i = 0; i < NUM_ASSETS; i++)
+  {
+    GetName(i, names[i]);
+    FILE* pFile = fopen(names[i], "wb");
+    success     = success && pFile && (fwrite(ppData[i], 1, GetSize(i), pFile) == GetSize(i));
+    if (pFile)
+    {
+      fclose(pFile);
+    }
+    success = mj::pack::Prepare(names[i], ppData[i], GetSize(i), false, &stored[i]) && success;
+    success = mj::pack::Prepare(names[i], ppData[i], GetSize(i), true, &compressed[i]) && success;
+  }
+
+  const char* pCollision = nullptr;
+  success                = success && mj::pack::Write(STORED_PACK_PATH, stored, NUM_ASSETS, &pCollision);
+  success                = success && mj::pack::Write(COMPRESSED_PACK_PATH, compressed, NUM_ASSETS, &pCollision);
+  for (uint32_t i = 0; i < NUM_ASSETS; i++)
+  {
+    mj::pack::FreeInput(&compressed[i]);
+  }
+  return success;
+}
+
+static void RemoveAssets()
+{
+  for (uint32_t i = 0; i < NUM_ASSETS; i++)
+  {
+    char name[32];
+    GetName(i, name);
+    MJ_DISCARD(remove(name));
+  }
+  MJ_DISCARD(remove(STORED_PACK_PATH));
+  MJ_DISCARD(remove(COMPRESSED_PACK_PATH));
+}
+
+void mj::bench::RunPack(uint32_t iterations)
+{
+  PrintHeader("Asset packs, 64 assets of 4 KB to 256 KB", "source           load ms      MB/s  files  check");
+
+  uint8_t* pData[NUM_ASSETS] = {};
+  size_t totalSize           = 0;
+  uint64_t expected          = 0;
+  bool allocated             = true;
+  for (uint32_t i = 0; i < NUM_ASSETS; i++)
+  {
+    pData[i] = (uint8_t*)malloc(GetSize(i));
+    if (!pData[i])
+    {
+      allocated = false;
+      continue;
+    }
+    Fill(pData[i], GetSize(i), i);
+    expected ^= mj::Hash64(pData[i], GetSize(i), i);
+    totalSize += GetSize(i);
+  }
+
+  if (allocated && WriteAssets(pData))
+  {
+    struct Variant
+    {
+      const char* pName;
+      uint32_t numFiles;
+      const char* pPackPath; // nullptr for loose files
+    };
+    static const Variant s_Variants[] = {
+      { "loose files", NUM_ASSETS, nullptr },          //
+      { "pack, stored", 1, STORED_PACK_PATH },         //
+      { "pack, compressed", 1, COMPRESSED_PACK_PATH }, //
+    };
+
+    uint32_t numRuns = iterations / (1 << 16) + 1;
+    for (const Variant& variant : s_Variants)
+    {
+      uint32_t numFailed = 0;
+      uint64_t hash      = 0;
+      double ns          = mj::bench::NsPerOp(numRuns, [&](uint32_t) {
+        hash = variant.pPackPath ? LoadPack(variant.pPackPath, &numFailed) : LoadLoose(&numFailed);
+      });
+      bool ok = (numFailed == 0) && (hash == expected);
+      printf("%-16s %8.3f %9.0f %6u  %6s\n", variant.pName, ns / 1e6, totalSize / ns * 1000.0, variant.numFiles,
+             mj::bench::Check(ok) ? "ok" : "FAILED");
+    }
+
+    mj::pack::Pack pack;
+    if (pack.Open(COMPRESSED_PACK_PATH))
+    {
+      char names[NUM_ASSETS][32];
+      for (uint32_t i = 0; i < NUM_ASSETS; i++)
+      {
+        GetName(i, names[i]);
+      }
+      double ns = mj::bench::NsPerOp(iterations, [&](uint32_t i) {
+        mj::bench::DoNotOptimize(pack.Find(names[i % NUM_ASSETS]));
+      });
+      printf("Lookup by name: %.1f ns, pack of %.1f KB (%.1f KB of assets)\n", ns, pack.GetFileSize() / 1024.0,
+             totalSize / 1024.0);
+    }
+  }
+  else
+  {
+    printf("Could not write the assets\n");
+  }
+
+  RemoveAssets();
+  for (uint8_t* p : pData)
+  {
+    free(p);
+  }
+}
@@ -0,0 +1,161 @@
+// Point-to-point path queries: Jump Point Search against plain A*
+// Both methods must find paths of the same cost, and every path is walked to check it is legal.
+#include "bench.h"
+#include "mj_pathfinder.h"
+
+static mj::bench::Random s_Random;
+
+struct Query
+{
+  BlockPos start;
+  BlockPos goal;
+};
+
+static BlockPos FindFreeCell(const mj::Grid& grid)
+{
+  BlockPos position;
+  do
+  {
+    position.x = (int32_t)(s_Random.Next() % grid.width);
+    position.z = (int32_t)(s_Random.Next() % grid.height);
+  } while (grid.IsSolid(position.x, position.z));
+  return position;
+}
+
+/// <summary>
+/// Steps along every segment of the path and sums its cost
+/// </summary>
+/// <returns>False if a segment is not a straight or diagonal line of legal steps</returns>
+static bool Walk(const mj::Grid& grid, const BlockPos* pPath, uint32_t length, uint32_t* pCost)
+{
+  uint32_t cost = 0;
+  for (uint32_t i = 1; i < length; i++)
+  {
+    int32_t dx = pPath[i].x - pPath[i - 1].x;
+    int32_t dz = pPath[i].z - pPath[i - 1].z;
+    if (dx != 0 && dz != 0 && abs(dx) != abs(dz))
+    {
+      return false;
+    }
+
+    int32_t stepX      = (dx > 0) - (dx < 0);
+    int32_t stepZ      = (dz > 0) - (dz < 0);
+    uint32_t direction = 0;
+    while (direction < 8 && (mj::NEIGHBOR_DX[direction] != stepX || mj::NEIGHBOR_DZ[direction] != stepZ))
+    {
+      direction++;
+    }
+    if (direction == 8)
+    {
+      return false;
+    }
+
+    int32_t x = pPath[i - 1].x;
+    int32_t z = pPath[i - 1].z;
+    while (x != pPath[i].x || z != pPath[i].z)
+    {
+      if (!(grid.GetStepMask(x, z) & (1 << direction)))
+      {
+        return false;
+      }
+      x += stepX;
+      z += stepZ;
+      cost += (direction & 1) ? mj::PathFinder::DIAGONAL_COST : mj::PathFinder::ORTHOGONAL_COST;
+    }
+  }
+  *pCost = cost;
+  return true;
+}
+
+static constexpr mj::PathFinder::Method s_Methods[2] = { mj::PathFinder::Method::AStar,
+                                                         mj::PathFinder::Method::JumpPoint };
+
+static void Run(const char* name, const mj::Grid& grid, uint32_t numQueries)
+{
+  mj::PathFinder finder;
+  if (!finder.Init(grid.width, grid.height))
+  {
+    return;
+  }
+
+  Query* pQueries = (Query*)malloc(numQueries * sizeof(Query));
+  for (uint32_t i = 0; i < numQueries; i++)
+  {
+    pQueries[i].start = FindFreeCell(grid);
+    pQueries[i].goal  = FindFreeCell(grid);
+  }
+
+  // Correctness pass
+  uint32_t* pCosts     = (uint32_t*)malloc(numQueries * sizeof(uint32_t));
+  bool match           = true;
+  uint64_t expanded[2] = {};
+  for (uint32_t m = 0; m < 2; m++)
+  {
+    for (uint32_t i = 0; i < numQueries; i++)
+    {
+      bool found = finder.FindPath(grid, pQueries[i].start, pQueries[i].goal, s_Methods[m]);
+      expanded[m] += finder.GetNumExpanded();
+
+      uint32_t cost = found ? finder.GetCost() : UINT32_MAX;
+      MJ_UNINITIALIZED uint32_t walked;
+      if (found && (!Walk(grid, finder.GetPath(), finder.GetPathLength(), &walked) || walked != cost))
+      {
+        match = false;
+      }
+      if (m == 0)
+      {
+        pCosts[i] = cost;
+      }
+      else if (pCosts[i] != cost)
+      {
+        match = false;
+      }
+    }
+  }
+
+  // Timing pass
+  double queriesPerSecond[2];
+  for (uint32_t m = 0; m < 2; m++)
+  {
+    double ns = mj::bench::NsPerOp(numQueries, [&](uint32_t i) {
+      mj::bench::DoNotOptimize(finder.FindPath(grid, pQueries[i].start, pQueries[i].goal, s_Methods[m]));
+    });
+    queriesPerSecond[m] = 1e9 / ns;
+  }
+
+  printf("%-12s %12.0f %12.0f %10.2fx %10.0f %10.0f %8s\n", name, queriesPerSecond[0], queriesPerSecond[1],
+         queriesPerSecond[1] / queriesPerSecond[0], (double)expanded[0] / numQueries,
+         (double)expanded[1] / numQueries, mj::bench::Check(match) ? "ok" : "MISMATCH");
+
+  free(pCosts);
+  free(pQueries);
+  finder.Destroy();
+}
+
+void mj::bench::RunPathFinder(uint32_t iterations)
+{
+  PrintHeader("Path finder",
+              "map            A* query/s  JPS query/s    speedup  A* expand  JPS expand    check");
+
+  // Queries are much more expensive than the other benchmarks' operations
+  auto clamp = [&](uint32_t maxQueries) { return iterations < maxQueries ? iterations : maxQueries; };
+
+  mj::Grid e1m1 = LoadE1M1();
+  if (e1m1.IsValid())
+  {
+    Run("E1M1 64x64", e1m1, clamp(4096));
+    mj::Grid::Free(e1m1);
+  }
+
+  mj::Grid maze = GenerateMaze(127, 127, 1234);
+  Run("maze 127", maze, clamp(1024));
+  mj::Grid::Free(maze);
+
+  maze = GenerateMaze(511, 511, 1234);
+  Run("maze 511", maze, clamp(128));
+  mj::Grid::Free(maze);
+
+  mj::Grid random = GenerateGrid(512, 512, 0.25f, 1234);
+  Run("random 512", random, clamp(128));
+  mj::Grid::Free(random);
+}
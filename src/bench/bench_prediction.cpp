@@ -0,0 +1,170 @@
+// Client-side prediction against a server at increasing ping
+// One client predicts its player and reconciles with snapshots, with packets held back by half the ping in
+// each direction and optionally lost. Without loss every prediction should be confirmed, with loss the
+// corrections are counted and timed, and the largest jump of the rendered position is compared with and
+// without smoothing (a player moves 0.05 cells per tick).
+#include "bench.h"
+#include "prediction.h"
+#include "server.h"
+
+#include <math.h>
+
+static constexpr uint32_t NUM_TICKS      = 1800; // Thirty seconds at 60 Hz
+static constexpr uint32_t QUEUE_CAPACITY = 256;  // Packets in flight, more than the highest ping in ticks
+
+struct Result
+{
+  double corrections; // Per second
+  double stale;       // Per second
+  double replayed;    // Inputs per correction
+  uint32_t maxReplayed;
+  double reconcileNs; // Per snapshot
+  double maxReconcileNs;
+  float maxError;        // Cells
+  float maxJumpRaw;      // Cells per tick
+  float maxJumpSmoothed; // Cells per tick
+};
+
+static float Distance(const mjm::vec3& a, const mjm::vec3& b)
+{
+  mjm::vec3 d = a - b;
+  return sqrtf(mjm::dot(d, d));
+}
+
+static Result Run(const mj::Grid& grid, uint32_t pingMs, uint32_t lossPercent, uint32_t numTicks)
+{
+  Result result = {};
+  Server server;
+  mj::net::Loopback connection;
+  mj::net::DelayQueue toServer;
+  mj::net::DelayQueue toClient;
+  SnapshotHistory snapshots;
+  Prediction prediction;
+  if (!server.Init(grid) || !connection.Init(QUEUE_CAPACITY) || !toServer.Init(QUEUE_CAPACITY) ||
+      !toClient.Init(QUEUE_CAPACITY) || !snapshots.Init())
+  {
+    server.Destroy();
+    connection.Destroy();
+    toServer.Destroy();
+    toClient.Destroy();
+    return result;
+  }
+
+  uint32_t client = server.Connect(&connection);
+  prediction.Reset(Server::PLAYER_RADIUS);
+
+  const float dt    = 1.0f / Server::TICK_RATE;
+  uint32_t delay    = (uint32_t)(pingMs * Server::TICK_RATE / 2000.0f + 0.5f); // Ticks, one way
+  uint32_t ackTick  = NO_SNAPSHOT;
+  PlayerInput input = { 0, 0 };
+  mj::bench::Random inputRandom;
+  mj::bench::Random lossRandom;
+  mjm::vec3 lastRaw      = mjm::vec3::zero();
+  mjm::vec3 lastSmoothed = mjm::vec3::zero();
+  uint64_t numReconciles = 0;
+  uint64_t reconcileNs   = 0;
+  uint8_t packet[mj::net::MAX_PACKET_SIZE];
+  for (uint32_t tick = 0; tick < numTicks; tick++)
+  {
+    // New buttons and heading every few ticks, so that lost inputs are noticed
+    if (tick % 8 == 0)
+    {
+      input.buttons = (uint16_t)(inputRandom.Next() & 0xF);
+      input.yaw     = (uint16_t)inputRandom.Next();
+    }
+
+    InputMessage message;
+    message.sequence = prediction.Predict(grid, input, dt);
+    message.ackTick  = ackTick;
+    message.input    = input;
+    if (lossRandom.Next() % 100 >= lossPercent)
+    {
+      MJ_DISCARD(toServer.Push(packet, WriteMessage(message, packet, sizeof(packet)), tick + delay));
+    }
+
+    uint32_t size;
+    while ((size = toServer.Pop(tick, packet)) > 0)
+    {
+      MJ_DISCARD(connection.toServer.Send(packet, size));
+    }
+    server.Tick();
+    while ((size = connection.toClient.Receive(packet)) > 0)
+    {
+      if (lossRandom.Next() % 100 >= lossPercent)
+      {
+        MJ_DISCARD(toClient.Push(packet, size, tick + delay));
+      }
+    }
+
+    while ((size = toClient.Pop(tick, packet)) > 0)
+    {
+      MJ_UNINITIALIZED SnapshotMessage snapshot;
+      if (ReadMessage(packet, size, snapshots, &snapshot))
+      {
+        ackTick        = snapshot.tick;
+        uint64_t begin = mj::bench::Now();
+        prediction.Reconcile(grid, snapshot.lastSequence, snapshot.position, dt);
+        uint64_t ns = mj::bench::Now() - begin;
+        reconcileNs += ns;
+        numReconciles++;
+        result.maxReconcileNs = (double)ns > result.maxReconcileNs ? (double)ns : result.maxReconcileNs;
+      }
+    }
+
+    // Skip the jump to the first known position
+    mjm::vec3 raw      = prediction.GetPosition();
+    mjm::vec3 smoothed = prediction.GetSmoothedPosition();
+    if (prediction.GetStats().numReconciles > 1)
+    {
+      float jumpRaw          = Distance(raw, lastRaw);
+      float jumpSmoothed     = Distance(smoothed, lastSmoothed);
+      result.maxJumpRaw      = jumpRaw > result.maxJumpRaw ? jumpRaw : result.maxJumpRaw;
+      result.maxJumpSmoothed = jumpSmoothed > result.maxJumpSmoothed ? jumpSmoothed : result.maxJumpSmoothed;
+    }
+    lastRaw      = raw;
+    lastSmoothed = smoothed;
+  }
+
+  const Prediction::Stats& stats = prediction.GetStats();
+  double seconds                 = numTicks / Server::TICK_RATE;
+  result.corrections             = stats.numCorrections / seconds;
+  result.stale                   = stats.numStale / seconds;
+  result.replayed                = stats.numCorrections ? (double)stats.numReplayed / stats.numCorrections : 0.0;
+  result.maxReplayed             = stats.maxReplayed;
+  result.reconcileNs             = numReconciles ? (double)reconcileNs / numReconciles : 0.0;
+  result.maxError                = stats.maxError;
+
+  server.Disconnect(client);
+  server.Destroy();
+  connection.Destroy();
+  toServer.Destroy();
+  toClient.Destroy();
+  snapshots.Destroy();
+  return result;
+}
+
+void mj::bench::RunPrediction(uint32_t iterations)
+{
+  uint32_t numTicks = iterations < NUM_TICKS ? iterations : NUM_TICKS;
+  mj::Grid e1m1     = LoadE1M1();
+  mj::Grid open     = GenerateGrid(256, 256, 0.1f, 1234);
+
+  PrintHeader("Prediction",
+              "map        ping ms loss corrections/s stale/s replayed max reconcile us max us max error  "
+              "jump raw jump smoothed");
+  for (uint32_t lossPercent : { 0, 5 })
+  {
+    for (uint32_t pingMs : { 0, 50, 100, 250, 500, 1000, 2000 })
+    {
+      const char* pName    = e1m1.IsValid() ? "E1M1 64x64" : "random 256";
+      const mj::Grid& grid = e1m1.IsValid() ? e1m1 : open;
+      Result r             = Run(grid, pingMs, lossPercent, numTicks);
+      printf("%-10s %7u %3u%% %13.1f %7.1f %8.1f %3u %12.3f %6.2f %9.3f %9.3f %13.3f\n", pName, pingMs, lossPercent,
+             r.corrections, r.stale, r.replayed, r.maxReplayed, r.reconcileNs / 1000.0, r.maxReconcileNs / 1000.0,
+             r.maxError, r.maxJumpRaw, r.maxJumpSmoothed);
+    }
+  }
+
+  mj::Grid::Free(e1m1);
+  mj::Grid::Free(open);
+}
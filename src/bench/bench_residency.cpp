@@ -0,0 +1,169 @@
+// Texture residency: an LRU cache of texture array layers at budgets from 8 slots to every layer
+// Four levels are played one after another, twice, each for 600 frames (10 s at 60 Hz). Every frame
+// references the layers of all 16 chunks of the level, as the game does, and uploads up to 4 missing layers.
+// The levels are E1M1 and three copies with other wall textures, so they share the floor and ceiling and
+// little else. Misses are counted once per layer per frame; a fallback frame draws at least one layer with
+// the fallback layer. Frame time is the cost of the references and the bookkeeping, not of the uploads.
+#include "bench.h"
+#include "mj_residency.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static constexpr uint32_t NUM_LEVELS        = 4;
+static constexpr uint32_t NUM_CYCLES        = 2;
+static constexpr uint32_t FRAMES_PER_LEVEL  = 600;
+static constexpr uint32_t NUM_LAYERS        = 240;
+static constexpr uint32_t CHUNK_SIZE        = 16;
+static constexpr uint32_t NUM_CHUNKS_X      = mj::bench::E1M1_SIZE / CHUNK_SIZE;
+static constexpr uint32_t NUM_CHUNKS        = NUM_CHUNKS_X * NUM_CHUNKS_X;
+static constexpr uint32_t UPLOADS_PER_FRAME = 4;
+static constexpr uint32_t FLOOR_LAYER       = 136;
+static constexpr uint32_t CEILING_LAYER     = 138;
+
+struct BenchLevel
+{
+  mj::LayerSet chunks[NUM_CHUNKS];
+  mj::LayerSet all;
+};
+
+/// <summary>
+/// Layers of the chunks, like the level loader: walls of solid cells that face open cells, and the floor
+/// and ceiling of open cells
+/// </summary>
+static void GetChunkLayers(const block_t* pBlocks, BenchLevel* pLevel)
+{
+  static const int32_t s_Neighbors[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+
+  const int32_t size = (int32_t)mj::bench::E1M1_SIZE;
+  *pLevel            = {};
+  for (int32_t z = 0; z < size; z++)
+  {
+    for (int32_t x = 0; x < size; x++)
+    {
+      mj::LayerSet& layers = pLevel->chunks[(z / CHUNK_SIZE) * NUM_CHUNKS_X + x / CHUNK_SIZE];
+      block_t block        = pBlocks[z * size + x];
+      if (!IsSolidBlock(block))
+      {
+        layers.Add(FLOOR_LAYER);
+        layers.Add(CEILING_LAYER);
+        continue;
+      }
+      for (const int32_t* pNeighbor : s_Neighbors)
+      {
+        int32_t nx = x + pNeighbor[0];
+        int32_t nz = z + pNeighbor[1];
+        if (block > 0 && nx >= 0 && nz >= 0 && nx < size && nz < size && !IsSolidBlock(pBlocks[nz * size + nx]))
+        {
+          layers.Add(2 * block - 1);
+        }
+      }
+    }
+  }
+  for (const mj::LayerSet& layers : pLevel->chunks)
+  {
+    for (uint32_t i = 0; i < MJ_COUNTOF(layers.bits); i++)
+    {
+      pLevel->all.bits[i] |= layers.bits[i];
+    }
+  }
+}
+
+static uint32_t CountLayers(const mj::LayerSet& layers)
+{
+  uint32_t count = 0;
+  for (uint32_t layer = 0; layer < mj::LayerSet::MAX_LAYERS; layer++)
+  {
+    count += (layers.bits[layer / 64] >> (layer % 64)) & 1;
+  }
+  return count;
+}
+
+/// <summary>
+/// One frame as Graphics::StreamLayers() does it
+/// </summary>
+static void Frame(mj::LayerCache& cache, const BenchLevel& level)
+{
+  cache.NewFrame();
+  for (const mj::LayerSet& layers : level.chunks)
+  {
+    cache.Reference(layers);
+  }
+  MJ_UNINITIALIZED uint32_t requests[UPLOADS_PER_FRAME];
+  uint32_t numRequests = cache.TakeRequests(requests, UPLOADS_PER_FRAME);
+  for (uint32_t i = 0; i < numRequests; i++)
+  {
+    MJ_DISCARD(cache.Insert(requests[i]));
+  }
+}
+
+static bool UsesFallback(const mj::LayerCache& cache, const mj::LayerSet& layers)
+{
+  for (uint32_t layer = 0; layer < mj::LayerSet::MAX_LAYERS; layer++)
+  {
+    bool referenced = (layers.bits[layer / 64] >> (layer % 64)) & 1;
+    if (referenced && cache.GetSlots()[layer] == mj::LayerCache::FALLBACK_SLOT)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void mj::bench::RunResidency(uint32_t iterations)
+{
+  MJ_UNINITIALIZED block_t blocks[E1M1_SIZE * E1M1_SIZE];
+  if (!LoadE1M1Blocks(blocks))
+  {
+    printf("\n== Texture residency ==\nassets/E1M1.bin not found, skipped\n");
+    return;
+  }
+
+  static BenchLevel s_Levels[NUM_LEVELS];
+  uint32_t numLevelLayers = 0;
+  for (uint32_t i = 0; i < NUM_LEVELS; i++)
+  {
+    // Other wall textures, each still a solid block
+    MJ_UNINITIALIZED block_t variant[E1M1_SIZE * E1M1_SIZE];
+    for (uint32_t cell = 0; cell < E1M1_SIZE * E1M1_SIZE; cell++)
+    {
+      block_t block = blocks[cell];
+      variant[cell] = (IsSolidBlock(block) && block > 0) ? (block_t)((block - 1 + i * 17) % 0x0069 + 1) : block;
+    }
+    GetChunkLayers(variant, &s_Levels[i]);
+    numLevelLayers = CountLayers(s_Levels[i].all) > numLevelLayers ? CountLayers(s_Levels[i].all) : numLevelLayers;
+  }
+
+  char title[96];
+  snprintf(title, sizeof(title), "Texture residency, %u levels of up to %u layers, %u layers in the file", NUM_LEVELS,
+           numLevelLayers, NUM_LAYERS);
+  PrintHeader(title, "slots  hit rate    misses  uploads  evictions  fallback frames  frame ns");
+
+  static const uint32_t s_Budgets[] = { 8, 16, 32, 64, NUM_LAYERS };
+  for (uint32_t numSlots : s_Budgets)
+  {
+    static mj::LayerCache s_Cache;
+    MJ_DISCARD(s_Cache.Init(NUM_LAYERS, numSlots + 1));
+
+    uint32_t numFallbackFrames = 0;
+    for (uint32_t cycle = 0; cycle < NUM_CYCLES; cycle++)
+    {
+      for (const BenchLevel& level : s_Levels)
+      {
+        for (uint32_t frame = 0; frame < FRAMES_PER_LEVEL; frame++)
+        {
+          Frame(s_Cache, level);
+          numFallbackFrames += UsesFallback(s_Cache, level.all) ? 1 : 0;
+        }
+      }
+    }
+    mj::LayerCache::Stats stats = s_Cache.GetStats();
+    uint64_t numReferences      = stats.numHits + stats.numMisses;
+
+    // Steady state: the last level stays loaded
+    double ns = mj::bench::NsPerOp(iterations / 64 + 1, [&](uint32_t) { Frame(s_Cache, s_Levels[NUM_LEVELS - 1]); });
+    printf("%5u  %7.2f%%  %8llu  %7llu  %9llu  %15u  %8.0f\n", numSlots, 100.0 * stats.numHits / numReferences,
+           (unsigned long long)stats.numMisses, (unsigned long long)stats.numInserted,
+           (unsigned long long)stats.numEvicted, numFallbackFrames, ns);
+  }
+}
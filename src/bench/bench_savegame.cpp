@@ -0,0 +1,147 @@
+// Save games: time on the calling thread to capture the state, and what the writer thread does with it
+// Worlds of increasing size are saved with and without compression. Capture is what the game pays per save,
+// the write (hash, compression and file I/O) runs on the writer thread. The save is loaded into a second
+// world, which must hash the same as the original.
+#include "bench.h"
+#include "mj_jobs.h"
+#include "savegame.h"
+
+#include <stdio.h>
+#include <thread>
+
+static constexpr const char* SAVE_PATH = "bench_save.mjs";
+static constexpr uint32_t NUM_TICKS    = 30;
+static constexpr uint32_t MAX_SAVES    = 20;
+
+/// <summary>
+/// Players with inputs and projectiles with lifetimes, a few ticks in, with some slots recycled
+/// </summary>
+static void Populate(World& world, const mj::Grid& grid, uint32_t numEntities)
+{
+  mj::bench::Random random;
+  world.Reset();
+  for (uint32_t i = 0; i < numEntities; i++)
+  {
+    MJ_UNINITIALIZED uint32_t x, z;
+    do
+    {
+      x = random.Next() % grid.width;
+      z = random.Next() % grid.height;
+    } while (grid.IsSolid(x, z));
+
+    mjm::vec3 position = mjm::vec3((float)x + 0.5f, 0.5f, (float)z + 0.5f);
+    bool player        = (i % 4) == 0;
+    mj::Entity entity  = world.Spawn(player ? EntityKind::Player : EntityKind::Projectile, position, 0.25f);
+    if (player)
+    {
+      world.inputs.Data<0>()[world.inputs.Add(entity)] = PlayerInput{ (uint16_t)(random.Next() & 0xF),
+                                                                      (uint16_t)random.Next() };
+    }
+    else
+    {
+      world.bodies.Data<BODY_VELOCITY>()[world.bodies.Find(entity)] =
+          mjm::vec3(random.Range(-10.0f, 10.0f), 0.0f, random.Range(-10.0f, 10.0f));
+      world.lifetimes.Data<0>()[world.lifetimes.Add(entity)] = random.Range(0.1f, 2.0f);
+    }
+  }
+
+  for (uint32_t tick = 0; tick < NUM_TICKS; tick++)
+  {
+    world.Tick(grid, 1.0f / 60.0f);
+  }
+}
+
+static void WaitForWriter(SaveGame& saveGame)
+{
+  while (saveGame.IsWriting())
+  {
+    std::this_thread::yield();
+  }
+}
+
+static void Run(const char* pName, const mj::Grid& grid, uint32_t numEntities, bool compress, uint32_t numSaves)
+{
+  World world;
+  World copy;
+  SaveGame saveGame;
+  mj::Grid otherGrid = mj::Grid::Create(grid.width, grid.height);
+  if (!world.Init() || !copy.Init() || !saveGame.Init() || !otherGrid.IsValid())
+  {
+    world.Destroy();
+    copy.Destroy();
+    mj::Grid::Free(otherGrid);
+    return;
+  }
+  Populate(world, grid, numEntities);
+
+  uint32_t extra     = 0x1234;
+  double captureMs   = 1e300;
+  double writeMs     = 1e300;
+  double loadNs      = 1e300;
+  bool match         = true;
+  uint32_t copyExtra = 0;
+  uint32_t numSaved  = 0;
+  for (uint32_t i = 0; i < numSaves; i++)
+  {
+    // Timed inside Save(), the writer thread may take over the core as soon as it is woken
+    bool saved = saveGame.Save(SAVE_PATH, world, grid, &extra, sizeof(extra), compress);
+    WaitForWriter(saveGame);
+    if (!saved)
+    {
+      continue;
+    }
+    SaveGame::Stats stats = saveGame.GetStats();
+    numSaved++;
+    captureMs = stats.captureMs < captureMs ? stats.captureMs : captureMs;
+    writeMs   = stats.writeMs < writeMs ? stats.writeMs : writeMs;
+
+    uint64_t begin = mj::bench::Now();
+    bool restored  = LoadSaveGame(SAVE_PATH, copy, grid, &copyExtra, sizeof(copyExtra));
+    uint64_t ns    = mj::bench::Now() - begin;
+    loadNs         = (double)ns < loadNs ? (double)ns : loadNs;
+    match          = match && restored && (copy.Hash() == world.Hash()) && (copyExtra == extra);
+  }
+
+  // A save of another level must be refused
+  memcpy(otherGrid.pSolid, grid.pSolid, grid.width * grid.height);
+  otherGrid.SetSolid(0, 0, !grid.IsSolid(0, 0));
+  match = match && !LoadSaveGame(SAVE_PATH, copy, otherGrid, &copyExtra, sizeof(copyExtra));
+
+  SaveGame::Stats stats = saveGame.GetStats();
+  printf("%-10s %8u %8s %10.1f %8.1f %8.1f %6.2f %9.3f %8.3f %6s\n", pName, world.entities.GetNumAlive(),
+         compress ? "lz" : "off", captureMs * 1000.0, stats.rawSize / 1024.0, stats.fileSize / 1024.0,
+         stats.fileSize ? (double)stats.rawSize / stats.fileSize : 0.0, writeMs, loadNs / 1e6,
+         mj::bench::Check(numSaved > 0 && match && stats.numFailed == 0) ? "ok" : "FAILED");
+
+  saveGame.Destroy();
+  world.Destroy();
+  copy.Destroy();
+  mj::Grid::Free(otherGrid);
+  MJ_DISCARD(remove(SAVE_PATH));
+}
+
+void mj::bench::RunSaveGame(uint32_t iterations)
+{
+  mj::jobs::Init();
+  PrintHeader("Save game",
+              "map        entities compress capture us   raw KB  file KB  ratio  write ms  load ms  check");
+
+  uint32_t numSaves = iterations < MAX_SAVES ? iterations : MAX_SAVES;
+  mj::Grid e1m1     = LoadE1M1();
+  mj::Grid open     = GenerateGrid(256, 256, 0.1f, 1234);
+  for (bool compress : { false, true })
+  {
+    if (e1m1.IsValid())
+    {
+      Run("E1M1 64x64", e1m1, 64, compress, numSaves);
+    }
+    for (uint32_t numEntities : { 1024u, 4096u, World::MAX_ENTITIES })
+    {
+      Run("random 256", open, numEntities, compress, numSaves);
+    }
+  }
+
+  mj::Grid::Free(e1m1);
+  mj::Grid::Free(open);
+  mj::jobs::Shutdown();
+}
@@ -0,0 +1,340 @@
+// Snapshot delta compression over the loopback transport
+// A server ticks random-walking, shooting players for ten seconds of game time. Every client decodes and
+// acknowledges its snapshots, optionally losing some, and checks the result against the server state.
+// Bandwidth per client is compared with uncompressed states and with bit-packed full snapshots,
+// then encoding and decoding are timed on their own.
+#include "bench.h"
+#include "server.h"
+
+static constexpr uint32_t NUM_TICKS        = 600; // Ten seconds at 60 Hz
+static constexpr uint32_t QUEUE_CAPACITY   = 64;
+static constexpr uint32_t SHOT_CHANCE      = 32; // One in this many moving players shoots per tick
+static constexpr float PROJECTILE_RADIUS   = 0.05f;
+static constexpr float PROJECTILE_SPEED    = 6.0f; // Times the player speed
+static constexpr float PROJECTILE_LIFETIME = 1.0f;
+static constexpr uint32_t FULL_BUFFER_SIZE = 65536;
+static constexpr uint32_t BASELINE_AGE     = 2; // Ticks, for timing: one round trip over loopback
+
+struct Client
+{
+  mj::net::Loopback connection;
+  SnapshotHistory snapshots;
+  uint32_t client;
+  uint32_t sequence;
+  uint32_t ackTick;
+  PlayerInput input;
+};
+
+static bool IsEqual(const Snapshot& a, const Snapshot& b)
+{
+  if (a.numEntities != b.numEntities)
+  {
+    return false;
+  }
+  for (uint32_t i = 0; i < a.numEntities; i++)
+  {
+    const EntityState& x = a.pEntities[i];
+    const EntityState& y = b.pEntities[i];
+    if (x.entity != y.entity || x.kind != y.kind || memcmp(x.position, y.position, sizeof(x.position)) ||
+        memcmp(x.velocity, y.velocity, sizeof(x.velocity)))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void SendInput(Client& client, mj::bench::Random& random, uint32_t tick)
+{
+  if (tick % 30 == 0)
+  {
+    client.input.buttons = (uint16_t)(random.Next() & 0xF);
+    client.input.yaw     = (uint16_t)random.Next();
+  }
+
+  InputMessage message;
+  message.sequence = ++client.sequence;
+  message.ackTick  = client.ackTick;
+  message.input    = client.input;
+  uint8_t packet[mj::net::MAX_PACKET_SIZE];
+  MJ_DISCARD(client.connection.toServer.Send(packet, WriteMessage(message, packet, sizeof(packet))));
+}
+
+/// <returns>True if a snapshot was decoded and equals the server state</returns>
+static bool ReceiveSnapshots(Client& client, mj::bench::Random& random, uint32_t lossPercent,
+                             const Snapshot& expected)
+{
+  bool exact = false;
+  uint8_t packet[mj::net::MAX_PACKET_SIZE];
+  uint32_t size;
+  while ((size = client.connection.toClient.Receive(packet)) > 0)
+  {
+    if (random.Next() % 100 < lossPercent)
+    {
+      continue;
+    }
+
+    MJ_UNINITIALIZED SnapshotMessage message;
+    const Snapshot* pSnapshot = ReadMessage(packet, size, client.snapshots, &message);
+    if (pSnapshot)
+    {
+      client.ackTick = pSnapshot->tick;
+      exact          = IsEqual(*pSnapshot, expected);
+    }
+  }
+  return exact;
+}
+
+/// <summary>
+/// Moving players sometimes shoot along their velocity, so entities come and go
+/// </summary>
+static void Shoot(World& world, mj::bench::Random& random)
+{
+  uint32_t numBodies = world.bodies.Size();
+  for (uint32_t i = 0; i < numBodies; i++)
+  {
+    mj::Entity entity = world.bodies.GetEntities()[i];
+    if (!world.inputs.Has(entity) || (random.Next() % SHOT_CHANCE) != 0)
+    {
+      continue;
+    }
+
+    mjm::vec3 position = world.bodies.Data<BODY_POSITION>()[i];
+    mjm::vec3 velocity = world.bodies.Data<BODY_VELOCITY>()[i];
+    if (velocity.x == 0.0f && velocity.z == 0.0f)
+    {
+      continue;
+    }
+
+    mj::Entity projectile = world.Spawn(EntityKind::Projectile, position, PROJECTILE_RADIUS);
+    if (projectile != mj::NULL_ENTITY)
+    {
+      world.bodies.Data<BODY_VELOCITY>()[world.bodies.Find(projectile)] = velocity * PROJECTILE_SPEED;
+      world.lifetimes.Data<0>()[world.lifetimes.Add(projectile)]         = PROJECTILE_LIFETIME;
+    }
+  }
+}
+
+struct Result
+{
+  uint32_t numClients;
+  double entities;    // Average per tick
+  double relevant;    // Average per client and tick
+  double rawKBs;      // Per client
+  double fullKBs;     // Per client
+  double deltaKBs;    // Per client
+  double encodeNs;    // Per snapshot
+  double decodeNs;    // Per snapshot
+  double exact;       // Fraction of client updates that decoded the server state
+  double replicateUs; // Per tick
+  double sendUs;      // Per tick
+  double tickUs;      // Per tick
+  double cellChanges; // Per tick
+  double viewUpdates; // Per tick
+};
+
+static Result Run(const mj::Grid& grid, uint32_t numClients, uint32_t lossPercent, bool interest, uint32_t numTicks,
+                  uint32_t iterations)
+{
+  Result result = {};
+  Server server;
+  Client* pClients = (Client*)calloc(numClients, sizeof(Client));
+  uint8_t* pFull   = (uint8_t*)malloc(FULL_BUFFER_SIZE);
+  SnapshotHistory history; // Of the first client, as the server sees it, for timing
+  Snapshot expected;
+  expected.capacity  = MAX_SNAPSHOT_ENTITIES;
+  expected.pEntities = (EntityState*)malloc(MAX_SNAPSHOT_ENTITIES * sizeof(EntityState));
+  Snapshot sent;
+  sent.capacity  = MAX_SNAPSHOT_ENTITIES;
+  sent.pEntities = (EntityState*)malloc(MAX_SNAPSHOT_ENTITIES * sizeof(EntityState));
+  if (!pClients || !pFull || !expected.pEntities || !sent.pEntities || !history.Init() || !server.Init(grid))
+  {
+    free(pClients);
+    free(pFull);
+    free(expected.pEntities);
+    free(sent.pEntities);
+    history.Destroy();
+    return result;
+  }
+  server.SetInterestManagement(interest);
+
+  uint32_t numConnected = 0;
+  for (uint32_t i = 0; i < numClients; i++)
+  {
+    Client& client = pClients[numConnected];
+    client.ackTick = NO_SNAPSHOT;
+    if (client.connection.Init(QUEUE_CAPACITY) && client.snapshots.Init())
+    {
+      client.client = server.Connect(&client.connection);
+      if (client.client != UINT32_MAX)
+      {
+        numConnected++;
+        continue;
+      }
+    }
+    client.snapshots.Destroy();
+    client.connection.Destroy();
+  }
+
+  mj::bench::Random inputRandom;
+  mj::bench::Random lossRandom;
+  mj::bench::Random shotRandom;
+  const Snapshot empty = {};
+  uint64_t numEntities = 0;
+  uint64_t numRelevant = 0;
+  uint64_t rawBytes    = 0;
+  uint64_t fullBytes   = 0;
+  uint64_t numExact    = 0;
+  uint64_t numCells    = 0;
+  uint64_t numViews    = 0;
+  double replicateMs   = 0.0;
+  double sendMs        = 0.0;
+  double tickMs        = 0.0;
+  for (uint32_t tick = 0; tick < numTicks; tick++)
+  {
+    for (uint32_t i = 0; i < numConnected; i++)
+    {
+      SendInput(pClients[i], inputRandom, tick);
+    }
+    server.Tick();
+    Shoot(server.world, shotRandom);
+
+    const Server::TickTimings& timings = server.GetLastTimings();
+    replicateMs += timings.replicate;
+    sendMs += timings.send;
+    tickMs += timings.receive + timings.simulate + timings.replicate + timings.send;
+    numCells += server.GetInterest().GetNumCellChanges();
+    numViews += server.GetInterest().GetNumViewUpdates();
+    numEntities += server.GetSnapshot().numEntities;
+
+    for (uint32_t i = 0; i < numConnected; i++)
+    {
+      server.GetClientSnapshot(pClients[i].client, &expected);
+      numExact += ReceiveSnapshots(pClients[i], lossRandom, lossPercent, expected) ? 1 : 0;
+
+      SnapshotMessage message = { server.world.tick, NO_SNAPSHOT, 0, 0, mjm::vec3::zero() };
+      numRelevant += expected.numEntities;
+      rawBytes += sizeof(SnapshotMessage) + expected.numEntities * sizeof(EntityState);
+      uint32_t firstIndex = 0;
+      fullBytes += WriteMessage(message, empty, expected, pFull, FULL_BUFFER_SIZE, &sent, &firstIndex);
+      if (i == 0)
+      {
+        Snapshot& copy   = history.Claim(server.world.tick);
+        copy.numEntities = expected.numEntities;
+        memcpy(copy.pEntities, expected.pEntities, expected.numEntities * sizeof(EntityState));
+      }
+    }
+  }
+
+  // Timing on the last snapshot of the first client against a baseline one round trip old
+  const Snapshot* pSnapshot = history.Find(server.world.tick);
+  const Snapshot* pBaseline = history.Find(server.world.tick - BASELINE_AGE);
+  if (pSnapshot && pBaseline)
+  {
+    mj::MemoryBuffer encoded(pFull, FULL_BUFFER_SIZE);
+    uint32_t firstIndex = 0;
+    MJ_DISCARD(EncodeSnapshot(*pBaseline, *pSnapshot, encoded, &sent, &firstIndex));
+    size_t size = encoded.Good() ? encoded.Position() - (char*)pFull : 0;
+
+    result.encodeNs = mj::bench::NsPerOp(iterations, [&](uint32_t) {
+      mj::MemoryBuffer writer(pFull + FULL_BUFFER_SIZE / 2, FULL_BUFFER_SIZE / 2);
+      uint32_t start = 0;
+      mj::bench::DoNotOptimize(EncodeSnapshot(*pBaseline, *pSnapshot, writer, &sent, &start));
+    });
+    result.decodeNs = mj::bench::NsPerOp(iterations, [&](uint32_t) {
+      mj::MemoryBuffer reader(pFull, size);
+      mj::bench::DoNotOptimize(DecodeSnapshot(*pBaseline, reader, &sent));
+    });
+  }
+
+  double seconds     = numTicks / Server::TICK_RATE;
+  double numUpdates  = (double)(numConnected ? numConnected : 1) * numTicks;
+  double perClient   = 1.0 / (numConnected ? numConnected : 1) / seconds / 1024.0;
+  result.numClients  = numConnected;
+  result.entities    = (double)numEntities / numTicks;
+  result.relevant    = numRelevant / numUpdates;
+  result.rawKBs      = rawBytes * perClient;
+  result.fullKBs     = fullBytes * perClient;
+  result.deltaKBs    = server.GetBytesSent() * perClient;
+  result.exact       = numExact / numUpdates;
+  result.replicateUs = replicateMs * 1000.0 / numTicks;
+  result.sendUs      = sendMs * 1000.0 / numTicks;
+  result.tickUs      = tickMs * 1000.0 / numTicks;
+  result.cellChanges = (double)numCells / numTicks;
+  result.viewUpdates = (double)numViews / numTicks;
+
+  for (uint32_t i = 0; i < numConnected; i++)
+  {
+    server.Disconnect(pClients[i].client);
+    pClients[i].snapshots.Destroy();
+    pClients[i].connection.Destroy();
+  }
+  server.Destroy();
+  history.Destroy();
+  free(expected.pEntities);
+  free(sent.pEntities);
+  free(pFull);
+  free(pClients);
+  return result;
+}
+
+static void RunCompression(const char* name, const mj::Grid& grid, uint32_t numClients, uint32_t lossPercent,
+                           uint32_t numTicks, uint32_t iterations)
+{
+  Result r = Run(grid, numClients, lossPercent, true, numTicks, iterations);
+  printf("%-11s %7u %8.0f %8.1f %4u%% %8.1f %9.1f %10.2f %6.1fx %9.2f %9.2f %6.1f%%\n", name, r.numClients,
+         r.entities, r.relevant, lossPercent, r.rawKBs, r.fullKBs, r.deltaKBs, r.rawKBs / r.deltaKBs,
+         r.encodeNs / 1000.0, r.decodeNs / 1000.0, 100.0 * r.exact);
+}
+
+static void RunScaling(const char* name, const mj::Grid& grid, uint32_t numClients, uint32_t numTicks)
+{
+  for (bool interest : { false, true })
+  {
+    Result r = Run(grid, numClients, 0, interest, numTicks, 1);
+    printf("%-11s %7u %8.0f %4s %8.1f %10.2f %12.1f %9.1f %9.1f %9.1f %9.1f %6.1f%%\n", name, r.numClients,
+           r.entities, interest ? "on" : "off", r.relevant, r.deltaKBs, r.replicateUs, r.sendUs, r.tickUs,
+           r.cellChanges, r.viewUpdates, 100.0 * r.exact);
+  }
+}
+
+void mj::bench::RunSnapshot(uint32_t iterations)
+{
+  uint32_t numTicks = iterations < NUM_TICKS ? iterations : NUM_TICKS;
+  mj::Grid e1m1     = LoadE1M1();
+  mj::Grid open     = GenerateGrid(256, 256, 0.1f, 1234);
+  mj::Grid dense    = GenerateGrid(256, 256, 0.35f, 1234);
+
+  PrintHeader("Snapshot",
+              "map         clients entities relevant loss  raw KB/s full KB/s delta KB/s  ratio encode us decode us  "
+              "exact");
+  if (e1m1.IsValid())
+  {
+    RunCompression("E1M1 64x64", e1m1, 8, 0, numTicks, iterations);
+    RunCompression("E1M1 64x64", e1m1, 32, 0, numTicks, iterations);
+    RunCompression("E1M1 64x64", e1m1, 32, 10, numTicks, iterations);
+  }
+  RunCompression("random 256", open, 128, 0, numTicks, iterations);
+  RunCompression("random 256", open, 128, 10, numTicks, iterations);
+
+  // Interest management off and on, per tick
+  PrintHeader("Snapshot interest",
+              "map         clients entities cull relevant delta KB/s replicate us   send us   tick us  cells/t   "
+              "views/t  exact");
+  for (uint32_t numClients : { 32, 64, 128, 256 })
+  {
+    if (e1m1.IsValid())
+    {
+      RunScaling("E1M1 64x64", e1m1, numClients, numTicks);
+    }
+  }
+  for (uint32_t numClients : { 32, 128, 256 })
+  {
+    RunScaling("random 256", open, numClients, numTicks);
+    RunScaling("walls 256", dense, numClients, numTicks);
+  }
+
+  mj::Grid::Free(e1m1);
+  mj::Grid::Free(open);
+  mj::Grid::Free(dense);
+}
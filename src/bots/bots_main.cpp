@@ -0,0 +1,167 @@
+// Bot load test - ramps up bots against an in-process server and reports what they cost it
+// Usage: bots [level] [--max N] [--ticks N] [--script file]
+//   level     Level file (*.mjm) or raw 64x64 block dump, default assets/E1M1.bin
+//   --max     Most bots (default 256). The first stage has 8, every next stage twice as many.
+//   --ticks   Ticks per stage (default 600, ten seconds of game time)
+//   --script  Bot script, see LoadBotScript(). Without one the bots walk randomly.
+// Ticks run back to back. For every stage it prints the server tick time percentiles, the average time
+// of the simulation and the other server phases, bandwidth, and the time the bots themselves take.
+// Invalid counts the snapshots bots could not decode since they connected.
+#include "bot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+static constexpr uint32_t FIRST_STAGE      = 8; // Bots
+static constexpr uint32_t MAX_SCRIPT_STEPS = 256;
+
+static mj::stats::Percentiles GetPercentiles(float* pTimes, uint32_t count)
+{
+  mj::stats::Percentiles percentiles = {};
+  if (count > 0)
+  {
+    std::sort(pTimes, pTimes + count);
+    percentiles.p50 = pTimes[(count - 1) * 50 / 100];
+    percentiles.p95 = pTimes[(count - 1) * 95 / 100];
+    percentiles.p99 = pTimes[(count - 1) * 99 / 100];
+    percentiles.max = pTimes[count - 1];
+  }
+  return percentiles;
+}
+
+int main(int argc, char** argv)
+{
+  const char* pLevelPath  = nullptr;
+  const char* pScriptPath = nullptr;
+  uint32_t maxBots        = 256;
+  uint32_t numTicks       = 600;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--max") && i + 1 < argc)
+    {
+      maxBots = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    }
+    else if (!strcmp(argv[i], "--ticks") && i + 1 < argc)
+    {
+      numTicks = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    }
+    else if (!strcmp(argv[i], "--script") && i + 1 < argc)
+    {
+      pScriptPath = argv[++i];
+    }
+    else
+    {
+      pLevelPath = argv[i];
+    }
+  }
+  if (maxBots > Server::MAX_CLIENTS)
+  {
+    maxBots = Server::MAX_CLIENTS;
+  }
+  if (numTicks == 0)
+  {
+    numTicks = 1;
+  }
+
+  mj::Grid grid = pLevelPath ? LoadLevelFile(pLevelPath) : LoadDefaultLevel();
+  if (!grid.IsValid())
+  {
+    printf("Could not load %s\n", pLevelPath ? pLevelPath : "assets/E1M1.bin, run from the repository root");
+    return 1;
+  }
+
+  BotStep script[MAX_SCRIPT_STEPS];
+  uint32_t numSteps = pScriptPath ? LoadBotScript(pScriptPath, script, MAX_SCRIPT_STEPS) : 0;
+  if (pScriptPath && numSteps == 0)
+  {
+    printf("Could not load bot script %s\n", pScriptPath);
+    return 1;
+  }
+
+  Server server;
+  Bot* pBots        = (Bot*)calloc(maxBots, sizeof(Bot));
+  float* pTickTimes = (float*)malloc(numTicks * sizeof(float));
+  if (!pBots || !pTickTimes || !server.Init(grid))
+  {
+    printf("Out of memory\n");
+    return 1;
+  }
+
+  printf("%ux%u level, %u ticks per stage, %s bots\n", grid.width, grid.height, numTicks,
+         pScriptPath ? pScriptPath : "random-walk");
+  printf("   bots  tick ms p50    p95    p99    max  receive  simulate replicate     send  out KB/s  per bot  "
+         "bots ms  invalid\n");
+
+  uint32_t numBots = 0;
+  for (uint32_t stage = FIRST_STAGE;; stage *= 2)
+  {
+    uint32_t target = stage < maxBots ? stage : maxBots;
+    while (numBots < target && pBots[numBots].Init(server, 0x9E3779B9 + numBots, script, numSteps))
+    {
+      numBots++;
+    }
+
+    Server::TickTimings total = {};
+    double botMs              = 0.0;
+    uint64_t bytesSent        = server.GetBytesSent();
+    uint32_t numInvalid       = 0;
+
+    for (uint32_t tick = 0; tick < numTicks; tick++)
+    {
+      double start = mj::stats::Now();
+      for (uint32_t i = 0; i < numBots; i++)
+      {
+        pBots[i].SendInput();
+      }
+      double sent = mj::stats::Now();
+      server.Tick();
+      double ticked = mj::stats::Now();
+      for (uint32_t i = 0; i < numBots; i++)
+      {
+        pBots[i].Receive();
+      }
+      botMs += (sent - start) + (mj::stats::Now() - ticked);
+
+      const Server::TickTimings& timings = server.GetLastTimings();
+      total.receive += timings.receive;
+      total.simulate += timings.simulate;
+      total.replicate += timings.replicate;
+      total.send += timings.send;
+      pTickTimes[tick] = timings.receive + timings.simulate + timings.replicate + timings.send;
+    }
+
+    for (uint32_t i = 0; i < numBots; i++)
+    {
+      numInvalid += pBots[i].GetNumInvalid();
+    }
+
+    double seconds                     = numTicks / Server::TICK_RATE;
+    double outKBs                      = (server.GetBytesSent() - bytesSent) / seconds / 1024.0;
+    mj::stats::Percentiles percentiles = GetPercentiles(pTickTimes, numTicks);
+    printf("%7u %12.3f %6.3f %6.3f %6.3f %8.3f %9.3f %9.3f %8.3f %9.1f %8.2f %8.3f %8u\n", numBots, percentiles.p50,
+           percentiles.p95, percentiles.p99, percentiles.max, total.receive / numTicks, total.simulate / numTicks,
+           total.replicate / numTicks, total.send / numTicks, outKBs, outKBs / numBots, botMs / numTicks, numInvalid);
+
+    if (numBots < target)
+    {
+      printf("Server full at %u bots\n", numBots);
+      break;
+    }
+    if (target == maxBots)
+    {
+      break;
+    }
+  }
+
+  for (uint32_t i = 0; i < numBots; i++)
+  {
+    pBots[i].Destroy(server);
+  }
+  free(pBots);
+  free(pTickTimes);
+  server.Destroy();
+  mj::Grid::Free(grid);
+  return 0;
+}
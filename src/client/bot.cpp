@@ -0,0 +1,197 @@
+// Bot - headless client for load tests
+// Should not use pre-compiled headers (for portability)
+
+#include "bot.h"
+#include "controls.h"
+#include "mj_input.h"
+#include "mj_profiler.h"
+
+#include <stdio.h>
+
+/// <returns>False if the line is not a step</returns>
+static bool ParseStep(const char* pLine, BotStep* pStep)
+{
+  char keys[8];
+  int turn;
+  unsigned int numTicks;
+  if (sscanf(pLine, "%7s %d %u", keys, &turn, &numTicks) != 3 || turn < INT16_MIN || turn > INT16_MAX)
+  {
+    return false;
+  }
+
+  pStep->buttons = 0;
+  for (const char* pKey = keys; *pKey; pKey++)
+  {
+    switch (*pKey)
+    {
+    case 'W':
+    case 'w':
+      pStep->buttons |= INPUT_FORWARD;
+      break;
+    case 'S':
+    case 's':
+      pStep->buttons |= INPUT_BACKWARD;
+      break;
+    case 'A':
+    case 'a':
+      pStep->buttons |= INPUT_LEFT;
+      break;
+    case 'D':
+    case 'd':
+      pStep->buttons |= INPUT_RIGHT;
+      break;
+    case '-':
+      break;
+    default:
+      return false;
+    }
+  }
+  pStep->turn     = (int16_t)turn;
+  pStep->numTicks = numTicks;
+  return true;
+}
+
+uint32_t LoadBotScript(const char* pPath, BotStep* pSteps, uint32_t maxSteps)
+{
+  FILE* pFile = fopen(pPath, "r");
+  if (!pFile)
+  {
+    return 0;
+  }
+
+  uint32_t numSteps = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), pFile))
+  {
+    const char* pLine = line;
+    while (*pLine == ' ' || *pLine == '\t')
+    {
+      pLine++;
+    }
+    if (*pLine == '#' || *pLine == '\r' || *pLine == '\n' || *pLine == '\0')
+    {
+      continue;
+    }
+
+    if (numSteps == maxSteps || !ParseStep(pLine, &pSteps[numSteps]))
+    {
+      numSteps = 0;
+      break;
+    }
+    numSteps++;
+  }
+
+  fclose(pFile);
+  return numSteps;
+}
+
+bool Bot::Init(Server& server, uint32_t seed, const BotStep* pScript, uint32_t numSteps)
+{
+  if (!this->connection.Init(Bot::QUEUE_CAPACITY))
+  {
+    return false;
+  }
+  if (!this->snapshots.Init())
+  {
+    this->connection.Destroy();
+    return false;
+  }
+
+  this->client = server.Connect(&this->connection);
+  if (this->client == UINT32_MAX)
+  {
+    this->snapshots.Destroy();
+    this->connection.Destroy();
+    return false;
+  }
+
+  this->pScript       = numSteps > 0 ? pScript : nullptr;
+  this->numSteps      = numSteps;
+  this->nextStep      = 0;
+  this->ticksLeft     = 0;
+  this->random        = seed ? seed : 1;
+  this->sequence      = 0;
+  this->ackTick       = NO_SNAPSHOT;
+  this->yaw           = 0.0f;
+  this->bytesReceived = 0;
+  this->numSnapshots  = 0;
+  this->numInvalid    = 0;
+  return true;
+}
+
+void Bot::Destroy(Server& server)
+{
+  server.Disconnect(this->client);
+  this->snapshots.Destroy();
+  this->connection.Destroy();
+}
+
+void Bot::NextStep()
+{
+  if (this->pScript)
+  {
+    this->step     = this->pScript[this->nextStep];
+    this->nextStep = (this->nextStep + 1) % this->numSteps;
+  }
+  else
+  {
+    this->random ^= this->random << 13;
+    this->random ^= this->random >> 17;
+    this->random ^= this->random << 5;
+    int32_t turn        = (int32_t)((this->random >> 16) % (2 * Bot::MAX_RANDOM_TURN + 1)) - Bot::MAX_RANDOM_TURN;
+    this->step.buttons  = (uint16_t)(this->random & 0xF);
+    this->step.turn     = (int16_t)turn;
+    this->step.numTicks = Bot::RANDOM_TICKS;
+  }
+  this->ticksLeft = this->step.numTicks > 0 ? this->step.numTicks : 1;
+}
+
+void Bot::SendInput()
+{
+  ZoneScoped;
+  if (this->ticksLeft == 0)
+  {
+    NextStep();
+  }
+  this->ticksLeft--;
+
+  // Through mj::input, like the keyboard and mouse of a player
+  mj::input::SetKey(Key::KeyW, (this->step.buttons & INPUT_FORWARD) != 0);
+  mj::input::SetKey(Key::KeyS, (this->step.buttons & INPUT_BACKWARD) != 0);
+  mj::input::SetKey(Key::KeyA, (this->step.buttons & INPUT_LEFT) != 0);
+  mj::input::SetKey(Key::KeyD, (this->step.buttons & INPUT_RIGHT) != 0);
+  mj::input::AddRelativeMouseMovement(this->step.turn, 0);
+  mj::input::Update();
+  this->yaw = ApplyMouseLook(this->yaw);
+
+  InputMessage message;
+  message.sequence = ++this->sequence;
+  message.ackTick  = this->ackTick;
+  message.input    = SampleControls(this->yaw);
+  uint8_t packet[mj::net::MAX_PACKET_SIZE];
+  MJ_DISCARD(this->connection.toServer.Send(packet, WriteMessage(message, packet, sizeof(packet))));
+}
+
+void Bot::Receive()
+{
+  ZoneScoped;
+  uint8_t packet[mj::net::MAX_PACKET_SIZE];
+  uint32_t size;
+  while ((size = this->connection.toClient.Receive(packet)) > 0)
+  {
+    this->bytesReceived += size;
+    MJ_UNINITIALIZED SnapshotMessage message;
+    const Snapshot* pSnapshot = ReadMessage(packet, size, this->snapshots, &message);
+    if (!pSnapshot)
+    {
+      this->numInvalid++;
+      continue;
+    }
+
+    this->numSnapshots++;
+    if (this->ackTick == NO_SNAPSHOT || (int32_t)(pSnapshot->tick - this->ackTick) > 0)
+    {
+      this->ackTick = pSnapshot->tick;
+    }
+  }
+}
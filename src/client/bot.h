@@ -0,0 +1,94 @@
+// Bot - headless client for load tests
+// Should not use pre-compiled headers (for portability)
+//
+// A bot connects to a Server over loopback and plays like a player: every tick it holds movement keys and
+// moves the mouse through mj::input, and sends what SampleControls() makes of that. It follows a script of
+// steps, or walks randomly. Snapshots are decoded and acknowledged like the game does.
+// mj::input is global, so bots take turns with it and cannot share a process with a real player.
+
+#pragma once
+#include "server.h"
+
+/// <summary>
+/// What a bot does for a number of ticks
+/// </summary>
+struct BotStep
+{
+  uint16_t buttons;  // INPUT_* flags, held as the W, S, A and D keys
+  int16_t turn;      // Mouse counts per tick
+  uint32_t numTicks; // At least one is played
+};
+
+/// <summary>
+/// Reads a script: one step per line as keys (any of WASD, or - for none), mouse counts per tick and
+/// a number of ticks, for example "WA 4 60". Empty lines and lines starting with # are skipped.
+/// </summary>
+/// <returns>Number of steps read, 0 if the file could not be read or has an invalid line</returns>
+uint32_t LoadBotScript(const char* pPath, BotStep* pSteps, uint32_t maxSteps);
+
+class Bot
+{
+public:
+  static constexpr uint32_t QUEUE_CAPACITY = 64; // Packets per direction
+  static constexpr uint32_t RANDOM_TICKS   = 30; // Length of a random step
+  static constexpr int16_t MAX_RANDOM_TURN = 16; // Mouse counts per tick
+
+  /// <summary>
+  /// Connects to a server.
+  /// </summary>
+  /// <param name="pScript">Steps to loop through, must outlive the bot. nullptr to walk randomly.</param>
+  /// <returns>False if out of memory or the server is full</returns>
+  bool Init(Server& server, uint32_t seed, const BotStep* pScript, uint32_t numSteps);
+
+  /// <summary>
+  /// Disconnects from the server it was initialized with
+  /// </summary>
+  void Destroy(Server& server);
+
+  /// <summary>
+  /// Plays one tick: samples mj::input and sends the input to the server
+  /// </summary>
+  void SendInput();
+
+  /// <summary>
+  /// Decodes and acknowledges all snapshots that arrived
+  /// </summary>
+  void Receive();
+
+  uint64_t GetBytesReceived() const
+  {
+    return this->bytesReceived;
+  }
+
+  uint32_t GetNumSnapshots() const
+  {
+    return this->numSnapshots;
+  }
+
+  /// <summary>
+  /// Snapshots that could not be decoded, for example because their baseline was too old
+  /// </summary>
+  uint32_t GetNumInvalid() const
+  {
+    return this->numInvalid;
+  }
+
+private:
+  void NextStep();
+
+  mj::net::Loopback connection;
+  SnapshotHistory snapshots;
+  const BotStep* pScript;
+  uint32_t numSteps;
+  uint32_t nextStep;
+  BotStep step;
+  uint32_t ticksLeft; // In step
+  uint32_t random;
+  uint32_t client;
+  uint32_t sequence;
+  uint32_t ackTick;
+  float yaw;
+  uint64_t bytesReceived;
+  uint32_t numSnapshots;
+  uint32_t numInvalid;
+};
@@ -0,0 +1,25 @@
+// Controls - player commands from the state of mj::input
+// Should not use pre-compiled headers (for portability)
+
+#include "controls.h"
+#include "mj_input.h"
+
+#include <math.h>
+
+float ApplyMouseLook(float yaw)
+{
+  MJ_UNINITIALIZED int32_t dx, dy;
+  mj::input::GetRelativeMouseMovement(&dx, &dy);
+  return yaw + MOUSE_SENSITIVITY * dx;
+}
+
+PlayerInput SampleControls(float yaw)
+{
+  PlayerInput input;
+  input.buttons = (uint16_t)((mj::input::GetKey(Key::KeyW) ? INPUT_FORWARD : 0) |  //
+                             (mj::input::GetKey(Key::KeyS) ? INPUT_BACKWARD : 0) | //
+                             (mj::input::GetKey(Key::KeyA) ? INPUT_LEFT : 0) |     //
+                             (mj::input::GetKey(Key::KeyD) ? INPUT_RIGHT : 0));
+  input.yaw     = (uint16_t)(int32_t)floorf(yaw * (65536.0f / 6.28318530718f) + 0.5f);
+  return input;
+}
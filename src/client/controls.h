@@ -0,0 +1,21 @@
+// Controls - player commands from the state of mj::input
+// Should not use pre-compiled headers (for portability)
+//
+// The game samples the local player with these. Bots hold virtual keys and move a virtual mouse through
+// mj::input instead, so that both take exactly the same path into PlayerInput.
+
+#pragma once
+#include "world.h"
+
+static constexpr float MOUSE_SENSITIVITY = 0.0025f; // Radians per mouse count
+
+/// <summary>
+/// Turns a view by the relative mouse movement of this frame
+/// </summary>
+float ApplyMouseLook(float yaw);
+
+/// <summary>
+/// Movement keys and the view direction, quantized
+/// </summary>
+/// <param name="yaw">Radians, 0 faces +Z</param>
+PlayerInput SampleControls(float yaw);
@@ -420,86 +420,14 @@ void EditorState::Update(ComPtr<ID3D11DeviceContext> pContext, mj::ArrayList<Dra
   auto projection    = mjm::perspectiveLH_ZO(mjm::radians(cam.yFov), cam.viewport[2] / cam.viewport[3], 0.01f, 100.0f);
   cam.viewProjection = projection * view;
 
-  {
-    // Level
-    DrawCommand* pCmd = drawList.EmplaceSingle();
-    if (pCmd)
-    {
-      pCmd->pCamera      = &this->camera;
-      pCmd->pMesh        = &this->levelMesh;
-      pCmd->vertexShader = Graphics::GetVertexShader();
-      pCmd->pixelShader  = Graphics::GetPixelShader();
-    }
-  }
+  // Level
+  this->levelMesh.Draw(drawList, &this->camera);
 
   this->blockCursor.Update(*this, pContext, drawList);
 }
 
-void EditorState::SetLevel(const Level* pLvl, ComPtr<ID3D11Device> pDevice)
+void EditorState::SetLevel(const Level* pLvl, const LevelMesh& mesh)
 {
-  this->pLevel = pLvl;
-
-  mj::ArrayList<Vertex> vertices;
-  mj::ArrayList<uint16_t> indices;
-
-  Graphics::InsertWalls(vertices, indices, pLevel);
-
-  // Floor/ceiling pass
-  for (size_t z = 0; z < Meta::LEVEL_DIM; z++)
-  {
-    // Check for blocks in this slice
-    for (size_t x = 0; x < Meta::LEVEL_DIM; x++)
-    {
-      if (this->pLevel->pBlocks[z * this->pLevel->width + x] >= 0x006A)
-      {
-        Graphics::InsertFloor(vertices, indices, (float)x, 0.0f, (float)z, 136.0f);
-        Graphics::InsertCeiling(vertices, indices, (float)x, (float)z, 138.0f);
-      }
-      else
-      {
-        // Editor: draw top of level for clarity
-        Graphics::InsertFloor(vertices, indices, (float)x, 1.0f, (float)z, 138.0f);
-      }
-    }
-  }
-
-  {
-    // Fill in a buffer description.
-    D3D11_BUFFER_DESC bufferDesc;
-    bufferDesc.Usage          = D3D11_USAGE_IMMUTABLE;
-    bufferDesc.ByteWidth      = vertices.ByteWidth();
-    bufferDesc.BindFlags      = D3D11_BIND_VERTEX_BUFFER;
-    bufferDesc.CPUAccessFlags = 0;
-    bufferDesc.MiscFlags      = 0;
-
-    // Fill in the subresource data.
-    D3D11_SUBRESOURCE_DATA InitData;
-    InitData.pSysMem          = vertices.Get();
-    InitData.SysMemPitch      = vertices.ElemSize();
-    this->levelMesh.stride    = InitData.SysMemPitch;
-    InitData.SysMemSlicePitch = 0;
-
-    // Create the vertex buffer.
-    MJ_DISCARD(pDevice->CreateBuffer(&bufferDesc, &InitData, this->levelMesh.vertexBuffer.ReleaseAndGetAddressOf()));
-  }
-  {
-    this->levelMesh.indexCount  = indices.Size();
-    this->levelMesh.inputLayout = Graphics::GetInputLayout();
-
-    D3D11_BUFFER_DESC bufferDesc;
-    bufferDesc.Usage          = D3D11_USAGE_IMMUTABLE;
-    bufferDesc.ByteWidth      = indices.ByteWidth();
-    bufferDesc.BindFlags      = D3D11_BIND_INDEX_BUFFER;
-    bufferDesc.CPUAccessFlags = 0;
-    bufferDesc.MiscFlags      = 0;
-
-    // Define the resource data.
-    D3D11_SUBRESOURCE_DATA InitData;
-    InitData.pSysMem          = indices.Get();
-    InitData.SysMemPitch      = indices.ElemSize();
-    InitData.SysMemSlicePitch = 0;
-
-    // Create the buffer with the device.
-    MJ_DISCARD(pDevice->CreateBuffer(&bufferDesc, &InitData, this->levelMesh.indexBuffer.ReleaseAndGetAddressOf()));
-  }
+  this->pLevel    = pLvl;
+  this->levelMesh = mesh;
 }
@@ -3,6 +3,7 @@
 #include "camera.h"
 #include "mj_input.h"
 #include "graphics.h"
+#include "level_loader.h"
 
 class EditorState : public StateBase
 {
@@ -17,7 +18,10 @@ public:
   void Entry() override;
   void Update(ComPtr<ID3D11DeviceContext> pContext, mj::ArrayList<DrawCommand>& drawList) override;
 
-  void SetLevel(const Level* pLvl, ComPtr<ID3D11Device> pDevice);
+  /// <summary>
+  /// The level is owned by Meta, the mesh is built by LevelLoader
+  /// </summary>
+  void SetLevel(const Level* pLvl, const LevelMesh& mesh);
 
 private:
   class BlockSelection
@@ -100,7 +104,7 @@ private:
   InputCombo inputComboSave;
   InputCombo inputComboSaveAs;
 
-  Mesh levelMesh;
+  LevelMesh levelMesh;
   const Level* pLevel = nullptr;
   BlockCursor blockCursor;
   BlockSelection blockSelection;
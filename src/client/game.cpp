@@ -1,50 +1,361 @@
 #include "pch.h"
 #include "mj_input.h"
+#include "mj_assets.h"
+#include "controls.h"
+#include "mj_frame_stats.h"
 #include "mj_common.h" // MJ_RT_WIDTH / MJ_RT_HEIGHT
 #include "main.h"
 #include "meta.h"
 
-void GameState::SetLevel(Level level, ComPtr<ID3D11Device> pDevice)
+#include <utility> // std::swap
+
+static constexpr const char* QUICKSAVE_PATH = "quicksave.mjs";
+
+void GameState::SetLevel(LoadedLevel& level)
 {
-  uint8_t xz[] = { 0, 0 }; // xz yzx zxy
+  // The local server plays on the grid that is replaced
+  Disconnect();
 
-  mj::ArrayList<Vertex> vertices;
-  mj::ArrayList<uint16_t> indices;
+  std::swap(this->levelMesh, level.gameMesh);
+  std::swap(this->grid, level.grid);
+}
 
-  Graphics::InsertWalls(vertices, indices, &level);
+/// <summary>
+/// CPU frame time history and per-phase percentiles, in milliseconds
+/// </summary>
+static void ShowFrameStats()
+{
+  MJ_UNINITIALIZED uint32_t offset, count;
+  const float* pFrameTimes = mj::stats::GetHistory(mj::stats::Phase::Frame, &offset, &count);
+  ImGui::PlotHistogram("##FrameTimes", pFrameTimes, (int)count, (int)offset, "CPU frame time (ms)", 0.0f, 50.0f,
+                       ImVec2(0.0f, 80.0f));
 
-  // Floor/ceiling pass
-  for (size_t z = 0; z < Meta::LEVEL_DIM; z++)
+  ImGui::Columns(5, "##FrameStats");
+  ImGui::Text("Phase");
+  ImGui::NextColumn();
+  ImGui::Text("p50");
+  ImGui::NextColumn();
+  ImGui::Text("p95");
+  ImGui::NextColumn();
+  ImGui::Text("p99");
+  ImGui::NextColumn();
+  ImGui::Text("max");
+  ImGui::NextColumn();
+  ImGui::Separator();
+  for (uint32_t i = 0; i < (uint32_t)mj::stats::Phase::Count; i++)
   {
-    // Check for blocks in this slice
-    for (size_t x = 0; x < Meta::LEVEL_DIM; x++)
-    {
-      if (level.pBlocks[z * level.width + x] >= 0x006A)
-      {
-        Graphics::InsertFloor(vertices, indices, (float)x, 0.0f, (float)z, 136.0f);
-        Graphics::InsertCeiling(vertices, indices, (float)x, (float)z, 138.0f);
-      }
-    }
+    mj::stats::Phase phase             = (mj::stats::Phase)i;
+    mj::stats::Percentiles percentiles = mj::stats::GetPercentiles(phase);
+    ImGui::Text("%s", mj::stats::GetPhaseName(phase));
+    ImGui::NextColumn();
+    ImGui::Text("%.2f", percentiles.p50);
+    ImGui::NextColumn();
+    ImGui::Text("%.2f", percentiles.p95);
+    ImGui::NextColumn();
+    ImGui::Text("%.2f", percentiles.p99);
+    ImGui::NextColumn();
+    ImGui::Text("%.2f", percentiles.max);
+    ImGui::NextColumn();
   }
+  ImGui::Columns(1);
+}
 
-  this->levelMesh =
-      Graphics::CreateMesh(pDevice, vertices.Cast<float>(), 6, indices, D3D11_USAGE_IMMUTABLE, D3D11_USAGE_IMMUTABLE);
-  this->levelMesh.inputLayout = Graphics::GetInputLayout();
+/// <summary>
+/// Timing and size of the last save, and the saves that did not make it to disk
+/// </summary>
+static void ShowSaveStats(SaveGame& saveGame)
+{
+  SaveGame::Stats stats = saveGame.GetStats();
+  if (stats.numWritten > 0)
+  {
+    ImGui::Text("Last save: %.3f ms to capture, %.2f ms to write %u KB as %u KB", stats.captureMs, stats.writeMs,
+                stats.rawSize / 1024, stats.fileSize / 1024);
+  }
+  if (saveGame.IsWriting())
+  {
+    ImGui::Text("Writing save...");
+  }
+  if (stats.numFailed > 0 || stats.numSkipped > 0)
+  {
+    ImGui::Text("%u saves failed, %u skipped while writing", stats.numFailed, stats.numSkipped);
+  }
+}
+
+/// <summary>
+/// Reload button and the timing of the last load. The current level stays playable while the next one loads.
+/// </summary>
+static void ShowLevelLoading(Meta* pMeta)
+{
+  LevelLoader::Stats stats = pMeta->GetLevelLoadStats();
+  if (ImGui::Button("Reload level"))
+  {
+    pMeta->LoadLevel(Meta::LEVEL_PATH);
+  }
+  ImGui::SameLine();
+  if (pMeta->IsLevelLoading())
+  {
+    ImGui::Text("Loading...");
+  }
+  else
+  {
+    ImGui::Text("Last load %.2f ms (%u loaded, %u failed), %u of %u chunks meshed", stats.loadMs, stats.numLoaded,
+                stats.numFailed, stats.numChunksMeshed, LevelMesh::NUM_CHUNKS);
+  }
+}
+
+/// <summary>
+/// Hot reloads of the texture array and residency of its layers
+/// </summary>
+static void ShowTextureStreaming(Meta* pMeta)
+{
+  // Edits to the texture array on disk show up without restarting
+  Meta::HotReloadStats reload = pMeta->GetHotReloadStats();
+  ImGui::Text("Texture array: last reload %.2f ms (%u loaded, %u failed), %u layers uploaded",
+              reload.textureLoad.loadMs, reload.textureLoad.numLoaded, reload.textureLoad.numFailed,
+              reload.numLayersUpdated);
+
+  // Layers are uploaded when they are first drawn; until then they show the fallback layer
+  mj::LayerCache::Stats stats = pMeta->GetResidencyStats();
+  uint64_t numReferences      = stats.numHits + stats.numMisses;
+  ImGui::Text("Texture layers: %u of %u slots resident, %u pending", stats.numResident, stats.numSlots,
+              stats.numPending);
+  ImGui::Text("%llu hits, %llu misses (%.1f%% hit rate), %llu uploads, %llu evictions",
+              (unsigned long long)stats.numHits, (unsigned long long)stats.numMisses,
+              numReferences > 0 ? 100.0 * stats.numHits / numReferences : 100.0,
+              (unsigned long long)stats.numInserted, (unsigned long long)stats.numEvicted);
+}
+
+/// <summary>
+/// Where the assets were loaded from
+/// </summary>
+static void ShowAssetStats()
+{
+  mj::assets::Stats stats = mj::assets::GetStats();
+  ImGui::Text("Assets: %u in pack, %u mapped, %u decompressed, %u loose, %u missing", stats.numEntries, stats.numMapped,
+              stats.numDecompressed, stats.numLoose, stats.numMissing);
+}
+
+void GameState::Init(ComPtr<ID3D11Device> pDevice)
+{
+  MJ_DISCARD(pDevice);
+  MJ_DISCARD(this->world.Init());
+  MJ_DISCARD(this->replay.Init(GameState::MAX_REPLAY_TICKS, 1));
+  MJ_DISCARD(this->saveGame.Init());
+}
+
+void GameState::Destroy()
+{
+  this->saveGame.Destroy();
 }
 
 void GameState::Entry()
 {
+  Disconnect();
   MJ_DISCARD(SDL_SetRelativeMouseMode((SDL_bool) true));
   // ImGui::GetIO().WantCaptureMouse    = this->MouseLook;
   // ImGui::GetIO().WantCaptureKeyboard = this->MouseLook;
 
   this->camera.yFov = 60.0f;
 
-  this->lastMousePos    = 0.0f;
-  this->currentMousePos = 0.0f;
   this->camera.position = mjm::vec3(54.5f, 0.5f, 34.5f);
-  this->camera.rotation = mjm::quat(mjm::vec3(0.0f, -this->currentMousePos, 0));
-  this->yaw             = -this->currentMousePos;
+  this->camera.rotation = mjm::quat(mjm::vec3(0.0f, 0.0f, 0.0f));
+  this->yaw             = 0.0f;
+
+  // Same starting state every time, so replays stay in sync
+  this->world.Reset();
+  this->player = this->world.Spawn(EntityKind::Player, this->camera.position, GameState::PLAYER_RADIUS);
+  if (this->player != mj::NULL_ENTITY)
+  {
+    this->world.inputs.Data<0>()[this->world.inputs.Add(this->player)] = PlayerInput{ 0, 0 };
+  }
+
+  this->current.position = this->camera.position;
+  this->previous         = this->current;
+  this->simulationTime   = 0.0f;
+  this->stateHash        = this->world.Hash();
+  this->timestep.Reset();
+}
+
+/// <summary>
+/// Restarts the game and starts recording or playing back the replay
+/// </summary>
+void GameState::StartReplay(ReplayMode mode)
+{
+  Entry();
+  if (mode == ReplayMode::Recording)
+  {
+    this->replay.Clear();
+  }
+  else
+  {
+    this->replay.Rewind();
+  }
+  this->replayMode = mode;
+}
+
+/// <summary>
+/// Advances the simulation by exactly one tick. Does not touch rendering state.
+/// </summary>
+void GameState::Tick(const PlayerInput& input)
+{
+  ZoneScopedNC("Simulation tick", tracy::Color::LimeGreen);
+
+  uint32_t tick = this->world.tick;
+  uint32_t slot = this->world.inputs.Find(this->player);
+  if (slot != this->world.inputs.INVALID)
+  {
+    this->world.inputs.Data<0>()[slot] = input;
+  }
+
+  this->world.Tick(this->grid, this->timestep.GetTickTime());
+
+  uint32_t body = this->world.bodies.Find(this->player);
+  if (body != this->world.bodies.INVALID)
+  {
+    this->current.position = this->world.bodies.Data<BODY_POSITION>()[body];
+  }
+
+  this->stateHash = this->world.Hash();
+  if (this->replayMode == ReplayMode::Recording)
+  {
+    if (!this->replay.Record(&input, this->stateHash))
+    {
+      this->replayMode = ReplayMode::Off;
+    }
+  }
+  else if (this->replayMode == ReplayMode::Playback)
+  {
+    MJ_DISCARD(this->replay.Verify(tick, this->stateHash));
+  }
+}
+
+/// <summary>
+/// Starts a server on the current level and plays through it, see TickOnline()
+/// </summary>
+bool GameState::Connect()
+{
+  Disconnect();
+  if (!this->server.Init(this->grid) ||                    //
+      !this->connection.Init(GameState::QUEUE_CAPACITY) || //
+      !this->toServer.Init(GameState::QUEUE_CAPACITY) ||   //
+      !this->toClient.Init(GameState::QUEUE_CAPACITY) ||   //
+      !this->snapshots.Init())
+  {
+    Disconnect();
+    return false;
+  }
+
+  this->client = this->server.Connect(&this->connection);
+  if (this->client == UINT32_MAX)
+  {
+    Disconnect();
+    return false;
+  }
+
+  this->replayMode = ReplayMode::Off;
+  this->ackTick    = NO_SNAPSHOT;
+  this->prediction.Reset(Server::PLAYER_RADIUS);
+  return true;
+}
+
+/// <summary>
+/// Stops the local server, if any. Play continues in the local world.
+/// </summary>
+void GameState::Disconnect()
+{
+  this->server.Destroy();
+  this->connection.Destroy();
+  this->toServer.Destroy();
+  this->toClient.Destroy();
+  this->snapshots.Destroy();
+  this->client = UINT32_MAX;
+}
+
+/// <summary>
+/// One tick as a client: predicts the player, sends the input, ticks the server and reconciles with the
+/// snapshots that arrive. Packets are held back by half the ping in each direction.
+/// </summary>
+void GameState::TickOnline(const PlayerInput& input)
+{
+  ZoneScopedNC("Simulation tick", tracy::Color::LimeGreen);
+
+  float dt       = this->timestep.GetTickTime();
+  uint32_t tick  = this->server.world.tick;
+  uint32_t delay = (uint32_t)(this->ping * GameState::TICK_RATE / 2000.0f + 0.5f);
+  uint8_t packet[mj::net::MAX_PACKET_SIZE];
+
+  InputMessage message;
+  message.sequence = this->prediction.Predict(this->grid, input, dt);
+  message.ackTick  = this->ackTick;
+  message.input    = input;
+  MJ_DISCARD(this->toServer.Push(packet, WriteMessage(message, packet, sizeof(packet)), tick + delay));
+
+  uint32_t size;
+  while ((size = this->toServer.Pop(tick, packet)) > 0)
+  {
+    MJ_DISCARD(this->connection.toServer.Send(packet, size));
+  }
+  this->server.Tick();
+  while ((size = this->connection.toClient.Receive(packet)) > 0)
+  {
+    MJ_DISCARD(this->toClient.Push(packet, size, tick + delay));
+  }
+
+  while ((size = this->toClient.Pop(tick, packet)) > 0)
+  {
+    MJ_UNINITIALIZED SnapshotMessage snapshot;
+    if (ReadMessage(packet, size, this->snapshots, &snapshot))
+    {
+      this->ackTick = snapshot.tick;
+      this->prediction.Reconcile(this->grid, snapshot.lastSequence, snapshot.position, dt);
+    }
+  }
+
+  if (this->prediction.HasPosition())
+  {
+    this->current.position = this->prediction.GetSmoothedPosition();
+  }
+  this->stateHash = this->server.world.Hash();
+}
+
+/// <summary>
+/// Saves the local world in the background, see SaveGame
+/// </summary>
+void GameState::QuickSave()
+{
+  SavedState state;
+  state.player  = this->player;
+  state.current = this->current;
+  state.yaw     = this->yaw;
+  MJ_DISCARD(this->saveGame.Save(QUICKSAVE_PATH, this->world, this->grid, &state, sizeof(state), this->compressSaves));
+}
+
+/// <summary>
+/// Continues from the quicksave. Blocks while reading.
+/// </summary>
+void GameState::QuickLoad()
+{
+  MJ_UNINITIALIZED SavedState state;
+  this->loadFailed = !LoadSaveGame(QUICKSAVE_PATH, this->world, this->grid, &state, sizeof(state));
+  if (this->loadFailed)
+  {
+    // A world that did not fit is left empty
+    if (!this->world.entities.IsAlive(this->player))
+    {
+      Entry();
+    }
+    return;
+  }
+
+  this->replayMode      = ReplayMode::Off;
+  this->player          = state.player;
+  this->current         = state.current;
+  this->previous        = state.current;
+  this->yaw             = state.yaw;
+  this->camera.position = state.current.position;
+  this->camera.rotation = mjm::quat(mjm::vec3(0.0f, state.yaw, 0.0f));
+  this->stateHash       = this->world.Hash();
+  this->timestep.Reset();
 }
 
 void GameState::Update(ComPtr<ID3D11DeviceContext> pContext, mj::ArrayList<DrawCommand>& drawList)
@@ -54,55 +365,149 @@ void GameState::Update(ComPtr<ID3D11DeviceContext> pContext, mj::ArrayList<DrawC
   // Reset button
   if (!ImGui::IsAnyWindowFocused() && mj::input::GetKeyDown(Key::KeyR))
   {
+    this->replayMode = ReplayMode::Off;
     Entry();
   }
+  bool online = this->client != UINT32_MAX;
+  if (!online && !ImGui::IsAnyWindowFocused())
+  {
+    if (mj::input::GetKeyDown(Key::F5))
+    {
+      QuickSave();
+    }
+    if (mj::input::GetKeyDown(Key::F9))
+    {
+      QuickLoad();
+    }
+  }
 
   {
     ImGui::Begin("Debug");
-    ImGui::Text("R to reset, F3 toggles editor");
+    ImGui::Text("R to reset, F3 toggles editor, F5 quicksave, F9 quickload");
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate,
                 ImGui::GetIO().Framerate);
+    ImGui::Text("Simulation %.0f Hz, %u tick(s) this frame, %.3f ms", GameState::TICK_RATE,
+                this->timestep.GetNumTicksThisFrame(), this->simulationTime);
+    ImGui::Text("Tick %u, state hash %016llx", online ? this->server.world.tick : this->world.tick,
+                (unsigned long long)this->stateHash);
+    if (ImGui::Checkbox("Play through local server", &online))
+    {
+      if (online)
+      {
+        MJ_DISCARD(Connect());
+      }
+      else
+      {
+        Entry();
+      }
+    }
+    if (this->client != UINT32_MAX)
+    {
+      const Prediction::Stats& stats = this->prediction.GetStats();
+      ImGui::SliderInt("Ping (ms)", &this->ping, 0, GameState::MAX_PING);
+      ImGui::Text("%u inputs in flight, %u corrections, %u inputs replayed (max %u), largest %.3f cells",
+                  this->prediction.GetNumPending(), stats.numCorrections, stats.numReplayed, stats.maxReplayed,
+                  stats.maxError);
+    }
+    else
+    {
+      if (ImGui::Button("Record replay"))
+      {
+        StartReplay(ReplayMode::Recording);
+      }
+      ImGui::SameLine();
+      if (this->replay.GetNumTicks() > 0 && ImGui::Button("Play back"))
+      {
+        StartReplay(ReplayMode::Playback);
+      }
+      if (ImGui::Button("Quicksave"))
+      {
+        QuickSave();
+      }
+      ImGui::SameLine();
+      if (ImGui::Button("Quickload"))
+      {
+        QuickLoad();
+      }
+      ImGui::SameLine();
+      ImGui::Checkbox("Compress saves", &this->compressSaves);
+      ShowSaveStats(this->saveGame);
+      if (this->loadFailed)
+      {
+        ImGui::Text("Could not load %s", QUICKSAVE_PATH);
+      }
+    }
+    if (this->replayMode == ReplayMode::Recording)
+    {
+      ImGui::Text("Recording, %u ticks", this->replay.GetNumTicks());
+    }
+    else if (this->replayMode == ReplayMode::Playback)
+    {
+      ImGui::Text("Playing back, tick %u of %u", this->world.tick, this->replay.GetNumTicks());
+    }
+    if (this->replay.GetDesyncTick() != UINT32_MAX)
+    {
+      ImGui::Text("Desync at tick %u", this->replay.GetDesyncTick());
+    }
+    ShowLevelLoading(this->pMeta);
+    ShowTextureStreaming(this->pMeta);
+    ShowAssetStats();
+    ShowFrameStats();
+#ifdef MJ_PROFILER_ENABLED
+    if (ImGui::Button("Save profile (profile.json)"))
+    {
+      MJ_DISCARD(mj::profiler::WriteChromeTrace("profile.json"));
+    }
+#endif
     ImGui::End();
   }
 
-  const float dt = mj::GetDeltaTime();
-
   auto& cam = this->camera;
-  if (mj::input::GetKey(Key::KeyW))
-  {
-    mjm::vec3 vec = cam.rotation * axis::FORWARD;
-    vec.y         = 0.0f;
-    cam.position += mjm::vec3(mjm::normalize(vec) * dt * GameState::MOVEMENT_FACTOR);
-  }
-  if (mj::input::GetKey(Key::KeyA))
-  {
-    mjm::vec3 vec = cam.rotation * axis::LEFT;
-    vec.y         = 0.0f;
-    cam.position += mjm::vec3(mjm::normalize(vec) * dt * GameState::MOVEMENT_FACTOR);
-  }
-  if (mj::input::GetKey(Key::KeyS))
-  {
-    mjm::vec3 vec = cam.rotation * axis::BACKWARD;
-    vec.y         = 0.0f;
-    cam.position += mjm::vec3(mjm::normalize(vec) * dt * GameState::MOVEMENT_FACTOR);
-  }
-  if (mj::input::GetKey(Key::KeyD))
+
+  // Mouse look stays at frame rate, it only affects the view
+  float yaw = ApplyMouseLook(this->yaw);
+  if (yaw != this->yaw)
   {
-    mjm::vec3 vec = cam.rotation * axis::RIGHT;
-    vec.y         = 0.0f;
-    cam.position += mjm::vec3(mjm::normalize(vec) * dt * GameState::MOVEMENT_FACTOR);
+    cam.rotation = mjm::quat(mjm::vec3(0.0f, yaw, 0));
+    this->yaw    = yaw;
   }
 
-  MJ_UNINITIALIZED int32_t dx, dy;
-  mj::input::GetRelativeMouseMovement(&dx, &dy);
-  this->currentMousePos -= GameState::ROT_SPEED * dx;
-  if (this->currentMousePos != this->lastMousePos)
+  // Run as many fixed ticks as the elapsed time allows
   {
-    cam.rotation       = mjm::quat(mjm::vec3(0.0f, -this->currentMousePos, 0));
-    this->yaw          = -this->currentMousePos;
-    this->lastMousePos = this->currentMousePos;
+    Uint64 start = SDL_GetPerformanceCounter();
+    this->timestep.Advance(mj::GetDeltaTime());
+    while (this->timestep.Step())
+    {
+      this->previous    = this->current;
+      PlayerInput input = SampleControls(this->yaw);
+      if (this->replayMode == ReplayMode::Playback)
+      {
+        if (this->world.tick < this->replay.GetNumTicks())
+        {
+          input     = this->replay.GetInputs(this->world.tick)[0];
+          this->yaw = input.yaw * (6.28318530718f / 65536.0f);
+        }
+        else
+        {
+          this->replayMode = ReplayMode::Off;
+        }
+      }
+      if (this->client != UINT32_MAX)
+      {
+        TickOnline(input);
+      }
+      else
+      {
+        Tick(input);
+      }
+    }
+    this->simulationTime =
+        (float)(SDL_GetPerformanceCounter() - start) * 1000.0f / (float)SDL_GetPerformanceFrequency();
   }
 
+  // Render between the last two simulation states
+  cam.position = mjm::mix(this->previous.position, this->current.position, this->timestep.GetAlpha());
+
   mjm::mat4 rotate    = mjm::transpose(mjm::eulerAngleY(this->yaw));
   mjm::mat4 translate = mjm::identity<mjm::mat4>();
   translate           = mjm::translate(translate, -mjm::vec3(cam.position));
@@ -115,14 +520,5 @@ void GameState::Update(ComPtr<ID3D11DeviceContext> pContext, mj::ArrayList<DrawC
 
   cam.viewProjection = projection * view;
 
-  {
-    auto* pCmd = drawList.EmplaceSingle();
-    if (pCmd)
-    {
-      pCmd->pCamera      = &this->camera;
-      pCmd->pMesh        = &this->levelMesh;
-      pCmd->vertexShader = Graphics::GetVertexShader();
-      pCmd->pixelShader  = Graphics::GetPixelShader();
-    }
-  }
+  this->levelMesh.Draw(drawList, &this->camera);
 }
@@ -1,25 +1,101 @@
 #pragma once
 #include "state_machine.h"
 #include "camera.h"
+#include "world.h"
+#include "replay.h"
+#include "server.h"
+#include "prediction.h"
+#include "savegame.h"
+#include "level_loader.h"
 
 class GameState : public StateBase
 {
 public:
   // StateBase
+  void Init(ComPtr<ID3D11Device> pDevice) override;
   void Entry() override;
   void Update(ComPtr<ID3D11DeviceContext> pContext, mj::ArrayList<DrawCommand>& drawList) override;
 
-  void SetLevel(Level level, ComPtr<ID3D11Device> pDevice);
+  /// <summary>
+  /// Swaps in a loaded level, which receives the previous one
+  /// </summary>
+  void SetLevel(LoadedLevel& level);
+
+  /// <summary>
+  /// Finishes pending saves
+  /// </summary>
+  void Destroy();
 
 private:
-  static constexpr float MOVEMENT_FACTOR = 3.0f;
-  static constexpr float ROT_SPEED       = 0.0025f;
+  static constexpr float TICK_RATE           = 60.0f;
+  static constexpr float PLAYER_RADIUS       = 0.25f;
+  static constexpr uint32_t MAX_REPLAY_TICKS = 36000; // Ten minutes
+  static constexpr uint32_t QUEUE_CAPACITY   = 128;   // Packets in flight to and from the local server
+  static constexpr int32_t MAX_PING          = 1000;  // Milliseconds
+
+  /// <summary>
+  /// Everything that is advanced at the fixed simulation rate
+  /// </summary>
+  struct SimState
+  {
+    mjm::vec3 position;
+  };
+
+  /// <summary>
+  /// Game state that is saved along with the world
+  /// </summary>
+  struct SavedState
+  {
+    mj::Entity player;
+    SimState current;
+    float yaw;
+  };
+
+  enum class ReplayMode
+  {
+    Off,
+    Recording,
+    Playback,
+  };
+
+  void Tick(const PlayerInput& input);
+  void StartReplay(ReplayMode mode);
+  bool Connect();
+  void Disconnect();
+  void TickOnline(const PlayerInput& input);
+  void QuickSave();
+  void QuickLoad();
+
+  mj::FixedTimestep timestep = mj::FixedTimestep(1.0f / GameState::TICK_RATE);
+  SimState previous;
+  SimState current;
+  float simulationTime; // Milliseconds spent in Tick() this frame
+  uint64_t stateHash;   // World::Hash() after the last tick
+
+  Replay replay;
+  ReplayMode replayMode = ReplayMode::Off;
+
+  float yaw; // Radians, of the view
+
+  LevelMesh levelMesh;
+  mj::Grid grid;
+  World world;
+  mj::Entity player;
 
-  float lastMousePos;
-  float currentMousePos;
-  float yaw;
+  // Playing through an in-process server instead of the local world, with a simulated ping
+  Server server;
+  mj::net::Loopback connection;
+  mj::net::DelayQueue toServer;
+  mj::net::DelayQueue toClient;
+  SnapshotHistory snapshots;
+  Prediction prediction;
+  uint32_t client = UINT32_MAX; // UINT32_MAX when playing offline
+  uint32_t ackTick;
+  int32_t ping = 100; // Milliseconds, round trip
 
-  Mesh levelMesh;
+  SaveGame saveGame;
+  bool compressSaves = true;
+  bool loadFailed    = false;
 
   Camera camera;
 };
@@ -1,5 +1,7 @@
 #include "pch.h"
 #include "graphics.h"
+#include "mj_assets.h"
+#include "mj_bc.h"
 #include "mj_common.h"
 #include "level.h"
 #include "camera.h"
@@ -9,6 +11,8 @@
 #include "generated/rasterizer_vs.h"
 #include "generated/rasterizer_ps.h"
 
+#include <utility> // std::swap
+
 ComPtr<ID3D11InputLayout> Graphics::s_InputLayout;
 ComPtr<ID3D11VertexShader> Graphics::s_VertexShader;
 ComPtr<ID3D11PixelShader> Graphics::s_PixelShader;
@@ -120,7 +124,8 @@ Mesh Graphics::CreateMesh(ComPtr<ID3D11Device> pDevice, const mj::ArrayListView<
   return mesh;
 }
 
-void Graphics::InsertWalls(mj::ArrayList<Vertex>& vertices, mj::ArrayList<uint16_t>& indices, const Level* pLevel)
+void Graphics::InsertWalls(mj::ArrayList<Vertex>& vertices, mj::ArrayList<uint16_t>& indices, const Level* pLevel,
+                           uint32_t x0, uint32_t z0, uint32_t x1, uint32_t z1)
 {
   uint8_t xz[] = { 0, 0 }; // xz yzx zxy
 
@@ -129,7 +134,8 @@ void Graphics::InsertWalls(mj::ArrayList<Vertex>& vertices, mj::ArrayList<uint16
   // -X, -Z, +X, +Z
   for (int32_t i = 0; i < 4; i++)
   {
-    int32_t levelDim[]    = { pLevel->width, pLevel->height };
+    int32_t begin[]       = { (int32_t)x0, (int32_t)z0 };
+    int32_t end[]         = { (int32_t)x1, (int32_t)z1 };
     int32_t primaryAxis   = i & 1;           //  x  z  x  z
     int32_t secondaryAxis = primaryAxis ^ 1; //  z  x  z  x
 
@@ -139,10 +145,11 @@ void Graphics::InsertWalls(mj::ArrayList<Vertex>& vertices, mj::ArrayList<uint16
     int32_t next_x  = (i + 1) & 3;       //  0,  1,  1,  0
 
     // Traverse the level slice by slice from a single direction
-    for (xz[primaryAxis] = 0; xz[primaryAxis] < levelDim[primaryAxis]; xz[primaryAxis]++)
+    for (xz[primaryAxis] = (uint8_t)begin[primaryAxis]; xz[primaryAxis] < end[primaryAxis]; xz[primaryAxis]++)
     {
       // Check for blocks in this slice
-      for (xz[secondaryAxis] = 0; xz[secondaryAxis] < levelDim[secondaryAxis]; xz[secondaryAxis]++)
+      for (xz[secondaryAxis] = (uint8_t)begin[secondaryAxis]; xz[secondaryAxis] < end[secondaryAxis];
+           xz[secondaryAxis]++)
       {
         uint16_t block = pLevel->pBlocks[xz[1] * pLevel->width + xz[0]];
 
@@ -297,82 +304,286 @@ static void CreateDefaultTexture(ComPtr<ID3D11Device> pDevice)
 #endif
 }
 
+/// <summary>
+/// Formats the asset cooker writes, see src/cooker. mj::dds::ParseArray() accepts no others.
+/// </summary>
+static DXGI_FORMAT GetTextureArrayFormat(mj::dds::Format format)
+{
+  switch (format)
+  {
+  case mj::dds::Format::RGBA8:
+    return DXGI_FORMAT_R8G8B8A8_UNORM;
+  case mj::dds::Format::BC1:
+    return DXGI_FORMAT_BC1_UNORM;
+  case mj::dds::Format::BC3:
+    return DXGI_FORMAT_BC3_UNORM;
+  case mj::dds::Format::BC7:
+    return DXGI_FORMAT_BC7_UNORM;
+  default:
+    return DXGI_FORMAT_UNKNOWN;
+  }
+}
+
+TextureArrayData TextureArrayData::Load(const char* pName)
+{
+  ZoneScoped;
+  TextureArrayData data = {};
+  data.asset            = mj::assets::Load(pName);
+
+  bool valid = mj::dds::ParseArray(data.asset.pData, data.asset.size, &data.info) && //
+               (data.info.numLayers <= mj::LayerCache::MAX_LAYERS);
+  if (!valid)
+  {
+    Free(data);
+  }
+  return data;
+}
+
+void TextureArrayData::Free(TextureArrayData& data)
+{
+  mj::assets::Free(&data.asset);
+  data = {};
+}
+
+/// <summary>
+/// Flat mid grey, encoded like the layers it stands in for. Every mip is a whole number of 4x4 blocks or
+/// of texels, so one of them repeated fills the layer.
+/// </summary>
+static void FillFallbackLayer(const mj::dds::ArrayInfo& info, uint8_t* pLayer)
+{
+  MJ_UNINITIALIZED uint8_t texels[4 * 4 * 4];
+  for (uint32_t i = 0; i < 4 * 4; i++)
+  {
+    texels[i * 4 + 0] = 128;
+    texels[i * 4 + 1] = 128;
+    texels[i * 4 + 2] = 128;
+    texels[i * 4 + 3] = 255;
+  }
+  uint32_t unitSize = mj::dds::IsCompressed(info.format) ? 4 : 1;
+  MJ_UNINITIALIZED uint8_t unit[16];
+  mj::bc::Encode(info.format, texels, unitSize, unitSize, mj::bc::Quality::Fast, unit);
+
+  size_t unitBytes = mj::dds::GetMipSize(info.format, unitSize, unitSize);
+  for (size_t offset = 0; offset < info.layerSize; offset += unitBytes)
+  {
+    memcpy(pLayer + offset, unit, unitBytes);
+  }
+}
+
+bool Graphics::CreateTextureArray(ComPtr<ID3D11Device> pDevice)
+{
+  ZoneScoped;
+  MJ_DISCARD(this->residency.Init(0, 0)); // Everything uses the fallback slot until the new texture exists
+
+  const mj::dds::ArrayInfo& info = this->textureArray.info;
+  uint32_t numSlots              = info.numLayers + 1; // One for the fallback
+  numSlots                       = numSlots < NUM_RESIDENT_LAYERS ? numSlots : NUM_RESIDENT_LAYERS;
+  D3D11_TEXTURE2D_DESC desc      = {};
+  desc.Width                     = info.width;
+  desc.Height                    = info.height;
+  desc.MipLevels                 = info.numMips;
+  desc.ArraySize                 = numSlots;
+  desc.Format                    = GetTextureArrayFormat(info.format);
+  desc.SampleDesc.Count          = 1;
+  desc.SampleDesc.Quality        = 0;
+  desc.Usage                     = D3D11_USAGE_DEFAULT; // Layers are uploaded as they are drawn
+  desc.BindFlags                 = D3D11_BIND_SHADER_RESOURCE;
+  desc.CPUAccessFlags            = 0;
+  desc.MiscFlags                 = 0;
+
+  // Every slot starts out as the fallback layer, one subresource per mip, see D3D11CalcSubresource()
+  uint8_t* pFallback = (uint8_t*)malloc(info.layerSize);
+  if (!pFallback)
+  {
+    return false;
+  }
+  FillFallbackLayer(info, pFallback);
+  uint32_t numSubresources = numSlots * info.numMips;
+  D3D11_SUBRESOURCE_DATA* srd =
+      (D3D11_SUBRESOURCE_DATA*)alloca(numSubresources * sizeof(D3D11_SUBRESOURCE_DATA));
+  for (uint32_t slot = 0; slot < numSlots; slot++)
+  {
+    for (uint32_t mip = 0; mip < info.numMips; mip++)
+    {
+      uint32_t width                      = (info.width >> mip) > 0 ? info.width >> mip : 1;
+      D3D11_SUBRESOURCE_DATA& subresource = srd[D3D11CalcSubresource(mip, slot, info.numMips)];
+      size_t offset                       = mj::dds::GetLayerSize(info.format, info.width, info.height, mip);
+      subresource.pSysMem                 = pFallback + offset;
+      subresource.SysMemPitch             = (UINT)mj::dds::GetRowPitch(info.format, width);
+      subresource.SysMemSlicePitch        = 0;
+    }
+  }
+
+  ComPtr<ID3D11Texture2D> pTexture;
+  ComPtr<ID3D11ShaderResourceView> pView;
+  bool created = SUCCEEDED(pDevice->CreateTexture2D(&desc, srd, pTexture.ReleaseAndGetAddressOf()));
+  free(pFallback);
+  if (!created)
+  {
+    return false;
+  }
+
+  D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+  srvDesc.Format                          = desc.Format;
+  srvDesc.ViewDimension                   = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+  srvDesc.Texture2DArray.MostDetailedMip  = 0;
+  srvDesc.Texture2DArray.MipLevels        = info.numMips;
+  srvDesc.Texture2DArray.FirstArraySlice  = 0;
+  srvDesc.Texture2DArray.ArraySize        = numSlots;
+  if (FAILED(pDevice->CreateShaderResourceView(pTexture.Get(), &srvDesc, pView.ReleaseAndGetAddressOf())))
+  {
+    return false;
+  }
+
+  this->pTextureArray       = pTexture;
+  this->pShaderResourceView = pView;
+  MJ_DISCARD(this->residency.Init(info.numLayers, numSlots));
+  return true;
+}
+
 void Graphics::InitTexture2DArray(ComPtr<ID3D11Device> pDevice)
 {
-  MJ_UNINITIALIZED size_t datasize;
-  void* pFile = SDL_LoadFile("texture_array.dds", &datasize);
-  if (pFile)
+  // Nothing is uploaded until it is drawn
+  this->textureArray = TextureArrayData::Load(Graphics::TEXTURE_ARRAY_PATH);
+  if (this->textureArray.info.numLayers > 0)
   {
-    bx::Error error;
-    bimg::ImageContainer* pImageContainer =
-        bimg::imageParseDds(&this->defaultAllocator, pFile, (uint32_t)datasize, &error);
+    MJ_DISCARD(this->CreateTextureArray(pDevice));
+  }
 
-    if (pImageContainer)
+  {
+    D3D11_BUFFER_DESC desc   = {};
+    desc.ByteWidth           = mj::LayerCache::MAX_LAYERS * sizeof(uint32_t);
+    desc.Usage               = D3D11_USAGE_DYNAMIC;
+    desc.BindFlags           = D3D11_BIND_CONSTANT_BUFFER;
+    desc.CPUAccessFlags      = D3D11_CPU_ACCESS_WRITE;
+    desc.MiscFlags           = 0;
+    desc.StructureByteStride = 0;
+    MJ_DISCARD(pDevice->CreateBuffer(&desc, nullptr, this->pLayerSlots.ReleaseAndGetAddressOf()));
+  }
+
+  D3D11_SAMPLER_DESC samplerDesc = {};
+  samplerDesc.Filter             = D3D11_FILTER_MIN_MAG_POINT_MIP_LINEAR; // Texels stay sharp up close
+  samplerDesc.AddressU           = D3D11_TEXTURE_ADDRESS_WRAP;
+  samplerDesc.AddressV           = D3D11_TEXTURE_ADDRESS_WRAP;
+  samplerDesc.AddressW           = D3D11_TEXTURE_ADDRESS_WRAP;
+  samplerDesc.MipLODBias         = 0.0f;
+  samplerDesc.MaxAnisotropy      = 16;
+  samplerDesc.ComparisonFunc     = D3D11_COMPARISON_LESS_EQUAL;
+  samplerDesc.BorderColor[0]     = 0.0f;
+  samplerDesc.BorderColor[1]     = 0.0f;
+  samplerDesc.BorderColor[2]     = 0.0f;
+  samplerDesc.BorderColor[3]     = 0.0f;
+  samplerDesc.MinLOD             = 0.0f;
+  samplerDesc.MaxLOD             = D3D11_FLOAT32_MAX;
+  pDevice->CreateSamplerState(&samplerDesc, this->pTextureSamplerState.ReleaseAndGetAddressOf());
+}
+
+uint32_t Graphics::UpdateTextureArray(ComPtr<ID3D11Device> pDevice, ComPtr<ID3D11DeviceContext> pContext,
+                                      TextureArrayData& data)
+{
+  ZoneScoped;
+  if (data.info.numLayers == 0)
+  {
+    return 0;
+  }
+
+  const mj::dds::ArrayInfo& previous = this->textureArray.info;
+
+  bool sameLayout = this->pTextureArray &&                     //
+                    (data.info.format == previous.format) &&   //
+                    (data.info.width == previous.width) &&     //
+                    (data.info.height == previous.height) &&   //
+                    (data.info.numMips == previous.numMips) && //
+                    (data.info.numLayers == previous.numLayers);
+  std::swap(this->textureArray, data);
+  if (!sameLayout)
+  {
+    MJ_DISCARD(this->CreateTextureArray(pDevice));
+    return 0;
+  }
+
+  // Layers that are not resident are read from the new file when they are drawn
+  const mj::dds::ArrayInfo& info = this->textureArray.info;
+  const uint32_t* slots          = this->residency.GetSlots();
+  uint32_t numUpdated            = 0;
+  for (uint32_t layer = 0; layer < info.numLayers; layer++)
+  {
+    const uint8_t* pLayer         = info.pLayers + layer * info.layerSize;
+    const uint8_t* pPreviousLayer = data.info.pLayers + layer * info.layerSize;
+    if ((slots[layer] != mj::LayerCache::FALLBACK_SLOT) && (memcmp(pLayer, pPreviousLayer, info.layerSize) != 0))
     {
-      D3D11_TEXTURE2D_DESC desc = {};
-      desc.Width                = pImageContainer->m_width;
-      desc.Height               = pImageContainer->m_height;
-      desc.MipLevels            = pImageContainer->m_numMips;
-      desc.ArraySize            = pImageContainer->m_numLayers;
-      desc.Format               = DXGI_FORMAT_R8G8B8A8_UNORM;
-      desc.SampleDesc.Count     = 1;
-      desc.SampleDesc.Quality   = 0;
-      desc.Usage                = D3D11_USAGE_IMMUTABLE;
-      desc.BindFlags            = D3D11_BIND_SHADER_RESOURCE;
-      desc.CPUAccessFlags       = 0;
-      desc.MiscFlags            = 0;
-
-      pImageContainer->m_offset = UINT32_MAX;
-      D3D11_SUBRESOURCE_DATA* srd =
-          (D3D11_SUBRESOURCE_DATA*)alloca(pImageContainer->m_numLayers * sizeof(D3D11_SUBRESOURCE_DATA));
-      MJ_UNINITIALIZED bimg::ImageMip mip;
-      for (uint16_t i = 0; i < pImageContainer->m_numLayers; i++)
-      {
-        constexpr uint8_t lod = 0;
-        if (bimg::imageGetRawData(*pImageContainer, i, lod, nullptr, 0, MJ_REF mip))
-        {
-          srd[i].pSysMem          = mip.m_data;
-          srd[i].SysMemPitch      = mip.m_width * mip.m_bpp / 8;
-          srd[i].SysMemSlicePitch = 0;
-        }
-      }
+      this->UploadLayer(pContext, layer, slots[layer]);
+      numUpdated++;
+    }
+  }
+  return numUpdated;
+}
 
-      MJ_DISCARD(pDevice->CreateTexture2D(&desc, srd, this->pTextureArray.ReleaseAndGetAddressOf()));
-
-      D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-      srvDesc.Format                          = desc.Format;
-      srvDesc.ViewDimension                   = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
-      srvDesc.Texture2DArray.MostDetailedMip  = 0;
-      srvDesc.Texture2DArray.MipLevels        = 1;
-      srvDesc.Texture2DArray.FirstArraySlice  = 0;
-      srvDesc.Texture2DArray.ArraySize        = pImageContainer->m_numLayers;
-
-      MJ_DISCARD(pDevice->CreateShaderResourceView(this->pTextureArray.Get(), &srvDesc,
-                                                   this->pShaderResourceView.ReleaseAndGetAddressOf()));
-
-      D3D11_SAMPLER_DESC samplerDesc = {};
-      samplerDesc.Filter             = D3D11_FILTER_MINIMUM_MIN_MAG_MIP_POINT;
-      samplerDesc.AddressU           = D3D11_TEXTURE_ADDRESS_WRAP;
-      samplerDesc.AddressV           = D3D11_TEXTURE_ADDRESS_WRAP;
-      samplerDesc.AddressW           = D3D11_TEXTURE_ADDRESS_WRAP;
-      samplerDesc.MipLODBias         = 0.0f;
-      samplerDesc.MaxAnisotropy      = 16;
-      samplerDesc.ComparisonFunc     = D3D11_COMPARISON_LESS_EQUAL;
-      samplerDesc.BorderColor[0]     = 0.0f;
-      samplerDesc.BorderColor[1]     = 0.0f;
-      samplerDesc.BorderColor[2]     = 0.0f;
-      samplerDesc.BorderColor[3]     = 0.0f;
-      samplerDesc.MinLOD             = 0.0f;
-      samplerDesc.MaxLOD             = D3D11_FLOAT32_MAX;
-      pDevice->CreateSamplerState(&samplerDesc, this->pTextureSamplerState.ReleaseAndGetAddressOf());
-
-      bimg::imageFree(pImageContainer);
+void Graphics::UploadLayer(ComPtr<ID3D11DeviceContext> pContext, uint32_t layer, uint32_t slot)
+{
+  ZoneScoped;
+  const mj::dds::ArrayInfo& info = this->textureArray.info;
+  const uint8_t* pLayer          = info.pLayers + layer * info.layerSize;
+  for (uint32_t mip = 0; mip < info.numMips; mip++)
+  {
+    uint32_t width = (info.width >> mip) > 0 ? info.width >> mip : 1;
+    size_t offset  = mj::dds::GetLayerSize(info.format, info.width, info.height, mip); // Of the larger mips
+    pContext->UpdateSubresource(this->pTextureArray.Get(), D3D11CalcSubresource(mip, slot, info.numMips), nullptr,
+                                pLayer + offset, (UINT)mj::dds::GetRowPitch(info.format, width), 0);
+  }
+}
+
+/// <summary>
+/// Makes the layers of the draw list resident before anything is drawn, and tells the vertex shader
+/// which slot every layer is in
+/// </summary>
+void Graphics::StreamLayers(ComPtr<ID3D11DeviceContext> pContext, const mj::ArrayList<DrawCommand>& drawList)
+{
+  ZoneScoped;
+  if (!this->pTextureArray || !this->pLayerSlots)
+  {
+    return;
+  }
+
+  this->residency.NewFrame();
+  for (const auto& command : drawList)
+  {
+    if (command.pLayers)
+    {
+      this->residency.Reference(*command.pLayers);
     }
+  }
 
-    SDL_free(pFile);
+  // Page faults of a mapped pack happen here; the rest of the queue waits for the next frames
+  MJ_UNINITIALIZED uint32_t requests[Graphics::MAX_UPLOADS_PER_FRAME];
+  uint32_t numRequests = this->residency.TakeRequests(requests, MJ_COUNTOF(requests));
+  for (uint32_t i = 0; i < numRequests; i++)
+  {
+    uint32_t slot = this->residency.Insert(requests[i]);
+    if (slot != mj::LayerCache::FALLBACK_SLOT)
+    {
+      this->UploadLayer(pContext, requests[i], slot);
+    }
+  }
+
+  MJ_UNINITIALIZED D3D11_MAPPED_SUBRESOURCE mappedResource;
+  if (SUCCEEDED(pContext->Map(this->pLayerSlots.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource)))
+  {
+    memcpy(mappedResource.pData, this->residency.GetSlots(), mj::LayerCache::MAX_LAYERS * sizeof(uint32_t));
+    pContext->Unmap(this->pLayerSlots.Get(), 0);
   }
 }
 
+mj::LayerCache::Stats Graphics::GetResidencyStats() const
+{
+  return this->residency.GetStats();
+}
+
+Graphics::~Graphics()
+{
+  TextureArrayData::Free(this->textureArray);
+}
+
 void Graphics::Init(ComPtr<ID3D11Device> pDevice)
 {
   MJ_DISCARD(pDevice->CreateVertexShader(rasterizer_vs, sizeof(rasterizer_vs), nullptr,
@@ -474,6 +685,8 @@ void Graphics::Update(ComPtr<ID3D11DeviceContext> pContext, const mj::ArrayList<
   viewport.MaxDepth       = 1.0f;
   mj::GetWindowSize(&viewport.Width, &viewport.Height);
 
+  this->StreamLayers(pContext, drawList);
+
   pContext->RSSetViewports(1, &viewport);
   pContext->RSSetState(this->pRasterizerState.Get());
 
@@ -495,6 +708,7 @@ void Graphics::Update(ComPtr<ID3D11DeviceContext> pContext, const mj::ArrayList<
       // Vertex Shader
       pContext->VSSetShader(command.vertexShader.Get(), nullptr, 0);
       pContext->VSSetConstantBuffers(0, 1, this->pResource.GetAddressOf());
+      pContext->VSSetConstantBuffers(1, 1, this->pLayerSlots.GetAddressOf());
 
       // Pixel Shader
       pContext->PSSetShaderResources(0, 1, this->pShaderResourceView.GetAddressOf());
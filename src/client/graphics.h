@@ -1,7 +1,10 @@
 #pragma once
 #include "level.h"
+#include "mj_assets.h"
 #include "mj_common.h"
+#include "mj_dds.h"
 #include "mj_math.h"
+#include "mj_residency.h"
 
 struct Camera;
 
@@ -243,18 +246,42 @@ struct DrawCommand
 {
   ComPtr<ID3D11VertexShader> vertexShader;
   ComPtr<ID3D11PixelShader> pixelShader;
-  const Mesh* pMesh        = nullptr;
-  const Camera* pCamera    = nullptr;
-  const mjm::mat4* pMatrix = nullptr;
+  const Mesh* pMesh           = nullptr;
+  const Camera* pCamera       = nullptr;
+  const mjm::mat4* pMatrix    = nullptr;
+  const mj::LayerSet* pLayers = nullptr; // Texture array layers of the mesh, if it uses the texture array
+};
+
+/// <summary>
+/// The texture array file, loaded and parsed on any thread. Layers are uploaded on the main thread when
+/// they are first drawn, straight from the asset, which is a view into the pack if it is stored there.
+/// </summary>
+struct TextureArrayData
+{
+  mj::assets::Asset asset = {};
+  mj::dds::ArrayInfo info = {}; // numLayers is 0 if the file is missing, corrupt or in another format
+
+  static TextureArrayData Load(const char* pName);
+  static void Free(TextureArrayData& data);
 };
 
 class Graphics
 {
 public:
+  static constexpr const char* TEXTURE_ARRAY_PATH = "texture_array.dds";
+  static constexpr uint32_t NUM_RESIDENT_LAYERS   = 64; // Slots of the texture array, including the fallback
+  static constexpr uint32_t MAX_UPLOADS_PER_FRAME = 4;  // Other missing layers show the fallback for now
+
+  ~Graphics();
+
   static Mesh CreateMesh(ComPtr<ID3D11Device> pDevice, const mj::ArrayListView<float>& vertexData,
                          uint32_t numVertexComponents, const mj::ArrayListView<uint16_t>& indices,
                          D3D11_USAGE vertexBufferUsage, D3D11_USAGE indexBufferUsage);
-  static void InsertWalls(mj::ArrayList<Vertex>& vertices, mj::ArrayList<uint16_t>& indices, const Level* pLevel);
+  /// <summary>
+  /// Walls of the solid cells in [x0, x1) x [z0, z1) that face open cells
+  /// </summary>
+  static void InsertWalls(mj::ArrayList<Vertex>& vertices, mj::ArrayList<uint16_t>& indices, const Level* pLevel,
+                          uint32_t x0, uint32_t z0, uint32_t x1, uint32_t z1);
   static void InsertCeiling(mj::ArrayList<Vertex>& vertices, mj::ArrayList<uint16_t>& indices, float x, float z,
                             float texture);
   static void InsertFloor(mj::ArrayList<Vertex>& vertices, mj::ArrayList<uint16_t>& indices, float x, float y, float z,
@@ -266,6 +293,16 @@ public:
   void Init(ComPtr<ID3D11Device> pDevice);
   void Resize(int width, int height);
   void Update(ComPtr<ID3D11DeviceContext> pContext, const mj::ArrayList<DrawCommand>& drawList);
+
+  /// <summary>
+  /// Switches to a reloaded texture array, uploading the resident layers that changed. The texture is
+  /// created again if the size, format, mips or number of layers changed, and every layer streams in again.
+  /// </summary>
+  /// <param name="data">Gets the previous texture array, which the caller frees</param>
+  /// <returns>Number of layers uploaded</returns>
+  uint32_t UpdateTextureArray(ComPtr<ID3D11Device> pDevice, ComPtr<ID3D11DeviceContext> pContext,
+                              TextureArrayData& data);
+  mj::LayerCache::Stats GetResidencyStats() const;
   void* GetTileTexture(int x, int y);
 
 private:
@@ -274,14 +311,18 @@ private:
   static ComPtr<ID3D11PixelShader> s_PixelShader;
 
   void InitTexture2DArray(ComPtr<ID3D11Device> pDevice);
+  bool CreateTextureArray(ComPtr<ID3D11Device> pDevice);
+  void StreamLayers(ComPtr<ID3D11DeviceContext> pContext, const mj::ArrayList<DrawCommand>& drawList);
+  void UploadLayer(ComPtr<ID3D11DeviceContext> pContext, uint32_t layer, uint32_t slot);
 
   ComPtr<ID3D11Texture2D> pTextureArray;
   ComPtr<ID3D11SamplerState> pTextureSamplerState;
   ComPtr<ID3D11ShaderResourceView> pShaderResourceView; // Texture array SRV
+  ComPtr<ID3D11Buffer> pLayerSlots;                     // Slot of every layer of the file, see mj::LayerCache
+  TextureArrayData textureArray;                        // The file the resident layers come from
+  mj::LayerCache residency;
   ComPtr<ID3D11RasterizerState> pRasterizerState;
   ComPtr<ID3D11RasterizerState> pRasterizerStateCullNone;
   ComPtr<ID3D11BlendState> pBlendState;
   ComPtr<ID3D11Buffer> pResource;
-
-  bx::DefaultAllocator defaultAllocator;
 };
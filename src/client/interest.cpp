@@ -0,0 +1,243 @@
+// Interest - which entities each client is told about
+// Should not use pre-compiled headers (for portability)
+
+#include "interest.h"
+#include "mj_profiler.h"
+
+#include <math.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static uint32_t CountTrailingZeros(uint64_t value)
+{
+#if defined(_MSC_VER)
+  MJ_UNINITIALIZED unsigned long index;
+  _BitScanForward64(&index, value);
+  return (uint32_t)index;
+#else
+  return (uint32_t)__builtin_ctzll(value);
+#endif
+}
+
+static void GetCell(const EntityState& state, int32_t* pX, int32_t* pZ)
+{
+  mjm::vec3 position = GetPosition(state);
+  *pX                = (int32_t)floorf(position.x);
+  *pZ                = (int32_t)floorf(position.z);
+}
+
+bool InterestMap::Init(uint32_t maxClients, uint32_t maxEntities)
+{
+  this->maxClients  = maxClients;
+  this->maxEntities = maxEntities;
+  this->numWords    = (maxEntities + 63) / 64;
+  this->pViewers    = (Viewer*)calloc(maxClients, sizeof(Viewer));
+  this->pTracked    = (Tracked*)calloc(maxEntities, sizeof(Tracked));
+  this->pActive     = (uint32_t*)malloc(maxClients * sizeof(uint32_t));
+  if (!this->pViewers || !this->pTracked || !this->pActive)
+  {
+    Destroy();
+    return false;
+  }
+
+  this->numUpdates     = 0;
+  this->numCellChanges = 0;
+  this->numViewUpdates = 0;
+  return true;
+}
+
+void InterestMap::Destroy()
+{
+  for (uint32_t i = 0; this->pViewers && i < this->maxClients; i++)
+  {
+    RemoveClient(i);
+  }
+  free(this->pViewers);
+  free(this->pTracked);
+  free(this->pActive);
+  this->pViewers    = nullptr;
+  this->pTracked    = nullptr;
+  this->pActive     = nullptr;
+  this->maxClients  = 0;
+  this->maxEntities = 0;
+}
+
+bool InterestMap::AddClient(uint32_t client, uint32_t player)
+{
+  Viewer& viewer = this->pViewers[client];
+  if (!viewer.pRelevant)
+  {
+    viewer.pRelevant = (uint64_t*)malloc(this->numWords * sizeof(uint64_t));
+    if (!viewer.pRelevant || !viewer.fov.Init(InterestMap::VIEW_RADIUS))
+    {
+      RemoveClient(client);
+      return false;
+    }
+  }
+
+  memset(viewer.pRelevant, 0, this->numWords * sizeof(uint64_t));
+  viewer.player  = player;
+  viewer.x       = INT32_MIN;
+  viewer.z       = INT32_MIN;
+  viewer.active  = true;
+  viewer.rebuild = true;
+  return true;
+}
+
+void InterestMap::RemoveClient(uint32_t client)
+{
+  Viewer& viewer = this->pViewers[client];
+  viewer.fov.Destroy();
+  free(viewer.pRelevant);
+  viewer.pRelevant = nullptr;
+  viewer.active    = false;
+}
+
+bool InterestMap::IsRelevant(const Viewer& viewer, int32_t x, int32_t z) const
+{
+  int32_t dx = x - viewer.x;
+  int32_t dz = z - viewer.z;
+  if (dx >= -InterestMap::NEAR_RADIUS && dx <= InterestMap::NEAR_RADIUS && //
+      dz >= -InterestMap::NEAR_RADIUS && dz <= InterestMap::NEAR_RADIUS)
+  {
+    return true;
+  }
+  return viewer.fov.IsVisible(x, z);
+}
+
+void InterestMap::SetRelevant(Viewer& viewer, uint32_t index, bool relevant)
+{
+  uint64_t bit = 1ull << (index & 63);
+  if (relevant)
+  {
+    viewer.pRelevant[index >> 6] |= bit;
+  }
+  else
+  {
+    viewer.pRelevant[index >> 6] &= ~bit;
+  }
+}
+
+void InterestMap::Update(const mj::Grid& grid, const Snapshot& snapshot)
+{
+  ZoneScoped;
+  this->numUpdates++;
+  this->numCellChanges = 0;
+  this->numViewUpdates = 0;
+
+  for (uint32_t i = 0; i < snapshot.numEntities; i++)
+  {
+    uint32_t index = snapshot.pEntities[i].entity.index;
+    if (index < this->maxEntities)
+    {
+      this->pTracked[index].slot   = i;
+      this->pTracked[index].update = this->numUpdates;
+    }
+  }
+
+  // Viewers that changed cell look around again and test every entity, the others only moved entities
+  uint32_t numActive  = 0;
+  uint32_t numRebuild = 0;
+  for (uint32_t i = 0; i < this->maxClients; i++)
+  {
+    Viewer& viewer = this->pViewers[i];
+    if (!viewer.active)
+    {
+      continue;
+    }
+
+    const Tracked* pPlayer = viewer.player < this->maxEntities ? &this->pTracked[viewer.player] : nullptr;
+    if (!pPlayer || pPlayer->update != this->numUpdates)
+    {
+      // Not in this snapshot: keep what it saw last, and look again once it is back
+      viewer.rebuild = true;
+      continue;
+    }
+
+    MJ_UNINITIALIZED int32_t x, z;
+    GetCell(snapshot.pEntities[pPlayer->slot], &x, &z);
+    if (viewer.rebuild || x != viewer.x || z != viewer.z)
+    {
+      viewer.x       = x;
+      viewer.z       = z;
+      viewer.rebuild = true;
+      viewer.fov.Compute(grid, x, z, InterestMap::VIEW_RADIUS);
+      memset(viewer.pRelevant, 0, this->numWords * sizeof(uint64_t));
+      this->numViewUpdates++;
+    }
+
+    // Rebuilding viewers go to the back
+    if (viewer.rebuild)
+    {
+      numRebuild++;
+      this->pActive[this->maxClients - numRebuild] = i;
+    }
+    else
+    {
+      this->pActive[numActive++] = i;
+    }
+  }
+
+  for (uint32_t i = 0; i < snapshot.numEntities; i++)
+  {
+    const EntityState& state = snapshot.pEntities[i];
+    uint32_t index           = state.entity.index;
+    if (index >= this->maxEntities)
+    {
+      continue;
+    }
+
+    MJ_UNINITIALIZED int32_t x, z;
+    GetCell(state, &x, &z);
+    Tracked& tracked = this->pTracked[index];
+    if ((tracked.generation != state.entity.generation) || (tracked.x != x) || (tracked.z != z))
+    {
+      tracked.generation = state.entity.generation;
+      tracked.x          = x;
+      tracked.z          = z;
+      this->numCellChanges++;
+      for (uint32_t j = 0; j < numActive; j++)
+      {
+        Viewer& viewer = this->pViewers[this->pActive[j]];
+        SetRelevant(viewer, index, IsRelevant(viewer, x, z));
+      }
+    }
+
+    for (uint32_t j = this->maxClients - numRebuild; j < this->maxClients; j++)
+    {
+      Viewer& viewer = this->pViewers[this->pActive[j]];
+      SetRelevant(viewer, index, IsRelevant(viewer, x, z));
+    }
+  }
+
+  for (uint32_t j = this->maxClients - numRebuild; j < this->maxClients; j++)
+  {
+    this->pViewers[this->pActive[j]].rebuild = false;
+  }
+}
+
+void InterestMap::Filter(uint32_t client, const Snapshot& snapshot, Snapshot* pOut) const
+{
+  ZoneScoped;
+  const Viewer& viewer = this->pViewers[client];
+  uint32_t count       = 0;
+  for (uint32_t word = 0; viewer.active && word < this->numWords; word++)
+  {
+    uint64_t bits = viewer.pRelevant[word];
+    while (bits && count < pOut->capacity)
+    {
+      uint32_t index = word * 64 + CountTrailingZeros(bits);
+      bits &= bits - 1;
+
+      // Entities that died keep their bit until the index is used again
+      const Tracked& tracked = this->pTracked[index];
+      if (tracked.update == this->numUpdates && tracked.slot < snapshot.numEntities &&
+          snapshot.pEntities[tracked.slot].entity.index == index)
+      {
+        pOut->pEntities[count++] = snapshot.pEntities[tracked.slot];
+      }
+    }
+  }
+  pOut->numEntities = count;
+}
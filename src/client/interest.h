@@ -0,0 +1,92 @@
+// Interest - which entities each client is told about
+// Should not use pre-compiled headers (for portability)
+//
+// An entity is relevant to a client if its cell is within NEAR_RADIUS cells of the client's player,
+// or visible from the player's cell within VIEW_RADIUS (mj::FieldOfView). Snapshots sent to a client
+// only contain its relevant entities, which keeps both bandwidth and encoding cost per client
+// proportional to what it can see instead of to the size of the world.
+//
+// Relevancy is kept as one bit per client and entity index, and updated incrementally from the
+// snapshots themselves: an entity is only tested again when it moves to another cell (one bit test per
+// client), and a client's field of view is only recomputed when its player changes cell.
+
+#pragma once
+#include "mj_fov.h"
+#include "snapshot.h"
+
+class InterestMap
+{
+public:
+  static constexpr int32_t VIEW_RADIUS = 24; // Cells
+  static constexpr int32_t NEAR_RADIUS = 2;  // Cells, so that entities around a corner do not pop in
+
+  bool Init(uint32_t maxClients, uint32_t maxEntities);
+  void Destroy();
+
+  /// <summary>
+  /// Starts tracking a client. Its relevant set is built on the next Update().
+  /// </summary>
+  /// <param name="player">Entity index of the client's player</param>
+  /// <returns>False if out of memory</returns>
+  bool AddClient(uint32_t client, uint32_t player);
+  void RemoveClient(uint32_t client);
+
+  /// <summary>
+  /// Brings relevancy up to date with a new snapshot of the whole world.
+  /// </summary>
+  void Update(const mj::Grid& grid, const Snapshot& snapshot);
+
+  /// <summary>
+  /// Copies the entities of the snapshot passed to the last Update() that are relevant to a client,
+  /// up to the capacity of pOut. The tick is not touched.
+  /// </summary>
+  void Filter(uint32_t client, const Snapshot& snapshot, Snapshot* pOut) const;
+
+  // Work done by the last Update()
+  uint32_t GetNumCellChanges() const
+  {
+    return this->numCellChanges;
+  }
+
+  uint32_t GetNumViewUpdates() const
+  {
+    return this->numViewUpdates;
+  }
+
+private:
+  struct Viewer
+  {
+    mj::FieldOfView fov;
+    uint64_t* pRelevant; // Bit per entity index
+    uint32_t player;
+    int32_t x;
+    int32_t z;
+    bool active;
+    bool rebuild; // Test every entity on the next update
+  };
+
+  /// <summary>
+  /// Last known state of an entity index
+  /// </summary>
+  struct Tracked
+  {
+    uint32_t generation; // 0 if never seen
+    int32_t x;
+    int32_t z;
+    uint32_t slot;   // Position in the snapshot of the last update
+    uint32_t update; // Update in which slot was set
+  };
+
+  bool IsRelevant(const Viewer& viewer, int32_t x, int32_t z) const;
+  void SetRelevant(Viewer& viewer, uint32_t index, bool relevant);
+
+  Viewer* pViewers        = nullptr;
+  Tracked* pTracked       = nullptr;
+  uint32_t* pActive       = nullptr; // Clients to update, those that rebuild at the back
+  uint32_t maxClients     = 0;
+  uint32_t maxEntities    = 0;
+  uint32_t numWords       = 0; // Per relevancy bitset
+  uint32_t numUpdates     = 0;
+  uint32_t numCellChanges = 0;
+  uint32_t numViewUpdates = 0;
+};
@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "level.h"
+#include "mj_assets.h"
 #include "mj_common.h"
 
 // Level file format (*.mjl)
@@ -46,7 +47,7 @@ static bool BlockCursorTest(const Level* pLevel, const mjm::int3& position, bloc
     {
       *pBlock = block;
     }
-    return block < 0x006A;
+    return IsSolidBlock(block);
   }
   else
   {
@@ -64,12 +65,12 @@ static bool BlockCursorTest(const Level* pLevel, const mjm::int3& position, bloc
 
 Level Level::Load(const char* path)
 {
-  MJ_UNINITIALIZED size_t dataSize;
-  Level level = {};
-  void* pFile = SDL_LoadFile(path, &dataSize);
-  if (pFile)
+  Level level             = {};
+  mj::assets::Asset asset = mj::assets::Load(path);
+  if (asset.pData)
   {
-    mj::MemoryBuffer reader(pFile, dataSize);
+    // Only read from, so a view into the asset pack will do
+    mj::MemoryBuffer reader((void*)asset.pData, asset.size);
     MJ_UNINITIALIZED uint32_t magicWord;
     MJ_UNINITIALIZED uint8_t versionNumber;
     MJ_UNINITIALIZED size_t size;
@@ -87,7 +88,7 @@ Level Level::Load(const char* path)
       bx::memCopy(level.pBlocks, reader.Position(), size);
     }
 
-    SDL_free(pFile);
+    mj::assets::Free(&asset);
   }
 
   return level;
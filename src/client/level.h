@@ -4,6 +4,22 @@
 
 using block_t = uint16_t;
 
+/// <summary>
+/// Blocks below 0x006A are walls, the rest are floor/ceiling tiles
+/// </summary>
+inline bool IsSolidBlock(block_t block)
+{
+  return block < 0x006A;
+}
+
+/// <summary>
+/// Doors (0x005A - 0x0065) are solid until opened
+/// </summary>
+inline bool IsDoorBlock(block_t block)
+{
+  return block >= 0x005A && block <= 0x0065;
+}
+
 // -X, -Y, -Z, +X, +Y, +Z
 struct Face
 {
@@ -0,0 +1,356 @@
+#include "pch.h"
+#include "level_loader.h"
+#include "meta.h"
+#include "mj_frame_stats.h"
+
+void LoadedLevel::Free()
+{
+  Level::Free(this->level);
+  mj::Grid::Free(this->grid);
+  *this = {};
+}
+
+static_assert(LevelMesh::LEVEL_DIM == Meta::LEVEL_DIM, "Level meshes are chunked for levels of one size");
+static_assert(LevelMesh::LEVEL_DIM % LevelMesh::CHUNK_SIZE == 0, "Chunks must tile the level");
+
+/// <summary>
+/// Cells of a chunk, [x0, x1) x [z0, z1)
+/// </summary>
+struct ChunkCells
+{
+  uint32_t x0;
+  uint32_t z0;
+  uint32_t x1;
+  uint32_t z1;
+};
+
+static ChunkCells GetChunkCells(uint32_t chunk)
+{
+  ChunkCells cells = {};
+  cells.x0         = chunk % LevelMesh::NUM_CHUNKS_X * LevelMesh::CHUNK_SIZE;
+  cells.z0         = chunk / LevelMesh::NUM_CHUNKS_X * LevelMesh::CHUNK_SIZE;
+  cells.x1         = cells.x0 + LevelMesh::CHUNK_SIZE;
+  cells.z1         = cells.z0 + LevelMesh::CHUNK_SIZE;
+  return cells;
+}
+
+/// <summary>
+/// Walls, with a floor and ceiling under every open cell
+/// </summary>
+/// <param name="editor">Also draws the tops of walls</param>
+static void InsertGeometry(mj::ArrayList<Vertex>& vertices, mj::ArrayList<uint16_t>& indices, const Level& level,
+                           const ChunkCells& cells, bool editor)
+{
+  Graphics::InsertWalls(vertices, indices, &level, cells.x0, cells.z0, cells.x1, cells.z1);
+
+  // Floor/ceiling pass
+  for (size_t z = cells.z0; z < cells.z1; z++)
+  {
+    // Check for blocks in this slice
+    for (size_t x = cells.x0; x < cells.x1; x++)
+    {
+      if (!IsSolidBlock(level.pBlocks[z * level.width + x]))
+      {
+        Graphics::InsertFloor(vertices, indices, (float)x, 0.0f, (float)z, 136.0f);
+        Graphics::InsertCeiling(vertices, indices, (float)x, (float)z, 138.0f);
+      }
+      else if (editor)
+      {
+        // Editor: draw top of level for clarity
+        Graphics::InsertFloor(vertices, indices, (float)x, 1.0f, (float)z, 138.0f);
+      }
+    }
+  }
+}
+
+/// <summary>
+/// A wall belongs to the chunk of its solid cell but depends on the open cell in front of it, so a chunk
+/// also changes with the cells bordering it
+/// </summary>
+static bool IsChunkChanged(const Level& level, const block_t* pPrevious, const ChunkCells& cells)
+{
+  uint32_t x0 = cells.x0 > 0 ? cells.x0 - 1 : 0;
+  uint32_t z0 = cells.z0 > 0 ? cells.z0 - 1 : 0;
+  uint32_t x1 = cells.x1 < level.width ? cells.x1 + 1 : cells.x1;
+  uint32_t z1 = cells.z1 < level.height ? cells.z1 + 1 : cells.z1;
+  for (uint32_t z = z0; z < z1; z++)
+  {
+    const block_t* pRow         = level.pBlocks + z * level.width;
+    const block_t* pPreviousRow = pPrevious + z * level.width;
+    if (memcmp(pRow + x0, pPreviousRow + x0, (x1 - x0) * sizeof(block_t)) != 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// <summary>
+/// Texture array layers of the vertices, which are the same for every vertex of a face
+/// </summary>
+static mj::LayerSet GetLayers(const mj::ArrayList<Vertex>& vertices)
+{
+  mj::LayerSet layers = {};
+  for (const Vertex& vertex : vertices)
+  {
+    if (vertex.texCoord.z >= 0.0f)
+    {
+      layers.Add((uint32_t)vertex.texCoord.z);
+    }
+  }
+  return layers;
+}
+
+/// <returns>False if the vertices do not fit 16-bit indices</returns>
+static bool CreateLevelMesh(ComPtr<ID3D11Device> pDevice, mj::ArrayList<Vertex>& vertices,
+                            mj::ArrayList<uint16_t>& indices, Mesh* pMesh)
+{
+  if (vertices.Size() > UINT16_MAX + 1)
+  {
+    return false;
+  }
+  if (indices.Size() == 0)
+  {
+    *pMesh = {}; // Nothing to draw, e.g. a chunk of solid cells in the game
+    return true;
+  }
+  *pMesh = Graphics::CreateMesh(pDevice, vertices.Cast<float>(), 6, indices, D3D11_USAGE_IMMUTABLE,
+                                D3D11_USAGE_IMMUTABLE);
+  pMesh->inputLayout = Graphics::GetInputLayout();
+  return pMesh->vertexBuffer && pMesh->indexBuffer;
+}
+
+bool LevelLoader::Init(ComPtr<ID3D11Device> pDevice)
+{
+  this->pDevice = pDevice;
+  this->running = true;
+  this->loader  = std::thread(&LevelLoader::RunLoader, this);
+  return true;
+}
+
+void LevelLoader::Destroy()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->running = false;
+  }
+  this->condition.notify_all();
+  if (this->loader.joinable())
+  {
+    this->loader.join();
+  }
+
+  this->loaded.Free();
+  this->baseline = {};
+  this->status   = Status::Idle;
+  this->pDevice.Reset();
+}
+
+bool LevelLoader::Request(const char* pPath)
+{
+  return this->Start(pPath, false);
+}
+
+bool LevelLoader::RequestReload(const char* pPath)
+{
+  return this->Start(pPath, true);
+}
+
+bool LevelLoader::Start(const char* pPath, bool reload)
+{
+  size_t pathLength = strlen(pPath);
+  if (pathLength >= LevelLoader::MAX_PATH_LENGTH)
+  {
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->status == Status::Loading || !this->running)
+    {
+      return false;
+    }
+    if (reload && (this->status != Status::Idle || !this->baseline.valid || strcmp(this->baseline.path, pPath) != 0))
+    {
+      return false;
+    }
+    this->loaded.Free();
+    memcpy(this->path, pPath, pathLength + 1);
+    this->reload = reload;
+    this->status = Status::Loading;
+  }
+  this->condition.notify_all();
+  return true;
+}
+
+bool LevelLoader::IsLoading()
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->status == Status::Loading;
+}
+
+bool LevelLoader::IsIdle()
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->status == Status::Idle;
+}
+
+void LevelLoader::Wait()
+{
+  std::unique_lock<std::mutex> lock(this->mutex);
+  this->condition.wait(lock, [this] { return this->status != Status::Loading || !this->running; });
+}
+
+bool LevelLoader::Take(LoadedLevel* pLevel)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (this->status != Status::Ready)
+  {
+    return false;
+  }
+  *pLevel      = this->loaded;
+  this->loaded = {};
+  this->status = Status::Idle;
+
+  // Levels are validated to be LEVEL_DIM x LEVEL_DIM
+  memcpy(this->baseline.path, this->path, sizeof(this->path));
+  memcpy(this->baseline.blocks, pLevel->level.pBlocks, sizeof(this->baseline.blocks));
+  this->baseline.gameMesh   = pLevel->gameMesh;
+  this->baseline.editorMesh = pLevel->editorMesh;
+  this->baseline.valid      = true;
+  return true;
+}
+
+LevelLoader::Stats LevelLoader::GetStats()
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->stats;
+}
+
+void LevelLoader::RunLoader()
+{
+#ifdef MJ_PROFILER_ENABLED
+  mj::profiler::SetThreadName("Level loader");
+#endif
+  for (;;)
+  {
+    MJ_UNINITIALIZED char pathCopy[LevelLoader::MAX_PATH_LENGTH];
+    MJ_UNINITIALIZED bool reloadCopy;
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->condition.wait(lock, [this] { return this->status == Status::Loading || !this->running; });
+      if (this->status != Status::Loading)
+      {
+        return;
+      }
+      memcpy(pathCopy, this->path, sizeof(pathCopy));
+      reloadCopy = this->reload;
+    }
+
+    // The main thread keeps playing the current level meanwhile
+    double start             = mj::stats::Now();
+    LoadedLevel result       = {};
+    uint32_t numChunksMeshed = 0;
+    bool success             = Load(pathCopy, reloadCopy, &result, &numChunksMeshed);
+    if (!success)
+    {
+      result.Free();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      if (success)
+      {
+        this->loaded                = result;
+        this->status                = Status::Ready;
+        this->stats.loadMs          = (float)(mj::stats::Now() - start);
+        this->stats.numChunksMeshed = numChunksMeshed;
+        this->stats.numLoaded++;
+      }
+      else
+      {
+        this->status = Status::Idle;
+        this->stats.numFailed++;
+      }
+    }
+    this->condition.notify_all();
+  }
+}
+
+/// <summary>
+/// Runs on the loader thread. The baseline does not change while a level is loading.
+/// </summary>
+bool LevelLoader::Load(const char* pPath, bool reload, LoadedLevel* pLevel, uint32_t* pNumChunksMeshed)
+{
+  ZoneScoped;
+  pLevel->level = Level::Load(pPath);
+
+  // The game and editor are built around levels of one size
+  const Level& level = pLevel->level;
+  if (!level.IsValid() || (level.width != Meta::LEVEL_DIM) || (level.height != Meta::LEVEL_DIM))
+  {
+    return false;
+  }
+
+  pLevel->grid = mj::Grid::FromLevel(level);
+  if (!pLevel->grid.IsValid())
+  {
+    return false;
+  }
+
+  mj::ArrayList<Vertex> vertices;
+  mj::ArrayList<uint16_t> indices;
+  for (uint32_t chunk = 0; chunk < LevelMesh::NUM_CHUNKS; chunk++)
+  {
+    ChunkCells cells = GetChunkCells(chunk);
+    if (reload && !IsChunkChanged(level, this->baseline.blocks, cells))
+    {
+      // Shares the buffers, which are immutable
+      pLevel->gameMesh.chunks[chunk]   = this->baseline.gameMesh.chunks[chunk];
+      pLevel->gameMesh.layers[chunk]   = this->baseline.gameMesh.layers[chunk];
+      pLevel->editorMesh.chunks[chunk] = this->baseline.editorMesh.chunks[chunk];
+      pLevel->editorMesh.layers[chunk] = this->baseline.editorMesh.layers[chunk];
+      continue;
+    }
+
+    vertices.Clear();
+    indices.Clear();
+    InsertGeometry(vertices, indices, level, cells, false);
+    pLevel->gameMesh.layers[chunk] = GetLayers(vertices);
+    if (!CreateLevelMesh(this->pDevice, vertices, indices, &pLevel->gameMesh.chunks[chunk]))
+    {
+      return false;
+    }
+
+    vertices.Clear();
+    indices.Clear();
+    InsertGeometry(vertices, indices, level, cells, true);
+    pLevel->editorMesh.layers[chunk] = GetLayers(vertices);
+    if (!CreateLevelMesh(this->pDevice, vertices, indices, &pLevel->editorMesh.chunks[chunk]))
+    {
+      return false;
+    }
+    (*pNumChunksMeshed)++;
+  }
+  return true;
+}
+
+void LevelMesh::Draw(mj::ArrayList<DrawCommand>& drawList, const Camera* pCamera) const
+{
+  for (uint32_t chunk = 0; chunk < NUM_CHUNKS; chunk++)
+  {
+    if (this->chunks[chunk].indexCount == 0)
+    {
+      continue;
+    }
+    DrawCommand* pCmd = drawList.EmplaceSingle();
+    if (pCmd)
+    {
+      pCmd->pCamera      = pCamera;
+      pCmd->pMesh        = &this->chunks[chunk];
+      pCmd->pLayers      = &this->layers[chunk];
+      pCmd->vertexShader = Graphics::GetVertexShader();
+      pCmd->pixelShader  = Graphics::GetPixelShader();
+    }
+  }
+}
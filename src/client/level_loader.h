@@ -0,0 +1,149 @@
+#pragma once
+#include "graphics.h"
+#include "level.h"
+#include "mj_grid.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/// <summary>
+/// Level geometry in square chunks of cells, so a change to a few cells only remeshes the chunks around them
+/// </summary>
+struct LevelMesh
+{
+  static constexpr uint32_t LEVEL_DIM    = 64; // Meta::LEVEL_DIM
+  static constexpr uint32_t CHUNK_SIZE   = 16;
+  static constexpr uint32_t NUM_CHUNKS_X = LEVEL_DIM / CHUNK_SIZE;
+  static constexpr uint32_t NUM_CHUNKS   = NUM_CHUNKS_X * NUM_CHUNKS_X;
+
+  /// <summary>
+  /// Indexing: z * NUM_CHUNKS_X + x. Chunks without geometry have no buffers.
+  /// </summary>
+  Mesh chunks[NUM_CHUNKS];
+  mj::LayerSet layers[NUM_CHUNKS]; // Of the texture array, made resident when the chunk is drawn
+
+  /// <summary>
+  /// Adds a draw command for every chunk with geometry
+  /// </summary>
+  void Draw(mj::ArrayList<DrawCommand>& drawList, const Camera* pCamera) const;
+};
+
+/// <summary>
+/// Everything a level needs before it can be played and edited
+/// </summary>
+struct LoadedLevel
+{
+  Level level;
+  LevelMesh gameMesh;   // Floor and ceiling under open cells
+  LevelMesh editorMesh; // Also the tops of walls
+  mj::Grid grid;
+
+  /// <summary>
+  /// Frees whatever the level owns
+  /// </summary>
+  void Free();
+};
+
+/// <summary>
+/// Loads, validates and meshes levels on a background thread. Immutable buffers are created on that
+/// thread as well (the D3D11 device is free-threaded), so taking a loaded level only swaps pointers.
+/// A level that is ready stays with the loader until it is taken, which allows loading the next map
+/// while the current one is still being played. The level taken last is kept for reloads, which only
+/// remesh the chunks whose cells changed and share the meshes of the other chunks.
+/// </summary>
+class LevelLoader
+{
+public:
+  static constexpr uint32_t MAX_PATH_LENGTH = 256;
+
+  struct Stats
+  {
+    float loadMs;             // Of the last level that was loaded: file, validation, grid and meshes
+    uint32_t numChunksMeshed; // Of the last level that was loaded, fewer than NUM_CHUNKS if it was reloaded
+    uint32_t numLoaded;
+    uint32_t numFailed; // Missing, corrupt or of the wrong size
+  };
+
+  /// <summary>
+  /// Starts the loader thread
+  /// </summary>
+  bool Init(ComPtr<ID3D11Device> pDevice);
+
+  /// <summary>
+  /// Finishes the load in progress, frees a level that was not taken and stops the loader thread
+  /// </summary>
+  void Destroy();
+
+  /// <summary>
+  /// Starts loading a level. A level that is ready but not taken yet is freed.
+  /// </summary>
+  /// <returns>False if a level is still loading</returns>
+  bool Request(const char* pPath);
+
+  /// <summary>
+  /// Loads the level that was taken last again, e.g. after it was edited. Only the chunks around cells
+  /// that changed are meshed again. Unlike Request(), it never frees a level that is ready.
+  /// </summary>
+  /// <returns>False if pPath is not the file of the level that was taken last or the loader is not idle</returns>
+  bool RequestReload(const char* pPath);
+
+  /// <summary>
+  /// True from Request() until the level is ready or failed to load
+  /// </summary>
+  bool IsLoading();
+
+  /// <summary>
+  /// True if no level is loading or ready to be taken
+  /// </summary>
+  bool IsIdle();
+
+  /// <summary>
+  /// Blocks until the level in progress is ready or failed to load
+  /// </summary>
+  void Wait();
+
+  /// <summary>
+  /// Hands over a loaded level, which the caller frees. Its blocks and meshes are kept for reloads.
+  /// </summary>
+  /// <returns>False if no level is ready</returns>
+  bool Take(LoadedLevel* pLevel);
+
+  Stats GetStats();
+
+private:
+  enum class Status
+  {
+    Idle,
+    Loading, // The loader thread is working on path
+    Ready,
+  };
+
+  /// <summary>
+  /// The level taken last, which reloads are compared with
+  /// </summary>
+  struct Baseline
+  {
+    char path[MAX_PATH_LENGTH];
+    block_t blocks[LevelMesh::LEVEL_DIM * LevelMesh::LEVEL_DIM];
+    LevelMesh gameMesh;
+    LevelMesh editorMesh;
+    bool valid;
+  };
+
+  bool Start(const char* pPath, bool reload);
+  void RunLoader();
+  bool Load(const char* pPath, bool reload, LoadedLevel* pLevel, uint32_t* pNumChunksMeshed);
+
+  ComPtr<ID3D11Device> pDevice;
+  LoadedLevel loaded = {};
+  Status status      = Status::Idle;
+  Stats stats        = {};
+  bool running       = false;
+  bool reload        = false; // Of the level in path
+  char path[MAX_PATH_LENGTH];
+  Baseline baseline = {}; // Only changes while no level is loading
+  std::mutex mutex;       // Guards loaded, status, running, reload, path, baseline and stats
+  std::condition_variable condition;
+  std::thread loader;
+};
@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "mj_common.h"
 #include "mj_input.h"
+#include "mj_jobs.h"
+#include "mj_frame_stats.h"
 #include "meta.h"
 #include "mj_platform.h"
 #include "imgui_impl_sdl.h"
@@ -37,6 +39,7 @@ bool mj::IsWindowMouseFocused()
 static bool PumpEvents(Meta* pMeta)
 {
   ZoneScopedNC("Window message pump", tracy::Color::Aqua);
+  mj::stats::ScopedPhase phase(mj::stats::Phase::PumpEvents);
   SDL_Event event;
   while (SDL_PollEvent(&event))
   {
@@ -194,9 +197,10 @@ static void UpdateDeltaTime(Time* pTime)
   Uint64 now    = SDL_GetPerformanceCounter();
   Uint64 counts = now - pTime->lastTime;
   float dt      = (float)counts / pTime->perfFreq;
-  if (dt > (1.0f / 60.0f))
+  // Long stalls (breakpoints, window drags) should not be simulated in full
+  if (dt > 0.25f)
   {
-    dt = 1.0f / 60.0f;
+    dt = 0.25f;
   }
   mj_DeltaTime    = dt;
   pTime->lastTime = now;
@@ -254,6 +258,10 @@ int32_t CALLBACK wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInst
   }
 
   MJ_DISCARD(ImGui_ImplSDL2_InitForD3D(s_pWindow));
+#ifdef MJ_PROFILER_ENABLED
+  mj::profiler::SetThreadName("Main thread");
+#endif
+  mj::jobs::Init();
   Meta meta;
   meta.Init(wmInfo.info.win.window);
 
@@ -266,6 +274,7 @@ int32_t CALLBACK wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInst
   while (true)
   {
     ZoneScopedNC("Game loop", tracy::Color::CornflowerBlue);
+    mj::stats::BeginFrame();
     if (!PumpEvents(&meta))
     {
       break;
@@ -275,10 +284,12 @@ int32_t CALLBACK wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInst
     mj::input::Update();
     UpdateDeltaTime(&time);
     meta.Update();
+    mj::jobs::Drain();
     FrameMark;
   }
 
   // Cleanup
+  mj::jobs::Shutdown();
   ImGui_ImplSDL2_Shutdown();
 
   SDL_DestroyWindow(s_pWindow);
@@ -1,14 +1,18 @@
 #include "pch.h"
 #include "meta.h"
+#include "mj_assets.h"
 #include "mj_common.h"
 #include "graphics.h"
 #include "mj_input.h"
+#include "mj_frame_stats.h"
 #include "imgui_impl_dx11.h"
 #include "editor.h"
 #include "state_machine.h"
 #include "game.h"
 #include "main.h"
 
+#include <utility> // std::swap
+
 // Helper functions
 
 bool Meta::CreateDeviceD3D(HWND hWnd)
@@ -91,14 +95,118 @@ void Meta::CreateRenderTargetView()
                                         this->pDepthStencilView.ReleaseAndGetAddressOf());
 }
 
-void Meta::LoadLevel()
+void Meta::LoadLevel(const char* pPath)
+{
+  if (this->levelLoader.Request(pPath))
+  {
+    this->publishLevel = true;
+    MJ_DISCARD(this->watcher.Watch(pPath));
+  }
+}
+
+void Meta::PreloadLevel(const char* pPath)
+{
+  if (this->levelLoader.Request(pPath))
+  {
+    this->publishLevel = false;
+    MJ_DISCARD(this->watcher.Watch(pPath));
+  }
+}
+
+void Meta::SwitchToPreloadedLevel()
+{
+  this->publishLevel = true;
+}
+
+bool Meta::IsLevelLoading()
+{
+  return this->levelLoader.IsLoading();
+}
+
+LevelLoader::Stats Meta::GetLevelLoadStats()
+{
+  return this->levelLoader.GetStats();
+}
+
+mj::LayerCache::Stats Meta::GetResidencyStats()
+{
+  return this->graphics.GetResidencyStats();
+}
+
+Meta::HotReloadStats Meta::GetHotReloadStats()
+{
+  HotReloadStats stats   = {};
+  stats.textureLoad      = this->textureLoader.GetStats();
+  stats.numLayersUpdated = this->numLayersUpdated;
+  return stats;
+}
+
+/// <summary>
+/// Called at the start of a frame, so the game and editor never see half a level
+/// </summary>
+void Meta::PublishLevel()
+{
+  if (!this->publishLevel || this->levelLoader.IsLoading())
+  {
+    return;
+  }
+
+  // Nothing to take if the level failed to load
+  LoadedLevel loaded = {};
+  this->publishLevel = false;
+  if (!this->levelLoader.Take(&loaded))
+  {
+    return;
+  }
+
+  ZoneScoped;
+  std::swap(this->level, loaded.level);
+  this->game.SetLevel(loaded);
+  this->editor.SetLevel(&this->level, loaded.editorMesh);
+
+  // Now holds the previous level
+  loaded.Free();
+}
+
+/// <summary>
+/// Reloads the texture array and the current level when they change on disk. Both are loaded in the
+/// background like any other level; only the layers and chunks that changed are uploaded and remeshed.
+/// </summary>
+void Meta::ReloadChangedAssets()
 {
-  Level::Free(this->level);
-  this->level = Level::Load("e1m1.mjm");
-  if (level.IsValid())
+  MJ_UNINITIALIZED const char* changed[mj::FileWatcher::MAX_FILES];
+  uint32_t numChanged = this->watcher.Poll(changed, MJ_COUNTOF(changed));
+  for (uint32_t i = 0; i < numChanged; i++)
   {
-    game.SetLevel(level, pDevice);
-    editor.SetLevel(&level, pDevice);
+    // The pack, if any, still holds the old version
+    MJ_DISCARD(mj::assets::MarkChanged(changed[i]));
+    size_t length = strlen(changed[i]);
+    if (!strcmp(changed[i], Graphics::TEXTURE_ARRAY_PATH))
+    {
+      MJ_DISCARD(this->textureLoader.Request(changed[i]));
+    }
+    else if (length < sizeof(this->changedLevelPath))
+    {
+      memcpy(this->changedLevelPath, changed[i], length + 1);
+    }
+  }
+
+  // Only the level being played is reloaded; other watched levels are loaded fresh when requested. A level that
+  // is loading or ready, e.g. the next map, is taken first, which may make the change irrelevant.
+  if (this->changedLevelPath[0] && this->levelLoader.IsIdle())
+  {
+    if (this->levelLoader.RequestReload(this->changedLevelPath))
+    {
+      this->publishLevel = true;
+    }
+    this->changedLevelPath[0] = '\0';
+  }
+
+  TextureArrayData data = {};
+  if (this->textureLoader.Take(&data))
+  {
+    this->numLayersUpdated = this->graphics.UpdateTextureArray(this->pDevice, this->pContext, data);
+    TextureArrayData::Free(data);
   }
 }
 
@@ -111,11 +219,22 @@ void Meta::Init(HWND hwnd)
 
   this->CreateRenderTargetView();
 
+  // One mapping for every asset; without a pack they are loaded as loose files
+  MJ_DISCARD(mj::assets::Init(mj::assets::PACK_PATH));
   graphics.Init(this->pDevice);
   this->editor.Init(this->pDevice);
   this->game.Init(this->pDevice);
 
-  LoadLevel();
+  // Assets are reloaded when they are edited while the game runs
+  MJ_DISCARD(this->watcher.Init());
+  MJ_DISCARD(this->watcher.Watch(Graphics::TEXTURE_ARRAY_PATH));
+  MJ_DISCARD(this->textureLoader.Init());
+
+  // There is no level to play yet, so the first one is waited for
+  MJ_DISCARD(this->levelLoader.Init(this->pDevice));
+  LoadLevel(Meta::LEVEL_PATH);
+  this->levelLoader.Wait();
+  PublishLevel();
 
   {
     D3D11_DEPTH_STENCIL_DESC dsDesc     = {};
@@ -176,6 +295,9 @@ void Meta::NewFrame()
 
 void Meta::Update()
 {
+  ReloadChangedAssets();
+  PublishLevel();
+
   ImGui::NewFrame();
 
   if (mj::input::GetKeyDown(Key::F3))
@@ -184,7 +306,10 @@ void Meta::Update()
         (this->stateMachine.pStateCurrent == &this->game) ? (StateBase*)&this->editor : (StateBase*)&this->game;
   }
 
-  this->stateMachine.Update(this->pContext, this->drawList);
+  {
+    mj::stats::ScopedPhase phase(mj::stats::Phase::StateUpdate);
+    this->stateMachine.Update(this->pContext, this->drawList);
+  }
 
   this->pContext->OMSetRenderTargets(1, this->pRenderTargetView.GetAddressOf(), this->pDepthStencilView.Get());
   this->pContext->ClearDepthStencilView(this->pDepthStencilView.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
@@ -192,8 +317,11 @@ void Meta::Update()
   this->pContext->ClearRenderTargetView(this->pRenderTargetView.Get(), clearColor);
   this->pContext->OMSetDepthStencilState(this->pDepthStencilState.Get(), 1);
 
-  graphics.Update(this->pContext, this->drawList);
-  this->drawList.Clear();
+  {
+    mj::stats::ScopedPhase phase(mj::stats::Phase::GraphicsUpdate);
+    graphics.Update(this->pContext, this->drawList);
+    this->drawList.Clear();
+  }
 
 #if 0
   {
@@ -204,6 +332,7 @@ void Meta::Update()
 
   {
     ZoneScopedNC("ImGui render", tracy::Color::BlanchedAlmond);
+    mj::stats::ScopedPhase phase(mj::stats::Phase::ImGuiRender);
 
     // Rendering
     ImGui::Render();
@@ -219,6 +348,7 @@ void Meta::Update()
 
   {
     ZoneScopedNC("Swap Chain Present", tracy::Color::Azure);
+    mj::stats::ScopedPhase phase(mj::stats::Phase::Present);
     this->pSwapChain->Present(1, 0); // Present with vsync
     // pSwapChain->Present(0, 0); // Present without vsync
   }
@@ -226,13 +356,18 @@ void Meta::Update()
 
 Meta::~Meta()
 {
+  this->levelLoader.Destroy();
+  this->textureLoader.Destroy();
+  this->watcher.Destroy();
+  this->game.Destroy();
+  mj::assets::Destroy();
   ImGui_ImplDX11_Shutdown();
   ImGui::DestroyContext();
 }
 
 void Meta::NewLevel()
 {
-  LoadLevel();
+  LoadLevel(Meta::LEVEL_PATH);
 }
 
 void Meta::GainFocus()
@@ -4,6 +4,9 @@
 #include "editor.h"
 #include "graphics.h"
 #include "level.h"
+#include "level_loader.h"
+#include "texture_loader.h"
+#include "mj_watcher.h"
 
 class Meta
 {
@@ -14,7 +17,8 @@ public:
     editor.SetMeta(this);
   }
   ~Meta();
-  static constexpr uint32_t LEVEL_DIM = 64;
+  static constexpr uint32_t LEVEL_DIM     = 64;
+  static constexpr const char* LEVEL_PATH = "e1m1.mjm";
 
   void Init(HWND hwnd);
   void Resize(int width, int height);
@@ -23,10 +27,38 @@ public:
   void NewLevel();
   void GainFocus();
 
+  /// <summary>
+  /// Loads a level in the background. The current level is played until the new one has loaded, then the
+  /// new one replaces it at the start of a frame. Ignored while another level is loading.
+  /// </summary>
+  void LoadLevel(const char* pPath);
+
+  /// <summary>
+  /// Loads a level in the background without switching to it, e.g. during an intermission
+  /// </summary>
+  void PreloadLevel(const char* pPath);
+
+  /// <summary>
+  /// Switches to the preloaded level at the start of the next frame it is ready
+  /// </summary>
+  void SwitchToPreloadedLevel();
+
+  bool IsLevelLoading();
+  LevelLoader::Stats GetLevelLoadStats();
+
+  struct HotReloadStats
+  {
+    TextureLoader::Stats textureLoad;
+    uint32_t numLayersUpdated; // By the last texture array reload
+  };
+  HotReloadStats GetHotReloadStats();
+  mj::LayerCache::Stats GetResidencyStats();
+
 private:
   bool CreateDeviceD3D(HWND hWnd);
   void CreateRenderTargetView();
-  void LoadLevel();
+  void PublishLevel();
+  void ReloadChangedAssets();
 
   ComPtr<ID3D11Device> pDevice;
   ComPtr<ID3D11DeviceContext> pContext;
@@ -37,6 +69,12 @@ private:
   ComPtr<ID3D11Texture2D> pDepthStencilBuffer;
 
   Level level;
+  LevelLoader levelLoader;
+  bool publishLevel = false; // Switch to the loaded level once it is ready
+  mj::FileWatcher watcher;
+  TextureLoader textureLoader;
+  char changedLevelPath[LevelLoader::MAX_PATH_LENGTH] = {}; // Reloaded once the level loader is idle
+  uint32_t numLayersUpdated                           = 0;
   GameState game;
   EditorState editor;
   Graphics graphics;
@@ -0,0 +1,295 @@
+// Area map - connected floor areas and the doors between them, for sound propagation
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_areas.h"
+#include "mj_grid.h"
+#include "mj_profiler.h"
+
+bool mj::AreaMap::Init(const block_t* pBlocks, uint32_t width, uint32_t height)
+{
+  ZoneScoped;
+  size_t numCells  = (size_t)width * height;
+  this->pCellAreas = (uint16_t*)malloc(numCells * sizeof(uint16_t));
+  uint32_t* pQueue = (uint32_t*)malloc(numCells * sizeof(uint32_t));
+  if (!this->pCellAreas || !pQueue)
+  {
+    free(pQueue);
+    Destroy();
+    return false;
+  }
+  this->width  = width;
+  this->height = height;
+
+  // Flood fill every floor region that has not been labeled yet
+  uint32_t numAreas = 0;
+  uint32_t numDoors = 0;
+  for (size_t i = 0; i < numCells; i++)
+  {
+    this->pCellAreas[i] = NO_AREA;
+    numDoors += IsDoorBlock(pBlocks[i]) ? 1 : 0;
+  }
+  for (uint32_t start = 0; start < numCells && numAreas < NO_AREA; start++)
+  {
+    if (IsSolidBlock(pBlocks[start]) || this->pCellAreas[start] != NO_AREA)
+    {
+      continue;
+    }
+
+    uint32_t head           = 0;
+    uint32_t tail           = 0;
+    pQueue[tail++]          = start;
+    this->pCellAreas[start] = (uint16_t)numAreas;
+    while (head < tail)
+    {
+      uint32_t cell = pQueue[head++];
+      int32_t x     = (int32_t)(cell % width);
+      int32_t z     = (int32_t)(cell / width);
+      for (uint32_t i = 0; i < 8; i += 2)
+      {
+        int32_t nx = x + NEIGHBOR_DX[i];
+        int32_t nz = z + NEIGHBOR_DZ[i];
+        if ((uint32_t)nx >= width || (uint32_t)nz >= height)
+        {
+          continue;
+        }
+        uint32_t neighbor = nz * width + nx;
+        if (!IsSolidBlock(pBlocks[neighbor]) && this->pCellAreas[neighbor] == NO_AREA)
+        {
+          this->pCellAreas[neighbor] = (uint16_t)numAreas;
+          pQueue[tail++]             = neighbor;
+        }
+      }
+    }
+    numAreas++;
+  }
+  free(pQueue);
+  if (numAreas >= NO_AREA)
+  {
+    Destroy();
+    return false;
+  }
+
+  this->numAreas      = numAreas;
+  this->maskWords     = (numAreas + 63) / 64;
+  this->pDoors        = (Door*)malloc((numDoors ? numDoors : 1) * sizeof(Door));
+  this->pParents      = (uint16_t*)malloc((numAreas ? numAreas : 1) * sizeof(uint16_t));
+  this->pSizes        = (uint16_t*)malloc((numAreas ? numAreas : 1) * sizeof(uint16_t));
+  this->pMaskSlots    = (uint32_t*)malloc((numAreas ? numAreas : 1) * sizeof(uint32_t));
+  this->pMaskVersions = (uint32_t*)calloc(numAreas ? numAreas : 1, sizeof(uint32_t));
+  if (!this->pDoors || !this->pParents || !this->pSizes || !this->pMaskSlots || !this->pMaskVersions)
+  {
+    Destroy();
+    return false;
+  }
+
+  // A door joins the floor on opposite sides: -X/+X, or -Z/+Z if that does not fit
+  this->numDoors = 0;
+  for (uint32_t cell = 0; cell < numCells; cell++)
+  {
+    if (!IsDoorBlock(pBlocks[cell]))
+    {
+      continue;
+    }
+
+    int32_t x = (int32_t)(cell % width);
+    int32_t z = (int32_t)(cell / width);
+    Door door = { cell, GetArea(x - 1, z), GetArea(x + 1, z), false };
+    if (door.a == NO_AREA || door.b == NO_AREA)
+    {
+      door.a = GetArea(x, z - 1);
+      door.b = GetArea(x, z + 1);
+    }
+    if (door.a != NO_AREA && door.b != NO_AREA)
+    {
+      this->pDoors[this->numDoors++] = door;
+    }
+  }
+  for (uint32_t i = 0; i < this->numDoors; i++)
+  {
+    this->pCellAreas[this->pDoors[i].cell] = this->pDoors[i].a;
+  }
+
+  for (uint32_t i = 0; i < numAreas; i++)
+  {
+    this->pParents[i] = (uint16_t)i;
+    this->pSizes[i]   = 1;
+  }
+  return true;
+}
+
+void mj::AreaMap::Destroy()
+{
+  free(this->pCellAreas);
+  free(this->pDoors);
+  free(this->pParents);
+  free(this->pSizes);
+  free(this->pMaskSlots);
+  free(this->pMaskVersions);
+  free(this->pMasks);
+  this->pCellAreas    = nullptr;
+  this->pDoors        = nullptr;
+  this->pParents      = nullptr;
+  this->pSizes        = nullptr;
+  this->pMaskSlots    = nullptr;
+  this->pMaskVersions = nullptr;
+  this->pMasks        = nullptr;
+  this->numMasks      = 0;
+  this->maskCapacity  = 0;
+  this->width         = 0;
+  this->height        = 0;
+  this->numAreas      = 0;
+  this->numDoors      = 0;
+}
+
+uint16_t mj::AreaMap::GetArea(int32_t x, int32_t z) const
+{
+  if ((uint32_t)x >= this->width || (uint32_t)z >= this->height)
+  {
+    return NO_AREA;
+  }
+  return this->pCellAreas[z * this->width + x];
+}
+
+mj::AreaMap::Door* mj::AreaMap::FindDoor(int32_t x, int32_t z) const
+{
+  if ((uint32_t)x >= this->width || (uint32_t)z >= this->height)
+  {
+    return nullptr;
+  }
+
+  uint32_t cell  = z * this->width + x;
+  uint32_t first = 0;
+  uint32_t count = this->numDoors;
+  while (count > 0)
+  {
+    uint32_t half = count / 2;
+    if (this->pDoors[first + half].cell < cell)
+    {
+      first += half + 1;
+      count -= half + 1;
+    }
+    else
+    {
+      count = half;
+    }
+  }
+  return (first < this->numDoors && this->pDoors[first].cell == cell) ? &this->pDoors[first] : nullptr;
+}
+
+uint16_t mj::AreaMap::Find(uint16_t area)
+{
+  // Path halving
+  while (this->pParents[area] != area)
+  {
+    this->pParents[area] = this->pParents[this->pParents[area]];
+    area                 = this->pParents[area];
+  }
+  return area;
+}
+
+void mj::AreaMap::Union(uint16_t a, uint16_t b)
+{
+  a = Find(a);
+  b = Find(b);
+  if (a == b)
+  {
+    return;
+  }
+  if (this->pSizes[a] < this->pSizes[b])
+  {
+    mj::swap(a, b);
+  }
+  this->pParents[b] = a;
+  this->pSizes[a] += this->pSizes[b];
+}
+
+bool mj::AreaMap::SetDoorOpen(int32_t x, int32_t z, bool open)
+{
+  Door* pDoor = FindDoor(x, z);
+  if (!pDoor)
+  {
+    return false;
+  }
+  if (pDoor->open == open)
+  {
+    return true;
+  }
+
+  pDoor->open = open;
+  this->version++;
+  if (open)
+  {
+    Union(pDoor->a, pDoor->b);
+  }
+  else
+  {
+    // Union-find cannot split, so start over from the doors that are still open
+    for (uint32_t i = 0; i < this->numAreas; i++)
+    {
+      this->pParents[i] = (uint16_t)i;
+      this->pSizes[i]   = 1;
+    }
+    for (uint32_t i = 0; i < this->numDoors; i++)
+    {
+      if (this->pDoors[i].open)
+      {
+        Union(this->pDoors[i].a, this->pDoors[i].b);
+      }
+    }
+  }
+  return true;
+}
+
+bool mj::AreaMap::IsDoorOpen(int32_t x, int32_t z) const
+{
+  const Door* pDoor = FindDoor(x, z);
+  return pDoor && pDoor->open;
+}
+
+bool mj::AreaMap::AreConnected(uint16_t a, uint16_t b)
+{
+  return a != NO_AREA && b != NO_AREA && Find(a) == Find(b);
+}
+
+const uint64_t* mj::AreaMap::GetAudibleMask(uint16_t area)
+{
+  assert(area < this->numAreas);
+  uint16_t root = Find(area);
+  if (this->pMaskVersions[root] == this->version)
+  {
+    return this->pMasks + (size_t)this->pMaskSlots[root] * this->maskWords;
+  }
+
+  // The masks of older versions are stale, reuse their memory
+  if (this->masksVersion != this->version)
+  {
+    this->numMasks     = 0;
+    this->masksVersion = this->version;
+  }
+  if (this->numMasks == this->maskCapacity)
+  {
+    // Every root has at most one mask
+    uint32_t capacity = this->maskCapacity ? 2 * this->maskCapacity : 16;
+    capacity          = capacity < this->numAreas ? capacity : this->numAreas;
+    uint64_t* pMasks  = (uint64_t*)realloc(this->pMasks, (size_t)capacity * this->maskWords * sizeof(uint64_t));
+    if (!pMasks)
+    {
+      return nullptr;
+    }
+    this->pMasks       = pMasks;
+    this->maskCapacity = capacity;
+  }
+
+  uint64_t* pMask = this->pMasks + (size_t)this->numMasks * this->maskWords;
+  memset(pMask, 0, this->maskWords * sizeof(uint64_t));
+  for (uint32_t i = 0; i < this->numAreas; i++)
+  {
+    if (Find((uint16_t)i) == root)
+    {
+      pMask[i >> 6] |= 1ull << (i & 63);
+    }
+  }
+  this->pMaskSlots[root]    = this->numMasks++;
+  this->pMaskVersions[root] = this->version;
+  return pMask;
+}
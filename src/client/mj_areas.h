@@ -0,0 +1,97 @@
+// Area map - connected floor areas and the doors between them, for sound propagation
+// Should not use pre-compiled headers (for portability)
+//
+// At load time, floor cells are labeled with the 4-connected area they belong to, and every door
+// is recorded with the two areas it separates. Open doors join areas in a union-find, so
+// "does area A hear a sound in area B" is a comparison of two roots, and the set of areas that hear
+// a sound is a bitmask that is cached per root once it is queried. Opening a door is a union; closing one
+// rebuilds the union-find from the doors that are still open, which is cheap because it only visits doors.
+// A door change drops the cached masks, so they only take memory for the roots queried since.
+
+#pragma once
+#include "level.h"
+
+namespace mj
+{
+  class AreaMap
+  {
+  public:
+    static constexpr uint16_t NO_AREA = 0xFFFF;
+
+    /// <summary>
+    /// Labels the areas of a level. All doors start closed.
+    /// </summary>
+    bool Init(const block_t* pBlocks, uint32_t width, uint32_t height);
+    void Destroy();
+
+    /// <returns>Area of a floor cell, the area on the -X or -Z side of a door cell, or NO_AREA</returns>
+    uint16_t GetArea(int32_t x, int32_t z) const;
+
+    /// <returns>False if the cell is not a door</returns>
+    bool SetDoorOpen(int32_t x, int32_t z, bool open);
+
+    bool IsDoorOpen(int32_t x, int32_t z) const;
+
+    /// <summary>
+    /// True if a sound in one area reaches the other through open doors
+    /// </summary>
+    bool AreConnected(uint16_t a, uint16_t b);
+
+    /// <summary>
+    /// Bit i is set if area i hears a sound made in the given area. GetMaskWords() words long.
+    /// Valid until the next door change or the next call.
+    /// </summary>
+    /// <returns>Mask, or nullptr if out of memory</returns>
+    const uint64_t* GetAudibleMask(uint16_t area);
+
+    static bool IsSet(const uint64_t* pMask, uint16_t area)
+    {
+      return area != NO_AREA && (pMask[area >> 6] & (1ull << (area & 63))) != 0;
+    }
+
+    uint32_t GetNumAreas() const
+    {
+      return this->numAreas;
+    }
+
+    uint32_t GetNumDoors() const
+    {
+      return this->numDoors;
+    }
+
+    uint32_t GetMaskWords() const
+    {
+      return this->maskWords;
+    }
+
+  private:
+    struct Door
+    {
+      uint32_t cell;
+      uint16_t a;
+      uint16_t b;
+      bool open;
+    };
+
+    Door* FindDoor(int32_t x, int32_t z) const;
+    uint16_t Find(uint16_t area);
+    void Union(uint16_t a, uint16_t b);
+
+    uint32_t width          = 0;
+    uint32_t height         = 0;
+    uint32_t numAreas       = 0;
+    uint32_t numDoors       = 0;
+    uint32_t maskWords      = 0;
+    uint32_t version        = 1; // Incremented on every door change
+    uint16_t* pCellAreas    = nullptr;
+    Door* pDoors            = nullptr; // Sorted by cell
+    uint16_t* pParents      = nullptr; // Union-find
+    uint16_t* pSizes        = nullptr;
+    uint32_t* pMaskSlots    = nullptr; // Per root: index into pMasks, if the version matches
+    uint32_t* pMaskVersions = nullptr;
+    uint64_t* pMasks        = nullptr; // Areas that hear a root, one mask per root queried in this version
+    uint32_t numMasks       = 0;
+    uint32_t maskCapacity   = 0;
+    uint32_t masksVersion   = 0; // Of the masks in pMasks
+  };
+} // namespace mj
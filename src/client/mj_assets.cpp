@@ -0,0 +1,129 @@
+// Assets - loads assets from the asset pack, or from loose files where the pack has none
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_assets.h"
+#include "mj_file.h"
+#include "mj_pack.h"
+#include "mj_profiler.h"
+
+#include <atomic>
+#include <mutex>
+#include <stdlib.h>
+
+static mj::pack::Pack s_Pack;
+static std::atomic<uint32_t> s_NumMapped;
+static std::atomic<uint32_t> s_NumDecompressed;
+static std::atomic<uint32_t> s_NumLoose;
+static std::atomic<uint32_t> s_NumMissing;
+
+// Name hashes of assets that are loaded from loose files
+static std::mutex s_ChangedMutex;
+static uint64_t s_Changed[mj::assets::MAX_CHANGED];
+static std::atomic<uint32_t> s_NumChanged;
+
+static bool IsChanged(uint64_t nameHash)
+{
+  // Nothing is locked before the first asset changes
+  if (s_NumChanged == 0)
+  {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(s_ChangedMutex);
+  for (uint32_t i = 0; i < s_NumChanged; i++)
+  {
+    if (s_Changed[i] == nameHash)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool mj::assets::Init(const char* pPackPath)
+{
+  ZoneScoped;
+  return s_Pack.Open(pPackPath);
+}
+
+void mj::assets::Destroy()
+{
+  s_Pack.Close();
+  s_NumChanged = 0;
+}
+
+mj::assets::Asset mj::assets::Load(const char* pName)
+{
+  ZoneScoped;
+  Asset asset                   = {};
+  uint64_t nameHash             = mj::pack::HashName(pName);
+  const mj::pack::Entry* pEntry = IsChanged(nameHash) ? nullptr : s_Pack.Find(nameHash);
+  if (pEntry && !(pEntry->flags & mj::pack::ENTRY_LZ))
+  {
+    asset.pData = s_Pack.GetData(pEntry);
+    asset.size  = pEntry->size;
+    s_NumMapped++;
+    return asset;
+  }
+
+  if (pEntry)
+  {
+    asset.pAllocation = malloc(pEntry->rawSize > 0 ? pEntry->rawSize : 1);
+    if (asset.pAllocation && s_Pack.Read(pEntry, asset.pAllocation))
+    {
+      asset.pData = asset.pAllocation;
+      asset.size  = pEntry->rawSize;
+      s_NumDecompressed++;
+      return asset;
+    }
+    free(asset.pAllocation);
+    asset.pAllocation = nullptr;
+  }
+  else
+  {
+    asset.pAllocation = mj::ReadFile(pName, &asset.size);
+    if (asset.pAllocation)
+    {
+      asset.pData = asset.pAllocation;
+      s_NumLoose++;
+      return asset;
+    }
+  }
+
+  asset.size = 0;
+  s_NumMissing++;
+  return asset;
+}
+
+void mj::assets::Free(Asset* pAsset)
+{
+  free(pAsset->pAllocation);
+  *pAsset = {};
+}
+
+bool mj::assets::MarkChanged(const char* pName)
+{
+  uint64_t nameHash = mj::pack::HashName(pName);
+  if (IsChanged(nameHash))
+  {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(s_ChangedMutex);
+  if (s_NumChanged == mj::assets::MAX_CHANGED)
+  {
+    return false;
+  }
+  s_Changed[s_NumChanged] = nameHash;
+  s_NumChanged++;
+  return true;
+}
+
+mj::assets::Stats mj::assets::GetStats()
+{
+  Stats stats           = {};
+  stats.numEntries      = s_Pack.GetNumEntries();
+  stats.numMapped       = s_NumMapped;
+  stats.numDecompressed = s_NumDecompressed;
+  stats.numLoose        = s_NumLoose;
+  stats.numMissing      = s_NumMissing;
+  return stats;
+}
@@ -0,0 +1,67 @@
+// Assets - loads assets from the asset pack, or from loose files where the pack has none
+// Should not use pre-compiled headers (for portability)
+//
+// Init() maps the pack once at startup (mj_pack.h). Load() returns entries stored as they are as a view
+// into the mapping, without a copy or any file I/O, and decompresses compressed entries into a new
+// allocation. Assets that are not in the pack, or every asset if there is no pack, are read from the loose
+// file with the same relative path, so a new asset can be tried without rebuilding the pack. After
+// MarkChanged(), an asset is read from its loose file as well, so edits show up while the game runs.
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace mj
+{
+  namespace assets
+  {
+    static constexpr const char* PACK_PATH = "assets.mjp";
+    static constexpr uint32_t MAX_CHANGED  = 64;
+
+    struct Asset
+    {
+      const void* pData; // nullptr if the asset could not be loaded
+      size_t size;
+      void* pAllocation; // nullptr if pData points into the pack
+    };
+
+    struct Stats
+    {
+      uint32_t numEntries;      // In the pack, 0 without one
+      uint32_t numMapped;       // Loads served from the pack without a copy
+      uint32_t numDecompressed; // Loads served from the pack, decompressed
+      uint32_t numLoose;        // Loads served from loose files
+      uint32_t numMissing;      // Loads that failed
+    };
+
+    /// <summary>
+    /// Maps the pack
+    /// </summary>
+    /// <returns>False if there is no valid pack at pPackPath; assets then come from loose files</returns>
+    bool Init(const char* pPackPath);
+
+    /// <summary>
+    /// Unmaps the pack. Assets that point into it must not be used anymore.
+    /// </summary>
+    void Destroy();
+
+    /// <summary>
+    /// Thread-safe between Init() and Destroy()
+    /// </summary>
+    /// <param name="pName">Relative path, e.g. "texture_array.dds"</param>
+    Asset Load(const char* pName);
+
+    /// <summary>
+    /// Frees the copy of an asset, if Load() made one
+    /// </summary>
+    void Free(Asset* pAsset);
+
+    /// <summary>
+    /// From now on loads the asset from its loose file, e.g. after it was edited. Thread-safe.
+    /// </summary>
+    /// <returns>False if MAX_CHANGED assets were marked already</returns>
+    bool MarkChanged(const char* pName);
+
+    Stats GetStats();
+  } // namespace assets
+} // namespace mj
@@ -0,0 +1,1130 @@
+// Block compression - BC1, BC3 and BC7 encoders, for the asset cooker
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_bc.h"
+#include "mj_common.h"
+#include "mj_profiler.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static constexpr uint32_t NUM_TEXELS = 16;
+
+// By quality: least squares passes after the first fit
+static constexpr uint32_t NUM_REFINEMENTS[] = { 0, 1, 3 };
+
+// BC7 partitions that are encoded for real after ranking all of them, at the best quality
+static constexpr uint32_t NUM_PARTITIONS_TRIED = 4;
+
+// BC1 weights of the second color, by index
+static constexpr float COLOR_WEIGHTS[] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+// BC7 weights of the second endpoint out of 64, for 3-bit and 4-bit indices
+static constexpr int32_t WEIGHTS_3[] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static constexpr int32_t WEIGHTS_4[] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// BC7 two-subset partitions: bit i is the subset of texel i
+static constexpr uint16_t PARTITIONS_2[64] = {
+  0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8,
+  0xFF00, 0xFFF0, 0xF000, 0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110,
+  0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C, 0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696,
+  0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660, 0x0272, 0x04E4, 0x4E40, 0x2720,
+  0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+};
+
+// BC7 two-subset partitions: the texel of the second subset whose index is stored with one bit less
+static constexpr uint8_t ANCHORS_2[64] = {
+  15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 2,  8, 2,  2, 8,  8,  15, 2,  8,  2,  2,
+  8,  8,  2,  2,  15, 15, 6,  8,  2,  8,  15, 15, 2,  8,  2,  2,  2,  15, 15, 6, 6, 2,  6,  8,  15, 15, 2,  2,
+  15, 15, 15, 15, 15, 2,  2,  15,
+};
+
+/// <summary>
+/// Endpoints in [0, 255], per channel
+/// </summary>
+struct Line
+{
+  float start[4];
+  float end[4];
+};
+
+/// <summary>
+/// BC7 bits, from the lowest bit of the first byte up
+/// </summary>
+struct BitWriter
+{
+  uint8_t* pBytes;
+  uint32_t position;
+
+  void Write(uint32_t value, uint32_t numBits)
+  {
+    for (uint32_t i = 0; i < numBits; i++, this->position++)
+    {
+      this->pBytes[this->position / 8] |= (uint8_t)(((value >> i) & 1) << (this->position % 8));
+    }
+  }
+};
+
+struct BitReader
+{
+  const uint8_t* pBytes;
+  uint32_t position;
+
+  uint32_t Read(uint32_t numBits)
+  {
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < numBits; i++, this->position++)
+    {
+      value |= ((this->pBytes[this->position / 8] >> (this->position % 8)) & 1u) << i;
+    }
+    return value;
+  }
+};
+
+static inline float Clamp255(float value)
+{
+  return value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value);
+}
+
+static inline int32_t Interpolate(int32_t start, int32_t end, int32_t weight)
+{
+  return ((64 - weight) * start + weight * end + 32) >> 6;
+}
+
+/// <summary>
+/// Copies the texels in the mask to floats
+/// </summary>
+/// <returns>Number of texels copied</returns>
+static uint32_t Gather(const uint8_t* pTexels, uint16_t mask, float (*pOut)[4])
+{
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < NUM_TEXELS; i++)
+  {
+    if (mask & (1u << i))
+    {
+      for (uint32_t c = 0; c < 4; c++)
+      {
+        pOut[count][c] = pTexels[i * 4 + c];
+      }
+      count++;
+    }
+  }
+  return count;
+}
+
+/// <summary>
+/// Corners of the bounding box of the texels. Channels that fall while the widest one rises are flipped,
+/// so the line follows the texels instead of always running from dark to bright.
+/// </summary>
+static Line FitBoundingBox(const float (*pTexels)[4], uint32_t count, uint32_t numChannels)
+{
+  Line line     = {};
+  float mean[4] = {};
+  for (uint32_t c = 0; c < numChannels; c++)
+  {
+    line.start[c] = 255.0f;
+    for (uint32_t i = 0; i < count; i++)
+    {
+      line.start[c] = fminf(line.start[c], pTexels[i][c]);
+      line.end[c]   = fmaxf(line.end[c], pTexels[i][c]);
+      mean[c] += pTexels[i][c] / count;
+    }
+  }
+
+  uint32_t widest = 0;
+  for (uint32_t c = 1; c < numChannels; c++)
+  {
+    if (line.end[c] - line.start[c] > line.end[widest] - line.start[widest])
+    {
+      widest = c;
+    }
+  }
+  for (uint32_t c = 0; c < numChannels; c++)
+  {
+    float covariance = 0.0f;
+    for (uint32_t i = 0; i < count; i++)
+    {
+      covariance += (pTexels[i][c] - mean[c]) * (pTexels[i][widest] - mean[widest]);
+    }
+    if (covariance < 0.0f)
+    {
+      float start   = line.start[c];
+      line.start[c] = line.end[c];
+      line.end[c]   = start;
+    }
+  }
+  return line;
+}
+
+/// <summary>
+/// Ends of the line through the mean of the texels along the direction of largest variance
+/// </summary>
+static Line FitPrincipalAxis(const float (*pTexels)[4], uint32_t count, uint32_t numChannels)
+{
+  float mean[4] = {};
+  for (uint32_t i = 0; i < count; i++)
+  {
+    for (uint32_t c = 0; c < numChannels; c++)
+    {
+      mean[c] += pTexels[i][c] / count;
+    }
+  }
+
+  float covariance[4][4] = {};
+  for (uint32_t i = 0; i < count; i++)
+  {
+    for (uint32_t a = 0; a < numChannels; a++)
+    {
+      for (uint32_t b = 0; b < numChannels; b++)
+      {
+        covariance[a][b] += (pTexels[i][a] - mean[a]) * (pTexels[i][b] - mean[b]);
+      }
+    }
+  }
+
+  // Power iteration, from the row of the channel with the largest variance
+  uint32_t widest = 0;
+  for (uint32_t c = 1; c < numChannels; c++)
+  {
+    if (covariance[c][c] > covariance[widest][widest])
+    {
+      widest = c;
+    }
+  }
+  float axis[4] = {};
+  for (uint32_t c = 0; c < numChannels; c++)
+  {
+    axis[c] = covariance[widest][c];
+  }
+  for (uint32_t iteration = 0; iteration < 8; iteration++)
+  {
+    float next[4] = {};
+    float largest = 0.0f;
+    for (uint32_t a = 0; a < numChannels; a++)
+    {
+      for (uint32_t b = 0; b < numChannels; b++)
+      {
+        next[a] += covariance[a][b] * axis[b];
+      }
+      largest = fmaxf(largest, fabsf(next[a]));
+    }
+    if (largest < 1e-6f)
+    {
+      break;
+    }
+    for (uint32_t c = 0; c < numChannels; c++)
+    {
+      axis[c] = next[c] / largest;
+    }
+  }
+
+  float lengthSquared = 0.0f;
+  for (uint32_t c = 0; c < numChannels; c++)
+  {
+    lengthSquared += axis[c] * axis[c];
+  }
+
+  // All texels equal: a line of one point
+  Line line = {};
+  if (lengthSquared < 1e-12f)
+  {
+    memcpy(line.start, mean, sizeof(mean));
+    memcpy(line.end, mean, sizeof(mean));
+    return line;
+  }
+
+  float minimum = 0.0f;
+  float maximum = 0.0f;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    float t = 0.0f;
+    for (uint32_t c = 0; c < numChannels; c++)
+    {
+      t += (pTexels[i][c] - mean[c]) * axis[c];
+    }
+    minimum = fminf(minimum, t);
+    maximum = fmaxf(maximum, t);
+  }
+  for (uint32_t c = 0; c < numChannels; c++)
+  {
+    line.start[c] = Clamp255(mean[c] + axis[c] * minimum / lengthSquared);
+    line.end[c]   = Clamp255(mean[c] + axis[c] * maximum / lengthSquared);
+  }
+  return line;
+}
+
+/// <summary>
+/// Moves the endpoints to where they best reproduce the texels with the given weights of the end, which
+/// come from the indices the texels got. Keeps the line if all weights are equal.
+/// </summary>
+static void RefineLeastSquares(const float (*pTexels)[4], uint32_t count, uint32_t numChannels,
+                               const float* pWeights, Line* pLine)
+{
+  float startStart = 0.0f;
+  float startEnd   = 0.0f;
+  float endEnd     = 0.0f;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    float w = pWeights[i];
+    startStart += (1.0f - w) * (1.0f - w);
+    startEnd += (1.0f - w) * w;
+    endEnd += w * w;
+  }
+  float determinant = startStart * endEnd - startEnd * startEnd;
+  if (fabsf(determinant) < 1e-6f)
+  {
+    return;
+  }
+
+  for (uint32_t c = 0; c < numChannels; c++)
+  {
+    float startTexel = 0.0f;
+    float endTexel   = 0.0f;
+    for (uint32_t i = 0; i < count; i++)
+    {
+      startTexel += (1.0f - pWeights[i]) * pTexels[i][c];
+      endTexel += pWeights[i] * pTexels[i][c];
+    }
+    pLine->start[c] = Clamp255((startTexel * endEnd - endTexel * startEnd) / determinant);
+    pLine->end[c]   = Clamp255((endTexel * startStart - startTexel * startEnd) / determinant);
+  }
+}
+
+/// <summary>
+/// Gives every texel in the mask the index of the closest palette entry, the first one on ties
+/// </summary>
+/// <returns>Squared error over the first numChannels channels</returns>
+static uint32_t SelectIndices(const uint8_t* pTexels, const int32_t (*pPalette)[4], uint32_t numEntries,
+                              uint32_t numChannels, uint16_t mask, uint8_t* pIndices)
+{
+  uint32_t error = 0;
+  for (uint32_t i = 0; i < NUM_TEXELS; i++)
+  {
+    if (!(mask & (1u << i)))
+    {
+      continue;
+    }
+    uint32_t bestError = UINT32_MAX;
+    for (uint32_t entry = 0; entry < numEntries; entry++)
+    {
+      uint32_t entryError = 0;
+      for (uint32_t c = 0; c < numChannels; c++)
+      {
+        int32_t difference = pPalette[entry][c] - pTexels[i * 4 + c];
+        entryError += (uint32_t)(difference * difference);
+      }
+      if (entryError < bestError)
+      {
+        bestError   = entryError;
+        pIndices[i] = (uint8_t)entry;
+      }
+    }
+    error += bestError;
+  }
+  return error;
+}
+
+static uint16_t PackRgb565(const float* pColor)
+{
+  uint32_t r = (uint32_t)(Clamp255(pColor[0]) * 31.0f / 255.0f + 0.5f);
+  uint32_t g = (uint32_t)(Clamp255(pColor[1]) * 63.0f / 255.0f + 0.5f);
+  uint32_t b = (uint32_t)(Clamp255(pColor[2]) * 31.0f / 255.0f + 0.5f);
+  return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+/// <summary>
+/// BC1 colors. In 4-color mode the two extra colors lie at a third and two thirds of the line, else the
+/// third color is halfway and the fourth one is transparent black. BC3 always uses 4-color mode.
+/// </summary>
+static void GetColorPalette(uint16_t color0, uint16_t color1, bool fourColors, int32_t (*pPalette)[4])
+{
+  uint16_t colors[2] = { color0, color1 };
+  for (uint32_t i = 0; i < 2; i++)
+  {
+    int32_t r      = (colors[i] >> 11) & 31;
+    int32_t g      = (colors[i] >> 5) & 63;
+    int32_t b      = colors[i] & 31;
+    pPalette[i][0] = (r << 3) | (r >> 2);
+    pPalette[i][1] = (g << 2) | (g >> 4);
+    pPalette[i][2] = (b << 3) | (b >> 2);
+    pPalette[i][3] = 255;
+  }
+  for (uint32_t c = 0; c < 3; c++)
+  {
+    if (fourColors)
+    {
+      pPalette[2][c] = (2 * pPalette[0][c] + pPalette[1][c]) / 3;
+      pPalette[3][c] = (pPalette[0][c] + 2 * pPalette[1][c]) / 3;
+    }
+    else
+    {
+      pPalette[2][c] = (pPalette[0][c] + pPalette[1][c]) / 2;
+      pPalette[3][c] = 0;
+    }
+  }
+  pPalette[2][3] = 255;
+  pPalette[3][3] = fourColors ? 255 : 0;
+}
+
+/// <summary>
+/// BC1 block, or the color half of a BC3 block. Always in 4-color mode, alpha is ignored.
+/// </summary>
+static void EncodeColorBlock(const uint8_t* pTexels, mj::bc::Quality quality, uint8_t* pBlock)
+{
+  MJ_UNINITIALIZED float texels[NUM_TEXELS][4];
+  MJ_DISCARD(Gather(pTexels, UINT16_MAX, texels));
+  Line line = (quality == mj::bc::Quality::Fast) ? FitBoundingBox(texels, NUM_TEXELS, 3)
+                                                 : FitPrincipalAxis(texels, NUM_TEXELS, 3);
+  if (quality == mj::bc::Quality::Fast)
+  {
+    // Pull the ends in a little: the extremes are rarely worth an endpoint of their own
+    for (uint32_t c = 0; c < 3; c++)
+    {
+      float inset = (line.end[c] - line.start[c]) / 16.0f;
+      line.start[c] += inset;
+      line.end[c] -= inset;
+    }
+  }
+
+  uint32_t bestError      = UINT32_MAX;
+  uint16_t bestColors[2]  = {};
+  uint8_t bestIndices[16] = {};
+  uint32_t numRefinements = NUM_REFINEMENTS[(uint32_t)quality];
+  for (uint32_t pass = 0;; pass++)
+  {
+    // 4-color mode needs the first color to be larger, the line runs backwards if it is not
+    uint16_t color0 = PackRgb565(line.start);
+    uint16_t color1 = PackRgb565(line.end);
+    bool backwards  = color0 < color1;
+    if (backwards)
+    {
+      uint16_t color = color0;
+      color0         = color1;
+      color1         = color;
+    }
+
+    MJ_UNINITIALIZED int32_t palette[4][4];
+    GetColorPalette(color0, color1, true, palette);
+    MJ_UNINITIALIZED uint8_t indices[NUM_TEXELS];
+    uint32_t error = SelectIndices(pTexels, palette, 4, 3, UINT16_MAX, indices);
+    if (error < bestError)
+    {
+      bestError     = error;
+      bestColors[0] = color0;
+      bestColors[1] = color1;
+      memcpy(bestIndices, indices, sizeof(indices));
+    }
+    if (pass == numRefinements || error == 0)
+    {
+      break;
+    }
+
+    MJ_UNINITIALIZED float weights[NUM_TEXELS];
+    for (uint32_t i = 0; i < NUM_TEXELS; i++)
+    {
+      weights[i] = backwards ? 1.0f - COLOR_WEIGHTS[indices[i]] : COLOR_WEIGHTS[indices[i]];
+    }
+    RefineLeastSquares(texels, NUM_TEXELS, 3, weights, &line);
+  }
+
+  uint32_t bits = 0;
+  for (uint32_t i = 0; i < NUM_TEXELS; i++)
+  {
+    bits |= (uint32_t)bestIndices[i] << (i * 2);
+  }
+  pBlock[0] = (uint8_t)bestColors[0];
+  pBlock[1] = (uint8_t)(bestColors[0] >> 8);
+  pBlock[2] = (uint8_t)bestColors[1];
+  pBlock[3] = (uint8_t)(bestColors[1] >> 8);
+  for (uint32_t i = 0; i < 4; i++)
+  {
+    pBlock[4 + i] = (uint8_t)(bits >> (i * 8));
+  }
+}
+
+static void DecodeColorBlock(const uint8_t* pBlock, bool alwaysFourColors, uint8_t* pTexels)
+{
+  uint16_t color0 = (uint16_t)(pBlock[0] | (pBlock[1] << 8));
+  uint16_t color1 = (uint16_t)(pBlock[2] | (pBlock[3] << 8));
+  MJ_UNINITIALIZED int32_t palette[4][4];
+  GetColorPalette(color0, color1, alwaysFourColors || (color0 > color1), palette);
+
+  uint32_t bits = (uint32_t)pBlock[4] | ((uint32_t)pBlock[5] << 8) | ((uint32_t)pBlock[6] << 16) |
+                  ((uint32_t)pBlock[7] << 24);
+  for (uint32_t i = 0; i < NUM_TEXELS; i++)
+  {
+    uint32_t index = (bits >> (i * 2)) & 3;
+    for (uint32_t c = 0; c < 4; c++)
+    {
+      pTexels[i * 4 + c] = (uint8_t)palette[index][c];
+    }
+  }
+}
+
+/// <summary>
+/// BC3 alphas. With the first alpha larger there are 6 steps between the two, else 4 and then 0 and 255.
+/// </summary>
+static void GetAlphaPalette(int32_t alpha0, int32_t alpha1, int32_t* pPalette)
+{
+  pPalette[0] = alpha0;
+  pPalette[1] = alpha1;
+  if (alpha0 > alpha1)
+  {
+    for (int32_t i = 2; i < 8; i++)
+    {
+      pPalette[i] = ((8 - i) * alpha0 + (i - 1) * alpha1) / 7;
+    }
+  }
+  else
+  {
+    for (int32_t i = 2; i < 6; i++)
+    {
+      pPalette[i] = ((6 - i) * alpha0 + (i - 1) * alpha1) / 5;
+    }
+    pPalette[6] = 0;
+    pPalette[7] = 255;
+  }
+}
+
+/// <summary>
+/// The alpha half of a BC3 block, between the smallest and largest alpha
+/// </summary>
+static void EncodeAlphaBlock(const uint8_t* pTexels, uint8_t* pBlock)
+{
+  int32_t alpha0 = 0;
+  int32_t alpha1 = 255;
+  for (uint32_t i = 0; i < NUM_TEXELS; i++)
+  {
+    alpha0 = pTexels[i * 4 + 3] > alpha0 ? pTexels[i * 4 + 3] : alpha0;
+    alpha1 = pTexels[i * 4 + 3] < alpha1 ? pTexels[i * 4 + 3] : alpha1;
+  }
+  MJ_UNINITIALIZED int32_t palette[8];
+  GetAlphaPalette(alpha0, alpha1, palette);
+
+  uint64_t bits = 0;
+  for (uint32_t i = 0; i < NUM_TEXELS; i++)
+  {
+    uint32_t index   = 0;
+    int32_t distance = abs(palette[0] - pTexels[i * 4 + 3]);
+    for (uint32_t entry = 1; entry < 8; entry++)
+    {
+      if (abs(palette[entry] - pTexels[i * 4 + 3]) < distance)
+      {
+        distance = abs(palette[entry] - pTexels[i * 4 + 3]);
+        index    = entry;
+      }
+    }
+    bits |= (uint64_t)index << (i * 3);
+  }
+  pBlock[0] = (uint8_t)alpha0;
+  pBlock[1] = (uint8_t)alpha1;
+  for (uint32_t i = 0; i < 6; i++)
+  {
+    pBlock[2 + i] = (uint8_t)(bits >> (i * 8));
+  }
+}
+
+static void DecodeAlphaBlock(const uint8_t* pBlock, uint8_t* pTexels)
+{
+  MJ_UNINITIALIZED int32_t palette[8];
+  GetAlphaPalette(pBlock[0], pBlock[1], palette);
+  uint64_t bits = 0;
+  for (uint32_t i = 0; i < 6; i++)
+  {
+    bits |= (uint64_t)pBlock[2 + i] << (i * 8);
+  }
+  for (uint32_t i = 0; i < NUM_TEXELS; i++)
+  {
+    pTexels[i * 4 + 3] = (uint8_t)palette[(bits >> (i * 3)) & 7];
+  }
+}
+
+/// <summary>
+/// Mode 6 endpoint: 7 bits per channel plus a p-bit for all four, which is the lowest bit of each
+/// </summary>
+/// <returns>The p-bit</returns>
+static uint32_t QuantizeMode6(const float* pColor, uint32_t* pBits)
+{
+  float bestError = INFINITY;
+  uint32_t pbit   = 0;
+  for (uint32_t p = 0; p < 2; p++)
+  {
+    MJ_UNINITIALIZED uint32_t bits[4];
+    float error = 0.0f;
+    for (uint32_t c = 0; c < 4; c++)
+    {
+      int32_t value    = (int32_t)((Clamp255(pColor[c]) - p) / 2.0f + 0.5f);
+      bits[c]          = (uint32_t)(value < 0 ? 0 : (value > 127 ? 127 : value));
+      float difference = (float)((bits[c] << 1) | p) - pColor[c];
+      error += difference * difference;
+    }
+    if (error < bestError)
+    {
+      bestError = error;
+      pbit      = p;
+      memcpy(pBits, bits, sizeof(bits));
+    }
+  }
+  return pbit;
+}
+
+/// <summary>
+/// Mode 1 endpoint channel: 6 bits plus the p-bit of the subset, 7 bits that are widened to 8
+/// </summary>
+static inline int32_t ExpandMode1(uint32_t bits, uint32_t pbit)
+{
+  int32_t value = (int32_t)((bits << 1) | pbit);
+  return (value << 1) | (value >> 6);
+}
+
+static uint32_t QuantizeMode1(float value, uint32_t pbit)
+{
+  int32_t guess      = (int32_t)((Clamp255(value) * 127.0f / 255.0f - pbit) / 2.0f + 0.5f);
+  uint32_t bestBits  = 0;
+  float bestDistance = INFINITY;
+  for (int32_t bits = guess - 1; bits <= guess + 1; bits++)
+  {
+    if (bits >= 0 && bits < 64)
+    {
+      float distance = fabsf((float)ExpandMode1((uint32_t)bits, pbit) - value);
+      if (distance < bestDistance)
+      {
+        bestDistance = distance;
+        bestBits     = (uint32_t)bits;
+      }
+    }
+  }
+  return bestBits;
+}
+
+/// <returns>Squared error over RGBA</returns>
+static uint32_t EncodeMode6(const uint8_t* pTexels, const float (*pTexelsF)[4], mj::bc::Quality quality,
+                            uint8_t* pBlock)
+{
+  Line line = (quality == mj::bc::Quality::Fast) ? FitBoundingBox(pTexelsF, NUM_TEXELS, 4)
+                                                 : FitPrincipalAxis(pTexelsF, NUM_TEXELS, 4);
+
+  uint32_t bestError      = UINT32_MAX;
+  uint32_t bestBits[2][4] = {};
+  uint32_t bestPbits[2]   = {};
+  uint8_t bestIndices[16] = {};
+  uint32_t numRefinements = NUM_REFINEMENTS[(uint32_t)quality];
+  for (uint32_t pass = 0;; pass++)
+  {
+    MJ_UNINITIALIZED uint32_t bits[2][4];
+    uint32_t pbits[2] = { QuantizeMode6(line.start, bits[0]), QuantizeMode6(line.end, bits[1]) };
+
+    MJ_UNINITIALIZED int32_t palette[16][4];
+    for (uint32_t c = 0; c < 4; c++)
+    {
+      int32_t start = (int32_t)((bits[0][c] << 1) | pbits[0]);
+      int32_t end   = (int32_t)((bits[1][c] << 1) | pbits[1]);
+      for (uint32_t i = 0; i < 16; i++)
+      {
+        palette[i][c] = Interpolate(start, end, WEIGHTS_4[i]);
+      }
+    }
+    MJ_UNINITIALIZED uint8_t indices[NUM_TEXELS];
+    uint32_t error = SelectIndices(pTexels, palette, 16, 4, UINT16_MAX, indices);
+    if (error < bestError)
+    {
+      bestError = error;
+      memcpy(bestBits, bits, sizeof(bits));
+      memcpy(bestPbits, pbits, sizeof(pbits));
+      memcpy(bestIndices, indices, sizeof(indices));
+    }
+    if (pass == numRefinements || error == 0)
+    {
+      break;
+    }
+
+    MJ_UNINITIALIZED float weights[NUM_TEXELS];
+    for (uint32_t i = 0; i < NUM_TEXELS; i++)
+    {
+      weights[i] = WEIGHTS_4[indices[i]] / 64.0f;
+    }
+    RefineLeastSquares(pTexelsF, NUM_TEXELS, 4, weights, &line);
+  }
+
+  // The index of the first texel has no highest bit, it must be 0
+  uint32_t first = bestIndices[0] >= 8 ? 1 : 0;
+  if (first)
+  {
+    for (uint32_t i = 0; i < NUM_TEXELS; i++)
+    {
+      bestIndices[i] = (uint8_t)(15 - bestIndices[i]);
+    }
+  }
+
+  memset(pBlock, 0, 16);
+  BitWriter writer = { pBlock, 0 };
+  writer.Write(1 << 6, 7);
+  for (uint32_t c = 0; c < 4; c++)
+  {
+    writer.Write(bestBits[first][c], 7);
+    writer.Write(bestBits[1 - first][c], 7);
+  }
+  writer.Write(bestPbits[first], 1);
+  writer.Write(bestPbits[1 - first], 1);
+  for (uint32_t i = 0; i < NUM_TEXELS; i++)
+  {
+    writer.Write(bestIndices[i], i == 0 ? 3 : 4);
+  }
+  return bestError;
+}
+
+struct Mode1Subset
+{
+  uint32_t bits[2][3];
+  uint32_t pbit;
+  uint32_t error;
+};
+
+/// <summary>
+/// Endpoints of one subset of a mode 1 block, and the indices of its texels
+/// </summary>
+static Mode1Subset FitMode1Subset(const uint8_t* pTexels, uint16_t mask, mj::bc::Quality quality,
+                                  uint8_t* pIndices)
+{
+  MJ_UNINITIALIZED float texels[NUM_TEXELS][4];
+  uint32_t count = Gather(pTexels, mask, texels);
+  Line line      = FitPrincipalAxis(texels, count, 3);
+
+  Mode1Subset best        = {};
+  best.error              = UINT32_MAX;
+  uint32_t numRefinements = NUM_REFINEMENTS[(uint32_t)quality];
+  for (uint32_t pass = 0;; pass++)
+  {
+    uint32_t passError = UINT32_MAX;
+    MJ_UNINITIALIZED uint8_t passIndices[NUM_TEXELS];
+    for (uint32_t pbit = 0; pbit < 2; pbit++)
+    {
+      Mode1Subset subset = {};
+      subset.pbit        = pbit;
+      MJ_UNINITIALIZED int32_t palette[8][4];
+      for (uint32_t c = 0; c < 3; c++)
+      {
+        subset.bits[0][c] = QuantizeMode1(line.start[c], pbit);
+        subset.bits[1][c] = QuantizeMode1(line.end[c], pbit);
+        int32_t start     = ExpandMode1(subset.bits[0][c], pbit);
+        int32_t end       = ExpandMode1(subset.bits[1][c], pbit);
+        for (uint32_t i = 0; i < 8; i++)
+        {
+          palette[i][c] = Interpolate(start, end, WEIGHTS_3[i]);
+        }
+      }
+      MJ_UNINITIALIZED uint8_t indices[NUM_TEXELS];
+      subset.error = SelectIndices(pTexels, palette, 8, 3, mask, indices);
+      if (subset.error < passError)
+      {
+        passError = subset.error;
+        memcpy(passIndices, indices, sizeof(indices));
+      }
+      if (subset.error < best.error)
+      {
+        best = subset;
+        for (uint32_t i = 0; i < NUM_TEXELS; i++)
+        {
+          if (mask & (1u << i))
+          {
+            pIndices[i] = indices[i];
+          }
+        }
+      }
+    }
+    if (pass == numRefinements || passError == 0)
+    {
+      break;
+    }
+
+    MJ_UNINITIALIZED float weights[NUM_TEXELS];
+    for (uint32_t i = 0, j = 0; i < NUM_TEXELS; i++)
+    {
+      if (mask & (1u << i))
+      {
+        weights[j++] = WEIGHTS_3[passIndices[i]] / 64.0f;
+      }
+    }
+    RefineLeastSquares(texels, count, 3, weights, &line);
+  }
+  return best;
+}
+
+/// <returns>Squared error over RGB, alpha must be 255</returns>
+static uint32_t EncodeMode1(const uint8_t* pTexels, uint32_t partition, mj::bc::Quality quality, uint8_t* pBlock)
+{
+  uint16_t mask                  = PARTITIONS_2[partition];
+  MJ_UNINITIALIZED uint8_t indices[NUM_TEXELS];
+  Mode1Subset subsets[2]         = { FitMode1Subset(pTexels, (uint16_t)~mask, quality, indices),
+                                     FitMode1Subset(pTexels, mask, quality, indices) };
+
+  // The index of the first texel of each subset has no highest bit, it must be 0
+  uint32_t anchors[2] = { 0, ANCHORS_2[partition] };
+  for (uint32_t s = 0; s < 2; s++)
+  {
+    if (indices[anchors[s]] >= 4)
+    {
+      for (uint32_t c = 0; c < 3; c++)
+      {
+        uint32_t bits         = subsets[s].bits[0][c];
+        subsets[s].bits[0][c] = subsets[s].bits[1][c];
+        subsets[s].bits[1][c] = bits;
+      }
+      for (uint32_t i = 0; i < NUM_TEXELS; i++)
+      {
+        indices[i] = (((mask >> i) & 1) == s) ? (uint8_t)(7 - indices[i]) : indices[i];
+      }
+    }
+  }
+
+  memset(pBlock, 0, 16);
+  BitWriter writer = { pBlock, 0 };
+  writer.Write(1 << 1, 2);
+  writer.Write(partition, 6);
+  for (uint32_t c = 0; c < 3; c++)
+  {
+    for (uint32_t s = 0; s < 2; s++)
+    {
+      writer.Write(subsets[s].bits[0][c], 6);
+      writer.Write(subsets[s].bits[1][c], 6);
+    }
+  }
+  writer.Write(subsets[0].pbit, 1);
+  writer.Write(subsets[1].pbit, 1);
+  for (uint32_t i = 0; i < NUM_TEXELS; i++)
+  {
+    writer.Write(indices[i], (i == anchors[0] || i == anchors[1]) ? 2 : 3);
+  }
+  return subsets[0].error + subsets[1].error;
+}
+
+/// <summary>
+/// Sums of the RGB values and their products, from which the covariance of a set of texels follows
+/// </summary>
+struct Moments
+{
+  int32_t count;
+  int32_t sum[3];
+  int32_t products[6]; // rr, rg, rb, gg, gb, bb
+};
+
+static Moments GetMoments(const uint8_t* pTexels, uint16_t mask)
+{
+  // Without branches, the mask is as good as random
+  Moments moments = {};
+  for (uint32_t i = 0; i < NUM_TEXELS; i++)
+  {
+    int32_t in = (mask >> i) & 1;
+    int32_t r  = pTexels[i * 4 + 0] * in;
+    int32_t g  = pTexels[i * 4 + 1] * in;
+    int32_t b  = pTexels[i * 4 + 2] * in;
+    moments.count += in;
+    moments.sum[0] += r;
+    moments.sum[1] += g;
+    moments.sum[2] += b;
+    moments.products[0] += r * r;
+    moments.products[1] += r * g;
+    moments.products[2] += r * b;
+    moments.products[3] += g * g;
+    moments.products[4] += g * b;
+    moments.products[5] += b * b;
+  }
+  return moments;
+}
+
+/// <summary>
+/// Squared distance of the texels to the line through their mean along their principal axis: what is left
+/// for the indices to get wrong, to rank the partitions cheaply
+/// </summary>
+static float GetLineResidual(const Moments& moments)
+{
+  if (moments.count == 0)
+  {
+    return 0.0f;
+  }
+  float mean[3];
+  for (uint32_t c = 0; c < 3; c++)
+  {
+    mean[c] = (float)moments.sum[c] / moments.count;
+  }
+  const float n          = (float)moments.count;
+  float covariance[3][3] = {};
+  covariance[0][0]       = moments.products[0] - n * mean[0] * mean[0];
+  covariance[0][1]       = moments.products[1] - n * mean[0] * mean[1];
+  covariance[0][2]       = moments.products[2] - n * mean[0] * mean[2];
+  covariance[1][1]       = moments.products[3] - n * mean[1] * mean[1];
+  covariance[1][2]       = moments.products[4] - n * mean[1] * mean[2];
+  covariance[2][2]       = moments.products[5] - n * mean[2] * mean[2];
+  covariance[1][0]       = covariance[0][1];
+  covariance[2][0]       = covariance[0][2];
+  covariance[2][1]       = covariance[1][2];
+
+  // Largest eigenvalue by power iteration
+  float axis[3] = { 1.0f, 1.0f, 1.0f };
+  float largest = 0.0f;
+  for (uint32_t iteration = 0; iteration < 4; iteration++)
+  {
+    float next[3] = {};
+    for (uint32_t a = 0; a < 3; a++)
+    {
+      for (uint32_t b = 0; b < 3; b++)
+      {
+        next[a] += covariance[a][b] * axis[b];
+      }
+    }
+    largest = fmaxf(fabsf(next[0]), fmaxf(fabsf(next[1]), fabsf(next[2])));
+    if (largest < 1e-6f)
+    {
+      return 0.0f;
+    }
+    float scale = 1.0f / largest;
+    for (uint32_t c = 0; c < 3; c++)
+    {
+      axis[c] = next[c] * scale;
+    }
+  }
+  float trace = covariance[0][0] + covariance[1][1] + covariance[2][2];
+  return fmaxf(trace - largest, 0.0f);
+}
+
+/// <summary>
+/// Mode 6, and at the best quality mode 1 with the most promising partitions if the block is opaque
+/// </summary>
+static void EncodeBc7Block(const uint8_t* pTexels, mj::bc::Quality quality, uint8_t* pBlock)
+{
+  MJ_UNINITIALIZED float texels[NUM_TEXELS][4];
+  MJ_DISCARD(Gather(pTexels, UINT16_MAX, texels));
+  uint32_t bestError = EncodeMode6(pTexels, texels, quality, pBlock);
+  if (quality != mj::bc::Quality::Best || bestError == 0)
+  {
+    return;
+  }
+  for (uint32_t i = 0; i < NUM_TEXELS; i++)
+  {
+    if (pTexels[i * 4 + 3] != 255)
+    {
+      return;
+    }
+  }
+
+  // Partitions with the lowest estimates, best first. The moments of the first subset are those of the
+  // block minus those of the second one.
+  uint32_t candidates[NUM_PARTITIONS_TRIED] = {};
+  float estimates[NUM_PARTITIONS_TRIED];
+  for (uint32_t i = 0; i < NUM_PARTITIONS_TRIED; i++)
+  {
+    estimates[i] = INFINITY;
+  }
+  Moments block = GetMoments(pTexels, UINT16_MAX);
+  for (uint32_t partition = 0; partition < MJ_COUNTOF(PARTITIONS_2); partition++)
+  {
+    Moments second = GetMoments(pTexels, PARTITIONS_2[partition]);
+    Moments first  = block;
+    first.count -= second.count;
+    for (uint32_t c = 0; c < 3; c++)
+    {
+      first.sum[c] -= second.sum[c];
+    }
+    for (uint32_t i = 0; i < 6; i++)
+    {
+      first.products[i] -= second.products[i];
+    }
+    float estimate = GetLineResidual(first) + GetLineResidual(second);
+    for (uint32_t i = 0; i < NUM_PARTITIONS_TRIED; i++)
+    {
+      if (estimate < estimates[i])
+      {
+        memmove(estimates + i + 1, estimates + i, (NUM_PARTITIONS_TRIED - i - 1) * sizeof(float));
+        memmove(candidates + i + 1, candidates + i, (NUM_PARTITIONS_TRIED - i - 1) * sizeof(uint32_t));
+        estimates[i]  = estimate;
+        candidates[i] = partition;
+        break;
+      }
+    }
+  }
+
+  for (uint32_t candidate : candidates)
+  {
+    MJ_UNINITIALIZED uint8_t block[16];
+    uint32_t error = EncodeMode1(pTexels, candidate, quality, block);
+    if (error < bestError)
+    {
+      bestError = error;
+      memcpy(pBlock, block, sizeof(block));
+    }
+  }
+}
+
+static void DecodeBc7Block(const uint8_t* pBlock, uint8_t* pTexels)
+{
+  memset(pTexels, 0, NUM_TEXELS * 4);
+  BitReader reader = { pBlock, 0 };
+  uint32_t mode    = 0;
+  while (mode < 8 && reader.Read(1) == 0)
+  {
+    mode++;
+  }
+
+  if (mode == 6)
+  {
+    MJ_UNINITIALIZED uint32_t bits[2][4];
+    for (uint32_t c = 0; c < 4; c++)
+    {
+      bits[0][c] = reader.Read(7);
+      bits[1][c] = reader.Read(7);
+    }
+    uint32_t pbit0 = reader.Read(1);
+    uint32_t pbit1 = reader.Read(1);
+    for (uint32_t i = 0; i < NUM_TEXELS; i++)
+    {
+      uint32_t index = reader.Read(i == 0 ? 3 : 4);
+      for (uint32_t c = 0; c < 4; c++)
+      {
+        pTexels[i * 4 + c] = (uint8_t)Interpolate((int32_t)((bits[0][c] << 1) | pbit0),
+                                                  (int32_t)((bits[1][c] << 1) | pbit1), WEIGHTS_4[index]);
+      }
+    }
+  }
+  else if (mode == 1)
+  {
+    uint32_t partition = reader.Read(6);
+    MJ_UNINITIALIZED uint32_t bits[4][3];
+    for (uint32_t c = 0; c < 3; c++)
+    {
+      for (uint32_t e = 0; e < 4; e++)
+      {
+        bits[e][c] = reader.Read(6);
+      }
+    }
+    uint32_t pbits[2] = { reader.Read(1), reader.Read(1) };
+    for (uint32_t i = 0; i < NUM_TEXELS; i++)
+    {
+      uint32_t index = reader.Read((i == 0 || i == ANCHORS_2[partition]) ? 2 : 3);
+      uint32_t s     = (PARTITIONS_2[partition] >> i) & 1;
+      for (uint32_t c = 0; c < 3; c++)
+      {
+        pTexels[i * 4 + c] = (uint8_t)Interpolate(ExpandMode1(bits[s * 2][c], pbits[s]),
+                                                  ExpandMode1(bits[s * 2 + 1][c], pbits[s]), WEIGHTS_3[index]);
+      }
+      pTexels[i * 4 + 3] = 255;
+    }
+  }
+}
+
+void mj::bc::EncodeBlock(dds::Format format, const uint8_t* pTexels, Quality quality, uint8_t* pBlock)
+{
+  switch (format)
+  {
+  case dds::Format::RGBA8:
+    break;
+  case dds::Format::BC1:
+    EncodeColorBlock(pTexels, quality, pBlock);
+    break;
+  case dds::Format::BC3:
+    EncodeAlphaBlock(pTexels, pBlock);
+    EncodeColorBlock(pTexels, quality, pBlock + 8);
+    break;
+  case dds::Format::BC7:
+    EncodeBc7Block(pTexels, quality, pBlock);
+    break;
+  }
+}
+
+void mj::bc::DecodeBlock(dds::Format format, const uint8_t* pBlock, uint8_t* pTexels)
+{
+  switch (format)
+  {
+  case dds::Format::RGBA8:
+    break;
+  case dds::Format::BC1:
+    DecodeColorBlock(pBlock, false, pTexels);
+    break;
+  case dds::Format::BC3:
+    DecodeColorBlock(pBlock + 8, true, pTexels);
+    DecodeAlphaBlock(pBlock, pTexels);
+    break;
+  case dds::Format::BC7:
+    DecodeBc7Block(pBlock, pTexels);
+    break;
+  }
+}
+
+void mj::bc::Encode(dds::Format format, const uint8_t* pSrc, uint32_t width, uint32_t height, Quality quality,
+                    uint8_t* pDst)
+{
+  ZoneScoped;
+  if (!dds::IsCompressed(format))
+  {
+    memcpy(pDst, pSrc, (size_t)width * height * 4);
+    return;
+  }
+
+  size_t blockSize = dds::GetMipSize(format, 1, 1);
+  for (uint32_t blockY = 0; blockY < height; blockY += 4)
+  {
+    for (uint32_t blockX = 0; blockX < width; blockX += 4)
+    {
+      MJ_UNINITIALIZED uint8_t texels[NUM_TEXELS * 4];
+      for (uint32_t y = 0; y < 4; y++)
+      {
+        uint32_t srcY = (blockY + y < height) ? blockY + y : height - 1;
+        for (uint32_t x = 0; x < 4; x++)
+        {
+          uint32_t srcX = (blockX + x < width) ? blockX + x : width - 1;
+          memcpy(texels + (y * 4 + x) * 4, pSrc + ((size_t)srcY * width + srcX) * 4, 4);
+        }
+      }
+      EncodeBlock(format, texels, quality, pDst);
+      pDst += blockSize;
+    }
+  }
+}
+
+void mj::bc::Decode(dds::Format format, const uint8_t* pSrc, uint32_t width, uint32_t height, uint8_t* pDst)
+{
+  ZoneScoped;
+  if (!dds::IsCompressed(format))
+  {
+    memcpy(pDst, pSrc, (size_t)width * height * 4);
+    return;
+  }
+
+  size_t blockSize = dds::GetMipSize(format, 1, 1);
+  for (uint32_t blockY = 0; blockY < height; blockY += 4)
+  {
+    for (uint32_t blockX = 0; blockX < width; blockX += 4)
+    {
+      MJ_UNINITIALIZED uint8_t texels[NUM_TEXELS * 4];
+      DecodeBlock(format, pSrc, texels);
+      pSrc += blockSize;
+      for (uint32_t y = 0; y < 4 && blockY + y < height; y++)
+      {
+        for (uint32_t x = 0; x < 4 && blockX + x < width; x++)
+        {
+          memcpy(pDst + ((size_t)(blockY + y) * width + blockX + x) * 4, texels + (y * 4 + x) * 4, 4);
+        }
+      }
+    }
+  }
+}
+
+uint64_t mj::bc::GetSquaredError(const uint8_t* pA, const uint8_t* pB, size_t size)
+{
+  uint64_t error = 0;
+  for (size_t i = 0; i < size; i++)
+  {
+    int32_t difference = pA[i] - pB[i];
+    error += (uint64_t)(difference * difference);
+  }
+  return error;
+}
+
+double mj::bc::GetPsnr(uint64_t squaredError, size_t size)
+{
+  if (squaredError == 0 || size == 0)
+  {
+    return INFINITY;
+  }
+  return 10.0 * log10(255.0 * 255.0 * size / (double)squaredError);
+}
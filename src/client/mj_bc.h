@@ -0,0 +1,66 @@
+// Block compression - BC1, BC3 and BC7 encoders, for the asset cooker
+// Should not use pre-compiled headers (for portability)
+//
+// The formats store 4x4 texels per block. BC1 has two RGB565 endpoints and a 2-bit index per texel into
+// the 4 colors on the line between them, 8 bytes per block. BC3 adds 8 bytes for alpha: two 8-bit
+// endpoints and 3-bit indices. BC7 has 16 bytes per block and 8 modes; the encoder writes mode 6 (one RGBA
+// line with 7-bit endpoints and 4-bit indices) and, at the best quality, mode 1 for opaque blocks (two RGB
+// lines split by one of 64 partitions, 3-bit indices).
+//
+// Endpoints start at the ends of the principal axis of the texels and are then refined by least squares
+// on the indices they got. Fast uses the bounding box of the texels instead and does not refine, Best
+// refines more and searches the BC7 partitions. Blocks are independent, so callers can compress rows of
+// blocks in parallel.
+
+#pragma once
+#include "mj_dds.h"
+
+namespace mj
+{
+  namespace bc
+  {
+    enum class Quality
+    {
+      Fast,
+      Normal,
+      Best,
+    };
+
+    /// <summary>
+    /// Compresses one block
+    /// </summary>
+    /// <param name="format">BC1, BC3 or BC7</param>
+    /// <param name="pTexels">4x4 RGBA8 texels, row after row</param>
+    /// <param name="pBlock">8 or 16 bytes, see dds::GetMipSize</param>
+    void EncodeBlock(dds::Format format, const uint8_t* pTexels, Quality quality, uint8_t* pBlock);
+
+    /// <summary>
+    /// Writes the 4x4 RGBA8 texels of a block. BC7 blocks must use mode 1 or 6, other modes decode to 0.
+    /// </summary>
+    void DecodeBlock(dds::Format format, const uint8_t* pBlock, uint8_t* pTexels);
+
+    /// <summary>
+    /// Compresses a width x height RGBA8 image. Blocks past the right or bottom edge repeat the last column
+    /// or row. Copies the image as it is for RGBA8.
+    /// </summary>
+    /// <param name="pDst">dds::GetMipSize(format, width, height) bytes</param>
+    void Encode(dds::Format format, const uint8_t* pSrc, uint32_t width, uint32_t height, Quality quality,
+                uint8_t* pDst);
+
+    /// <summary>
+    /// Writes a width x height RGBA8 image
+    /// </summary>
+    void Decode(dds::Format format, const uint8_t* pSrc, uint32_t width, uint32_t height, uint8_t* pDst);
+
+    /// <summary>
+    /// Sum of the squared differences of two byte arrays, e.g. an image and its decoded copy
+    /// </summary>
+    uint64_t GetSquaredError(const uint8_t* pA, const uint8_t* pB, size_t size);
+
+    /// <summary>
+    /// Peak signal-to-noise ratio in dB of 8-bit values, infinite if they are equal
+    /// </summary>
+    /// <param name="size">Number of values the error was summed over</param>
+    double GetPsnr(uint64_t squaredError, size_t size);
+  } // namespace bc
+} // namespace mj
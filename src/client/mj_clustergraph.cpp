@@ -0,0 +1,577 @@
+// Cluster graph - hierarchical path finding (HPA*) for large maps
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_clustergraph.h"
+#include "mj_jobs.h"
+#include "mj_profiler.h"
+
+#include <algorithm>
+#include <functional>
+
+static constexpr uint32_t CELLS_PER_CLUSTER = mj::ClusterGraph::CLUSTER_SIZE * mj::ClusterGraph::CLUSTER_SIZE;
+static constexpr uint32_t MAX_NODES         = mj::ClusterGraph::MAX_CLUSTER_NODES;
+static constexpr uint32_t UNREACHABLE       = UINT32_MAX;
+static constexpr uint32_t NO_PARENT         = UINT32_MAX;
+static constexpr uint8_t NO_NODE            = 0xFF;
+static constexpr uint8_t NO_DIRECTION       = 0xFF;
+
+// Entrances at least this long get a transition at both ends instead of one in the middle
+static constexpr int32_t SPLIT_ENTRANCE_LENGTH = 6;
+
+// Clusters per job in a full build
+static constexpr uint32_t BUILD_GRAIN_SIZE = 4;
+
+static uint32_t Abs(int32_t value)
+{
+  return (uint32_t)(value < 0 ? -value : value);
+}
+
+static uint32_t Octile(uint32_t dx, uint32_t dz)
+{
+  uint32_t diagonal = dx < dz ? dx : dz;
+  uint32_t straight = (dx > dz ? dx : dz) - diagonal;
+  return diagonal * mj::ClusterGraph::DIAGONAL_COST + straight * mj::ClusterGraph::ORTHOGONAL_COST;
+}
+
+bool mj::ClusterGraph::Init(uint32_t width, uint32_t height)
+{
+  size_t numCells    = (size_t)width * height;
+  this->numClustersX = (width + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+  this->numClustersZ = (height + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+  size_t numClusters = (size_t)this->numClustersX * this->numClustersZ;
+  size_t maxPath     = numClusters * MAX_NODES + 2;
+  this->pClusters    = (Cluster*)calloc(numClusters, sizeof(Cluster));
+  this->pNodeAt      = (uint8_t*)malloc(numCells);
+  this->pEdgeCosts   = (uint32_t*)malloc(numClusters * MAX_NODES * MAX_NODES * sizeof(uint32_t));
+  this->pFields      = (uint8_t*)malloc(numClusters * MAX_NODES * CELLS_PER_CLUSTER);
+  this->pNodes       = (Node*)calloc(numClusters * MAX_NODES + 1, sizeof(Node));
+  this->pPath        = (BlockPos*)malloc(maxPath * sizeof(BlockPos));
+  this->pPathNodes   = (uint32_t*)malloc(maxPath * sizeof(uint32_t));
+  if (!this->pClusters || !this->pNodeAt || !this->pEdgeCosts || !this->pFields || !this->pNodes || !this->pPath ||
+      !this->pPathNodes)
+  {
+    Destroy();
+    return false;
+  }
+
+  this->width    = width;
+  this->height   = height;
+  this->searchId = 0;
+  memset(this->pNodeAt, NO_NODE, numCells);
+  for (uint32_t cz = 0; cz < this->numClustersZ; cz++)
+  {
+    for (uint32_t cx = 0; cx < this->numClustersX; cx++)
+    {
+      Cluster& cluster = this->pClusters[cz * this->numClustersX + cx];
+      cluster.x0       = cx * CLUSTER_SIZE;
+      cluster.z0       = cz * CLUSTER_SIZE;
+      cluster.x1       = std::min((cx + 1) * CLUSTER_SIZE, width);
+      cluster.z1       = std::min((cz + 1) * CLUSTER_SIZE, height);
+    }
+  }
+  return true;
+}
+
+void mj::ClusterGraph::Destroy()
+{
+  free(this->pClusters);
+  free(this->pNodeAt);
+  free(this->pEdgeCosts);
+  free(this->pFields);
+  free(this->pNodes);
+  free(this->pHeap);
+  free(this->pPath);
+  free(this->pPathNodes);
+  this->pClusters    = nullptr;
+  this->pNodeAt      = nullptr;
+  this->pEdgeCosts   = nullptr;
+  this->pFields      = nullptr;
+  this->pNodes       = nullptr;
+  this->pHeap        = nullptr;
+  this->pPath        = nullptr;
+  this->pPathNodes   = nullptr;
+  this->heapCapacity = 0;
+  this->width        = 0;
+  this->height       = 0;
+}
+
+uint32_t mj::ClusterGraph::GetCluster(int32_t x, int32_t z) const
+{
+  return (z / CLUSTER_SIZE) * this->numClustersX + (x / CLUSTER_SIZE);
+}
+
+uint32_t mj::ClusterGraph::GetLocalCell(const Cluster& cluster, uint32_t cell) const
+{
+  return ((cell / this->width) - cluster.z0) * CLUSTER_SIZE + ((cell % this->width) - cluster.x0);
+}
+
+/// <summary>
+/// Scans the border between cluster low and its +X (acrossX) or +Z neighbor for entrances,
+/// and adds the transition cells on one side of it to cluster.
+/// </summary>
+void mj::ClusterGraph::AddTransitions(const Grid& grid, uint32_t cluster, uint32_t low, bool acrossX, bool highSide)
+{
+  const Cluster& border = this->pClusters[low];
+  Cluster& target       = this->pClusters[cluster];
+
+  // Position along the border -> cell on the chosen side
+  int32_t begin  = acrossX ? border.z0 : border.x0;
+  int32_t end    = acrossX ? border.z1 : border.x1;
+  int32_t across = (acrossX ? border.x1 : border.z1) - (highSide ? 0 : 1);
+  auto isFree    = [&](int32_t along) {
+    int32_t x = acrossX ? border.x1 : along;
+    int32_t z = acrossX ? along : border.z1;
+    return !grid.IsSolid(x, z) && !grid.IsSolid(x - (acrossX ? 1 : 0), z - (acrossX ? 0 : 1));
+  };
+  auto add = [&](int32_t along) {
+    uint32_t cell = acrossX ? (along * this->width + across) : (across * this->width + along);
+    if (this->pNodeAt[cell] == NO_NODE)
+    {
+      assert(target.numNodes < MAX_NODES);
+      this->pNodeAt[cell]             = (uint8_t)target.numNodes;
+      target.cells[target.numNodes++] = cell;
+    }
+  };
+
+  int32_t along = begin;
+  while (along < end)
+  {
+    if (!isFree(along))
+    {
+      along++;
+      continue;
+    }
+
+    int32_t first = along;
+    while (along < end && isFree(along))
+    {
+      along++;
+    }
+    int32_t last = along - 1;
+
+    if (last - first + 1 >= SPLIT_ENTRANCE_LENGTH)
+    {
+      add(first);
+      add(last);
+    }
+    else
+    {
+      add((first + last) / 2);
+    }
+  }
+}
+
+/// <summary>
+/// Per local cell: the steps that are possible without leaving the cluster
+/// </summary>
+void mj::ClusterGraph::GetStepMasks(const Grid& grid, const Cluster& cluster, uint8_t* pMasks) const
+{
+  for (int32_t z = cluster.z0; z < cluster.z1; z++)
+  {
+    for (int32_t x = cluster.x0; x < cluster.x1; x++)
+    {
+      uint32_t mask = grid.GetStepMask(x, z);
+      for (uint32_t i = 0; i < 8; i++)
+      {
+        int32_t nx = x + NEIGHBOR_DX[i];
+        int32_t nz = z + NEIGHBOR_DZ[i];
+        if (nx < cluster.x0 || nz < cluster.z0 || nx >= cluster.x1 || nz >= cluster.z1)
+        {
+          mask &= ~(1 << i);
+        }
+      }
+      pMasks[(z - cluster.z0) * CLUSTER_SIZE + (x - cluster.x0)] = (uint8_t)mask;
+    }
+  }
+}
+
+/// <summary>
+/// Dijkstra from a local cell over the step masks of a cluster.
+/// Per local cell: path cost, and the direction of the next step toward source.
+/// </summary>
+void mj::ClusterGraph::Fill(const uint8_t* pMasks, uint32_t source, uint32_t* pCosts, uint8_t* pDirections) const
+{
+  static constexpr int32_t s_Offsets[8] = {
+    NEIGHBOR_DX[0] + NEIGHBOR_DZ[0] * (int32_t)CLUSTER_SIZE, NEIGHBOR_DX[1] + NEIGHBOR_DZ[1] * (int32_t)CLUSTER_SIZE,
+    NEIGHBOR_DX[2] + NEIGHBOR_DZ[2] * (int32_t)CLUSTER_SIZE, NEIGHBOR_DX[3] + NEIGHBOR_DZ[3] * (int32_t)CLUSTER_SIZE,
+    NEIGHBOR_DX[4] + NEIGHBOR_DZ[4] * (int32_t)CLUSTER_SIZE, NEIGHBOR_DX[5] + NEIGHBOR_DZ[5] * (int32_t)CLUSTER_SIZE,
+    NEIGHBOR_DX[6] + NEIGHBOR_DZ[6] * (int32_t)CLUSTER_SIZE, NEIGHBOR_DX[7] + NEIGHBOR_DZ[7] * (int32_t)CLUSTER_SIZE,
+  };
+
+  for (uint32_t i = 0; i < CELLS_PER_CLUSTER; i++)
+  {
+    pCosts[i] = UNREACHABLE;
+  }
+  if (pDirections)
+  {
+    memset(pDirections, NO_DIRECTION, CELLS_PER_CLUSTER);
+  }
+
+  // With only two step costs, Dijkstra needs no heap: cells are popped in cost order, so a FIFO queue
+  // per step cost stays sorted, and the next cell is the cheaper of the two queue heads.
+  // Entries are (cost << 8) | local cell. Each cell is expanded once and pushes at most 4 entries per queue.
+  MJ_UNINITIALIZED uint32_t queues[2][4 * CELLS_PER_CLUSTER + 1];
+  uint32_t heads[2]     = {};
+  uint32_t tails[2]     = {};
+  pCosts[source]        = 0;
+  queues[0][tails[0]++] = source;
+
+  while (heads[0] < tails[0] || heads[1] < tails[1])
+  {
+    bool diagonal  = heads[0] == tails[0] || (heads[1] < tails[1] && queues[1][heads[1]] < queues[0][heads[0]]);
+    uint32_t entry = queues[diagonal][heads[diagonal]++];
+    uint32_t cost  = entry >> 8;
+    uint32_t local = entry & 0xFF;
+    if (cost > pCosts[local])
+    {
+      continue;
+    }
+
+    uint32_t mask = pMasks[local];
+    for (uint32_t i = 0; i < 8; i++)
+    {
+      if (!(mask & (1 << i)))
+      {
+        continue;
+      }
+
+      uint32_t neighbor = local + s_Offsets[i];
+      uint32_t newCost  = cost + ((i & 1) ? DIAGONAL_COST : ORTHOGONAL_COST);
+      if (newCost < pCosts[neighbor])
+      {
+        pCosts[neighbor] = newCost;
+        if (pDirections)
+        {
+          pDirections[neighbor] = (uint8_t)((i + 4) & 7);
+        }
+        queues[i & 1][tails[i & 1]++] = (newCost << 8) | neighbor;
+      }
+    }
+  }
+}
+
+void mj::ClusterGraph::BuildCluster(const Grid& grid, uint32_t cluster)
+{
+  Cluster& c = this->pClusters[cluster];
+  for (uint32_t i = 0; i < c.numNodes; i++)
+  {
+    this->pNodeAt[c.cells[i]] = NO_NODE;
+  }
+  c.numNodes = 0;
+
+  uint32_t cx = cluster % this->numClustersX;
+  uint32_t cz = cluster / this->numClustersX;
+  if (cx > 0)
+  {
+    AddTransitions(grid, cluster, cluster - 1, true, true);
+  }
+  if (cx + 1 < this->numClustersX)
+  {
+    AddTransitions(grid, cluster, cluster, true, false);
+  }
+  if (cz > 0)
+  {
+    AddTransitions(grid, cluster, cluster - this->numClustersX, false, true);
+  }
+  if (cz + 1 < this->numClustersZ)
+  {
+    AddTransitions(grid, cluster, cluster, false, false);
+  }
+
+  // Cache the paths between all nodes of the cluster
+  MJ_UNINITIALIZED uint8_t masks[CELLS_PER_CLUSTER];
+  MJ_UNINITIALIZED uint32_t costs[CELLS_PER_CLUSTER];
+  GetStepMasks(grid, c, masks);
+  uint32_t* pEdges = this->pEdgeCosts + (size_t)cluster * MAX_NODES * MAX_NODES;
+  for (uint32_t i = 0; i < c.numNodes; i++)
+  {
+    uint8_t* pField = this->pFields + ((size_t)cluster * MAX_NODES + i) * CELLS_PER_CLUSTER;
+    Fill(masks, GetLocalCell(c, c.cells[i]), costs, pField);
+    for (uint32_t j = 0; j < c.numNodes; j++)
+    {
+      pEdges[i * MAX_NODES + j] = costs[GetLocalCell(c, c.cells[j])];
+    }
+  }
+}
+
+void mj::ClusterGraph::Build(const Grid& grid)
+{
+  ZoneScoped;
+  assert(grid.width == this->width && grid.height == this->height);
+  mj::jobs::ParallelFor(this->numClustersX * this->numClustersZ, BUILD_GRAIN_SIZE, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t cluster = begin; cluster < end; cluster++)
+    {
+      BuildCluster(grid, cluster);
+    }
+  });
+}
+
+void mj::ClusterGraph::OnCellChanged(const Grid& grid, int32_t x, int32_t z)
+{
+  ZoneScoped;
+  uint32_t cluster = GetCluster(x, z);
+  const Cluster& c = this->pClusters[cluster];
+  BuildCluster(grid, cluster);
+
+  // Border cells also change the entrances of the neighbor
+  if (x == c.x0 && c.x0 > 0)
+  {
+    BuildCluster(grid, cluster - 1);
+  }
+  if (x == c.x1 - 1 && c.x1 < (int32_t)this->width)
+  {
+    BuildCluster(grid, cluster + 1);
+  }
+  if (z == c.z0 && c.z0 > 0)
+  {
+    BuildCluster(grid, cluster - this->numClustersX);
+  }
+  if (z == c.z1 - 1 && c.z1 < (int32_t)this->height)
+  {
+    BuildCluster(grid, cluster + this->numClustersX);
+  }
+}
+
+void mj::ClusterGraph::Open(uint32_t node, uint32_t parent, uint32_t g, uint32_t h)
+{
+  Node& n = this->pNodes[node];
+  if (n.searchId != this->searchId)
+  {
+    n.searchId = this->searchId;
+    n.g        = UNREACHABLE;
+    n.closed   = false;
+  }
+  if (n.closed || g >= n.g)
+  {
+    return;
+  }
+  n.g      = g;
+  n.parent = parent;
+
+  // Lazy deletion: outdated entries are skipped when popped
+  if (this->heapSize == this->heapCapacity)
+  {
+    uint32_t capacity = this->heapCapacity ? 2 * this->heapCapacity : 1024;
+    uint64_t* pHeap   = (uint64_t*)realloc(this->pHeap, capacity * sizeof(uint64_t));
+    if (!pHeap)
+    {
+      return;
+    }
+    this->pHeap        = pHeap;
+    this->heapCapacity = capacity;
+  }
+  this->pHeap[this->heapSize++] = ((uint64_t)(g + h) << 32) | node;
+  std::push_heap(this->pHeap, this->pHeap + this->heapSize, std::greater<uint64_t>());
+}
+
+bool mj::ClusterGraph::FindPath(const Grid& grid, BlockPos start, BlockPos goal)
+{
+  ZoneScoped;
+  assert(grid.width == this->width && grid.height == this->height);
+  this->pathLength = 0;
+  this->cost       = 0;
+  if (grid.IsSolid(start.x, start.z) || grid.IsSolid(goal.x, goal.z))
+  {
+    return false;
+  }
+
+  if (++this->searchId == 0)
+  {
+    for (size_t i = 0; i < (size_t)this->numClustersX * this->numClustersZ * MAX_NODES + 1; i++)
+    {
+      this->pNodes[i].searchId = 0;
+    }
+    this->searchId = 1;
+  }
+
+  // Connect start and goal to the nodes of their clusters
+  uint32_t goalNode     = this->numClustersX * this->numClustersZ * MAX_NODES;
+  uint32_t startCluster = GetCluster(start.x, start.z);
+  this->goalCluster     = GetCluster(goal.x, goal.z);
+  const Cluster& sc     = this->pClusters[startCluster];
+  const Cluster& gc     = this->pClusters[this->goalCluster];
+  MJ_UNINITIALIZED uint8_t masks[CELLS_PER_CLUSTER];
+  MJ_UNINITIALIZED uint32_t startCosts[CELLS_PER_CLUSTER], goalCosts[CELLS_PER_CLUSTER];
+  GetStepMasks(grid, sc, masks);
+  Fill(masks, GetLocalCell(sc, start.z * this->width + start.x), startCosts, nullptr);
+  GetStepMasks(grid, gc, masks);
+  Fill(masks, GetLocalCell(gc, goal.z * this->width + goal.x), goalCosts, this->goalField);
+
+  auto heuristic = [&](uint32_t cell) {
+    return Octile(Abs((int32_t)(cell % this->width) - goal.x), Abs((int32_t)(cell / this->width) - goal.z));
+  };
+
+  this->heapSize = 0;
+  if (startCluster == this->goalCluster)
+  {
+    uint32_t direct = goalCosts[(start.z - gc.z0) * CLUSTER_SIZE + (start.x - gc.x0)];
+    if (direct != UNREACHABLE)
+    {
+      Open(goalNode, NO_PARENT, direct, 0);
+    }
+  }
+  for (uint32_t i = 0; i < sc.numNodes; i++)
+  {
+    uint32_t g = startCosts[GetLocalCell(sc, sc.cells[i])];
+    if (g != UNREACHABLE)
+    {
+      Open(startCluster * MAX_NODES + i, NO_PARENT, g, heuristic(sc.cells[i]));
+    }
+  }
+
+  while (this->heapSize > 0)
+  {
+    std::pop_heap(this->pHeap, this->pHeap + this->heapSize, std::greater<uint64_t>());
+    uint32_t node = (uint32_t)this->pHeap[--this->heapSize];
+    Node& n       = this->pNodes[node];
+    if (n.closed)
+    {
+      continue;
+    }
+    n.closed = true;
+
+    if (node == goalNode)
+    {
+      this->cost = n.g;
+
+      // Walk back to the start, then reverse
+      this->pPathNodes[this->pathLength] = goalNode;
+      this->pPath[this->pathLength++]    = goal;
+      for (uint32_t p = n.parent; p != NO_PARENT; p = this->pNodes[p].parent)
+      {
+        uint32_t waypoint                  = this->pClusters[p / MAX_NODES].cells[p % MAX_NODES];
+        this->pPathNodes[this->pathLength] = p;
+        this->pPath[this->pathLength++]    = BlockPos{ (int32_t)(waypoint % this->width), //
+                                                    (int32_t)(waypoint / this->width) };
+      }
+      this->pPathNodes[this->pathLength] = NO_PARENT;
+      this->pPath[this->pathLength++]    = start;
+      std::reverse(this->pPath, this->pPath + this->pathLength);
+      std::reverse(this->pPathNodes, this->pPathNodes + this->pathLength);
+
+      // Drop zero-length segments (start or goal on a transition).
+      // The transition node is kept, since it tells RefineSegment how the waypoint was reached.
+      uint32_t length = 1;
+      for (uint32_t i = 1; i < this->pathLength; i++)
+      {
+        const BlockPos& previous = this->pPath[length - 1];
+        if (this->pPath[i].x != previous.x || this->pPath[i].z != previous.z)
+        {
+          this->pPath[length]      = this->pPath[i];
+          this->pPathNodes[length] = this->pPathNodes[i];
+          length++;
+        }
+        else if (this->pPathNodes[i] != goalNode)
+        {
+          this->pPathNodes[length - 1] = this->pPathNodes[i];
+        }
+      }
+      this->pathLength = length;
+      return true;
+    }
+
+    uint32_t cluster = node / MAX_NODES;
+    uint32_t index   = node % MAX_NODES;
+    const Cluster& c = this->pClusters[cluster];
+    uint32_t cell    = c.cells[index];
+
+    if (cluster == this->goalCluster)
+    {
+      uint32_t toGoal = goalCosts[GetLocalCell(c, cell)];
+      if (toGoal != UNREACHABLE)
+      {
+        Open(goalNode, node, n.g + toGoal, 0);
+      }
+    }
+
+    // Intra-cluster edges
+    const uint32_t* pEdges = this->pEdgeCosts + ((size_t)cluster * MAX_NODES + index) * MAX_NODES;
+    for (uint32_t j = 0; j < c.numNodes; j++)
+    {
+      if (j != index && pEdges[j] != UNREACHABLE)
+      {
+        Open(cluster * MAX_NODES + j, node, n.g + pEdges[j], heuristic(c.cells[j]));
+      }
+    }
+
+    // Inter-cluster edges: a node directly across a border is the other half of a transition
+    int32_t x = (int32_t)(cell % this->width);
+    int32_t z = (int32_t)(cell / this->width);
+    for (uint32_t i = 0; i < 8; i += 2)
+    {
+      int32_t nx = x + NEIGHBOR_DX[i];
+      int32_t nz = z + NEIGHBOR_DZ[i];
+      if ((uint32_t)nx >= this->width || (uint32_t)nz >= this->height)
+      {
+        continue;
+      }
+      uint32_t neighborCell    = nz * this->width + nx;
+      uint32_t neighborCluster = GetCluster(nx, nz);
+      if (neighborCluster != cluster && this->pNodeAt[neighborCell] != NO_NODE)
+      {
+        Open(neighborCluster * MAX_NODES + this->pNodeAt[neighborCell], node, n.g + ORTHOGONAL_COST,
+             heuristic(neighborCell));
+      }
+    }
+  }
+
+  return false;
+}
+
+uint32_t mj::ClusterGraph::Follow(const Cluster& cluster, const uint8_t* pDirections, BlockPos from, BlockPos to,
+                                  BlockPos* pCells, uint32_t capacity) const
+{
+  uint32_t count = 0;
+  int32_t x      = from.x;
+  int32_t z      = from.z;
+  while ((x != to.x || z != to.z) && count < capacity)
+  {
+    uint8_t direction = pDirections[(z - cluster.z0) * CLUSTER_SIZE + (x - cluster.x0)];
+    if (direction == NO_DIRECTION)
+    {
+      break;
+    }
+    x += NEIGHBOR_DX[direction];
+    z += NEIGHBOR_DZ[direction];
+    pCells[count++] = BlockPos{ x, z };
+  }
+  return count;
+}
+
+uint32_t mj::ClusterGraph::RefineSegment(uint32_t segment, BlockPos* pCells, uint32_t capacity) const
+{
+  assert(segment + 1 < this->pathLength);
+  BlockPos from = this->pPath[segment];
+  BlockPos to   = this->pPath[segment + 1];
+  uint32_t node = this->pPathNodes[segment + 1];
+
+  if (node == this->numClustersX * this->numClustersZ * MAX_NODES)
+  {
+    return Follow(this->pClusters[this->goalCluster], this->goalField, from, to, pCells, capacity);
+  }
+
+  uint32_t cluster = node / MAX_NODES;
+  if (GetCluster(from.x, from.z) == cluster)
+  {
+    return Follow(this->pClusters[cluster], this->pFields + (size_t)node * CELLS_PER_CLUSTER, from, to, pCells,
+                  capacity);
+  }
+
+  // Step across a border
+  if (capacity == 0)
+  {
+    return 0;
+  }
+  pCells[0] = to;
+  return 1;
+}
+
+uint32_t mj::ClusterGraph::GetNumNodes() const
+{
+  uint32_t numNodes = 0;
+  for (uint32_t i = 0; i < this->numClustersX * this->numClustersZ; i++)
+  {
+    numNodes += this->pClusters[i].numNodes;
+  }
+  return numNodes;
+}
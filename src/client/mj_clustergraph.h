@@ -0,0 +1,130 @@
+// Cluster graph - hierarchical path finding (HPA*) for large maps
+// Should not use pre-compiled headers (for portability)
+//
+// The grid is split into CLUSTER_SIZE x CLUSTER_SIZE clusters. Wherever two neighboring clusters
+// share a run of free cells along their border (an entrance), one or two transitions are placed:
+// a pair of nodes, one on each side. Inside a cluster, every pair of nodes is connected by
+// the cost of the shortest path that stays inside the cluster, and that path is cached as a
+// direction field per node. Queries search the small abstract graph and only turn the result
+// into cells when a segment is refined.
+//
+// Paths are near-optimal: they pass through transitions and cannot leave a cluster between two.
+// Movement rules are the same as PathFinder and FlowField (8 directions, no cutting corners).
+// After a cell changes, only the cluster containing it (and the neighbor, for border cells) is rebuilt.
+
+#pragma once
+#include "mj_grid.h"
+
+namespace mj
+{
+  class ClusterGraph
+  {
+  public:
+    static constexpr uint32_t CLUSTER_SIZE = 16;
+    // Transitions are at least one blocked cell apart, so a border has at most CLUSTER_SIZE / 2
+    static constexpr uint32_t MAX_CLUSTER_NODES = 4 * (CLUSTER_SIZE / 2);
+    static constexpr uint32_t ORTHOGONAL_COST   = 1000;
+    static constexpr uint32_t DIAGONAL_COST     = 1414;
+
+    bool Init(uint32_t width, uint32_t height);
+    void Destroy();
+
+    /// <summary>
+    /// Full rebuild. Clusters are built in parallel on the job system.
+    /// </summary>
+    void Build(const Grid& grid);
+
+    /// <summary>
+    /// Rebuilds the clusters affected by a change of a single cell (e.g. a door opened or closed).
+    /// The grid must already contain the new state. Paths found before the change must be queried again.
+    /// </summary>
+    void OnCellChanged(const Grid& grid, int32_t x, int32_t z);
+
+    /// <summary>
+    /// Searches the abstract graph. The result is stored in this object until the next query.
+    /// </summary>
+    /// <returns>False if either cell is solid or the goal cannot be reached</returns>
+    bool FindPath(const Grid& grid, BlockPos start, BlockPos goal);
+
+    /// <summary>
+    /// Start, the transitions on the way and the goal
+    /// </summary>
+    const BlockPos* GetAbstractPath() const
+    {
+      return this->pPath;
+    }
+
+    uint32_t GetAbstractPathLength() const
+    {
+      return this->pathLength;
+    }
+
+    /// <summary>
+    /// Cost of the last path, in ORTHOGONAL_COST per cell
+    /// </summary>
+    uint32_t GetCost() const
+    {
+      return this->cost;
+    }
+
+    /// <summary>
+    /// Writes the cells from abstract waypoint segment to segment + 1 (excluding the first) to pCells.
+    /// </summary>
+    /// <returns>Number of cells written</returns>
+    uint32_t RefineSegment(uint32_t segment, BlockPos* pCells, uint32_t capacity) const;
+
+    uint32_t GetNumNodes() const;
+
+  private:
+    struct Cluster
+    {
+      int32_t x0;
+      int32_t z0;
+      int32_t x1; // Exclusive
+      int32_t z1; // Exclusive
+      uint32_t numNodes;
+      uint32_t cells[MAX_CLUSTER_NODES];
+    };
+
+    struct Node
+    {
+      uint32_t g;
+      uint32_t parent;
+      uint32_t searchId; // Node is stale if this differs from the current search
+      bool closed;
+    };
+
+    uint32_t GetCluster(int32_t x, int32_t z) const;
+    void BuildCluster(const Grid& grid, uint32_t cluster);
+    void AddTransitions(const Grid& grid, uint32_t cluster, uint32_t low, bool acrossX, bool highSide);
+    uint32_t GetLocalCell(const Cluster& cluster, uint32_t cell) const;
+    void GetStepMasks(const Grid& grid, const Cluster& cluster, uint8_t* pMasks) const;
+    void Fill(const uint8_t* pMasks, uint32_t source, uint32_t* pCosts, uint8_t* pDirections) const;
+    uint32_t Follow(const Cluster& cluster, const uint8_t* pDirections, BlockPos from, BlockPos to, BlockPos* pCells,
+                    uint32_t capacity) const;
+    void Open(uint32_t node, uint32_t parent, uint32_t g, uint32_t h);
+
+    uint32_t width        = 0;
+    uint32_t height       = 0;
+    uint32_t numClustersX = 0;
+    uint32_t numClustersZ = 0;
+    Cluster* pClusters    = nullptr;
+    uint8_t* pNodeAt      = nullptr; // Per cell: index into its cluster's nodes, or NO_NODE
+    uint32_t* pEdgeCosts  = nullptr; // Per cluster: MAX_CLUSTER_NODES^2 intra-cluster costs
+    uint8_t* pFields      = nullptr; // Per node: direction toward the node for every cell of its cluster
+
+    // Query state
+    Node* pNodes          = nullptr;
+    uint64_t* pHeap       = nullptr; // Lazy min-heap of (f << 32) | node
+    uint32_t heapSize     = 0;
+    uint32_t heapCapacity = 0;
+    uint32_t searchId     = 0;
+    BlockPos* pPath       = nullptr;
+    uint32_t* pPathNodes  = nullptr;
+    uint32_t pathLength   = 0;
+    uint32_t cost         = 0;
+    // Paths into the goal, used to refine the last segment
+    uint32_t goalCluster                           = 0;
+    uint8_t goalField[CLUSTER_SIZE * CLUSTER_SIZE] = {};
+  };
+} // namespace mj
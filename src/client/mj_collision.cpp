@@ -0,0 +1,101 @@
+// Collision - swept boxes against the level grid
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_collision.h"
+
+#include <math.h>
+
+// Distance kept between a box and the wall it stopped at, so the next query does not start inside the wall
+static constexpr float SKIN = 0.001f;
+
+static bool IsSolid(const mj::Grid& grid, bool alongX, int32_t axis, int32_t perpendicular)
+{
+  return alongX ? grid.IsSolid(axis, perpendicular) : grid.IsSolid(perpendicular, axis);
+}
+
+/// <summary>
+/// Sweeps the leading edge of a box along one axis.
+/// A box covers cells floor(center - radius) up to and including ceil(center + radius) - 1.
+/// </summary>
+/// <returns>New center along the axis</returns>
+static float SweepAxis(const mj::Grid& grid, bool alongX, float center, float perpendicular, float delta, float radius,
+                       bool* pHit)
+{
+  *pHit = false;
+  if (delta == 0.0f)
+  {
+    return center;
+  }
+
+  int32_t perpMin = (int32_t)floorf(perpendicular - radius);
+  int32_t perpMax = (int32_t)ceilf(perpendicular + radius) - 1;
+
+  if (delta > 0.0f)
+  {
+    float edge    = center + radius;
+    int32_t first = (int32_t)ceilf(edge);
+    int32_t last  = (int32_t)ceilf(edge + delta) - 1;
+    for (int32_t cell = first; cell <= last; cell++)
+    {
+      for (int32_t p = perpMin; p <= perpMax; p++)
+      {
+        if (IsSolid(grid, alongX, cell, p))
+        {
+          *pHit      = true;
+          float stop = (float)cell - radius - SKIN;
+          return (stop > center) ? stop : center;
+        }
+      }
+    }
+  }
+  else
+  {
+    float edge    = center - radius;
+    int32_t first = (int32_t)floorf(edge) - 1;
+    int32_t last  = (int32_t)floorf(edge + delta);
+    for (int32_t cell = first; cell >= last; cell--)
+    {
+      for (int32_t p = perpMin; p <= perpMax; p++)
+      {
+        if (IsSolid(grid, alongX, cell, p))
+        {
+          *pHit      = true;
+          float stop = (float)(cell + 1) + radius + SKIN;
+          return (stop < center) ? stop : center;
+        }
+      }
+    }
+  }
+
+  return center + delta;
+}
+
+mj::collision::MoveResult mj::collision::Move(const Grid& grid, const mjm::vec3& position, const mjm::vec3& delta,
+                                              float radius)
+{
+  MoveResult result;
+  result.position   = position;
+  result.position.x = SweepAxis(grid, true, position.x, position.z, delta.x, radius, &result.hitX);
+  result.position.z = SweepAxis(grid, false, position.z, result.position.x, delta.z, radius, &result.hitZ);
+  result.position.y += delta.y;
+  return result;
+}
+
+bool mj::collision::Overlaps(const Grid& grid, float x, float z, float radius)
+{
+  int32_t xMin = (int32_t)floorf(x - radius);
+  int32_t xMax = (int32_t)ceilf(x + radius) - 1;
+  int32_t zMin = (int32_t)floorf(z - radius);
+  int32_t zMax = (int32_t)ceilf(z + radius) - 1;
+  for (int32_t cz = zMin; cz <= zMax; cz++)
+  {
+    for (int32_t cx = xMin; cx <= xMax; cx++)
+    {
+      if (grid.IsSolid(cx, cz))
+      {
+        return true;
+      }
+    }
+  }
+  return false;
+}
@@ -0,0 +1,34 @@
+// Collision - swept boxes against the level grid
+// Should not use pre-compiled headers (for portability)
+//
+// Actors are axis-aligned squares on the XZ plane. A move is resolved one axis at a time:
+// only the cells the leading edge sweeps through are tested, so a move costs a handful of
+// lookups regardless of its length, and cannot tunnel through walls.
+
+#pragma once
+#include "mj_grid.h"
+
+namespace mj
+{
+  namespace collision
+  {
+    struct MoveResult
+    {
+      mjm::vec3 position;
+      bool hitX;
+      bool hitZ;
+    };
+
+    /// <summary>
+    /// Moves a box along delta, stopping at solid cells and sliding along them. Y is passed through.
+    /// </summary>
+    /// <param name="position">Box center, must not overlap a solid cell</param>
+    /// <param name="radius">Half extent of the box, in cells</param>
+    MoveResult Move(const Grid& grid, const mjm::vec3& position, const mjm::vec3& delta, float radius);
+
+    /// <summary>
+    /// True if a box overlaps any solid cell
+    /// </summary>
+    bool Overlaps(const Grid& grid, float x, float z, float radius);
+  } // namespace collision
+} // namespace mj
@@ -1,7 +1,10 @@
 #pragma once
+#include <assert.h>
 #include <stdint.h>
+#include <stdlib.h> // malloc
 #include <string.h> // memcpy
 #include <new>
+#include <utility> // std::forward
 
 // Annotation macros
 
@@ -209,7 +212,7 @@ namespace mj
       {
         if (Double())
         {
-          return EmplaceSingle();
+          return EmplaceSingle(std::forward<Ts>(args)...);
         }
         else
         {
@@ -422,6 +425,87 @@ namespace mj
     uint32_t numElements = 0;
   };
 
+  /// <summary>
+  /// Accumulates frame time and hands it out in fixed-size simulation ticks.
+  /// The remainder is used to interpolate between the last two simulation states when rendering.
+  /// </summary>
+  class FixedTimestep
+  {
+  public:
+    /// <summary>
+    /// Upper bound on catch-up work, excess time is dropped (the game slows down instead of stalling).
+    /// </summary>
+    static constexpr uint32_t MAX_TICKS_PER_FRAME = 8;
+
+    FixedTimestep(float tickTime) : tickTime(tickTime)
+    {
+    }
+
+    void Reset()
+    {
+      this->accumulator   = 0.0f;
+      this->numTicksFrame = 0;
+    }
+
+    /// <summary>
+    /// Adds the time that passed since the last frame.
+    /// </summary>
+    void Advance(float frameTime)
+    {
+      this->accumulator += frameTime;
+      if (this->accumulator > MAX_TICKS_PER_FRAME * this->tickTime)
+      {
+        this->accumulator = MAX_TICKS_PER_FRAME * this->tickTime;
+      }
+      this->numTicksFrame = 0;
+    }
+
+    /// <summary>
+    /// Consumes one tick worth of time.
+    /// </summary>
+    /// <returns>True if a simulation tick should run</returns>
+    bool Step()
+    {
+      if (this->accumulator >= this->tickTime)
+      {
+        this->accumulator -= this->tickTime;
+        this->tick++;
+        this->numTicksFrame++;
+        return true;
+      }
+      return false;
+    }
+
+    /// <summary>
+    /// Interpolation factor between the previous (0) and the current (1) simulation state.
+    /// </summary>
+    float GetAlpha() const
+    {
+      return this->accumulator / this->tickTime;
+    }
+
+    float GetTickTime() const
+    {
+      return this->tickTime;
+    }
+
+    uint64_t GetTick() const
+    {
+      return this->tick;
+    }
+
+    uint32_t GetNumTicksThisFrame() const
+    {
+      return this->numTicksFrame;
+    }
+
+  private:
+    float tickTime;
+    float accumulator      = 0.0f;
+    uint64_t tick          = 0;
+    uint32_t numTicksFrame = 0;
+  };
+
   /// <summary>
   /// Read/write stream wrapped around a memory buffer
   /// </summary>
@@ -493,7 +577,7 @@ namespace mj
       return *this;
     }
 
-    MemoryBuffer& Write(void* pData, size_t size)
+    MemoryBuffer& Write(const void* pData, size_t size)
     {
       if (SizeLeft() >= size)
       {
@@ -0,0 +1,247 @@
+// DDS - writes and reads texture arrays in the DirectDraw Surface format
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_dds.h"
+#include "mj_common.h"
+#include "mj_profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static constexpr uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+static constexpr uint32_t DX10      = 0x30315844; // "DX10"
+static constexpr uint32_t DXT1      = 0x31545844; // "DXT1"
+static constexpr uint32_t DXT5      = 0x35545844; // "DXT5"
+
+// DDS_HEADER flags
+static constexpr uint32_t DDSD_CAPS        = 0x1;
+static constexpr uint32_t DDSD_HEIGHT      = 0x2;
+static constexpr uint32_t DDSD_WIDTH       = 0x4;
+static constexpr uint32_t DDSD_PITCH       = 0x8;
+static constexpr uint32_t DDSD_PIXELFORMAT = 0x1000;
+static constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+static constexpr uint32_t DDSD_LINEARSIZE  = 0x80000;
+static constexpr uint32_t DDPF_FOURCC      = 0x4;
+static constexpr uint32_t DDPF_RGB         = 0x40;
+static constexpr uint32_t DDSCAPS_COMPLEX  = 0x8;
+static constexpr uint32_t DDSCAPS_TEXTURE  = 0x1000;
+static constexpr uint32_t DDSCAPS_MIPMAP   = 0x400000;
+static constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+static constexpr uint32_t DDSCAPS2_VOLUME  = 0x200000;
+
+static constexpr uint32_t D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+static constexpr uint32_t D3D10_RESOURCE_MISC_TEXTURECUBE    = 0x4;
+
+struct DdsPixelFormat
+{
+  uint32_t size;
+  uint32_t flags;
+  uint32_t fourCC;
+  uint32_t rgbBitCount;
+  uint32_t rBitMask;
+  uint32_t gBitMask;
+  uint32_t bBitMask;
+  uint32_t aBitMask;
+};
+
+struct DdsHeader
+{
+  uint32_t size;
+  uint32_t flags;
+  uint32_t height;
+  uint32_t width;
+  uint32_t pitchOrLinearSize;
+  uint32_t depth;
+  uint32_t mipMapCount;
+  uint32_t reserved1[11];
+  DdsPixelFormat pixelFormat;
+  uint32_t caps;
+  uint32_t caps2;
+  uint32_t caps3;
+  uint32_t caps4;
+  uint32_t reserved2;
+};
+
+struct DdsHeaderDx10
+{
+  uint32_t dxgiFormat;
+  uint32_t resourceDimension;
+  uint32_t miscFlag;
+  uint32_t arraySize;
+  uint32_t miscFlags2;
+};
+
+static_assert(sizeof(DdsHeader) == 124, "DDS_HEADER");
+static_assert(sizeof(DdsHeaderDx10) == 20, "DDS_HEADER_DXT10");
+
+bool mj::dds::IsCompressed(Format format)
+{
+  return format != Format::RGBA8;
+}
+
+size_t mj::dds::GetMipSize(Format format, uint32_t width, uint32_t height)
+{
+  size_t numBlocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+  switch (format)
+  {
+  case Format::RGBA8:
+    return (size_t)width * height * 4;
+  case Format::BC1:
+    return numBlocks * 8;
+  case Format::BC3:
+  case Format::BC7:
+    return numBlocks * 16;
+  }
+  return 0;
+}
+
+size_t mj::dds::GetLayerSize(Format format, uint32_t width, uint32_t height, uint32_t numMips)
+{
+  size_t size = 0;
+  for (uint32_t mip = 0; mip < numMips; mip++)
+  {
+    size += GetMipSize(format, width, height);
+    width  = width > 1 ? width / 2 : 1;
+    height = height > 1 ? height / 2 : 1;
+  }
+  return size;
+}
+
+size_t mj::dds::GetRowPitch(Format format, uint32_t width)
+{
+  return GetMipSize(format, width, IsCompressed(format) ? 4 : 1);
+}
+
+/// <summary>
+/// Format of a legacy header, without the DX10 extension
+/// </summary>
+static bool GetLegacyFormat(const DdsPixelFormat& pixelFormat, mj::dds::Format* pFormat)
+{
+  if ((pixelFormat.flags & DDPF_FOURCC) && (pixelFormat.fourCC == DXT1 || pixelFormat.fourCC == DXT5))
+  {
+    *pFormat = pixelFormat.fourCC == DXT1 ? mj::dds::Format::BC1 : mj::dds::Format::BC3;
+    return true;
+  }
+  if ((pixelFormat.flags & DDPF_RGB) &&       //
+      (pixelFormat.rgbBitCount == 32) &&      //
+      (pixelFormat.rBitMask == 0x000000FF) && //
+      (pixelFormat.gBitMask == 0x0000FF00) && //
+      (pixelFormat.bBitMask == 0x00FF0000))
+  {
+    *pFormat = mj::dds::Format::RGBA8;
+    return true;
+  }
+  return false;
+}
+
+bool mj::dds::ParseArray(const void* pData, size_t size, ArrayInfo* pInfo)
+{
+  *pInfo                = {};
+  const uint8_t* pBytes = (const uint8_t*)pData;
+  size_t offset         = sizeof(DDS_MAGIC) + sizeof(DdsHeader);
+  if (!pBytes || size < offset)
+  {
+    return false;
+  }
+  MJ_UNINITIALIZED uint32_t magic;
+  MJ_UNINITIALIZED DdsHeader header;
+  memcpy(&magic, pBytes, sizeof(magic));
+  memcpy(&header, pBytes + sizeof(magic), sizeof(header));
+  bool isTexture2D = !(header.caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME));
+  if (magic != DDS_MAGIC || header.size != sizeof(DdsHeader) || !isTexture2D)
+  {
+    return false;
+  }
+
+  Format format      = Format::RGBA8;
+  uint32_t numLayers = 1;
+  if ((header.pixelFormat.flags & DDPF_FOURCC) && (header.pixelFormat.fourCC == DX10))
+  {
+    MJ_UNINITIALIZED DdsHeaderDx10 dx10;
+    if (size < offset + sizeof(dx10))
+    {
+      return false;
+    }
+    memcpy(&dx10, pBytes + offset, sizeof(dx10));
+    offset += sizeof(dx10);
+    isTexture2D = (dx10.resourceDimension == D3D10_RESOURCE_DIMENSION_TEXTURE2D) && //
+                  !(dx10.miscFlag & D3D10_RESOURCE_MISC_TEXTURECUBE);
+    if (!isTexture2D)
+    {
+      return false;
+    }
+    format    = (Format)dx10.dxgiFormat;
+    numLayers = dx10.arraySize;
+    if (format != Format::RGBA8 && format != Format::BC1 && format != Format::BC3 && format != Format::BC7)
+    {
+      return false;
+    }
+  }
+  else if (!GetLegacyFormat(header.pixelFormat, &format))
+  {
+    return false;
+  }
+
+  // Every mip is at least 1x1, so there are at most 1 + log2(largest side) of them
+  uint32_t numMips = ((header.flags & DDSD_MIPMAPCOUNT) && header.mipMapCount > 0) ? header.mipMapCount : 1;
+  uint32_t maxMips = 0;
+  for (uint32_t side = header.width > header.height ? header.width : header.height; side > 0; side /= 2)
+  {
+    maxMips++;
+  }
+  if (header.width == 0 || header.height == 0 || numLayers == 0 || numMips > maxMips)
+  {
+    return false;
+  }
+
+  size_t layerSize = GetLayerSize(format, header.width, header.height, numMips);
+  if (numLayers > (size - offset) / layerSize)
+  {
+    return false;
+  }
+  pInfo->format    = format;
+  pInfo->width     = header.width;
+  pInfo->height    = header.height;
+  pInfo->numMips   = numMips;
+  pInfo->numLayers = numLayers;
+  pInfo->layerSize = layerSize;
+  pInfo->pLayers   = pBytes + offset;
+  return true;
+}
+
+bool mj::dds::WriteArray(const char* pPath, Format format, uint32_t width, uint32_t height, uint32_t numMips,
+                         uint32_t numLayers, const void* pData)
+{
+  ZoneScoped;
+  DdsHeader header          = {};
+  header.size               = sizeof(DdsHeader);
+  header.flags              = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT;
+  header.height             = height;
+  header.width              = width;
+  header.pitchOrLinearSize  = (uint32_t)GetMipSize(format, width, IsCompressed(format) ? height : 1);
+  header.mipMapCount        = numMips;
+  header.pixelFormat.size   = sizeof(DdsPixelFormat);
+  header.pixelFormat.flags  = DDPF_FOURCC;
+  header.pixelFormat.fourCC = DX10;
+  header.caps               = DDSCAPS_TEXTURE | (numMips > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+  // Bytes of the first mip for block-compressed formats, bytes per row otherwise
+  header.flags |= IsCompressed(format) ? DDSD_LINEARSIZE : DDSD_PITCH;
+
+  DdsHeaderDx10 dx10     = {};
+  dx10.dxgiFormat        = (uint32_t)format;
+  dx10.resourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D;
+  dx10.arraySize         = numLayers;
+
+  FILE* pFile = fopen(pPath, "wb");
+  if (!pFile)
+  {
+    return false;
+  }
+  size_t size  = GetLayerSize(format, width, height, numMips) * numLayers;
+  bool written = (fwrite(&DDS_MAGIC, sizeof(DDS_MAGIC), 1, pFile) == 1) && //
+                 (fwrite(&header, sizeof(header), 1, pFile) == 1) &&       //
+                 (fwrite(&dx10, sizeof(dx10), 1, pFile) == 1) &&           //
+                 (fwrite(pData, 1, size, pFile) == size);
+  return (fclose(pFile) == 0) && written;
+}
@@ -0,0 +1,77 @@
+// DDS - writes and reads texture arrays in the DirectDraw Surface format
+// Should not use pre-compiled headers (for portability)
+//
+// Files have the DX10 extension header, which is what describes an array: "DDS ", DDS_HEADER,
+// DDS_HEADER_DXT10, then the layers one after another, each with its mips from largest to smallest.
+// That is the layout D3D11 and bimg::imageParseDds expect. Block-compressed mips store rows of 4x4 blocks,
+// rounded up to whole blocks. ParseArray() also reads single textures with the older DXT1, DXT5 and
+// 32-bit RGBA headers.
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace mj
+{
+  namespace dds
+  {
+    /// <summary>
+    /// Values of DXGI_FORMAT
+    /// </summary>
+    enum class Format : uint32_t
+    {
+      RGBA8 = 28, // DXGI_FORMAT_R8G8B8A8_UNORM
+      BC1   = 71, // DXGI_FORMAT_BC1_UNORM, 8 bytes per block
+      BC3   = 77, // DXGI_FORMAT_BC3_UNORM, 16 bytes per block
+      BC7   = 98, // DXGI_FORMAT_BC7_UNORM, 16 bytes per block
+    };
+
+    /// <summary>
+    /// True for formats stored in 4x4 blocks
+    /// </summary>
+    bool IsCompressed(Format format);
+
+    /// <summary>
+    /// Bytes of one mip
+    /// </summary>
+    size_t GetMipSize(Format format, uint32_t width, uint32_t height);
+
+    /// <summary>
+    /// Bytes of the mips of one layer
+    /// </summary>
+    size_t GetLayerSize(Format format, uint32_t width, uint32_t height, uint32_t numMips);
+
+    /// <summary>
+    /// Bytes of a row of texels, or of a row of 4x4 blocks for block-compressed formats
+    /// </summary>
+    size_t GetRowPitch(Format format, uint32_t width);
+
+    /// <summary>
+    /// A texture array in memory, see ParseArray()
+    /// </summary>
+    struct ArrayInfo
+    {
+      Format format;
+      uint32_t width;
+      uint32_t height;
+      uint32_t numMips;
+      uint32_t numLayers;
+      size_t layerSize;       // GetLayerSize(); mip i of a layer starts GetLayerSize(..., i) bytes into it
+      const uint8_t* pLayers; // Into the parsed data, layer after layer
+    };
+
+    /// <summary>
+    /// Reads the headers of a texture array without copying its layers
+    /// </summary>
+    /// <returns>False if the data is not a 2D texture in one of the formats above or is truncated</returns>
+    bool ParseArray(const void* pData, size_t size, ArrayInfo* pInfo);
+
+    /// <summary>
+    /// Writes a 2D texture array
+    /// </summary>
+    /// <param name="pData">numLayers * GetLayerSize() bytes, in file order</param>
+    /// <returns>False if the file could not be written</returns>
+    bool WriteArray(const char* pPath, Format format, uint32_t width, uint32_t height, uint32_t numMips,
+                    uint32_t numLayers, const void* pData);
+  } // namespace dds
+} // namespace mj
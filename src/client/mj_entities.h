@@ -0,0 +1,452 @@
+// Entities - generational handles and dense component pools
+// Should not use pre-compiled headers (for portability)
+//
+// An entity is an index into the slot arrays plus the generation of that slot.
+// Destroying an entity bumps the generation, so stale handles stop resolving.
+//
+// Components live in pools: a sparse array maps entity index to a dense index,
+// and all components of a pool are packed at the front of one array per component type.
+// Systems loop over the dense arrays directly. Removal swaps the last element into the hole.
+
+#pragma once
+#include "mj_common.h"
+#include "mj_hash.h"
+#include <tuple>
+
+namespace mj
+{
+  struct Entity
+  {
+    uint32_t index;
+    uint32_t generation;
+  };
+
+  inline bool operator==(const Entity& a, const Entity& b)
+  {
+    return (a.index == b.index) && (a.generation == b.generation);
+  }
+
+  inline bool operator!=(const Entity& a, const Entity& b)
+  {
+    return !(a == b);
+  }
+
+  /// <summary>
+  /// Generation 0 is never handed out
+  /// </summary>
+  static constexpr Entity NULL_ENTITY = { UINT32_MAX, 0 };
+
+  /// <summary>
+  /// Hands out entity handles. Capacity is fixed at Init.
+  /// </summary>
+  class EntityPool
+  {
+  public:
+    bool Init(uint32_t capacity)
+    {
+      this->pGenerations = (uint32_t*)calloc(capacity, sizeof(uint32_t));
+      this->pFree        = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+      this->pAlive       = (bool*)calloc(capacity, sizeof(bool));
+      if (!this->pGenerations || !this->pFree || !this->pAlive)
+      {
+        Destroy();
+        return false;
+      }
+
+      this->capacity = capacity;
+      Clear();
+      return true;
+    }
+
+    void Destroy()
+    {
+      free(this->pGenerations);
+      free(this->pFree);
+      free(this->pAlive);
+      this->pGenerations = nullptr;
+      this->pFree        = nullptr;
+      this->pAlive       = nullptr;
+      this->capacity     = 0;
+      this->numFree      = 0;
+      this->numUsed      = 0;
+    }
+
+    /// <summary>
+    /// Releases all entities. Generations are kept, so old handles stay invalid.
+    /// </summary>
+    void Clear()
+    {
+      for (uint32_t i = 0; i < this->capacity; i++)
+      {
+        if (this->pAlive[i] || this->pGenerations[i] == 0)
+        {
+          this->pGenerations[i]++;
+        }
+        this->pAlive[i] = false;
+        // Lowest indices are handed out first
+        this->pFree[i] = this->capacity - 1 - i;
+      }
+      this->numFree = this->capacity;
+    }
+
+    /// <summary>
+    /// Clear() that also restarts the generations, as if the pool was just initialized
+    /// </summary>
+    void Reset()
+    {
+      for (uint32_t i = 0; i < this->capacity; i++)
+      {
+        this->pGenerations[i] = 0;
+        this->pAlive[i]       = false;
+      }
+      this->numUsed = 0;
+      Clear();
+    }
+
+    /// <returns>NULL_ENTITY if the pool is full</returns>
+    Entity Create()
+    {
+      if (this->numFree == 0)
+      {
+        return NULL_ENTITY;
+      }
+
+      uint32_t index      = this->pFree[--this->numFree];
+      this->pAlive[index] = true;
+      if (index >= this->numUsed)
+      {
+        this->numUsed = index + 1;
+      }
+      return Entity{ index, this->pGenerations[index] };
+    }
+
+    void Destroy(Entity entity)
+    {
+      if (IsAlive(entity))
+      {
+        this->pAlive[entity.index] = false;
+        // Skip 0 on wrap-around, it marks NULL_ENTITY
+        if (++this->pGenerations[entity.index] == 0)
+        {
+          this->pGenerations[entity.index] = 1;
+        }
+        this->pFree[this->numFree++] = entity.index;
+      }
+    }
+
+    bool IsAlive(Entity entity) const
+    {
+      return (entity.index < this->capacity) && //
+             this->pAlive[entity.index] &&      //
+             (this->pGenerations[entity.index] == entity.generation);
+    }
+
+    uint32_t GetCapacity() const
+    {
+      return this->capacity;
+    }
+
+    uint32_t GetNumAlive() const
+    {
+      return this->capacity - this->numFree;
+    }
+
+    /// <summary>
+    /// Covers everything that decides which handles are handed out next.
+    /// Slots that were never used are implied by numUsed, so the cost follows the peak entity count.
+    /// </summary>
+    uint64_t Hash(uint64_t seed) const
+    {
+      uint32_t numNeverUsed = this->capacity - this->numUsed;
+      uint32_t numRecycled  = this->numFree - numNeverUsed;
+      uint64_t hash         = Hash64(&this->numFree, sizeof(this->numFree), seed);
+      hash                  = Hash64(&this->numUsed, sizeof(this->numUsed), hash);
+      hash                  = Hash64(this->pFree + numNeverUsed, numRecycled * sizeof(uint32_t), hash);
+      return Hash64(this->pGenerations, this->numUsed * sizeof(uint32_t), hash);
+    }
+
+    /// <summary>
+    /// Bytes written by Save(). Like Hash(), only covers the slots used so far.
+    /// </summary>
+    size_t GetSaveSize() const
+    {
+      uint32_t numRecycled = this->numFree - (this->capacity - this->numUsed);
+      return 3 * sizeof(uint32_t) + numRecycled * sizeof(uint32_t) + this->numUsed * (sizeof(uint32_t) + sizeof(bool));
+    }
+
+    void Save(MemoryBuffer& writer) const
+    {
+      uint32_t numNeverUsed = this->capacity - this->numUsed;
+      uint32_t numRecycled  = this->numFree - numNeverUsed;
+      writer.Write(this->capacity)
+          .Write(this->numFree)
+          .Write(this->numUsed)
+          .Write(this->pFree + numNeverUsed, numRecycled * sizeof(uint32_t))
+          .Write(this->pGenerations, this->numUsed * sizeof(uint32_t))
+          .Write(this->pAlive, this->numUsed * sizeof(bool));
+    }
+
+    /// <summary>
+    /// Restores the state written by Save(), reading straight from the buffer.
+    /// </summary>
+    /// <returns>False if the data does not fit this pool, which may then be left empty</returns>
+    bool Load(MemoryBuffer& reader)
+    {
+      MJ_UNINITIALIZED uint32_t capacity;
+      MJ_UNINITIALIZED uint32_t numFree;
+      MJ_UNINITIALIZED uint32_t numUsed;
+      if (!reader.Read(capacity).Read(numFree).Read(numUsed).Good() || //
+          (capacity != this->capacity) || (numUsed > capacity) ||       //
+          (numFree > capacity) || (numFree < capacity - numUsed))
+      {
+        return false;
+      }
+
+      // Sections are not aligned, only copies of them are read
+      uint32_t numNeverUsed         = capacity - numUsed;
+      uint32_t numRecycled          = numFree - numNeverUsed;
+      const void* pRecycled         = reader.ReserveArrayUnaligned<uint32_t>(numRecycled);
+      const void* pSavedGenerations = reader.ReserveArrayUnaligned<uint32_t>(numUsed);
+      const uint8_t* pSavedAlive    = reader.ReserveArrayUnaligned<uint8_t>(numUsed);
+      if (!reader.Good())
+      {
+        return false;
+      }
+
+      // Slots that were never used are at the bottom of pFree with generation 1, see Clear()
+      for (uint32_t i = 0; i < numNeverUsed; i++)
+      {
+        this->pFree[i]                  = capacity - 1 - i;
+        this->pGenerations[numUsed + i] = 1;
+        this->pAlive[numUsed + i]       = false;
+      }
+      memcpy(this->pFree + numNeverUsed, pRecycled, numRecycled * sizeof(uint32_t));
+      memcpy(this->pGenerations, pSavedGenerations, numUsed * sizeof(uint32_t));
+      for (uint32_t i = 0; i < numUsed; i++)
+      {
+        this->pAlive[i] = pSavedAlive[i] != 0;
+      }
+      this->numFree = numFree;
+      this->numUsed = numUsed;
+
+      for (uint32_t i = numNeverUsed; i < numFree; i++)
+      {
+        if (this->pFree[i] >= numUsed || this->pAlive[this->pFree[i]])
+        {
+          Clear();
+          return false;
+        }
+      }
+      return true;
+    }
+
+  private:
+    uint32_t* pGenerations = nullptr;
+    uint32_t* pFree        = nullptr; // Stack of free indices
+    bool* pAlive           = nullptr;
+    uint32_t capacity      = 0;
+    uint32_t numFree       = 0;
+    uint32_t numUsed       = 0; // Slots handed out since Init or Reset. The others are at the bottom of pFree.
+  };
+
+  /// <summary>
+  /// Dense storage for a group of components that are always used together, one array per component.
+  /// Access arrays by position: Data<0>() is the first component type.
+  /// </summary>
+  template <typename... Ts>
+  class ComponentPool
+  {
+  public:
+    static constexpr uint32_t INVALID = UINT32_MAX;
+
+    /// <param name="maxEntities">Capacity of the EntityPool the handles come from</param>
+    bool Init(uint32_t maxEntities)
+    {
+      this->pSparse   = (uint32_t*)malloc(maxEntities * sizeof(uint32_t));
+      this->pEntities = (Entity*)malloc(maxEntities * sizeof(Entity));
+      this->arrays    = std::tuple<Ts*...>{ (Ts*)malloc(maxEntities * sizeof(Ts))... };
+      bool allocated  = this->pSparse && this->pEntities;
+      std::apply([&allocated](auto*... pArrays) { allocated = allocated && (... && (pArrays != nullptr)); },
+                 this->arrays);
+      if (!allocated)
+      {
+        Destroy();
+        return false;
+      }
+
+      this->capacity = maxEntities;
+      for (uint32_t i = 0; i < maxEntities; i++)
+      {
+        this->pSparse[i] = INVALID;
+      }
+      this->size = 0;
+      return true;
+    }
+
+    void Destroy()
+    {
+      free(this->pSparse);
+      free(this->pEntities);
+      std::apply([](auto*... pArrays) { (free(pArrays), ...); }, this->arrays);
+      this->pSparse   = nullptr;
+      this->pEntities = nullptr;
+      this->arrays    = std::tuple<Ts*...>{};
+      this->capacity  = 0;
+      this->size      = 0;
+    }
+
+    void Clear()
+    {
+      for (uint32_t i = 0; i < this->size; i++)
+      {
+        this->pSparse[this->pEntities[i].index] = INVALID;
+      }
+      this->size = 0;
+    }
+
+    /// <summary>
+    /// Adds the components to an entity. New components are uninitialized.
+    /// </summary>
+    /// <returns>Dense index, also if the entity already had the components</returns>
+    uint32_t Add(Entity entity)
+    {
+      assert(entity.index < this->capacity);
+      uint32_t dense = Find(entity);
+      if (dense == INVALID)
+      {
+        dense                       = this->size++;
+        this->pSparse[entity.index] = dense;
+        this->pEntities[dense]      = entity;
+      }
+      return dense;
+    }
+
+    void Remove(Entity entity)
+    {
+      uint32_t dense = Find(entity);
+      if (dense != INVALID)
+      {
+        uint32_t last = --this->size;
+        if (dense != last)
+        {
+          std::apply([dense, last](auto*... pArrays) { ((pArrays[dense] = pArrays[last]), ...); }, this->arrays);
+          this->pEntities[dense]                      = this->pEntities[last];
+          this->pSparse[this->pEntities[dense].index] = dense;
+        }
+        this->pSparse[entity.index] = INVALID;
+      }
+    }
+
+    /// <returns>Dense index, or INVALID if the entity does not have these components</returns>
+    uint32_t Find(Entity entity) const
+    {
+      if (entity.index >= this->capacity)
+      {
+        return INVALID;
+      }
+      uint32_t dense = this->pSparse[entity.index];
+      if (dense != INVALID && this->pEntities[dense].generation == entity.generation)
+      {
+        return dense;
+      }
+      return INVALID;
+    }
+
+    bool Has(Entity entity) const
+    {
+      return Find(entity) != INVALID;
+    }
+
+    template <size_t I>
+    auto* Data() const
+    {
+      return std::get<I>(this->arrays);
+    }
+
+    const Entity* GetEntities() const
+    {
+      return this->pEntities;
+    }
+
+    uint32_t Size() const
+    {
+      return this->size;
+    }
+
+    /// <summary>
+    /// Hashes the dense arrays in order. Component types must not contain padding.
+    /// </summary>
+    uint64_t Hash(uint64_t seed) const
+    {
+      uint64_t hash = Hash64(&this->size, sizeof(this->size), seed);
+      hash          = Hash64(this->pEntities, this->size * sizeof(Entity), hash);
+      std::apply(
+          [this, &hash](auto*... pArrays) { ((hash = Hash64(pArrays, this->size * sizeof(*pArrays), hash)), ...); },
+          this->arrays);
+      return hash;
+    }
+
+    /// <summary>
+    /// Bytes written by Save()
+    /// </summary>
+    size_t GetSaveSize() const
+    {
+      return sizeof(this->size) + this->size * (sizeof(Entity) + (0 + ... + sizeof(Ts)));
+    }
+
+    /// <summary>
+    /// Writes the dense arrays in order, one copy per array
+    /// </summary>
+    void Save(MemoryBuffer& writer) const
+    {
+      writer.Write(this->size).Write(this->pEntities, this->size * sizeof(Entity));
+      std::apply([this, &writer](auto*... pArrays) { (writer.Write(pArrays, this->size * sizeof(*pArrays)), ...); },
+                 this->arrays);
+    }
+
+    /// <summary>
+    /// Replaces all components with the ones written by Save(), copying the arrays straight from the buffer.
+    /// </summary>
+    /// <returns>False if the data does not fit this pool, which may then be left empty</returns>
+    bool Load(MemoryBuffer& reader)
+    {
+      MJ_UNINITIALIZED uint32_t size;
+      if (!reader.Read(size).Good() || size > this->capacity ||
+          reader.SizeLeft() < size * (sizeof(Entity) + (0 + ... + sizeof(Ts))))
+      {
+        return false;
+      }
+
+      // Sections are not aligned, only copies of them are read
+      Clear();
+      memcpy(this->pEntities, reader.ReserveArrayUnaligned<Entity>(size), size * sizeof(Entity));
+      for (uint32_t i = 0; i < size; i++)
+      {
+        uint32_t index = this->pEntities[i].index;
+        if (index >= this->capacity || this->pSparse[index] != INVALID)
+        {
+          this->size = i;
+          Clear();
+          return false;
+        }
+        this->pSparse[index] = i;
+      }
+      std::apply(
+          [&reader, size](auto*... pArrays) {
+            ((memcpy(pArrays, reader.ReserveArrayUnaligned<std::remove_pointer_t<decltype(pArrays)>>(size),
+                     size * sizeof(*pArrays))),
+             ...);
+          },
+          this->arrays);
+      this->size = size;
+      return true;
+    }
+
+  private:
+    std::tuple<Ts*...> arrays;
+    uint32_t* pSparse = nullptr;
+    Entity* pEntities = nullptr;
+    uint32_t capacity = 0;
+    uint32_t size     = 0;
+  };
+} // namespace mj
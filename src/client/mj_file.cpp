@@ -0,0 +1,38 @@
+// File - whole-file reads
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+void* mj::ReadFile(const char* pPath, size_t* pSize)
+{
+  FILE* pFile = fopen(pPath, "rb");
+  if (!pFile)
+  {
+    return nullptr;
+  }
+
+  char* pData = nullptr;
+  if (fseek(pFile, 0, SEEK_END) == 0)
+  {
+    long size = ftell(pFile);
+    if (size >= 0 && fseek(pFile, 0, SEEK_SET) == 0)
+    {
+      pData = (char*)malloc((size_t)size + 1);
+      if (pData && fread(pData, 1, (size_t)size, pFile) != (size_t)size)
+      {
+        free(pData);
+        pData = nullptr;
+      }
+      if (pData)
+      {
+        pData[size] = '\0';
+        *pSize      = (size_t)size;
+      }
+    }
+  }
+  fclose(pFile);
+  return pData;
+}
@@ -0,0 +1,18 @@
+// File - whole-file reads
+// Should not use pre-compiled headers (for portability)
+//
+// Plain C stdio, so the same code runs on every platform and in the tools.
+
+#pragma once
+#include <stddef.h>
+
+namespace mj
+{
+  /// <summary>
+  /// Reads a whole file into memory the caller frees with free(). One more byte than the file is allocated
+  /// and set to zero, so text can be parsed in place.
+  /// </summary>
+  /// <param name="pSize">Receives the size of the file, without the terminating zero</param>
+  /// <returns>nullptr if the file could not be opened or read</returns>
+  void* ReadFile(const char* pPath, size_t* pSize);
+} // namespace mj
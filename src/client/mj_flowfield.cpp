@@ -0,0 +1,462 @@
+// Flow field - shared navigation toward a goal for any number of agents
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_flowfield.h"
+#include "mj_jobs.h"
+#include "mj_profiler.h"
+
+#include <math.h>
+#include <algorithm>
+
+// Step cost per neighbor direction
+static constexpr uint32_t s_Cost[8] = { 2, 3, 2, 3, 2, 3, 2, 3 };
+
+// Rows per job when computing directions
+static constexpr uint32_t DIRECTION_GRAIN_SIZE = 16;
+
+enum : uint8_t
+{
+  FLAG_GOAL     = 1 << 0,
+  FLAG_RESET    = 1 << 1, // Incremental update: cost depended on the changed cell
+  FLAG_FRONTIER = 1 << 2, // Incremental update: already added as seed
+};
+
+bool mj::FlowField::Init(uint32_t width, uint32_t height)
+{
+  size_t numCells  = (size_t)width * height;
+  this->pCosts     = (uint32_t*)malloc(numCells * sizeof(uint32_t));
+  this->pDirection = (uint8_t*)malloc(numCells);
+  this->pFlags     = (uint8_t*)calloc(numCells, 1);
+  this->pSeeds     = (uint32_t*)malloc(numCells * sizeof(uint32_t));
+  if (!this->pCosts || !this->pDirection || !this->pFlags || !this->pSeeds)
+  {
+    Destroy();
+    return false;
+  }
+
+  this->width  = width;
+  this->height = height;
+  for (size_t i = 0; i < numCells; i++)
+  {
+    this->pCosts[i]     = UNREACHABLE;
+    this->pDirection[i] = NO_DIRECTION;
+  }
+  return true;
+}
+
+void mj::FlowField::Destroy()
+{
+  free(this->pCosts);
+  free(this->pDirection);
+  free(this->pFlags);
+  free(this->pSeeds);
+  for (Bucket& bucket : this->buckets)
+  {
+    free(bucket.pCells);
+    bucket = {};
+  }
+  this->pCosts     = nullptr;
+  this->pDirection = nullptr;
+  this->pFlags     = nullptr;
+  this->pSeeds     = nullptr;
+  this->width      = 0;
+  this->height     = 0;
+}
+
+bool mj::FlowField::Push(uint32_t bucket, uint32_t cell)
+{
+  Bucket& b = this->buckets[bucket];
+  if (b.size == b.capacity)
+  {
+    uint32_t capacity = b.capacity ? 2 * b.capacity : 1024;
+    uint32_t* pCells  = (uint32_t*)realloc(b.pCells, capacity * sizeof(uint32_t));
+    if (!pCells)
+    {
+      return false;
+    }
+    b.pCells   = pCells;
+    b.capacity = capacity;
+  }
+  b.pCells[b.size++] = cell;
+  return true;
+}
+
+void mj::FlowField::ExpandDirty(uint32_t cell)
+{
+  int32_t x     = (int32_t)(cell % this->width);
+  int32_t z     = (int32_t)(cell / this->width);
+  this->dirtyX0 = std::min(this->dirtyX0, x);
+  this->dirtyZ0 = std::min(this->dirtyZ0, z);
+  this->dirtyX1 = std::max(this->dirtyX1, x);
+  this->dirtyZ1 = std::max(this->dirtyZ1, z);
+}
+
+/// <summary>
+/// Dijkstra with a bucket queue, starting from pSeeds (sorted by cost).
+/// Seeds with a higher cost are injected once the wavefront reaches that cost.
+/// </summary>
+bool mj::FlowField::Relax(const Grid& grid, uint32_t numSeeds)
+{
+  ZoneScoped;
+  for (Bucket& bucket : this->buckets)
+  {
+    bucket.size = 0;
+  }
+
+  // Local copies, Push writes memory so members would be reloaded in the inner loop
+  uint32_t* pCosts     = this->pCosts;
+  const uint32_t width = this->width;
+  int32_t offsets[8];
+  for (uint32_t i = 0; i < 8; i++)
+  {
+    offsets[i] = mj::NEIGHBOR_DZ[i] * (int32_t)width + mj::NEIGHBOR_DX[i];
+  }
+
+  uint32_t nextSeed = 0;
+  uint32_t pending  = 0;
+  uint32_t current  = 0;
+  while (nextSeed < numSeeds || pending > 0)
+  {
+    if (pending == 0 && this->pCosts[this->pSeeds[nextSeed]] > current)
+    {
+      current = this->pCosts[this->pSeeds[nextSeed]];
+    }
+    // Seeds that were lowered below their original cost have been pushed already
+    while (nextSeed < numSeeds && this->pCosts[this->pSeeds[nextSeed]] <= current)
+    {
+      uint32_t seed = this->pSeeds[nextSeed++];
+      if (this->pCosts[seed] == current)
+      {
+        if (!Push(current & 3, seed))
+        {
+          return false;
+        }
+        pending++;
+      }
+    }
+
+    Bucket& bucket = this->buckets[current & 3];
+    while (bucket.size > 0)
+    {
+      uint32_t cell = bucket.pCells[--bucket.size];
+      pending--;
+      if (this->pCosts[cell] != current)
+      {
+        // Stale entry, the cell was reached more cheaply
+        continue;
+      }
+
+      int32_t x     = (int32_t)(cell % width);
+      int32_t z     = (int32_t)(cell / width);
+      uint32_t mask = grid.GetStepMask(x, z);
+      for (uint32_t i = 0; i < 8; i++)
+      {
+        if (mask & (1 << i))
+        {
+          uint32_t neighbor = cell + offsets[i];
+          uint32_t cost     = current + s_Cost[i];
+          if (cost < pCosts[neighbor])
+          {
+            pCosts[neighbor] = cost;
+            if (!Push(cost & 3, neighbor))
+            {
+              return false;
+            }
+            pending++;
+            ExpandDirty(neighbor);
+          }
+        }
+      }
+    }
+    current++;
+  }
+  return true;
+}
+
+void mj::FlowField::UpdateDirections(const Grid& grid, int32_t x0, int32_t z0, int32_t x1, int32_t z1)
+{
+  ZoneScoped;
+  x0 = std::max(x0, 0);
+  z0 = std::max(z0, 0);
+  x1 = std::min(x1, (int32_t)this->width - 1);
+  z1 = std::min(z1, (int32_t)this->height - 1);
+  if (x0 > x1 || z0 > z1)
+  {
+    return;
+  }
+
+  mj::jobs::ParallelFor((uint32_t)(z1 - z0 + 1), DIRECTION_GRAIN_SIZE, [&](uint32_t begin, uint32_t end) {
+    for (int32_t z = z0 + (int32_t)begin; z < z0 + (int32_t)end; z++)
+    {
+      for (int32_t x = x0; x <= x1; x++)
+      {
+        uint32_t cell     = z * this->width + x;
+        uint32_t cost     = this->pCosts[cell];
+        uint8_t direction = NO_DIRECTION;
+        if (cost != UNREACHABLE && cost != 0 && !grid.IsSolid(x, z))
+        {
+          uint32_t best = cost;
+          uint32_t mask = grid.GetStepMask(x, z);
+          for (uint32_t i = 0; i < 8; i++)
+          {
+            if (mask & (1 << i))
+            {
+              int32_t neighbor      = (z + mj::NEIGHBOR_DZ[i]) * (int32_t)this->width + (x + mj::NEIGHBOR_DX[i]);
+              uint32_t neighborCost = this->pCosts[neighbor];
+              if (neighborCost < best)
+              {
+                best      = neighborCost;
+                direction = (uint8_t)i;
+              }
+            }
+          }
+        }
+        this->pDirection[cell] = direction;
+      }
+    }
+  });
+}
+
+bool mj::FlowField::Build(const Grid& grid, const BlockPos* pGoals, uint32_t numGoals)
+{
+  ZoneScoped;
+  assert(grid.width == this->width && grid.height == this->height);
+
+  size_t numCells = (size_t)this->width * this->height;
+  for (size_t i = 0; i < numCells; i++)
+  {
+    this->pFlags[i] = 0;
+  }
+
+  for (uint32_t i = 0; i < numGoals; i++)
+  {
+    const BlockPos& goal = pGoals[i];
+    if ((uint32_t)goal.x < this->width && (uint32_t)goal.z < this->height)
+    {
+      this->pFlags[goal.z * this->width + goal.x] |= FLAG_GOAL;
+    }
+  }
+
+  return Rebuild(grid);
+}
+
+/// <summary>
+/// Recomputes every cell from the goal flags. Also clears the scratch flags of an aborted update.
+/// </summary>
+bool mj::FlowField::Rebuild(const Grid& grid)
+{
+  uint32_t numSeeds = 0;
+  uint32_t numCells = this->width * this->height;
+  for (uint32_t cell = 0; cell < numCells; cell++)
+  {
+    this->pCosts[cell] = UNREACHABLE;
+    this->pFlags[cell] &= FLAG_GOAL;
+    if ((this->pFlags[cell] & FLAG_GOAL) && !grid.IsSolid(cell % this->width, cell / this->width))
+    {
+      this->pCosts[cell]       = 0;
+      this->pSeeds[numSeeds++] = cell;
+    }
+  }
+
+  this->dirtyX0 = 0;
+  this->dirtyZ0 = 0;
+  this->dirtyX1 = (int32_t)this->width - 1;
+  this->dirtyZ1 = (int32_t)this->height - 1;
+  bool ok       = Relax(grid, numSeeds);
+  if (!ok)
+  {
+    // Never leave a partial field behind: no path at all is consistent
+    for (uint32_t cell = 0; cell < numCells; cell++)
+    {
+      this->pCosts[cell] = UNREACHABLE;
+    }
+  }
+  UpdateDirections(grid, 0, 0, (int32_t)this->width - 1, (int32_t)this->height - 1);
+  return ok;
+}
+
+bool mj::FlowField::OnCellChanged(const Grid& grid, int32_t x, int32_t z)
+{
+  ZoneScoped;
+  if ((uint32_t)x >= this->width || (uint32_t)z >= this->height)
+  {
+    return true;
+  }
+
+  this->dirtyX0 = x;
+  this->dirtyZ0 = z;
+  this->dirtyX1 = x;
+  this->dirtyZ1 = z;
+
+  uint32_t changed  = z * this->width + x;
+  uint32_t numSeeds = 0;
+
+  if (grid.IsSolid(x, z))
+  {
+    // Raise: the new wall (and the diagonals it blocks) can only make paths longer.
+    // Collect every cell downstream of the 3x3 block around it: a neighbor is downstream
+    // if its cost is exactly one step more. This is a superset of the cells that lost their path.
+    Bucket& reset = this->buckets[0];
+    reset.size    = 0;
+    for (int32_t dz = -1; dz <= 1; dz++)
+    {
+      for (int32_t dx = -1; dx <= 1; dx++)
+      {
+        int32_t cx = x + dx;
+        int32_t cz = z + dz;
+        if ((uint32_t)cx < this->width && (uint32_t)cz < this->height)
+        {
+          uint32_t cell = cz * this->width + cx;
+          if (this->pCosts[cell] != UNREACHABLE)
+          {
+            this->pFlags[cell] |= FLAG_RESET;
+            if (!Push(0, cell))
+            {
+              return Rebuild(grid);
+            }
+          }
+        }
+      }
+    }
+
+    for (uint32_t r = 0; r < reset.size; r++)
+    {
+      uint32_t cell = reset.pCells[r];
+      int32_t cx    = (int32_t)(cell % this->width);
+      int32_t cz    = (int32_t)(cell / this->width);
+      for (uint32_t i = 0; i < 8; i++)
+      {
+        int32_t nx = cx + mj::NEIGHBOR_DX[i];
+        int32_t nz = cz + mj::NEIGHBOR_DZ[i];
+        if ((uint32_t)nx < this->width && (uint32_t)nz < this->height)
+        {
+          uint32_t neighbor = nz * this->width + nx;
+          if (!(this->pFlags[neighbor] & FLAG_RESET) && this->pCosts[neighbor] != UNREACHABLE &&
+              this->pCosts[neighbor] == this->pCosts[cell] + s_Cost[i])
+          {
+            this->pFlags[neighbor] |= FLAG_RESET;
+            if (!Push(0, neighbor))
+            {
+              return Rebuild(grid);
+            }
+          }
+        }
+      }
+    }
+
+    // Forget the collected costs, goals restart at 0
+    for (uint32_t r = 0; r < reset.size; r++)
+    {
+      uint32_t cell = reset.pCells[r];
+      ExpandDirty(cell);
+      if ((this->pFlags[cell] & FLAG_GOAL) && !grid.IsSolid(cell % this->width, cell / this->width))
+      {
+        this->pCosts[cell]       = 0;
+        this->pSeeds[numSeeds++] = cell;
+        this->pFlags[cell] |= FLAG_FRONTIER;
+      }
+      else
+      {
+        this->pCosts[cell] = UNREACHABLE;
+      }
+    }
+
+    // The cells bordering the reset area still have valid costs, relax from there
+    for (uint32_t r = 0; r < reset.size; r++)
+    {
+      uint32_t cell = reset.pCells[r];
+      int32_t cx    = (int32_t)(cell % this->width);
+      int32_t cz    = (int32_t)(cell / this->width);
+      for (uint32_t i = 0; i < 8; i++)
+      {
+        int32_t nx = cx + mj::NEIGHBOR_DX[i];
+        int32_t nz = cz + mj::NEIGHBOR_DZ[i];
+        if ((uint32_t)nx < this->width && (uint32_t)nz < this->height)
+        {
+          uint32_t neighbor = nz * this->width + nx;
+          if (!(this->pFlags[neighbor] & (FLAG_RESET | FLAG_FRONTIER)) && this->pCosts[neighbor] != UNREACHABLE)
+          {
+            this->pFlags[neighbor] |= FLAG_FRONTIER;
+            this->pSeeds[numSeeds++] = neighbor;
+          }
+        }
+      }
+    }
+
+    for (uint32_t r = 0; r < reset.size; r++)
+    {
+      this->pFlags[reset.pCells[r]] &= ~(FLAG_RESET | FLAG_FRONTIER);
+    }
+    for (uint32_t s = 0; s < numSeeds; s++)
+    {
+      this->pFlags[this->pSeeds[s]] &= ~FLAG_FRONTIER;
+    }
+  }
+  else
+  {
+    // Lower: a freed cell can only make paths shorter, relax from its neighbors
+    if (this->pFlags[changed] & FLAG_GOAL)
+    {
+      this->pCosts[changed]    = 0;
+      this->pSeeds[numSeeds++] = changed;
+    }
+    for (uint32_t i = 0; i < 8; i++)
+    {
+      int32_t nx = x + mj::NEIGHBOR_DX[i];
+      int32_t nz = z + mj::NEIGHBOR_DZ[i];
+      if ((uint32_t)nx < this->width && (uint32_t)nz < this->height)
+      {
+        uint32_t neighbor = nz * this->width + nx;
+        if (this->pCosts[neighbor] != UNREACHABLE)
+        {
+          this->pSeeds[numSeeds++] = neighbor;
+        }
+      }
+    }
+  }
+
+  std::sort(this->pSeeds, this->pSeeds + numSeeds,
+            [this](uint32_t a, uint32_t b) { return this->pCosts[a] < this->pCosts[b]; });
+  if (!Relax(grid, numSeeds))
+  {
+    return Rebuild(grid);
+  }
+
+  // Directions also change next to the dirty cells, and around blocked diagonals
+  UpdateDirections(grid, this->dirtyX0 - 1, this->dirtyZ0 - 1, this->dirtyX1 + 1, this->dirtyZ1 + 1);
+  return true;
+}
+
+uint32_t mj::FlowField::GetCost(int32_t x, int32_t z) const
+{
+  if ((uint32_t)x >= this->width || (uint32_t)z >= this->height)
+  {
+    return UNREACHABLE;
+  }
+  return this->pCosts[z * this->width + x];
+}
+
+uint8_t mj::FlowField::GetDirection(int32_t x, int32_t z) const
+{
+  if ((uint32_t)x >= this->width || (uint32_t)z >= this->height)
+  {
+    return NO_DIRECTION;
+  }
+  return this->pDirection[z * this->width + x];
+}
+
+mjm::vec3 mj::FlowField::Sample(const mjm::vec3& position) const
+{
+  static constexpr float D = 0.70710678f;
+  static const mjm::vec3 s_Directions[8] = {
+    mjm::vec3(1.0f, 0.0f, 0.0f),  mjm::vec3(D, 0.0f, D),   mjm::vec3(0.0f, 0.0f, 1.0f), mjm::vec3(-D, 0.0f, D),
+    mjm::vec3(-1.0f, 0.0f, 0.0f), mjm::vec3(-D, 0.0f, -D), mjm::vec3(0.0f, 0.0f, -1.0f), mjm::vec3(D, 0.0f, -D),
+  };
+
+  uint8_t direction = GetDirection((int32_t)floorf(position.x), (int32_t)floorf(position.z));
+  if (direction == NO_DIRECTION)
+  {
+    return mjm::vec3::zero();
+  }
+  return s_Directions[direction];
+}
@@ -0,0 +1,90 @@
+// Flow field - shared navigation toward a goal for any number of agents
+// Should not use pre-compiled headers (for portability)
+//
+// The integration field holds the path cost of every cell to the nearest goal
+// (Dijkstra over 8 neighbors, orthogonal step = 2, diagonal step = 3, no cutting corners).
+// The direction field points every cell at its cheapest neighbor, so agents sample it in O(1).
+//
+// When a cell of the grid changes, only the cells whose cost depended on it are recomputed.
+// A FlowField owns its scratch memory, so different fields can be built on different threads.
+
+#pragma once
+#include "mj_grid.h"
+
+namespace mj
+{
+  class FlowField
+  {
+  public:
+    static constexpr uint32_t UNREACHABLE = UINT32_MAX;
+    static constexpr uint8_t NO_DIRECTION = 0xFF;
+
+    bool Init(uint32_t width, uint32_t height);
+    void Destroy();
+
+    /// <summary>
+    /// Full rebuild. The direction field is computed in parallel on the job system.
+    /// </summary>
+    /// <returns>False if out of memory; every cell is unreachable then</returns>
+    bool Build(const Grid& grid, const BlockPos* pGoals, uint32_t numGoals);
+
+    /// <summary>
+    /// Incremental update after a single cell of the grid was changed (e.g. a door opened or closed).
+    /// The grid must already contain the new state. Falls back to a full rebuild if out of memory.
+    /// </summary>
+    /// <returns>False if out of memory; every cell is unreachable then</returns>
+    bool OnCellChanged(const Grid& grid, int32_t x, int32_t z);
+
+    /// <returns>Path cost to the nearest goal (2 per orthogonal step), or UNREACHABLE</returns>
+    uint32_t GetCost(int32_t x, int32_t z) const;
+
+    /// <returns>Index into the neighbor table (0 = +X, counter-clockwise in 45 degree steps), or NO_DIRECTION</returns>
+    uint8_t GetDirection(int32_t x, int32_t z) const;
+
+    /// <returns>Unit vector on the XZ plane toward the goal, or zero at the goal and in unreachable cells</returns>
+    mjm::vec3 Sample(const mjm::vec3& position) const;
+
+    uint32_t GetWidth() const
+    {
+      return this->width;
+    }
+
+    uint32_t GetHeight() const
+    {
+      return this->height;
+    }
+
+  private:
+    struct Bucket
+    {
+      uint32_t* pCells;
+      uint32_t size;
+      uint32_t capacity;
+    };
+
+    /// <returns>False if the bucket could not grow; the cell is dropped then</returns>
+    bool Push(uint32_t bucket, uint32_t cell);
+    /// <returns>False if a cell was dropped; the costs are partly updated then</returns>
+    bool Relax(const Grid& grid, uint32_t numSeeds);
+    bool Rebuild(const Grid& grid);
+    void UpdateDirections(const Grid& grid, int32_t x0, int32_t z0, int32_t x1, int32_t z1);
+    void ExpandDirty(uint32_t cell);
+
+    uint32_t width      = 0;
+    uint32_t height     = 0;
+    uint32_t* pCosts    = nullptr;
+    uint8_t* pDirection = nullptr;
+    uint8_t* pFlags     = nullptr; // Scratch for incremental updates
+
+    // Dial's algorithm: edge costs are at most 3, so 4 cost buckets are live at any time
+    Bucket buckets[4] = {};
+    // Cells with a known cost to start relaxing from, sorted by cost before use
+    uint32_t* pSeeds = nullptr;
+
+    // Bounding box of cells whose cost changed during an update
+    int32_t dirtyX0 = 0;
+    int32_t dirtyZ0 = 0;
+    int32_t dirtyX1 = 0;
+    int32_t dirtyZ1 = 0;
+  };
+} // namespace mj
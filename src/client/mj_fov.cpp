@@ -0,0 +1,140 @@
+// Field of view - visible cells around a point, for AI vision
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_fov.h"
+#include "mj_profiler.h"
+
+// Octant transforms: cell (dx, dz) of the scan maps to (dx * xx + dz * xz, dx * zx + dz * zz)
+static constexpr int32_t s_Octants[8][4] = {
+  { 1, 0, 0, 1 }, { 0, 1, 1, 0 }, { 0, -1, 1, 0 }, { -1, 0, 0, 1 },
+  { -1, 0, 0, -1 }, { 0, -1, -1, 0 }, { 0, 1, -1, 0 }, { 1, 0, 0, -1 },
+};
+
+bool mj::FieldOfView::Init(int32_t maxRadius)
+{
+  this->maxRadius = maxRadius;
+  this->size      = 2 * maxRadius + 1;
+  this->numWords  = (uint32_t)(this->size * this->size + 63) / 64;
+  this->pBits     = (uint64_t*)calloc(this->numWords, sizeof(uint64_t));
+  if (!this->pBits)
+  {
+    Destroy();
+    return false;
+  }
+  return true;
+}
+
+void mj::FieldOfView::Destroy()
+{
+  free(this->pBits);
+  this->pBits     = nullptr;
+  this->maxRadius = 0;
+  this->size      = 0;
+  this->numWords  = 0;
+}
+
+void mj::FieldOfView::SetVisible(int32_t dx, int32_t dz)
+{
+  uint32_t bit = (uint32_t)((dz + this->maxRadius) * this->size + (dx + this->maxRadius));
+  this->pBits[bit >> 6] |= 1ull << (bit & 63);
+}
+
+/// <summary>
+/// Scans one octant from row outward, between the slopes start and end (start > end).
+/// Whenever a run of walls ends, the part of the octant behind it is scanned recursively.
+/// </summary>
+void mj::FieldOfView::CastLight(const Grid& grid, int32_t row, float start, float end, int32_t xx, int32_t xz,
+                                int32_t zx, int32_t zz)
+{
+  if (start < end)
+  {
+    return;
+  }
+
+  int32_t radiusSquared = this->radius * this->radius;
+  float newStart        = 0.0f;
+  for (int32_t j = row; j <= this->radius; j++)
+  {
+    bool blocked = false;
+    int32_t dz   = -j;
+    for (int32_t dx = -j; dx <= 0; dx++)
+    {
+      float leftSlope  = (dx - 0.5f) / (dz + 0.5f);
+      float rightSlope = (dx + 0.5f) / (dz - 0.5f);
+      if (start < rightSlope)
+      {
+        continue;
+      }
+      if (end > leftSlope)
+      {
+        break;
+      }
+
+      int32_t mapDx     = dx * xx + dz * xz;
+      int32_t mapDz     = dx * zx + dz * zz;
+      bool solid        = grid.IsSolid(this->originX + mapDx, this->originZ + mapDz);
+      float centerSlope = (float)dx / (float)dz;
+      if (dx * dx + dz * dz <= radiusSquared && (solid || (centerSlope <= start && centerSlope >= end)))
+      {
+        SetVisible(mapDx, mapDz);
+      }
+
+      if (blocked)
+      {
+        if (solid)
+        {
+          newStart = rightSlope;
+        }
+        else
+        {
+          blocked = false;
+          start   = newStart;
+        }
+      }
+      else if (solid && j < this->radius)
+      {
+        blocked = true;
+        CastLight(grid, j + 1, start, leftSlope, xx, xz, zx, zz);
+        newStart = rightSlope;
+      }
+    }
+    if (blocked)
+    {
+      break;
+    }
+  }
+}
+
+void mj::FieldOfView::Compute(const Grid& grid, int32_t x, int32_t z, int32_t radius)
+{
+  ZoneScoped;
+  memset(this->pBits, 0, this->numWords * sizeof(uint64_t));
+  this->originX = x;
+  this->originZ = z;
+  this->radius  = radius < this->maxRadius ? radius : this->maxRadius;
+
+  SetVisible(0, 0);
+  if (grid.IsSolid(x, z))
+  {
+    return;
+  }
+  for (const int32_t* pOctant : s_Octants)
+  {
+    CastLight(grid, 1, 1.0f, 0.0f, pOctant[0], pOctant[1], pOctant[2], pOctant[3]);
+  }
+}
+
+uint32_t mj::FieldOfView::GetNumVisible() const
+{
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < this->numWords; i++)
+  {
+    uint64_t word = this->pBits[i];
+    while (word)
+    {
+      word &= word - 1;
+      count++;
+    }
+  }
+  return count;
+}
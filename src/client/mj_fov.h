@@ -0,0 +1,55 @@
+// Field of view - visible cells around a point, for AI vision
+// Should not use pre-compiled headers (for portability)
+//
+// Recursive shadowcasting: each of the 8 octants is scanned row by row, moving outward,
+// and walls cast shadows (ranges of slopes) that later rows skip entirely. Every cell in range
+// is visited at most once, instead of one ray per cell.
+//
+// Open cells are visible when their center is in view, walls when any part of them is, so
+// the walls that bound the visible area are visible themselves. The result is a bitset
+// over the square around the origin, so "can the agent see this cell" is a single bit test.
+
+#pragma once
+#include "mj_grid.h"
+
+namespace mj
+{
+  class FieldOfView
+  {
+  public:
+    bool Init(int32_t maxRadius);
+    void Destroy();
+
+    /// <summary>
+    /// Computes the cells visible from (x, z) within a circle of the given radius (clamped to maxRadius).
+    /// </summary>
+    void Compute(const Grid& grid, int32_t x, int32_t z, int32_t radius);
+
+    bool IsVisible(int32_t x, int32_t z) const
+    {
+      int32_t dx = x - this->originX;
+      int32_t dz = z - this->originZ;
+      if (dx < -this->maxRadius || dx > this->maxRadius || dz < -this->maxRadius || dz > this->maxRadius)
+      {
+        return false;
+      }
+      uint32_t bit = (uint32_t)((dz + this->maxRadius) * this->size + (dx + this->maxRadius));
+      return (this->pBits[bit >> 6] & (1ull << (bit & 63))) != 0;
+    }
+
+    uint32_t GetNumVisible() const;
+
+  private:
+    void SetVisible(int32_t dx, int32_t dz);
+    void CastLight(const Grid& grid, int32_t row, float start, float end, int32_t xx, int32_t xz, int32_t zx,
+                   int32_t zz);
+
+    int32_t maxRadius = 0;
+    int32_t size      = 0; // 2 * maxRadius + 1
+    uint32_t numWords = 0;
+    uint64_t* pBits   = nullptr;
+    int32_t originX   = 0;
+    int32_t originZ   = 0;
+    int32_t radius    = 0;
+  };
+} // namespace mj
@@ -0,0 +1,103 @@
+// Frame statistics - rolling CPU frame and phase timings
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_frame_stats.h"
+#include "mj_common.h"
+#include "mj_profiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+static constexpr uint32_t NUM_PHASES = (uint32_t)mj::stats::Phase::Count;
+
+static const char* s_PhaseNames[] = {
+  "Frame", "PumpEvents", "State update", "Graphics update", "ImGui render", "Present",
+};
+static_assert(MJ_COUNTOF(s_PhaseNames) == NUM_PHASES, "Phase name missing");
+
+// WARNING: global variables
+static float s_History[NUM_PHASES][mj::stats::NUM_FRAMES];
+static float s_Current[NUM_PHASES];
+static uint32_t s_NumFrames; // Total committed frames
+static double s_FrameStart;
+
+double mj::stats::Now()
+{
+  using namespace std::chrono;
+  return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+void mj::stats::BeginFrame()
+{
+  double now = Now();
+  if (s_FrameStart > 0.0)
+  {
+    s_Current[(uint32_t)Phase::Frame] = (float)(now - s_FrameStart);
+
+    uint32_t index = s_NumFrames % NUM_FRAMES;
+    for (uint32_t i = 0; i < NUM_PHASES; i++)
+    {
+      s_History[i][index] = s_Current[i];
+      s_Current[i]        = 0.0f;
+    }
+    s_NumFrames++;
+
+#if defined(TRACY_ENABLE) || defined(MJ_PROFILER_ENABLED)
+    for (uint32_t i = 0; i < NUM_PHASES; i++)
+    {
+      TracyPlot(s_PhaseNames[i], s_History[i][index]);
+    }
+    Percentiles frame = GetPercentiles(Phase::Frame);
+    TracyPlot("Frame p50", frame.p50);
+    TracyPlot("Frame p95", frame.p95);
+    TracyPlot("Frame p99", frame.p99);
+    TracyPlot("Frame max", frame.max);
+#endif
+  }
+  s_FrameStart = now;
+}
+
+void mj::stats::Record(Phase phase, float milliseconds)
+{
+  s_Current[(uint32_t)phase] += milliseconds;
+}
+
+mj::stats::Percentiles mj::stats::GetPercentiles(Phase phase)
+{
+  Percentiles percentiles = {};
+  uint32_t count          = s_NumFrames < NUM_FRAMES ? s_NumFrames : NUM_FRAMES;
+  if (count == 0)
+  {
+    return percentiles;
+  }
+
+  float sorted[NUM_FRAMES];
+  memcpy(sorted, s_History[(uint32_t)phase], count * sizeof(float));
+  std::sort(sorted, sorted + count);
+
+  percentiles.p50 = sorted[(count - 1) * 50 / 100];
+  percentiles.p95 = sorted[(count - 1) * 95 / 100];
+  percentiles.p99 = sorted[(count - 1) * 99 / 100];
+  percentiles.max = sorted[count - 1];
+  return percentiles;
+}
+
+const float* mj::stats::GetHistory(Phase phase, uint32_t* pOffset, uint32_t* pCount)
+{
+  if (s_NumFrames < NUM_FRAMES)
+  {
+    *pOffset = 0;
+    *pCount  = s_NumFrames;
+  }
+  else
+  {
+    *pOffset = s_NumFrames % NUM_FRAMES;
+    *pCount  = NUM_FRAMES;
+  }
+  return s_History[(uint32_t)phase];
+}
+
+const char* mj::stats::GetPhaseName(Phase phase)
+{
+  return s_PhaseNames[(uint32_t)phase];
+}
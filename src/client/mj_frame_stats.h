@@ -0,0 +1,84 @@
+// Frame statistics - rolling CPU frame and phase timings
+// Should not use pre-compiled headers (for portability)
+//
+// Keeps the last NUM_FRAMES timings of every phase in a ring buffer,
+// so percentiles show hitches that a smoothed average hides.
+
+#pragma once
+#include <stdint.h>
+
+namespace mj
+{
+  namespace stats
+  {
+    enum class Phase : uint32_t
+    {
+      Frame,
+      PumpEvents,
+      StateUpdate,
+      GraphicsUpdate,
+      ImGuiRender,
+      Present,
+      Count
+    };
+
+    static constexpr uint32_t NUM_FRAMES = 512;
+
+    struct Percentiles
+    {
+      float p50;
+      float p95;
+      float p99;
+      float max;
+    };
+
+    /// <summary>
+    /// Marks the start of a frame. Also commits the timings of the previous frame.
+    /// </summary>
+    void BeginFrame();
+
+    /// <summary>
+    /// Adds time to a phase in the current frame. A phase may be recorded more than once per frame.
+    /// </summary>
+    void Record(Phase phase, float milliseconds);
+
+    /// <summary>
+    /// Percentiles over the committed frames, in milliseconds.
+    /// </summary>
+    Percentiles GetPercentiles(Phase phase);
+
+    /// <summary>
+    /// Ring buffer of committed timings (milliseconds), NUM_FRAMES entries.
+    /// </summary>
+    /// <param name="pOffset">Index of the oldest entry</param>
+    /// <param name="pCount">Amount of valid entries</param>
+    const float* GetHistory(Phase phase, uint32_t* pOffset, uint32_t* pCount);
+
+    const char* GetPhaseName(Phase phase);
+
+    /// <summary>
+    /// Current time in milliseconds, for use with Record.
+    /// </summary>
+    double Now();
+
+    /// <summary>
+    /// Records the lifetime of this object to a phase.
+    /// </summary>
+    class ScopedPhase
+    {
+    public:
+      ScopedPhase(Phase phase) : phase(phase), start(Now())
+      {
+      }
+
+      ~ScopedPhase()
+      {
+        Record(this->phase, (float)(Now() - this->start));
+      }
+
+    private:
+      Phase phase;
+      double start;
+    };
+  } // namespace stats
+} // namespace mj
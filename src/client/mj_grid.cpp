@@ -0,0 +1,39 @@
+// Grid - per-cell level solidity
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_grid.h"
+
+mj::Grid mj::Grid::Create(uint32_t width, uint32_t height)
+{
+  Grid grid;
+  grid.pSolid = (uint8_t*)calloc((size_t)width * height, 1);
+  if (grid.pSolid)
+  {
+    grid.width  = width;
+    grid.height = height;
+  }
+  return grid;
+}
+
+mj::Grid mj::Grid::FromBlocks(const block_t* pBlocks, uint32_t width, uint32_t height)
+{
+  Grid grid = Create(width, height);
+  if (grid.IsValid())
+  {
+    for (size_t i = 0; i < (size_t)width * height; i++)
+    {
+      grid.pSolid[i] = IsSolidBlock(pBlocks[i]) ? 1 : 0;
+    }
+  }
+  return grid;
+}
+
+mj::Grid mj::Grid::FromLevel(const Level& level)
+{
+  return FromBlocks(level.pBlocks, level.width, level.height);
+}
+
+void mj::Grid::Free(Grid grid)
+{
+  free(grid.pSolid);
+}
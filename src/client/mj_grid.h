@@ -0,0 +1,71 @@
+// Grid - per-cell level solidity
+// Should not use pre-compiled headers (for portability)
+//
+// One byte per cell, so collision, navigation and visibility queries are a single load.
+// Cells outside the grid are solid.
+
+#pragma once
+#include "level.h"
+
+namespace mj
+{
+  // Neighbor directions, counter-clockwise starting at +X. Odd directions are diagonal.
+  static constexpr int32_t NEIGHBOR_DX[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+  static constexpr int32_t NEIGHBOR_DZ[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+
+  struct Grid
+  {
+    uint32_t width  = 0;
+    uint32_t height = 0;
+    /// <summary>
+    /// Indexing: z * width + x. Non-zero = solid.
+    /// </summary>
+    uint8_t* pSolid = nullptr;
+
+    /// <summary>
+    /// Allocates a grid with all cells empty
+    /// </summary>
+    static Grid Create(uint32_t width, uint32_t height);
+    static Grid FromBlocks(const block_t* pBlocks, uint32_t width, uint32_t height);
+    static Grid FromLevel(const Level& level);
+    static void Free(Grid grid);
+
+    bool IsSolid(int32_t x, int32_t z) const
+    {
+      if ((uint32_t)x >= this->width || (uint32_t)z >= this->height)
+      {
+        return true;
+      }
+      return this->pSolid[z * this->width + x] != 0;
+    }
+
+    void SetSolid(int32_t x, int32_t z, bool solid)
+    {
+      assert((uint32_t)x < this->width && (uint32_t)z < this->height);
+      this->pSolid[z * this->width + x] = solid ? 1 : 0;
+    }
+
+    /// <summary>
+    /// Bit i is set if a step in NEIGHBOR direction i is possible.
+    /// Diagonal steps are only allowed if both cells next to the diagonal are free (no cutting corners).
+    /// </summary>
+    uint32_t GetStepMask(int32_t x, int32_t z) const
+    {
+      uint32_t free = 0;
+      for (uint32_t i = 0; i < 8; i++)
+      {
+        free |= (uint32_t)!IsSolid(x + NEIGHBOR_DX[i], z + NEIGHBOR_DZ[i]) << i;
+      }
+
+      // Orthogonal neighbors of diagonal i are i - 1 and i + 1
+      uint32_t rotatedLeft  = ((free << 1) | (free >> 7)) & 0xFF;
+      uint32_t rotatedRight = ((free >> 1) | (free << 7)) & 0xFF;
+      return free & (0x55 | (rotatedLeft & rotatedRight));
+    }
+
+    bool IsValid() const
+    {
+      return this->pSolid != nullptr;
+    }
+  };
+} // namespace mj
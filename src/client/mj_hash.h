@@ -0,0 +1,15 @@
+// Hash - fast non-cryptographic hashing of memory
+// Should not use pre-compiled headers (for portability)
+//
+// XXH64: four independent 64-bit lanes over 32-byte stripes, so large buffers hash at several
+// bytes per cycle. The result only depends on the bytes, so equal data hashes equal on every
+// (little-endian) platform. Chain calls through the seed to hash several buffers.
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace mj
+{
+  uint64_t Hash64(const void* pData, size_t size, uint64_t seed = 0);
+} // namespace mj
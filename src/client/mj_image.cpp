@@ -0,0 +1,549 @@
+// Image - RGBA8 images and mip chains, for the asset cooker
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_image.h"
+#include "mj_common.h"
+#include "mj_file.h"
+#include "mj_profiler.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MJ_IMAGE_SSE2 1
+#endif
+
+static constexpr uint32_t KAISER_TAPS = 8;    // Source texels per destination texel, per axis
+static constexpr float KAISER_BETA    = 4.0f; // Window shape, higher is smoother
+
+mj::Image mj::Image::Create(uint32_t width, uint32_t height)
+{
+  Image image;
+  image.pPixels = (uint8_t*)malloc((size_t)width * height * 4);
+  if (image.pPixels)
+  {
+    image.width  = width;
+    image.height = height;
+  }
+  return image;
+}
+
+void mj::Image::Free(Image image)
+{
+  free(image.pPixels);
+}
+
+/// <summary>
+/// Converts a little-endian BGR, BGRA or 8-bit gray texel
+/// </summary>
+static inline void DecodeTexel(const uint8_t* pIn, uint32_t bytesPerTexel, uint8_t* pOut)
+{
+  if (bytesPerTexel == 1)
+  {
+    pOut[0] = pIn[0];
+    pOut[1] = pIn[0];
+    pOut[2] = pIn[0];
+    pOut[3] = 255;
+  }
+  else
+  {
+    pOut[0] = pIn[2];
+    pOut[1] = pIn[1];
+    pOut[2] = pIn[0];
+    pOut[3] = bytesPerTexel == 4 ? pIn[3] : 255;
+  }
+}
+
+/// <summary>
+/// Uncompressed or RLE; true color (24/32-bit), gray (8-bit) or color-mapped (8-bit indices)
+/// </summary>
+static mj::Image LoadTga(mj::MemoryBuffer reader)
+{
+  MJ_UNINITIALIZED uint8_t idLength, colorMapType, imageType, colorMapDepth, depth, descriptor;
+  MJ_UNINITIALIZED uint16_t colorMapFirst, colorMapLength, originX, originY, width, height;
+  if (!reader
+           .Read(idLength)       //
+           .Read(colorMapType)   //
+           .Read(imageType)      //
+           .Read(colorMapFirst)  //
+           .Read(colorMapLength) //
+           .Read(colorMapDepth)  //
+           .Read(originX)        //
+           .Read(originY)        //
+           .Read(width)          //
+           .Read(height)         //
+           .Read(depth)          //
+           .Read(descriptor)     //
+           .Skip(idLength)       //
+           .Good() ||
+      (width == 0) || (height == 0))
+  {
+    return {};
+  }
+
+  const uint8_t* pColorMap = nullptr;
+  uint32_t colorMapBytes   = colorMapDepth / 8;
+  if (colorMapType == 1)
+  {
+    pColorMap = reader.ReserveArrayUnaligned<uint8_t>((size_t)colorMapLength * colorMapBytes);
+  }
+  bool rle          = imageType >= 9;
+  uint32_t baseType = rle ? imageType - 8u : imageType;
+  bool mapped       = (baseType == 1) && pColorMap && (depth == 8) && (colorMapBytes == 3 || colorMapBytes == 4);
+  bool color        = (baseType == 2) && (depth == 24 || depth == 32);
+  bool gray         = (baseType == 3) && (depth == 8);
+  if (!reader.Good() || !(mapped || color || gray))
+  {
+    return {};
+  }
+
+  mj::Image image = mj::Image::Create(width, height);
+  if (!image.IsValid())
+  {
+    return image;
+  }
+
+  // A run packet repeats one texel, a raw packet is followed by its texels
+  uint32_t bytesPerTexel = depth / 8;
+  uint32_t numTexels     = (uint32_t)width * height;
+  uint32_t runLeft       = 0;
+  bool repeat            = false;
+  bool valid             = true;
+  const uint8_t* pTexel  = nullptr;
+  for (uint32_t i = 0; valid && (i < numTexels); i++)
+  {
+    if (rle && runLeft == 0)
+    {
+      uint8_t packet = 0;
+      valid          = reader.Read(packet).Good();
+      repeat         = (packet & 0x80) != 0;
+      runLeft        = (packet & 0x7F) + 1u;
+      pTexel         = reader.ReserveArrayUnaligned<uint8_t>(bytesPerTexel);
+    }
+    else if (!repeat)
+    {
+      pTexel = reader.ReserveArrayUnaligned<uint8_t>(bytesPerTexel);
+    }
+    runLeft--;
+    if (!valid || !pTexel)
+    {
+      valid = false;
+      break;
+    }
+
+    // Bottom-up unless bit 5 is set, right to left if bit 4 is set
+    uint32_t x    = i % width;
+    uint32_t y    = i / width;
+    x             = (descriptor & 0x10) ? width - 1 - x : x;
+    y             = (descriptor & 0x20) ? y : height - 1 - y;
+    uint8_t* pOut = image.pPixels + ((size_t)y * width + x) * 4;
+    if (mapped)
+    {
+      uint32_t index = (uint32_t)pTexel[0] - colorMapFirst;
+      valid          = (pTexel[0] >= colorMapFirst) && (index < colorMapLength);
+      if (valid)
+      {
+        DecodeTexel(pColorMap + index * colorMapBytes, colorMapBytes, pOut);
+      }
+    }
+    else
+    {
+      DecodeTexel(pTexel, bytesPerTexel, pOut);
+    }
+  }
+
+  if (!valid)
+  {
+    mj::Image::Free(image);
+    return {};
+  }
+  return image;
+}
+
+/// <summary>
+/// Uncompressed 8-bit palettized, 24-bit or 32-bit. 32-bit texels only have alpha with an alpha mask.
+/// </summary>
+static mj::Image LoadBmp(mj::MemoryBuffer file)
+{
+  static constexpr uint32_t BI_RGB       = 0;
+  static constexpr uint32_t BI_BITFIELDS = 3;
+  static constexpr int32_t MAX_SIZE      = 16384;
+
+  mj::MemoryBuffer reader = file;
+  MJ_UNINITIALIZED uint16_t magic, planes, depth;
+  MJ_UNINITIALIZED uint32_t fileSize, reserved, dataOffset, infoSize, compression, imageSize, xDensity, yDensity,
+      numColors, numImportant;
+  MJ_UNINITIALIZED int32_t width, height;
+  if (!reader
+           .Read(magic)        //
+           .Read(fileSize)     //
+           .Read(reserved)     //
+           .Read(dataOffset)   //
+           .Read(infoSize)     //
+           .Read(width)        //
+           .Read(height)       //
+           .Read(planes)       //
+           .Read(depth)        //
+           .Read(compression)  //
+           .Read(imageSize)    //
+           .Read(xDensity)     //
+           .Read(yDensity)     //
+           .Read(numColors)    //
+           .Read(numImportant) //
+           .Good() ||
+      (infoSize < 40) || (width <= 0) || (width > MAX_SIZE) || (height == 0) || (height < -MAX_SIZE) ||
+      (height > MAX_SIZE))
+  {
+    return {};
+  }
+
+  // Bit masks directly follow the 40-byte header, whether or not they are part of it
+  bool alpha = false;
+  if (compression == BI_BITFIELDS)
+  {
+    MJ_UNINITIALIZED uint32_t redMask, greenMask, blueMask, alphaMask;
+    if (!reader.Read(redMask).Read(greenMask).Read(blueMask).Good() || (depth != 32) || (redMask != 0x00FF0000) ||
+        (greenMask != 0x0000FF00) || (blueMask != 0x000000FF))
+    {
+      return {};
+    }
+    alpha = (infoSize >= 56) && reader.Read(alphaMask).Good() && (alphaMask == 0xFF000000);
+  }
+  else if (compression != BI_RGB || !(depth == 8 || depth == 24 || depth == 32))
+  {
+    return {};
+  }
+
+  // BGRX entries after the header
+  const uint8_t* pPalette = nullptr;
+  uint32_t paletteSize    = 0;
+  if (depth == 8)
+  {
+    paletteSize         = (numColors > 0 && numColors <= 256) ? numColors : 256;
+    mj::MemoryBuffer at = file;
+    pPalette            = at.Skip(14 + (size_t)infoSize).ReserveArrayUnaligned<uint8_t>(paletteSize * 4);
+    if (!pPalette)
+    {
+      return {};
+    }
+  }
+
+  // Rows are padded to 4 bytes and stored bottom-up, unless the height is negative
+  bool topDown         = height < 0;
+  uint32_t numRows     = topDown ? (uint32_t)-height : (uint32_t)height;
+  size_t stride        = ((size_t)width * depth + 31) / 32 * 4;
+  mj::MemoryBuffer at  = file;
+  const uint8_t* pData = at.Skip(dataOffset).ReserveArrayUnaligned<uint8_t>(stride * numRows);
+  if (!pData)
+  {
+    return {};
+  }
+
+  mj::Image image = mj::Image::Create((uint32_t)width, numRows);
+  if (!image.IsValid())
+  {
+    return image;
+  }
+  for (uint32_t row = 0; row < numRows; row++)
+  {
+    const uint8_t* pIn = pData + row * stride;
+    uint8_t* pOut      = image.pPixels + (size_t)(topDown ? row : numRows - 1 - row) * image.width * 4;
+    for (uint32_t x = 0; x < image.width; x++, pOut += 4)
+    {
+      if (depth == 8)
+      {
+        // Indices past the palette are black
+        static const uint8_t s_Black[4] = {};
+        DecodeTexel(pIn[x] < paletteSize ? pPalette + pIn[x] * 4 : s_Black, 3, pOut);
+      }
+      else
+      {
+        DecodeTexel(pIn + x * (depth / 8), alpha ? 4 : 3, pOut);
+      }
+    }
+  }
+  return image;
+}
+
+mj::Image mj::Image::Load(const char* pPath)
+{
+  ZoneScoped;
+  MJ_UNINITIALIZED size_t size;
+  void* pFile = mj::ReadFile(pPath, &size);
+  if (!pFile)
+  {
+    return {};
+  }
+
+  // TGA has no magic number
+  MemoryBuffer reader(pFile, size);
+  Image image = (size >= 2 && memcmp(pFile, "BM", 2) == 0) ? LoadBmp(reader) : LoadTga(reader);
+  free(pFile);
+  return image;
+}
+
+uint32_t mj::mips::GetNumMips(uint32_t width, uint32_t height)
+{
+  uint32_t numMips = 1;
+  while (width > 1 || height > 1)
+  {
+    width  = width > 1 ? width / 2 : 1;
+    height = height > 1 ? height / 2 : 1;
+    numMips++;
+  }
+  return numMips;
+}
+
+size_t mj::mips::GetChainSize(uint32_t width, uint32_t height, uint32_t numMips)
+{
+  size_t size = 0;
+  for (uint32_t mip = 0; mip < numMips; mip++)
+  {
+    size += (size_t)width * height * 4;
+    width  = width > 1 ? width / 2 : 1;
+    height = height > 1 ? height / 2 : 1;
+  }
+  return size;
+}
+
+void mj::mips::Generate(uint8_t* pChain, uint32_t width, uint32_t height, uint32_t numMips, Filter filter)
+{
+  ZoneScoped;
+  for (uint32_t mip = 1; mip < numMips; mip++)
+  {
+    uint8_t* pNext = pChain + (size_t)width * height * 4;
+    if (filter == Filter::Kaiser)
+    {
+      DownsampleKaiser(pChain, width, height, pNext);
+    }
+    else
+    {
+      DownsampleBox(pChain, width, height, pNext);
+    }
+    pChain = pNext;
+    width  = width > 1 ? width / 2 : 1;
+    height = height > 1 ? height / 2 : 1;
+  }
+}
+
+/// <summary>
+/// Destination texels [begin, end) of one row, from the two source rows under it
+/// </summary>
+static inline void BoxRowScalar(const uint8_t* pRow0, const uint8_t* pRow1, uint32_t width, uint32_t begin,
+                                uint32_t end, uint8_t* pDst)
+{
+  for (uint32_t x = begin; x < end; x++)
+  {
+    uint32_t x0 = 2 * x;
+    uint32_t x1 = 2 * x + 1 < width ? 2 * x + 1 : x0;
+    for (uint32_t c = 0; c < 4; c++)
+    {
+      uint32_t sum    = pRow0[x0 * 4 + c] + pRow0[x1 * 4 + c] + pRow1[x0 * 4 + c] + pRow1[x1 * 4 + c];
+      pDst[x * 4 + c] = (uint8_t)((sum + 2) >> 2);
+    }
+  }
+}
+
+void mj::mips::DownsampleBoxScalar(const uint8_t* pSrc, uint32_t width, uint32_t height, uint8_t* pDst)
+{
+  uint32_t dstWidth  = width > 1 ? width / 2 : 1;
+  uint32_t dstHeight = height > 1 ? height / 2 : 1;
+  for (uint32_t y = 0; y < dstHeight; y++)
+  {
+    const uint8_t* pRow0 = pSrc + (size_t)(2 * y) * width * 4;
+    const uint8_t* pRow1 = height > 1 ? pRow0 + (size_t)width * 4 : pRow0;
+    BoxRowScalar(pRow0, pRow1, width, 0, dstWidth, pDst + (size_t)y * dstWidth * 4);
+  }
+}
+
+void mj::mips::DownsampleBox(const uint8_t* pSrc, uint32_t width, uint32_t height, uint8_t* pDst)
+{
+  uint32_t dstWidth  = width > 1 ? width / 2 : 1;
+  uint32_t dstHeight = height > 1 ? height / 2 : 1;
+  for (uint32_t y = 0; y < dstHeight; y++)
+  {
+    const uint8_t* pRow0 = pSrc + (size_t)(2 * y) * width * 4;
+    const uint8_t* pRow1 = height > 1 ? pRow0 + (size_t)width * 4 : pRow0;
+    uint8_t* pOut        = pDst + (size_t)y * dstWidth * 4;
+    uint32_t x           = 0;
+#ifdef MJ_IMAGE_SSE2
+    // 4 source texels of both rows become 2 destination texels
+    const __m128i zero  = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi16(2);
+    for (; (width > 1) && (x + 2 <= dstWidth); x += 2)
+    {
+      __m128i row0  = _mm_loadu_si128((const __m128i*)(pRow0 + x * 8));
+      __m128i row1  = _mm_loadu_si128((const __m128i*)(pRow1 + x * 8));
+      __m128i left  = _mm_add_epi16(_mm_unpacklo_epi8(row0, zero), _mm_unpacklo_epi8(row1, zero));
+      __m128i right = _mm_add_epi16(_mm_unpackhi_epi8(row0, zero), _mm_unpackhi_epi8(row1, zero));
+      left          = _mm_add_epi16(left, _mm_srli_si128(left, 8));
+      right         = _mm_add_epi16(right, _mm_srli_si128(right, 8));
+      __m128i sum   = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(left, right), round), 2);
+      _mm_storel_epi64((__m128i*)(pOut + x * 4), _mm_packus_epi16(sum, sum));
+    }
+#endif
+    BoxRowScalar(pRow0, pRow1, width, x, dstWidth, pOut);
+  }
+}
+
+static inline double BesselI0(double x)
+{
+  double sum  = 1.0;
+  double term = 1.0;
+  for (uint32_t k = 1; k < 32; k++)
+  {
+    double f = x / (2.0 * k);
+    term *= f * f;
+    sum += term;
+  }
+  return sum;
+}
+
+/// <summary>
+/// Source texels that make up one destination texel along an axis
+/// </summary>
+struct KaiserAxis
+{
+  uint32_t numTaps;
+  float weights[KAISER_TAPS];
+  uint32_t* pIndices; // numTaps per destination texel, wrapped around the edges
+};
+
+/// <summary>
+/// Halves an axis, or keeps a size of 1 as it is
+/// </summary>
+static bool InitKaiserAxis(KaiserAxis* pAxis, uint32_t size)
+{
+  uint32_t dstSize = size > 1 ? size / 2 : 1;
+  pAxis->numTaps   = size > 1 ? KAISER_TAPS : 1;
+  pAxis->pIndices  = (uint32_t*)malloc((size_t)dstSize * pAxis->numTaps * sizeof(uint32_t));
+  if (!pAxis->pIndices)
+  {
+    return false;
+  }
+  if (size == 1)
+  {
+    pAxis->weights[0]  = 1.0f;
+    pAxis->pIndices[0] = 0;
+    return true;
+  }
+
+  // Texel k is k - 3.5 source texels from the center of the destination texel
+  static constexpr double PI = 3.14159265358979323846;
+  double radius              = KAISER_TAPS / 2;
+  double total               = 0.0;
+  double weights[KAISER_TAPS];
+  for (uint32_t k = 0; k < KAISER_TAPS; k++)
+  {
+    double d    = k - radius + 0.5;
+    double x    = PI * d / 2.0;
+    double r    = d / radius;
+    double sinc = sin(x) / x;
+    weights[k]  = sinc * BesselI0(KAISER_BETA * sqrt(1.0 - r * r)) / BesselI0(KAISER_BETA);
+    total += weights[k];
+  }
+  for (uint32_t k = 0; k < KAISER_TAPS; k++)
+  {
+    pAxis->weights[k] = (float)(weights[k] / total);
+  }
+
+  for (uint32_t i = 0; i < dstSize; i++)
+  {
+    for (uint32_t k = 0; k < KAISER_TAPS; k++)
+    {
+      int64_t index                        = (int64_t)2 * i + k - KAISER_TAPS / 2 + 1;
+      pAxis->pIndices[i * KAISER_TAPS + k] = (uint32_t)(((index % size) + size) % size);
+    }
+  }
+  return true;
+}
+
+void mj::mips::DownsampleKaiser(const uint8_t* pSrc, uint32_t width, uint32_t height, uint8_t* pDst)
+{
+  uint32_t dstWidth  = width > 1 ? width / 2 : 1;
+  uint32_t dstHeight = height > 1 ? height / 2 : 1;
+
+  // Horizontal pass into RGBA floats, then the vertical pass into the destination
+  KaiserAxis horizontal = {};
+  KaiserAxis vertical   = {};
+  float* pTemp          = (float*)malloc((size_t)dstWidth * height * 4 * sizeof(float));
+  if (!pTemp || !InitKaiserAxis(&horizontal, width) || !InitKaiserAxis(&vertical, height))
+  {
+    // Still a valid mip
+    DownsampleBox(pSrc, width, height, pDst);
+  }
+  else
+  {
+    for (uint32_t y = 0; y < height; y++)
+    {
+      const uint8_t* pRow = pSrc + (size_t)y * width * 4;
+      float* pOut         = pTemp + (size_t)y * dstWidth * 4;
+      for (uint32_t x = 0; x < dstWidth; x++, pOut += 4)
+      {
+        const uint32_t* pIndices = horizontal.pIndices + x * horizontal.numTaps;
+#ifdef MJ_IMAGE_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        __m128 sum         = _mm_setzero_ps();
+        for (uint32_t k = 0; k < horizontal.numTaps; k++)
+        {
+          MJ_UNINITIALIZED int32_t texel;
+          memcpy(&texel, pRow + pIndices[k] * 4, sizeof(texel));
+          __m128i wide = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(texel), zero), zero);
+          sum          = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(wide), _mm_set1_ps(horizontal.weights[k])));
+        }
+        _mm_storeu_ps(pOut, sum);
+#else
+        for (uint32_t c = 0; c < 4; c++)
+        {
+          float sum = 0.0f;
+          for (uint32_t k = 0; k < horizontal.numTaps; k++)
+          {
+            sum += pRow[pIndices[k] * 4 + c] * horizontal.weights[k];
+          }
+          pOut[c] = sum;
+        }
+#endif
+      }
+    }
+
+    for (uint32_t y = 0; y < dstHeight; y++)
+    {
+      const uint32_t* pIndices = vertical.pIndices + y * vertical.numTaps;
+      uint8_t* pOut            = pDst + (size_t)y * dstWidth * 4;
+      for (uint32_t x = 0; x < dstWidth; x++, pOut += 4)
+      {
+#ifdef MJ_IMAGE_SSE2
+        __m128 sum = _mm_setzero_ps();
+        for (uint32_t k = 0; k < vertical.numTaps; k++)
+        {
+          __m128 texel = _mm_loadu_ps(pTemp + ((size_t)pIndices[k] * dstWidth + x) * 4);
+          sum          = _mm_add_ps(sum, _mm_mul_ps(texel, _mm_set1_ps(vertical.weights[k])));
+        }
+        // Rounds to nearest and saturates, the negative lobes can over- and undershoot
+        __m128i wide  = _mm_cvtps_epi32(sum);
+        wide          = _mm_packs_epi32(wide, wide);
+        int32_t texel = _mm_cvtsi128_si32(_mm_packus_epi16(wide, wide));
+        memcpy(pOut, &texel, sizeof(texel));
+#else
+        for (uint32_t c = 0; c < 4; c++)
+        {
+          float sum = 0.0f;
+          for (uint32_t k = 0; k < vertical.numTaps; k++)
+          {
+            sum += pTemp[((size_t)pIndices[k] * dstWidth + x) * 4 + c] * vertical.weights[k];
+          }
+          // The negative lobes can over- and undershoot
+          float value = sum < 0.0f ? 0.0f : (sum > 255.0f ? 255.0f : sum);
+          pOut[c]     = (uint8_t)(value + 0.5f);
+        }
+#endif
+      }
+    }
+  }
+
+  free(horizontal.pIndices);
+  free(vertical.pIndices);
+  free(pTemp);
+}
@@ -0,0 +1,81 @@
+// Image - RGBA8 images and mip chains, for the asset cooker
+// Should not use pre-compiled headers (for portability)
+//
+// Images are read from uncompressed or RLE TGA files and uncompressed BMP files, true color or
+// palettized, so the cooker needs no image library. A mip chain is stored in one allocation, largest
+// mip first, each mip directly after its parent, which is the order of the mips of one layer in a DDS
+// file. Every mip halves the size of its parent, rounding down, until both sides are 1.
+//
+// Two filters build the next mip. Box averages 2x2 texels (SSE2 where available, 2 output texels per
+// step). Kaiser is a separable Kaiser-windowed sinc over 8x8 texels: distant mips keep more contrast
+// than with box and show less aliasing. It wraps around the edges like the sampler does.
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace mj
+{
+  struct Image
+  {
+    uint32_t width  = 0;
+    uint32_t height = 0;
+    /// <summary>
+    /// Indexing: (y * width + x) * 4, RGBA
+    /// </summary>
+    uint8_t* pPixels = nullptr;
+
+    static Image Create(uint32_t width, uint32_t height);
+
+    /// <summary>
+    /// Reads a TGA or BMP file
+    /// </summary>
+    /// <returns>Invalid image if the file is missing, corrupt or of an unsupported kind</returns>
+    static Image Load(const char* pPath);
+    static void Free(Image image);
+
+    bool IsValid() const
+    {
+      return this->pPixels != nullptr;
+    }
+  };
+
+  namespace mips
+  {
+    enum class Filter
+    {
+      Box,
+      Kaiser,
+    };
+
+    /// <summary>
+    /// Mips down to 1x1, the first one included
+    /// </summary>
+    uint32_t GetNumMips(uint32_t width, uint32_t height);
+
+    /// <summary>
+    /// Bytes of a chain of numMips RGBA8 mips
+    /// </summary>
+    size_t GetChainSize(uint32_t width, uint32_t height, uint32_t numMips);
+
+    /// <summary>
+    /// Fills in every mip after the first one, which the chain must already hold
+    /// </summary>
+    void Generate(uint8_t* pChain, uint32_t width, uint32_t height, uint32_t numMips, Filter filter);
+
+    /// <summary>
+    /// Writes the next mip of a width x height image. Uses SSE2 if the target has it.
+    /// </summary>
+    void DownsampleBox(const uint8_t* pSrc, uint32_t width, uint32_t height, uint8_t* pDst);
+
+    /// <summary>
+    /// DownsampleBox without SIMD, with identical results
+    /// </summary>
+    void DownsampleBoxScalar(const uint8_t* pSrc, uint32_t width, uint32_t height, uint8_t* pDst);
+
+    /// <summary>
+    /// Writes the next mip of a width x height image
+    /// </summary>
+    void DownsampleKaiser(const uint8_t* pSrc, uint32_t width, uint32_t height, uint8_t* pDst);
+  } // namespace mips
+} // namespace mj
@@ -9,6 +9,7 @@
 
 #include "mj_input.h"
 #include <assert.h>
+#include <string.h>
 #include <queue>
 
 #ifdef MJ_INPUT_SDL
@@ -492,11 +493,22 @@ void mj::input::SetKey(SDL_Scancode key, bool active)
   Key::Enum mappedKey = MapKey(key);
   if (mappedKey != Key::None)
   {
-    SetKey(mappedKey, active);
+    ::SetKey(mappedKey, active);
   }
 }
 #endif // MJ_INPUT_SDL
 
+/**
+ * @brief      Sets a virtual key without a device, for simulated players.
+ *
+ * @param[in]  key     The key
+ * @param[in]  active  True if the key is held down
+ */
+void mj::input::SetKey(Key::Enum key, bool active)
+{
+  ::SetKey(key, active);
+}
+
 /**
  * @brief      Queue an ASCII character for ImGui typing.
  *
@@ -243,6 +243,7 @@ namespace mj
 #ifdef MJ_INPUT_SDL
     void SetKey(SDL_Scancode key, bool active);
 #endif // MJ_INPUT_SDL
+    void SetKey(Key::Enum key, bool active);
     bool IsEscapePressed();
 
     const char* GetKeyName(Key::Enum key);
@@ -0,0 +1,408 @@
+// Job system - work-stealing scheduler
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_jobs.h"
+#include "mj_common.h"
+#include "mj_profiler.h"
+
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Must be a power of two. Also the maximum amount of jobs a single thread can have in flight per frame.
+static constexpr uint32_t MAX_JOBS_PER_THREAD = 4096;
+static constexpr uint32_t JOB_MASK            = MAX_JOBS_PER_THREAD - 1;
+static constexpr uint32_t MAX_THREADS         = 64;
+
+// Attempts to find work before a worker goes to sleep
+static constexpr uint32_t NUM_SPINS = 64;
+
+// Thread index of threads that are not part of the job system
+static constexpr uint32_t NO_THREAD = UINT32_MAX;
+
+struct alignas(64) mj::jobs::Job
+{
+  JobFunction function;
+  Job* pParent;
+  std::atomic<int32_t> unfinishedJobs;
+  char data[MAX_DATA_SIZE];
+};
+static_assert(sizeof(mj::jobs::Job) == 64, "Job should fill exactly one cache line");
+
+/// <summary>
+/// Chase-Lev work-stealing deque.
+/// The owning thread pushes and pops at the bottom, other threads steal from the top.
+/// </summary>
+class WorkStealingQueue
+{
+public:
+  void Push(mj::jobs::Job* pJob)
+  {
+    int64_t b = this->bottom.load(std::memory_order_relaxed);
+    this->jobs[b & JOB_MASK].store(pJob, std::memory_order_relaxed);
+    this->bottom.store(b + 1, std::memory_order_release);
+  }
+
+  mj::jobs::Job* Pop()
+  {
+    int64_t b = this->bottom.load(std::memory_order_relaxed) - 1;
+    this->bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = this->top.load(std::memory_order_relaxed);
+
+    if (t <= b)
+    {
+      mj::jobs::Job* pJob = this->jobs[b & JOB_MASK].load(std::memory_order_relaxed);
+      if (t != b)
+      {
+        // More than one job left
+        return pJob;
+      }
+
+      // Last job, race against stealing threads
+      if (!this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+      {
+        pJob = nullptr;
+      }
+      this->bottom.store(b + 1, std::memory_order_relaxed);
+      return pJob;
+    }
+    else
+    {
+      // Empty
+      this->bottom.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+  }
+
+  mj::jobs::Job* Steal()
+  {
+    int64_t t = this->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = this->bottom.load(std::memory_order_acquire);
+
+    if (t < b)
+    {
+      mj::jobs::Job* pJob = this->jobs[t & JOB_MASK].load(std::memory_order_relaxed);
+      if (this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+      {
+        return pJob;
+      }
+    }
+    return nullptr;
+  }
+
+private:
+  alignas(64) std::atomic<int64_t> top{ 0 };
+  alignas(64) std::atomic<int64_t> bottom{ 0 };
+  std::atomic<mj::jobs::Job*> jobs[MAX_JOBS_PER_THREAD];
+};
+
+struct ThreadData
+{
+  WorkStealingQueue queue;
+  mj::jobs::Job jobs[MAX_JOBS_PER_THREAD];
+  uint32_t numAllocated = 0;
+  uint32_t random       = 0;
+};
+
+// WARNING: global variables
+static ThreadData* s_pThreadData;
+static std::thread* s_pWorkers;
+static uint32_t s_NumThreads;
+static std::atomic<bool> s_Running;
+static std::atomic<int32_t> s_NumPending; // Scheduled jobs that have not completed yet
+static std::atomic<int32_t> s_NumSleeping;
+static std::mutex s_SleepMutex;
+static std::condition_variable s_SleepCondition;
+static thread_local uint32_t s_ThreadIndex = NO_THREAD;
+
+static mj::jobs::Job* Allocate(mj::jobs::JobFunction function, mj::jobs::Job* pParent, const void* pData, size_t size)
+{
+  assert(size <= mj::jobs::MAX_DATA_SIZE);
+  assert(s_ThreadIndex != NO_THREAD);
+  ThreadData& thread   = s_pThreadData[s_ThreadIndex];
+  mj::jobs::Job* pJob  = &thread.jobs[thread.numAllocated++ & JOB_MASK];
+  pJob->function       = function;
+  pJob->pParent        = pParent;
+  pJob->unfinishedJobs = 1;
+  if (pData && size > 0)
+  {
+    memcpy(pJob->data, pData, size);
+  }
+  return pJob;
+}
+
+static void Finish(mj::jobs::Job* pJob)
+{
+  // Read before completing, the job may be recycled right after
+  mj::jobs::Job* pParent = pJob->pParent;
+  if (pJob->unfinishedJobs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+  {
+    if (pParent)
+    {
+      Finish(pParent);
+    }
+    s_NumPending.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+static void Execute(mj::jobs::Job* pJob)
+{
+  ZoneScopedNC("Job", tracy::Color::SteelBlue);
+  if (pJob->function)
+  {
+    pJob->function(pJob, pJob->data);
+  }
+  Finish(pJob);
+}
+
+static mj::jobs::Job* GetJob()
+{
+  assert(s_ThreadIndex != NO_THREAD);
+  ThreadData& thread  = s_pThreadData[s_ThreadIndex];
+  mj::jobs::Job* pJob = thread.queue.Pop();
+  if (pJob)
+  {
+    return pJob;
+  }
+
+  if (s_NumThreads > 1)
+  {
+    // Steal, starting at a random victim
+    thread.random ^= thread.random << 13;
+    thread.random ^= thread.random >> 17;
+    thread.random ^= thread.random << 5;
+    uint32_t first = thread.random % s_NumThreads;
+    for (uint32_t i = 0; i < s_NumThreads; i++)
+    {
+      uint32_t victim = (first + i) % s_NumThreads;
+      if (victim != s_ThreadIndex)
+      {
+        pJob = s_pThreadData[victim].queue.Steal();
+        if (pJob)
+        {
+          return pJob;
+        }
+      }
+    }
+  }
+
+  return nullptr;
+}
+
+static bool TryExecuteOne()
+{
+  mj::jobs::Job* pJob = GetJob();
+  if (pJob)
+  {
+    Execute(pJob);
+    return true;
+  }
+  return false;
+}
+
+static void WorkerMain(uint32_t threadIndex)
+{
+  s_ThreadIndex                      = threadIndex;
+  s_pThreadData[threadIndex].random = 0x9E3779B9u * (threadIndex + 1);
+
+#if defined(TRACY_ENABLE) || defined(MJ_PROFILER_ENABLED)
+  char name[16];
+  snprintf(name, sizeof(name), "Worker %u", threadIndex);
+#ifdef TRACY_ENABLE
+  tracy::SetThreadName(name);
+#else
+  mj::profiler::SetThreadName(name);
+#endif
+#endif
+
+  uint32_t spins = 0;
+  while (s_Running.load(std::memory_order_relaxed))
+  {
+    if (TryExecuteOne())
+    {
+      spins = 0;
+    }
+    else if (++spins < NUM_SPINS)
+    {
+      std::this_thread::yield();
+    }
+    else
+    {
+      // Nothing to do, sleep until a job is scheduled. The timeout covers missed notifications.
+      std::unique_lock<std::mutex> lock(s_SleepMutex);
+      s_NumSleeping.fetch_add(1, std::memory_order_relaxed);
+      s_SleepCondition.wait_for(lock, std::chrono::milliseconds(1));
+      s_NumSleeping.fetch_sub(1, std::memory_order_relaxed);
+      spins = 0;
+    }
+  }
+}
+
+void mj::jobs::Init(uint32_t numWorkers)
+{
+  assert(!s_pThreadData);
+  if (numWorkers == 0)
+  {
+    uint32_t numCores = std::thread::hardware_concurrency();
+    numWorkers        = numCores > 1 ? numCores - 1 : 0;
+  }
+  if (numWorkers > MAX_THREADS - 1)
+  {
+    numWorkers = MAX_THREADS - 1;
+  }
+
+  s_NumThreads  = numWorkers + 1;
+  s_pThreadData = new ThreadData[s_NumThreads];
+  s_NumPending  = 0;
+  s_NumSleeping = 0;
+  s_Running     = true;
+
+  // Main thread
+  s_ThreadIndex            = 0;
+  s_pThreadData[0].random = 0x9E3779B9u;
+
+  s_pWorkers = new std::thread[numWorkers];
+  for (uint32_t i = 0; i < numWorkers; i++)
+  {
+    s_pWorkers[i] = std::thread(WorkerMain, i + 1);
+  }
+}
+
+void mj::jobs::Shutdown()
+{
+  if (!s_pThreadData)
+  {
+    return;
+  }
+
+  Drain();
+
+  s_Running = false;
+  s_SleepCondition.notify_all();
+  for (uint32_t i = 0; i < s_NumThreads - 1; i++)
+  {
+    s_pWorkers[i].join();
+  }
+
+  delete[] s_pWorkers;
+  delete[] s_pThreadData;
+  s_pWorkers    = nullptr;
+  s_pThreadData = nullptr;
+  s_NumThreads  = 0;
+  s_ThreadIndex = NO_THREAD;
+}
+
+uint32_t mj::jobs::GetNumThreads()
+{
+  return s_NumThreads;
+}
+
+uint32_t mj::jobs::GetThreadIndex()
+{
+  return s_ThreadIndex;
+}
+
+mj::jobs::Job* mj::jobs::Create(JobFunction function, const void* pData, size_t size)
+{
+  return Allocate(function, nullptr, pData, size);
+}
+
+mj::jobs::Job* mj::jobs::CreateChild(Job* pParent, JobFunction function, const void* pData, size_t size)
+{
+  pParent->unfinishedJobs.fetch_add(1, std::memory_order_relaxed);
+  return Allocate(function, pParent, pData, size);
+}
+
+void mj::jobs::Run(Job* pJob)
+{
+  assert(s_ThreadIndex != NO_THREAD);
+  s_NumPending.fetch_add(1, std::memory_order_relaxed);
+  s_pThreadData[s_ThreadIndex].queue.Push(pJob);
+
+  if (s_NumSleeping.load(std::memory_order_relaxed) > 0)
+  {
+    s_SleepCondition.notify_one();
+  }
+}
+
+void mj::jobs::Wait(const Job* pJob)
+{
+  ZoneScopedNC("Job wait", tracy::Color::DarkOrange);
+  while (pJob->unfinishedJobs.load(std::memory_order_acquire) > 0)
+  {
+    if (!TryExecuteOne())
+    {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void mj::jobs::Drain()
+{
+  ZoneScopedNC("Job drain", tracy::Color::DarkOrange);
+  while (s_NumPending.load(std::memory_order_acquire) > 0)
+  {
+    if (!TryExecuteOne())
+    {
+      std::this_thread::yield();
+    }
+  }
+}
+
+struct RangeData
+{
+  mj::jobs::RangeFunction function;
+  void* pUserData;
+  uint32_t begin;
+  uint32_t end;
+};
+
+static void RangeJob(mj::jobs::Job* pJob, const void* pData)
+{
+  MJ_DISCARD(pJob);
+  const RangeData* pRange = (const RangeData*)pData;
+  pRange->function(pRange->begin, pRange->end, pRange->pUserData);
+}
+
+void mj::jobs::ParallelFor(uint32_t count, uint32_t grainSize, RangeFunction function, void* pUserData)
+{
+  ZoneScoped;
+  if (count == 0)
+  {
+    return;
+  }
+
+  // Stay well within the per-thread job ring
+  uint32_t minGrainSize = count / (MAX_JOBS_PER_THREAD / 4) + 1;
+  if (grainSize < minGrainSize)
+  {
+    grainSize = minGrainSize;
+  }
+
+  // Single chunk, no workers or a thread outside of the job system: run inline
+  if (count <= grainSize || s_NumThreads <= 1 || s_ThreadIndex == NO_THREAD)
+  {
+    function(0, count, pUserData);
+    return;
+  }
+
+  Job* pRoot = Create(nullptr);
+  for (uint32_t begin = grainSize; begin < count; begin += grainSize)
+  {
+    RangeData range;
+    range.function  = function;
+    range.pUserData = pUserData;
+    range.begin     = begin;
+    range.end       = (count - begin > grainSize) ? begin + grainSize : count;
+    Run(CreateChild(pRoot, RangeJob, &range, sizeof(range)));
+  }
+  Run(pRoot);
+
+  // The first chunk runs on this thread while the others are being stolen
+  function(0, grainSize, pUserData);
+  Wait(pRoot);
+}
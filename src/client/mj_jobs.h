@@ -0,0 +1,89 @@
+// Job system - work-stealing scheduler
+// Should not use pre-compiled headers (for portability)
+//
+// Every thread (main thread included) owns a job pool and a work-stealing deque.
+// Jobs are pushed to the deque of the thread that runs them, idle threads steal from the others.
+// A job can have a parent: the parent only completes once all of its children have completed.
+//
+// Job memory is a per-thread ring that is recycled without bookkeeping,
+// so all jobs must be drained once per frame (see Drain).
+//
+// Only the main thread (the one that called Init) and the workers may create, run or wait for jobs.
+// Other threads (e.g. the level loader) have no job pool: ParallelFor runs inline there, everything else asserts.
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace mj
+{
+  namespace jobs
+  {
+    struct Job;
+    using JobFunction   = void (*)(Job* pJob, const void* pData);
+    using RangeFunction = void (*)(uint32_t begin, uint32_t end, void* pUserData);
+
+    /// <summary>
+    /// Starts the worker threads.
+    /// </summary>
+    /// <param name="numWorkers">Amount of worker threads besides the calling thread. 0 = one per remaining core.</param>
+    void Init(uint32_t numWorkers = 0);
+    void Shutdown();
+
+    /// <summary>
+    /// Amount of threads executing jobs, including the main thread.
+    /// </summary>
+    uint32_t GetNumThreads();
+
+    /// <summary>
+    /// 0 on the main thread, 1..N on workers, UINT32_MAX on threads outside of the job system.
+    /// </summary>
+    uint32_t GetThreadIndex();
+
+    /// <summary>
+    /// Allocates a job. Data (at most MAX_DATA_SIZE bytes) is copied into the job.
+    /// </summary>
+    /// <returns>Job, not yet scheduled</returns>
+    Job* Create(JobFunction function, const void* pData = nullptr, size_t size = 0);
+
+    /// <summary>
+    /// Allocates a job that must complete before pParent completes.
+    /// Must be called before the parent is finished, e.g. from the parent's function or before running the parent.
+    /// </summary>
+    Job* CreateChild(Job* pParent, JobFunction function, const void* pData = nullptr, size_t size = 0);
+
+    /// <summary>
+    /// Schedules the job on the calling thread's queue.
+    /// </summary>
+    void Run(Job* pJob);
+
+    /// <summary>
+    /// Blocks until the job and all of its children are completed. Executes other jobs while waiting.
+    /// </summary>
+    void Wait(const Job* pJob);
+
+    /// <summary>
+    /// Executes jobs until no job is pending anymore. Call once per frame from the main thread.
+    /// </summary>
+    void Drain();
+
+    /// <summary>
+    /// Splits [0, count) into chunks of at most grainSize and runs them in parallel.
+    /// Blocks until all chunks are done.
+    /// </summary>
+    void ParallelFor(uint32_t count, uint32_t grainSize, RangeFunction function, void* pUserData);
+
+    /// <summary>
+    /// ParallelFor for callables with the signature void(uint32_t begin, uint32_t end)
+    /// </summary>
+    template <typename F>
+    void ParallelFor(uint32_t count, uint32_t grainSize, const F& fn)
+    {
+      ParallelFor(
+          count, grainSize, [](uint32_t begin, uint32_t end, void* pUserData) { (*(const F*)pUserData)(begin, end); },
+          (void*)&fn);
+    }
+
+    static constexpr size_t MAX_DATA_SIZE = 40;
+  } // namespace jobs
+} // namespace mj
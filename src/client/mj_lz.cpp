@@ -0,0 +1,221 @@
+// LZ - fast byte-oriented LZ77 compression
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_lz.h"
+#include "mj_profiler.h"
+
+#include <string.h>
+
+static constexpr uint32_t MIN_MATCH     = 4;
+static constexpr uint32_t LAST_LITERALS = 5;  // Bytes at the end that are always literals
+static constexpr uint32_t MATCH_LIMIT   = 12; // No match starts within this many bytes of the end
+static constexpr uint32_t MAX_OFFSET    = 65535;
+static constexpr uint32_t HASH_BITS     = 12;
+static constexpr uint32_t SKIP_TRIGGER  = 6; // The search step grows by one every 2^6 misses in a row
+
+static inline uint32_t Read32(const uint8_t* p)
+{
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static inline uint32_t Hash(uint32_t sequence)
+{
+  return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/// <summary>
+/// Bytes that follow a nibble for a length, 0 if the length fits in the nibble
+/// </summary>
+static inline size_t GetLengthSize(size_t length)
+{
+  return length >= 15 ? (length - 15) / 255 + 1 : 0;
+}
+
+static inline uint8_t* WriteLength(uint8_t* pOut, size_t length)
+{
+  if (length >= 15)
+  {
+    for (length -= 15; length >= 255; length -= 255)
+    {
+      *pOut++ = 255;
+    }
+    *pOut++ = (uint8_t)length;
+  }
+  return pOut;
+}
+
+/// <summary>
+/// Adds the bytes that follow a nibble of 15
+/// </summary>
+/// <returns>False if the input ends first</returns>
+static inline bool ReadLength(const uint8_t** ppIn, const uint8_t* pInEnd, size_t* pLength)
+{
+  uint8_t byte;
+  do
+  {
+    if (*ppIn == pInEnd)
+    {
+      return false;
+    }
+    byte = *(*ppIn)++;
+    *pLength += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/// <param name="matchLength">0 for the last sequence, which only has literals</param>
+/// <returns>End of the sequence, nullptr if it does not fit</returns>
+static uint8_t* WriteSequence(uint8_t* pOut, const uint8_t* pOutEnd, const uint8_t* pLiterals, size_t numLiterals,
+                              size_t offset, size_t matchLength)
+{
+  size_t matchNibble = matchLength > 0 ? matchLength - MIN_MATCH : 0;
+  size_t size = 1 + GetLengthSize(numLiterals) + numLiterals + (matchLength > 0 ? 2 + GetLengthSize(matchNibble) : 0);
+  if ((size_t)(pOutEnd - pOut) < size)
+  {
+    return nullptr;
+  }
+
+  *pOut++ = (uint8_t)(((numLiterals < 15 ? numLiterals : 15) << 4) | (matchNibble < 15 ? matchNibble : 15));
+  pOut    = WriteLength(pOut, numLiterals);
+  memcpy(pOut, pLiterals, numLiterals);
+  pOut += numLiterals;
+  if (matchLength > 0)
+  {
+    *pOut++ = (uint8_t)offset;
+    *pOut++ = (uint8_t)(offset >> 8);
+    pOut    = WriteLength(pOut, matchNibble);
+  }
+  return pOut;
+}
+
+size_t mj::lz::GetMaxCompressedSize(size_t size)
+{
+  return size + size / 255 + 16;
+}
+
+size_t mj::lz::Compress(const void* pSrc, size_t size, void* pDst, size_t capacity)
+{
+  ZoneScoped;
+  const uint8_t* pIn     = (const uint8_t*)pSrc;
+  uint8_t* pOut          = (uint8_t*)pDst;
+  const uint8_t* pOutEnd = pOut + capacity;
+  if (size >= UINT32_MAX)
+  {
+    return 0;
+  }
+
+  // Position + 1 of the last 4-byte sequence with each hash, 0 if none
+  uint32_t table[1 << HASH_BITS] = {};
+
+  size_t anchor = 0; // Start of the literals that are not written yet
+  if (size > MATCH_LIMIT)
+  {
+    size_t matchStartLimit = size - MATCH_LIMIT;
+    size_t matchEndLimit   = size - LAST_LITERALS;
+    size_t position        = 0;
+    uint32_t numMisses     = 0;
+    while (position <= matchStartLimit)
+    {
+      uint32_t sequence = Read32(pIn + position);
+      uint32_t* pSlot   = &table[Hash(sequence)];
+      size_t candidate  = *pSlot;
+      *pSlot            = (uint32_t)(position + 1);
+      if (candidate == 0 || position + 1 - candidate > MAX_OFFSET || Read32(pIn + candidate - 1) != sequence)
+      {
+        position += 1 + (numMisses++ >> SKIP_TRIGGER);
+        continue;
+      }
+
+      size_t match  = candidate - 1;
+      size_t length = MIN_MATCH;
+      while (position + length < matchEndLimit && pIn[match + length] == pIn[position + length])
+      {
+        length++;
+      }
+      // Take over literals that also match
+      while (position > anchor && match > 0 && pIn[position - 1] == pIn[match - 1])
+      {
+        position--;
+        match--;
+        length++;
+      }
+
+      pOut = WriteSequence(pOut, pOutEnd, pIn + anchor, position - anchor, position - match, length);
+      if (!pOut)
+      {
+        return 0;
+      }
+      position += length;
+      anchor    = position;
+      numMisses = 0;
+    }
+  }
+
+  pOut = WriteSequence(pOut, pOutEnd, pIn + anchor, size - anchor, 0, 0);
+  return pOut ? pOut - (uint8_t*)pDst : 0;
+}
+
+bool mj::lz::Decompress(const void* pSrc, size_t size, void* pDst, size_t dstSize)
+{
+  ZoneScoped;
+  const uint8_t* pIn      = (const uint8_t*)pSrc;
+  const uint8_t* pInEnd   = pIn + size;
+  uint8_t* pOut           = (uint8_t*)pDst;
+  const uint8_t* pOutBase = pOut;
+  const uint8_t* pOutEnd  = pOut + dstSize;
+  while (pIn < pInEnd)
+  {
+    uint32_t token     = *pIn++;
+    size_t numLiterals = token >> 4;
+    if (numLiterals == 15 && !ReadLength(&pIn, pInEnd, &numLiterals))
+    {
+      return false;
+    }
+    if ((size_t)(pInEnd - pIn) < numLiterals || (size_t)(pOutEnd - pOut) < numLiterals)
+    {
+      return false;
+    }
+    memcpy(pOut, pIn, numLiterals);
+    pIn += numLiterals;
+    pOut += numLiterals;
+    if (pIn == pInEnd)
+    {
+      break; // Last sequence
+    }
+
+    if (pInEnd - pIn < 2)
+    {
+      return false;
+    }
+    size_t offset = pIn[0] | (pIn[1] << 8);
+    size_t length = token & 15;
+    pIn += 2;
+    if (length == 15 && !ReadLength(&pIn, pInEnd, &length))
+    {
+      return false;
+    }
+    length += MIN_MATCH;
+    if (offset == 0 || offset > (size_t)(pOut - pOutBase) || (size_t)(pOutEnd - pOut) < length)
+    {
+      return false;
+    }
+
+    // Overlapping matches repeat the last offset bytes
+    const uint8_t* pMatch = pOut - offset;
+    if (offset >= length)
+    {
+      memcpy(pOut, pMatch, length);
+      pOut += length;
+    }
+    else
+    {
+      for (size_t i = 0; i < length; i++)
+      {
+        *pOut++ = *pMatch++;
+      }
+    }
+  }
+  return pOut == pOutEnd;
+}
@@ -0,0 +1,32 @@
+// LZ - fast byte-oriented LZ77 compression
+// Should not use pre-compiled headers (for portability)
+//
+// The format follows the LZ4 block format: a sequence is a token byte (literal length in the high nibble,
+// match length - 4 in the low nibble, 15 means more length bytes follow), the literals, and a 2-byte
+// little-endian offset back into the output. The last sequence only has literals.
+// Matches are found through a single-entry hash table of 4-byte sequences and the search speeds up over
+// data that does not compress, so compression runs at hundreds of MB/s and decompression is bounded by memcpy.
+// Decompression checks every length and offset against both buffers, so corrupt input fails instead of
+// reading or writing out of bounds.
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace mj
+{
+  namespace lz
+  {
+    /// <summary>
+    /// Output capacity that is always enough to compress size bytes
+    /// </summary>
+    size_t GetMaxCompressedSize(size_t size);
+
+    /// <returns>Compressed size, 0 if the output does not fit in capacity</returns>
+    size_t Compress(const void* pSrc, size_t size, void* pDst, size_t capacity);
+
+    /// <param name="dstSize">Exact size of the decompressed data</param>
+    /// <returns>False if the input is corrupt or does not decompress to exactly dstSize bytes</returns>
+    bool Decompress(const void* pSrc, size_t size, void* pDst, size_t dstSize);
+  } // namespace lz
+} // namespace mj
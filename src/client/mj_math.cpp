@@ -171,7 +171,7 @@ float mjm::dot(const vec3& a, const vec3& b)
 float mjm::dot(const vec4& a, const vec4& b)
 {
   vec4 tmp(a * b);
-  return tmp.x + tmp.y + tmp.z;
+  return tmp.x + tmp.y + tmp.z + tmp.w;
 }
 
 mjm::vec3 mjm::cross(const vec3& x, const vec3& y)
@@ -533,4 +533,9 @@ mjm::vec3 mjm::sin(const vec3& v)
   using std::sin;
   return vec3(sin(v.x), sin(v.y), sin(v.z));
 }
+
+mjm::vec3 mjm::mix(const vec3& x, const vec3& y, float a)
+{
+  return x * (1.0f - a) + y * a;
+}
 #endif
@@ -1,4 +1,5 @@
 // Untemplated glm code to optimize compile time
+#include <stddef.h>
 #include <stdint.h>
 
 #pragma once
@@ -366,5 +367,7 @@ namespace mjm
   vec3 cos(const vec3& v);
   vec3 sin(const vec3& v);
 
+  vec3 mix(const vec3& x, const vec3& y, float a);
+
 } // namespace mjm
 #endif
@@ -0,0 +1,125 @@
+// Network - in-process packet transport
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_net.h"
+#include "mj_common.h"
+
+bool mj::net::PacketQueue::Init(uint32_t capacity)
+{
+  uint32_t size = 1;
+  while (size < capacity)
+  {
+    size <<= 1;
+  }
+
+  this->pSlots = (Slot*)malloc(size * sizeof(Slot));
+  if (!this->pSlots)
+  {
+    return false;
+  }
+
+  this->mask       = size - 1;
+  this->numSent    = 0;
+  this->bytesSent  = 0;
+  this->numDropped = 0;
+  this->head.store(0, std::memory_order_relaxed);
+  this->tail.store(0, std::memory_order_relaxed);
+  return true;
+}
+
+void mj::net::PacketQueue::Destroy()
+{
+  free(this->pSlots);
+  this->pSlots = nullptr;
+  this->mask   = 0;
+}
+
+bool mj::net::PacketQueue::Send(const void* pData, uint32_t size)
+{
+  uint32_t tail = this->tail.load(std::memory_order_relaxed);
+  if (!this->pSlots || size == 0 || size > MAX_PACKET_SIZE ||
+      tail - this->head.load(std::memory_order_acquire) > this->mask)
+  {
+    this->numDropped++;
+    return false;
+  }
+
+  Slot& slot = this->pSlots[tail & this->mask];
+  slot.size  = size;
+  memcpy(slot.data, pData, size);
+  this->tail.store(tail + 1, std::memory_order_release);
+
+  this->numSent++;
+  this->bytesSent += size;
+  return true;
+}
+
+uint32_t mj::net::PacketQueue::Receive(void* pBuffer)
+{
+  uint32_t head = this->head.load(std::memory_order_relaxed);
+  if (head == this->tail.load(std::memory_order_acquire))
+  {
+    return 0;
+  }
+
+  const Slot& slot = this->pSlots[head & this->mask];
+  uint32_t size    = slot.size;
+  memcpy(pBuffer, slot.data, size);
+  this->head.store(head + 1, std::memory_order_release);
+  return size;
+}
+
+bool mj::net::DelayQueue::Init(uint32_t capacity)
+{
+  uint32_t size = 1;
+  while (size < capacity)
+  {
+    size <<= 1;
+  }
+
+  this->pSlots = (Slot*)malloc(size * sizeof(Slot));
+  if (!this->pSlots)
+  {
+    return false;
+  }
+
+  this->mask = size - 1;
+  this->head = 0;
+  this->tail = 0;
+  return true;
+}
+
+void mj::net::DelayQueue::Destroy()
+{
+  free(this->pSlots);
+  this->pSlots = nullptr;
+  this->mask   = 0;
+}
+
+bool mj::net::DelayQueue::Push(const void* pData, uint32_t size, uint32_t releaseTime)
+{
+  if (!this->pSlots || size == 0 || size > MAX_PACKET_SIZE || this->tail - this->head > this->mask)
+  {
+    return false;
+  }
+
+  Slot& slot       = this->pSlots[this->tail & this->mask];
+  slot.size        = size;
+  slot.releaseTime = releaseTime;
+  memcpy(slot.data, pData, size);
+  this->tail++;
+  return true;
+}
+
+uint32_t mj::net::DelayQueue::Pop(uint32_t time, void* pBuffer)
+{
+  if (this->head == this->tail || (int32_t)(time - this->pSlots[this->head & this->mask].releaseTime) < 0)
+  {
+    return 0;
+  }
+
+  const Slot& slot = this->pSlots[this->head & this->mask];
+  memcpy(pBuffer, slot.data, slot.size);
+  this->head++;
+  return slot.size;
+}
@@ -0,0 +1,236 @@
+// Network - in-process packet transport
+// Should not use pre-compiled headers (for portability)
+//
+// Stand-in for a datagram socket: a connection is a pair of fixed-size packet queues, one per direction.
+// Packets are delivered whole and in order, or dropped when the queue is full, like UDP on a congested link.
+// Each queue has a single sender and a single receiver, which may be on different threads.
+//
+// BitWriter and BitReader pack fields of any width into the bytes of an mj::MemoryBuffer,
+// least significant bit first, for messages where whole bytes per field would waste bandwidth.
+
+#pragma once
+#include "mj_common.h"
+#include <atomic>
+
+namespace mj
+{
+  namespace net
+  {
+    static constexpr uint32_t MAX_PACKET_SIZE = 1200; // Fits in one Ethernet frame with IP and UDP headers
+
+    class PacketQueue
+    {
+    public:
+      /// <param name="capacity">Amount of packets in flight, rounded up to a power of two</param>
+      bool Init(uint32_t capacity);
+      void Destroy();
+
+      /// <returns>False if the packet is empty, too large or the queue is full. The packet is dropped.</returns>
+      bool Send(const void* pData, uint32_t size);
+
+      /// <param name="pBuffer">At least MAX_PACKET_SIZE bytes</param>
+      /// <returns>Size of the packet, or 0 if there is none</returns>
+      uint32_t Receive(void* pBuffer);
+
+      // Counters, only read them on the sending thread
+      uint64_t GetNumSent() const
+      {
+        return this->numSent;
+      }
+
+      uint64_t GetBytesSent() const
+      {
+        return this->bytesSent;
+      }
+
+      uint64_t GetNumDropped() const
+      {
+        return this->numDropped;
+      }
+
+    private:
+      struct Slot
+      {
+        uint32_t size;
+        uint8_t data[MAX_PACKET_SIZE];
+      };
+
+      Slot* pSlots        = nullptr;
+      uint32_t mask       = 0;
+      uint64_t numSent    = 0;
+      uint64_t bytesSent  = 0;
+      uint64_t numDropped = 0;
+      alignas(64) std::atomic<uint32_t> head{ 0 }; // Next slot to receive
+      alignas(64) std::atomic<uint32_t> tail{ 0 }; // Next slot to send into
+    };
+
+    /// <summary>
+    /// Both directions of a connection
+    /// </summary>
+    struct Loopback
+    {
+      PacketQueue toServer;
+      PacketQueue toClient;
+
+      bool Init(uint32_t capacity)
+      {
+        if (this->toServer.Init(capacity) && this->toClient.Init(capacity))
+        {
+          return true;
+        }
+        Destroy();
+        return false;
+      }
+
+      void Destroy()
+      {
+        this->toServer.Destroy();
+        this->toClient.Destroy();
+      }
+    };
+
+    /// <summary>
+    /// Holds packets back until a given time, to try out latency without a network. Single-threaded.
+    /// </summary>
+    class DelayQueue
+    {
+    public:
+      /// <param name="capacity">Amount of packets held, rounded up to a power of two</param>
+      bool Init(uint32_t capacity);
+      void Destroy();
+
+      /// <param name="releaseTime">In any unit. Packets leave in order, an earlier time waits for older ones.</param>
+      /// <returns>False if the packet is empty, too large or the queue is full. The packet is dropped.</returns>
+      bool Push(const void* pData, uint32_t size, uint32_t releaseTime);
+
+      /// <param name="pBuffer">At least MAX_PACKET_SIZE bytes</param>
+      /// <returns>Size of the oldest packet if its release time has come, or 0</returns>
+      uint32_t Pop(uint32_t time, void* pBuffer);
+
+    private:
+      struct Slot
+      {
+        uint32_t size;
+        uint32_t releaseTime;
+        uint8_t data[MAX_PACKET_SIZE];
+      };
+
+      Slot* pSlots  = nullptr;
+      uint32_t mask = 0;
+      uint32_t head = 0;
+      uint32_t tail = 0;
+    };
+
+    class BitWriter
+    {
+    public:
+      BitWriter(mj::MemoryBuffer& buffer) : buffer(buffer)
+      {
+      }
+
+      /// <param name="value">Must fit in numBits</param>
+      /// <param name="numBits">1 to 32</param>
+      void Write(uint32_t value, uint32_t numBits)
+      {
+        this->scratch |= (uint64_t)value << this->numScratchBits;
+        this->numScratchBits += numBits;
+        this->numBits += numBits;
+        if (this->numScratchBits >= 32)
+        {
+          uint32_t word = (uint32_t)this->scratch;
+          this->buffer.Write(word);
+          this->scratch >>= 32;
+          this->numScratchBits -= 32;
+        }
+      }
+
+      /// <summary>
+      /// Writes the bits that are still pending, padded to a whole byte
+      /// </summary>
+      void Flush()
+      {
+        while (this->numScratchBits > 0)
+        {
+          uint8_t byte = (uint8_t)this->scratch;
+          this->buffer.Write(byte);
+          this->scratch >>= 8;
+          this->numScratchBits = this->numScratchBits > 8 ? this->numScratchBits - 8 : 0;
+        }
+      }
+
+      /// <summary>
+      /// Bits written so far, including those not flushed yet
+      /// </summary>
+      uint32_t GetNumBits() const
+      {
+        return this->numBits;
+      }
+
+    private:
+      mj::MemoryBuffer& buffer;
+      uint64_t scratch        = 0;
+      uint32_t numScratchBits = 0;
+      uint32_t numBits        = 0;
+    };
+
+    class BitReader
+    {
+    public:
+      BitReader(mj::MemoryBuffer& buffer) : buffer(buffer)
+      {
+      }
+
+      /// <param name="numBits">1 to 32</param>
+      /// <returns>0 if the buffer has run out, see Good()</returns>
+      uint32_t Read(uint32_t numBits)
+      {
+        if (this->numScratchBits < numBits)
+        {
+          Refill();
+          if (this->numScratchBits < numBits)
+          {
+            this->good = false;
+            return 0;
+          }
+        }
+
+        uint32_t value = (uint32_t)(this->scratch & ((1ull << numBits) - 1));
+        this->scratch >>= numBits;
+        this->numScratchBits -= numBits;
+        return value;
+      }
+
+      bool Good() const
+      {
+        return this->good;
+      }
+
+    private:
+      void Refill()
+      {
+        if (this->buffer.SizeLeft() >= sizeof(uint32_t))
+        {
+          MJ_UNINITIALIZED uint32_t word;
+          this->buffer.Read(word);
+          this->scratch |= (uint64_t)word << this->numScratchBits;
+          this->numScratchBits += 32;
+        }
+        else
+        {
+          while (this->buffer.SizeLeft() > 0 && this->numScratchBits <= 56)
+          {
+            MJ_UNINITIALIZED uint8_t byte;
+            this->buffer.Read(byte);
+            this->scratch |= (uint64_t)byte << this->numScratchBits;
+            this->numScratchBits += 8;
+          }
+        }
+      }
+
+      mj::MemoryBuffer& buffer;
+      uint64_t scratch        = 0;
+      uint32_t numScratchBits = 0;
+      bool good               = true;
+    };
+  } // namespace net
+} // namespace mj
@@ -0,0 +1,343 @@
+// Pack - many assets in one memory-mapped file
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_pack.h"
+#include "mj_common.h"
+#include "mj_hash.h"
+#include "mj_lz.h"
+#include "mj_profiler.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static constexpr uint64_t FNV_OFFSET = 0xCBF29CE484222325ull;
+static constexpr uint64_t FNV_PRIME  = 0x100000001B3ull;
+
+// Including the .tmp suffix of the file that is written first
+static constexpr size_t MAX_PATH_LENGTH = 1024;
+
+static uint64_t AlignUp(uint64_t value)
+{
+  return (value + mj::pack::ALIGNMENT - 1) & ~(uint64_t)(mj::pack::ALIGNMENT - 1);
+}
+
+static uint32_t GetChecksum(const void* pData, size_t size)
+{
+  return (uint32_t)mj::Hash64(pData, size);
+}
+
+uint64_t mj::pack::HashName(const char* pName)
+{
+  // FNV-1a over the normalized name, so names of any length hash without a copy
+  uint64_t hash = FNV_OFFSET;
+  for (const char* pChar = pName; *pChar; pChar++)
+  {
+    char c = *pChar;
+    if (c == '\\')
+    {
+      c = '/';
+    }
+    else if (c >= 'A' && c <= 'Z')
+    {
+      c = (char)(c - 'A' + 'a');
+    }
+    hash = (hash ^ (uint8_t)c) * FNV_PRIME;
+  }
+  return hash;
+}
+
+/// <summary>
+/// Maps a whole file read-only
+/// </summary>
+/// <returns>nullptr if the file could not be mapped or is empty</returns>
+static const uint8_t* MapFile(const char* pPath, size_t* pSize)
+{
+#ifdef _WIN32
+  HANDLE file = CreateFileA(pPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    return nullptr;
+  }
+  const uint8_t* pData = nullptr;
+  LARGE_INTEGER size;
+  if (GetFileSizeEx(file, &size) && size.QuadPart > 0 && (uint64_t)size.QuadPart <= SIZE_MAX)
+  {
+    // The view keeps the mapping and the file open
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping)
+    {
+      pData = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(mapping);
+    }
+    *pSize = (size_t)size.QuadPart;
+  }
+  CloseHandle(file);
+  return pData;
+#else
+  int fd = open(pPath, O_RDONLY);
+  if (fd < 0)
+  {
+    return nullptr;
+  }
+  const uint8_t* pData = nullptr;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0)
+  {
+    // The mapping keeps the file open
+    void* pMapping = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (pMapping != MAP_FAILED)
+    {
+      pData  = (const uint8_t*)pMapping;
+      *pSize = (size_t)st.st_size;
+    }
+  }
+  close(fd);
+  return pData;
+#endif
+}
+
+static void UnmapFile(const uint8_t* pData, size_t size)
+{
+#ifdef _WIN32
+  (void)size;
+  UnmapViewOfFile(pData);
+#else
+  munmap((void*)pData, size);
+#endif
+}
+
+/// <returns>True if the header and the table describe this file</returns>
+static bool Validate(const uint8_t* pData, size_t size)
+{
+  if (size < sizeof(mj::pack::Header))
+  {
+    return false;
+  }
+  const mj::pack::Header* pHeader = (const mj::pack::Header*)pData;
+  if ((pHeader->magic != mj::pack::MAGIC) ||               //
+      (pHeader->version != mj::pack::VERSION) ||           //
+      (pHeader->alignment != mj::pack::ALIGNMENT) ||       //
+      (pHeader->fileSize != size) ||                       //
+      (pHeader->tableOffset % mj::pack::ALIGNMENT != 0) || //
+      (pHeader->tableOffset > size) ||                     //
+      ((size - pHeader->tableOffset) / sizeof(mj::pack::Entry) < pHeader->numEntries))
+  {
+    return false;
+  }
+
+  const mj::pack::Entry* pEntries = (const mj::pack::Entry*)(pData + pHeader->tableOffset);
+  for (uint32_t i = 0; i < pHeader->numEntries; i++)
+  {
+    const mj::pack::Entry& entry = pEntries[i];
+    bool sorted                  = (i == 0) || (pEntries[i - 1].nameHash < entry.nameHash);
+    bool inside                  = (entry.offset <= size) && (entry.size <= size - entry.offset);
+    bool sizes                   = (entry.flags & mj::pack::ENTRY_LZ) ? true : (entry.size == entry.rawSize);
+    if (!sorted || !inside || !sizes)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool mj::pack::Pack::Open(const char* pPath)
+{
+  ZoneScoped;
+  this->Close();
+
+  MJ_UNINITIALIZED size_t size;
+  const uint8_t* pData = MapFile(pPath, &size);
+  if (!pData)
+  {
+    return false;
+  }
+  if (!Validate(pData, size))
+  {
+    UnmapFile(pData, size);
+    return false;
+  }
+
+  const Header* pHeader = (const Header*)pData;
+  this->pBase           = pData;
+  this->fileSize        = size;
+  this->pEntries        = (const Entry*)(pData + pHeader->tableOffset);
+  this->numEntries      = pHeader->numEntries;
+  return true;
+}
+
+void mj::pack::Pack::Close()
+{
+  if (this->pBase)
+  {
+    UnmapFile(this->pBase, this->fileSize);
+  }
+  this->pBase      = nullptr;
+  this->fileSize   = 0;
+  this->pEntries   = nullptr;
+  this->numEntries = 0;
+}
+
+const mj::pack::Entry* mj::pack::Pack::Find(const char* pName) const
+{
+  return this->Find(HashName(pName));
+}
+
+const mj::pack::Entry* mj::pack::Pack::Find(uint64_t nameHash) const
+{
+  const Entry* pEnd   = this->pEntries + this->numEntries;
+  const Entry* pEntry = std::lower_bound(this->pEntries, pEnd, nameHash,
+                                         [](const Entry& entry, uint64_t hash) { return entry.nameHash < hash; });
+  return (pEntry != pEnd && pEntry->nameHash == nameHash) ? pEntry : nullptr;
+}
+
+bool mj::pack::Pack::Read(const Entry* pEntry, void* pDst) const
+{
+  ZoneScoped;
+  const void* pData = this->GetData(pEntry);
+  if (pEntry->flags & ENTRY_LZ)
+  {
+    return mj::lz::Decompress(pData, pEntry->size, pDst, pEntry->rawSize);
+  }
+  memcpy(pDst, pData, pEntry->size);
+  return true;
+}
+
+bool mj::pack::Pack::Verify(const Entry* pEntry) const
+{
+  ZoneScoped;
+  return GetChecksum(this->GetData(pEntry), pEntry->size) == pEntry->checksum;
+}
+
+bool mj::pack::Prepare(const char* pName, const void* pData, size_t size, bool compress, Input* pInput)
+{
+  ZoneScoped;
+  *pInput                = {};
+  pInput->pName          = pName;
+  pInput->entry.nameHash = HashName(pName);
+  if (size > UINT32_MAX)
+  {
+    return false;
+  }
+
+  pInput->pData         = pData;
+  pInput->entry.size    = (uint32_t)size;
+  pInput->entry.rawSize = (uint32_t)size;
+  if (compress && size > 0)
+  {
+    size_t capacity   = mj::lz::GetMaxCompressedSize(size);
+    void* pCompressed = malloc(capacity);
+    if (!pCompressed)
+    {
+      return false;
+    }
+    size_t compressedSize = mj::lz::Compress(pData, size, pCompressed, capacity);
+    if (compressedSize > 0 && compressedSize <= size - size / 8)
+    {
+      pInput->pData       = pCompressed;
+      pInput->pCompressed = pCompressed;
+      pInput->entry.size  = (uint32_t)compressedSize;
+      pInput->entry.flags = ENTRY_LZ;
+    }
+    else
+    {
+      free(pCompressed);
+    }
+  }
+  pInput->entry.checksum = GetChecksum(pInput->pData, pInput->entry.size);
+  return true;
+}
+
+void mj::pack::FreeInput(Input* pInput)
+{
+  free(pInput->pCompressed);
+  pInput->pCompressed = nullptr;
+}
+
+bool mj::pack::Write(const char* pPath, Input* pInputs, uint32_t numInputs, const char** ppCollision)
+{
+  ZoneScoped;
+  std::sort(pInputs, pInputs + numInputs,
+            [](const Input& a, const Input& b) { return a.entry.nameHash < b.entry.nameHash; });
+  for (uint32_t i = 1; i < numInputs; i++)
+  {
+    if (pInputs[i].entry.nameHash == pInputs[i - 1].entry.nameHash)
+    {
+      *ppCollision = pInputs[i].pName;
+      return false;
+    }
+  }
+
+  Header header      = {};
+  header.magic       = MAGIC;
+  header.version     = VERSION;
+  header.numEntries  = numInputs;
+  header.alignment   = ALIGNMENT;
+  header.tableOffset = AlignUp(sizeof(Header));
+  uint64_t offset    = AlignUp(header.tableOffset + (uint64_t)numInputs * sizeof(Entry));
+  for (uint32_t i = 0; i < numInputs; i++)
+  {
+    pInputs[i].entry.offset = offset;
+    offset                  = AlignUp(offset + pInputs[i].entry.size);
+  }
+  header.fileSize = offset;
+
+  // Replace the pack only once the new one is complete, so a failed cook keeps the previous pack
+  char tempPath[MAX_PATH_LENGTH];
+  int length = snprintf(tempPath, sizeof(tempPath), "%s.tmp", pPath);
+  if (length < 0 || length >= (int)sizeof(tempPath))
+  {
+    return false;
+  }
+  FILE* pFile = fopen(tempPath, "wb");
+  if (!pFile)
+  {
+    return false;
+  }
+
+  // Padding is written from a block of zeros, the table one entry at a time
+  static const uint8_t s_Zeros[ALIGNMENT] = {};
+  size_t padding                          = (size_t)(header.tableOffset - sizeof(Header));
+  bool written                            = (fwrite(&header, sizeof(header), 1, pFile) == 1) && //
+                 (fwrite(s_Zeros, 1, padding, pFile) == padding);
+  uint64_t position = header.tableOffset;
+  for (uint32_t i = 0; i < numInputs && written; i++)
+  {
+    written = fwrite(&pInputs[i].entry, sizeof(Entry), 1, pFile) == 1;
+    position += sizeof(Entry);
+  }
+  for (uint32_t i = 0; i < numInputs && written; i++)
+  {
+    const Entry& entry = pInputs[i].entry;
+    padding            = (size_t)(entry.offset - position);
+    written            = (fwrite(s_Zeros, 1, padding, pFile) == padding) && //
+              (fwrite(pInputs[i].pData, 1, entry.size, pFile) == entry.size);
+    position = entry.offset + entry.size;
+  }
+  padding = (size_t)(header.fileSize - position);
+  written = written && (fwrite(s_Zeros, 1, padding, pFile) == padding);
+  written = (fclose(pFile) == 0) && written;
+#ifdef _WIN32
+  written = written && MoveFileExA(tempPath, pPath, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+  written = written && (rename(tempPath, pPath) == 0);
+#endif
+  if (!written)
+  {
+    MJ_DISCARD(remove(tempPath));
+  }
+  return written;
+}
@@ -0,0 +1,152 @@
+// Pack - many assets in one memory-mapped file
+// Should not use pre-compiled headers (for portability)
+//
+// A pack starts with a Header, followed by the table of contents at ALIGNMENT bytes and then the data of
+// every entry, each at a multiple of ALIGNMENT. The table holds one Entry per asset, sorted by the hash of
+// its name, so a lookup is a binary search that never touches the data. Names are not stored; they are
+// hashed after lowercasing and turning backslashes into slashes, so "Textures\A.dds" finds
+// "textures/a.dds".
+//
+// Open() maps the whole file read-only and checks the header and the table once. Entries stored as they
+// are can then be used straight from the mapping (GetData()), without copies or file I/O. Entries with
+// ENTRY_LZ were compressed with mj_lz.h by the cooker because that saved at least an eighth of their size;
+// Read() decompresses them. Pages are loaded by the OS on first touch, so opening a pack costs about as
+// much as opening a single file however big it is.
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace mj
+{
+  namespace pack
+  {
+    static constexpr uint32_t MAGIC     = 0x4B504A4D; // MJPK
+    static constexpr uint32_t VERSION   = 1;
+    static constexpr uint32_t ALIGNMENT = 64; // Of the table and of the data of every entry
+
+    enum : uint32_t
+    {
+      ENTRY_LZ = 1 << 0, // Compressed with mj::lz::Compress
+    };
+
+    struct Header
+    {
+      uint32_t magic;
+      uint32_t version;
+      uint32_t numEntries;
+      uint32_t alignment;
+      uint64_t tableOffset;
+      uint64_t fileSize; // Catches truncated files
+    };
+
+    struct Entry
+    {
+      uint64_t nameHash; // HashName()
+      uint64_t offset;   // Of the data, from the start of the file
+      uint32_t size;     // Of the data in the file
+      uint32_t rawSize;  // Of the data after decompressing
+      uint32_t flags;    // ENTRY_* flags
+      uint32_t checksum; // Lowest 32 bits of Hash64() of the data in the file
+    };
+
+    static_assert(sizeof(Header) == 32, "Header is part of the file format");
+    static_assert(sizeof(Entry) == 32, "Entry is part of the file format");
+
+    /// <summary>
+    /// Hash of a name as stored in the table: case-insensitive, '\' and '/' are the same
+    /// </summary>
+    uint64_t HashName(const char* pName);
+
+    /// <summary>
+    /// A read-only view of a pack file. Lookups and reads are thread-safe while the pack is open.
+    /// </summary>
+    class Pack
+    {
+    public:
+      ~Pack()
+      {
+        this->Close();
+      }
+
+      /// <returns>False if the file could not be mapped or is not a valid pack</returns>
+      bool Open(const char* pPath);
+      void Close();
+
+      bool IsOpen() const
+      {
+        return this->pBase != nullptr;
+      }
+
+      /// <returns>nullptr if there is no entry with this name</returns>
+      const Entry* Find(const char* pName) const;
+      const Entry* Find(uint64_t nameHash) const;
+
+      /// <summary>
+      /// Data of an entry as it is in the file, valid until Close(). Compressed if the entry has ENTRY_LZ.
+      /// </summary>
+      const void* GetData(const Entry* pEntry) const
+      {
+        return this->pBase + pEntry->offset;
+      }
+
+      /// <summary>
+      /// Copies or decompresses an entry
+      /// </summary>
+      /// <param name="pDst">pEntry->rawSize bytes</param>
+      /// <returns>False if the data is corrupt</returns>
+      bool Read(const Entry* pEntry, void* pDst) const;
+
+      /// <returns>False if the data of the entry does not match its checksum. Touches every page of it.</returns>
+      bool Verify(const Entry* pEntry) const;
+
+      uint32_t GetNumEntries() const
+      {
+        return this->numEntries;
+      }
+
+      const Entry* GetEntries() const
+      {
+        return this->pEntries;
+      }
+
+      size_t GetFileSize() const
+      {
+        return this->fileSize;
+      }
+
+    private:
+      const uint8_t* pBase  = nullptr;
+      size_t fileSize       = 0;
+      const Entry* pEntries = nullptr;
+      uint32_t numEntries   = 0;
+    };
+
+    /// <summary>
+    /// An asset on its way into a pack
+    /// </summary>
+    struct Input
+    {
+      const char* pName;
+      Entry entry;       // Offset is set by Write()
+      const void* pData; // What is written: the asset or pCompressed
+      void* pCompressed; // Owned, freed by FreeInput()
+    };
+
+    /// <summary>
+    /// Fills in an input for an asset that stays valid until the pack is written. Thread-safe.
+    /// </summary>
+    /// <param name="compress">Compresses the asset if that saves at least an eighth of its size</param>
+    /// <returns>False if the asset is 4 GB or larger or memory ran out</returns>
+    bool Prepare(const char* pName, const void* pData, size_t size, bool compress, Input* pInput);
+    void FreeInput(Input* pInput);
+
+    /// <summary>
+    /// Sorts the inputs by name hash and writes the pack. The pack is written next to pPath first and then renamed,
+    /// so an existing pack stays intact if writing fails.
+    /// </summary>
+    /// <param name="ppCollision">Set to the name of an input whose name hash another input has</param>
+    /// <returns>False if two names have the same hash or the file could not be written</returns>
+    bool Write(const char* pPath, Input* pInputs, uint32_t numInputs, const char** ppCollision);
+  } // namespace pack
+} // namespace mj
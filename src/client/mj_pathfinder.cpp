@@ -0,0 +1,410 @@
+// Path finder - single-agent A* over the level grid, with optional Jump Point Search
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_pathfinder.h"
+#include "mj_profiler.h"
+
+static constexpr uint32_t CLOSED      = UINT32_MAX;
+static constexpr uint32_t NOT_IN_HEAP = UINT32_MAX - 1;
+static constexpr uint32_t NO_PARENT   = UINT32_MAX;
+
+static int32_t Sign(int32_t value)
+{
+  return (value > 0) - (value < 0);
+}
+
+static uint32_t Abs(int32_t value)
+{
+  return (uint32_t)(value < 0 ? -value : value);
+}
+
+/// <summary>
+/// Cost of the cheapest 8-directional path between two cells on an empty grid
+/// </summary>
+static uint32_t Octile(uint32_t dx, uint32_t dz)
+{
+  uint32_t diagonal = dx < dz ? dx : dz;
+  uint32_t straight = (dx > dz ? dx : dz) - diagonal;
+  return diagonal * mj::PathFinder::DIAGONAL_COST + straight * mj::PathFinder::ORTHOGONAL_COST;
+}
+
+bool mj::PathFinder::Init(uint32_t width, uint32_t height)
+{
+  size_t numCells = (size_t)width * height;
+  this->pNodes    = (Node*)calloc(numCells, sizeof(Node));
+  this->pHeap     = (HeapEntry*)malloc(numCells * sizeof(HeapEntry));
+  this->pPath     = (BlockPos*)malloc(numCells * sizeof(BlockPos));
+  if (!this->pNodes || !this->pHeap || !this->pPath)
+  {
+    Destroy();
+    return false;
+  }
+
+  this->width    = width;
+  this->height   = height;
+  this->searchId = 0;
+  return true;
+}
+
+void mj::PathFinder::Destroy()
+{
+  free(this->pNodes);
+  free(this->pHeap);
+  free(this->pPath);
+  this->pNodes = nullptr;
+  this->pHeap  = nullptr;
+  this->pPath  = nullptr;
+  this->width  = 0;
+  this->height = 0;
+}
+
+uint32_t mj::PathFinder::Heuristic(int32_t x, int32_t z) const
+{
+  return Octile(Abs(x - this->goalX), Abs(z - this->goalZ));
+}
+
+void mj::PathFinder::SiftUp(uint32_t index)
+{
+  HeapEntry entry = this->pHeap[index];
+  while (index > 0)
+  {
+    uint32_t parent        = (index - 1) / 2;
+    const HeapEntry& above = this->pHeap[parent];
+    if (above.f < entry.f || (above.f == entry.f && above.h <= entry.h))
+    {
+      break;
+    }
+    this->pHeap[index]                 = above;
+    this->pNodes[above.cell].heapIndex = index;
+    index                              = parent;
+  }
+  this->pHeap[index]                 = entry;
+  this->pNodes[entry.cell].heapIndex = index;
+}
+
+void mj::PathFinder::SiftDown(uint32_t index)
+{
+  HeapEntry entry = this->pHeap[index];
+  for (;;)
+  {
+    uint32_t child = 2 * index + 1;
+    if (child >= this->heapSize)
+    {
+      break;
+    }
+    if (child + 1 < this->heapSize)
+    {
+      const HeapEntry& left  = this->pHeap[child];
+      const HeapEntry& right = this->pHeap[child + 1];
+      if (right.f < left.f || (right.f == left.f && right.h < left.h))
+      {
+        child++;
+      }
+    }
+    const HeapEntry& below = this->pHeap[child];
+    if (entry.f < below.f || (entry.f == below.f && entry.h <= below.h))
+    {
+      break;
+    }
+    this->pHeap[index]                 = below;
+    this->pNodes[below.cell].heapIndex = index;
+    index                              = child;
+  }
+  this->pHeap[index]                 = entry;
+  this->pNodes[entry.cell].heapIndex = index;
+}
+
+uint32_t mj::PathFinder::PopMin()
+{
+  uint32_t cell                = this->pHeap[0].cell;
+  this->pNodes[cell].heapIndex = CLOSED;
+  if (--this->heapSize > 0)
+  {
+    this->pHeap[0] = this->pHeap[this->heapSize];
+    SiftDown(0);
+  }
+  return cell;
+}
+
+/// <summary>
+/// Adds a cell to the open list, or lowers its cost if it is already there
+/// </summary>
+void mj::PathFinder::Open(uint32_t cell, uint32_t parent, uint32_t g, uint32_t h)
+{
+  Node& node = this->pNodes[cell];
+  if (node.searchId != this->searchId)
+  {
+    node.searchId  = this->searchId;
+    node.g         = UINT32_MAX;
+    node.heapIndex = NOT_IN_HEAP;
+  }
+
+  // The heuristic is consistent, so closed cells already have their final cost
+  if (node.heapIndex == CLOSED || g >= node.g)
+  {
+    return;
+  }
+
+  node.g      = g;
+  node.parent = parent;
+  if (node.heapIndex == NOT_IN_HEAP)
+  {
+    node.heapIndex              = this->heapSize++;
+    this->pHeap[node.heapIndex] = HeapEntry{ g + h, h, cell };
+  }
+  else
+  {
+    this->pHeap[node.heapIndex].f = g + h;
+  }
+  SiftUp(node.heapIndex);
+}
+
+void mj::PathFinder::ExpandAStar(const Grid& grid, uint32_t cell)
+{
+  int32_t x     = (int32_t)(cell % this->width);
+  int32_t z     = (int32_t)(cell / this->width);
+  uint32_t g    = this->pNodes[cell].g;
+  uint32_t mask = grid.GetStepMask(x, z);
+  for (uint32_t i = 0; i < 8; i++)
+  {
+    if (mask & (1 << i))
+    {
+      int32_t nx = x + NEIGHBOR_DX[i];
+      int32_t nz = z + NEIGHBOR_DZ[i];
+      Open(nz * this->width + nx, cell, g + ((i & 1) ? DIAGONAL_COST : ORTHOGONAL_COST), Heuristic(nx, nz));
+    }
+  }
+}
+
+/// <summary>
+/// Walks in a straight line until it hits a wall (no jump point), the goal,
+/// or a cell with a forced neighbor: a side cell that is open while the cell behind it was closed.
+/// </summary>
+bool mj::PathFinder::JumpStraight(const Grid& grid, int32_t x, int32_t z, int32_t dx, int32_t dz, int32_t* pJumpX,
+                                  int32_t* pJumpZ) const
+{
+  for (;;)
+  {
+    x += dx;
+    z += dz;
+    if (grid.IsSolid(x, z))
+    {
+      return false;
+    }
+    if ((x == this->goalX && z == this->goalZ) ||
+        ((dx != 0) && ((!grid.IsSolid(x, z - 1) && grid.IsSolid(x - dx, z - 1)) ||
+                       (!grid.IsSolid(x, z + 1) && grid.IsSolid(x - dx, z + 1)))) ||
+        ((dz != 0) && ((!grid.IsSolid(x - 1, z) && grid.IsSolid(x - 1, z - dz)) ||
+                       (!grid.IsSolid(x + 1, z) && grid.IsSolid(x + 1, z - dz)))))
+    {
+      *pJumpX = x;
+      *pJumpZ = z;
+      return true;
+    }
+  }
+}
+
+/// <summary>
+/// Diagonal jumps stop at cells from which a straight jump finds a jump point
+/// </summary>
+bool mj::PathFinder::Jump(const Grid& grid, int32_t x, int32_t z, int32_t dx, int32_t dz, int32_t* pJumpX,
+                          int32_t* pJumpZ) const
+{
+  if (dx == 0 || dz == 0)
+  {
+    return JumpStraight(grid, x, z, dx, dz, pJumpX, pJumpZ);
+  }
+
+  MJ_UNINITIALIZED int32_t ignoreX, ignoreZ;
+  for (;;)
+  {
+    if (grid.IsSolid(x + dx, z + dz) || grid.IsSolid(x + dx, z) || grid.IsSolid(x, z + dz))
+    {
+      return false;
+    }
+    x += dx;
+    z += dz;
+    if ((x == this->goalX && z == this->goalZ) ||              //
+        JumpStraight(grid, x, z, dx, 0, &ignoreX, &ignoreZ) || //
+        JumpStraight(grid, x, z, 0, dz, &ignoreX, &ignoreZ))
+    {
+      *pJumpX = x;
+      *pJumpZ = z;
+      return true;
+    }
+  }
+}
+
+void mj::PathFinder::ExpandJumpPoint(const Grid& grid, uint32_t cell)
+{
+  int32_t x       = (int32_t)(cell % this->width);
+  int32_t z       = (int32_t)(cell / this->width);
+  uint32_t g      = this->pNodes[cell].g;
+  uint32_t parent = this->pNodes[cell].parent;
+
+  // Directions worth searching, pruned by the direction we arrived from
+  MJ_UNINITIALIZED int32_t directions[8][2];
+  uint32_t numDirections = 0;
+  auto add               = [&](int32_t dx, int32_t dz) {
+    directions[numDirections][0] = dx;
+    directions[numDirections][1] = dz;
+    numDirections++;
+  };
+
+  if (parent == NO_PARENT)
+  {
+    uint32_t mask = grid.GetStepMask(x, z);
+    for (uint32_t i = 0; i < 8; i++)
+    {
+      if (mask & (1 << i))
+      {
+        add(NEIGHBOR_DX[i], NEIGHBOR_DZ[i]);
+      }
+    }
+  }
+  else
+  {
+    int32_t dx = Sign(x - (int32_t)(parent % this->width));
+    int32_t dz = Sign(z - (int32_t)(parent / this->width));
+    if (dx != 0 && dz != 0)
+    {
+      bool freeX = !grid.IsSolid(x + dx, z);
+      bool freeZ = !grid.IsSolid(x, z + dz);
+      if (freeZ)
+      {
+        add(0, dz);
+      }
+      if (freeX)
+      {
+        add(dx, 0);
+      }
+      if (freeX && freeZ)
+      {
+        add(dx, dz);
+      }
+    }
+    else if (dx != 0)
+    {
+      bool freeNext = !grid.IsSolid(x + dx, z);
+      bool freeUp   = !grid.IsSolid(x, z + 1);
+      bool freeDown = !grid.IsSolid(x, z - 1);
+      if (freeNext)
+      {
+        add(dx, 0);
+        if (freeUp)
+        {
+          add(dx, 1);
+        }
+        if (freeDown)
+        {
+          add(dx, -1);
+        }
+      }
+      if (freeUp)
+      {
+        add(0, 1);
+      }
+      if (freeDown)
+      {
+        add(0, -1);
+      }
+    }
+    else
+    {
+      bool freeNext  = !grid.IsSolid(x, z + dz);
+      bool freeRight = !grid.IsSolid(x + 1, z);
+      bool freeLeft  = !grid.IsSolid(x - 1, z);
+      if (freeNext)
+      {
+        add(0, dz);
+        if (freeRight)
+        {
+          add(1, dz);
+        }
+        if (freeLeft)
+        {
+          add(-1, dz);
+        }
+      }
+      if (freeRight)
+      {
+        add(1, 0);
+      }
+      if (freeLeft)
+      {
+        add(-1, 0);
+      }
+    }
+  }
+
+  for (uint32_t i = 0; i < numDirections; i++)
+  {
+    MJ_UNINITIALIZED int32_t jumpX, jumpZ;
+    if (Jump(grid, x, z, directions[i][0], directions[i][1], &jumpX, &jumpZ))
+    {
+      uint32_t distance = Octile(Abs(jumpX - x), Abs(jumpZ - z));
+      Open(jumpZ * this->width + jumpX, cell, g + distance, Heuristic(jumpX, jumpZ));
+    }
+  }
+}
+
+bool mj::PathFinder::FindPath(const Grid& grid, BlockPos start, BlockPos goal, Method method)
+{
+  ZoneScoped;
+  assert(grid.width == this->width && grid.height == this->height);
+  this->pathLength  = 0;
+  this->cost        = 0;
+  this->numExpanded = 0;
+  if (grid.IsSolid(start.x, start.z) || grid.IsSolid(goal.x, goal.z))
+  {
+    return false;
+  }
+
+  // Invalidate all nodes at once
+  if (++this->searchId == 0)
+  {
+    for (size_t i = 0; i < (size_t)this->width * this->height; i++)
+    {
+      this->pNodes[i].searchId = 0;
+    }
+    this->searchId = 1;
+  }
+
+  this->goalX       = goal.x;
+  this->goalZ       = goal.z;
+  this->heapSize    = 0;
+  uint32_t goalCell = goal.z * this->width + goal.x;
+  Open(start.z * this->width + start.x, NO_PARENT, 0, Heuristic(start.x, start.z));
+
+  while (this->heapSize > 0)
+  {
+    uint32_t cell = PopMin();
+    this->numExpanded++;
+    if (cell == goalCell)
+    {
+      this->cost = this->pNodes[cell].g;
+
+      // Walk back to the start, then reverse
+      for (uint32_t c = cell; c != NO_PARENT; c = this->pNodes[c].parent)
+      {
+        this->pPath[this->pathLength++] = BlockPos{ (int32_t)(c % this->width), (int32_t)(c / this->width) };
+      }
+      for (uint32_t i = 0; i < this->pathLength / 2; i++)
+      {
+        mj::swap(this->pPath[i], this->pPath[this->pathLength - 1 - i]);
+      }
+      return true;
+    }
+
+    if (method == Method::JumpPoint)
+    {
+      ExpandJumpPoint(grid, cell);
+    }
+    else
+    {
+      ExpandAStar(grid, cell);
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,109 @@
+// Path finder - single-agent A* over the level grid, with optional Jump Point Search
+// Should not use pre-compiled headers (for portability)
+//
+// Moves in 8 directions without cutting corners (see Grid::GetStepMask).
+// All memory is allocated in Init and reused by every query: per-cell node state is
+// invalidated by bumping a search id instead of clearing, and the open list is an indexed
+// binary heap with one slot per cell.
+//
+// Jump Point Search only pushes cells where the optimal path can change direction,
+// so the resulting path is a list of jump points connected by straight or diagonal lines.
+// Plain A* returns every cell on the path.
+
+#pragma once
+#include "mj_grid.h"
+
+namespace mj
+{
+  class PathFinder
+  {
+  public:
+    enum class Method
+    {
+      AStar,
+      JumpPoint,
+    };
+
+    static constexpr uint32_t ORTHOGONAL_COST = 1000;
+    static constexpr uint32_t DIAGONAL_COST   = 1414;
+
+    bool Init(uint32_t width, uint32_t height);
+    void Destroy();
+
+    /// <summary>
+    /// Finds the shortest path from start to goal. The path is stored in this object until the next query.
+    /// </summary>
+    /// <returns>False if either cell is solid or the goal cannot be reached</returns>
+    bool FindPath(const Grid& grid, BlockPos start, BlockPos goal, Method method = Method::JumpPoint);
+
+    /// <summary>
+    /// Waypoints from start to goal, both included
+    /// </summary>
+    const BlockPos* GetPath() const
+    {
+      return this->pPath;
+    }
+
+    uint32_t GetPathLength() const
+    {
+      return this->pathLength;
+    }
+
+    /// <summary>
+    /// Cost of the last path, in ORTHOGONAL_COST per cell
+    /// </summary>
+    uint32_t GetCost() const
+    {
+      return this->cost;
+    }
+
+    /// <summary>
+    /// Cells taken from the open list during the last query
+    /// </summary>
+    uint32_t GetNumExpanded() const
+    {
+      return this->numExpanded;
+    }
+
+  private:
+    struct Node
+    {
+      uint32_t g;
+      uint32_t parent;
+      uint32_t heapIndex; // CLOSED once expanded
+      uint32_t searchId;  // Node is stale if this differs from the current search
+    };
+
+    struct HeapEntry
+    {
+      uint32_t f;
+      uint32_t h;
+      uint32_t cell;
+    };
+
+    void Open(uint32_t cell, uint32_t parent, uint32_t g, uint32_t h);
+    uint32_t PopMin();
+    void SiftUp(uint32_t index);
+    void SiftDown(uint32_t index);
+
+    void ExpandAStar(const Grid& grid, uint32_t cell);
+    void ExpandJumpPoint(const Grid& grid, uint32_t cell);
+    bool Jump(const Grid& grid, int32_t x, int32_t z, int32_t dx, int32_t dz, int32_t* pJumpX, int32_t* pJumpZ) const;
+    bool JumpStraight(const Grid& grid, int32_t x, int32_t z, int32_t dx, int32_t dz, int32_t* pJumpX,
+                      int32_t* pJumpZ) const;
+    uint32_t Heuristic(int32_t x, int32_t z) const;
+
+    uint32_t width       = 0;
+    uint32_t height      = 0;
+    Node* pNodes         = nullptr;
+    HeapEntry* pHeap     = nullptr;
+    BlockPos* pPath      = nullptr;
+    uint32_t heapSize    = 0;
+    uint32_t searchId    = 0;
+    uint32_t pathLength  = 0;
+    uint32_t cost        = 0;
+    uint32_t numExpanded = 0;
+    int32_t goalX        = 0;
+    int32_t goalZ        = 0;
+  };
+} // namespace mj
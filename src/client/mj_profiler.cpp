@@ -0,0 +1,239 @@
+// Profiler - scoped CPU zones with Chrome trace export
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_profiler.h"
+
+#ifdef MJ_PROFILER_ENABLED
+#include "mj_common.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+
+// Must be a power of two
+static constexpr uint64_t EVENTS_PER_THREAD = 1 << 16;
+static constexpr uint64_t EVENT_MASK        = EVENTS_PER_THREAD - 1;
+
+// When a buffer has wrapped, skip this many of the oldest events, as they are likely overwritten during the dump
+static constexpr uint64_t WRAP_MARGIN = 1024;
+
+enum class EventType : uint32_t
+{
+  Zone,
+  Frame,
+  Plot,
+};
+
+struct Event
+{
+  const char* pName;
+  uint64_t timestamp; // Nanoseconds
+  union {
+    uint64_t duration; // Nanoseconds
+    double value;
+  };
+  EventType type;
+};
+
+/// <summary>
+/// Written only by its owning thread. Never freed, so events of exited threads can still be dumped.
+/// </summary>
+struct ThreadBuffer
+{
+  Event events[EVENTS_PER_THREAD];
+  std::atomic<uint64_t> numWritten;
+  uint32_t threadId;
+  char name[32];
+  ThreadBuffer* pNext;
+};
+
+// WARNING: global variables
+static std::atomic<ThreadBuffer*> s_pThreads;
+static std::atomic<uint32_t> s_NumThreads;
+static thread_local ThreadBuffer* s_pThreadBuffer;
+
+static uint64_t Now()
+{
+  using namespace std::chrono;
+  return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static ThreadBuffer* GetThreadBuffer()
+{
+  if (!s_pThreadBuffer)
+  {
+    ThreadBuffer* pBuffer = (ThreadBuffer*)malloc(sizeof(ThreadBuffer));
+    if (!pBuffer)
+    {
+      return nullptr;
+    }
+    new (&pBuffer->numWritten) std::atomic<uint64_t>(0);
+    pBuffer->threadId = s_NumThreads.fetch_add(1, std::memory_order_relaxed);
+    snprintf(pBuffer->name, sizeof(pBuffer->name), "Thread %u", pBuffer->threadId);
+
+    // Lock-free push onto the thread list
+    pBuffer->pNext = s_pThreads.load(std::memory_order_relaxed);
+    while (!s_pThreads.compare_exchange_weak(pBuffer->pNext, pBuffer, std::memory_order_release,
+                                             std::memory_order_relaxed))
+    {
+    }
+    s_pThreadBuffer = pBuffer;
+  }
+  return s_pThreadBuffer;
+}
+
+static Event* BeginWrite(ThreadBuffer* pBuffer)
+{
+  return &pBuffer->events[pBuffer->numWritten.load(std::memory_order_relaxed) & EVENT_MASK];
+}
+
+static void EndWrite(ThreadBuffer* pBuffer)
+{
+  pBuffer->numWritten.fetch_add(1, std::memory_order_release);
+}
+
+mj::profiler::Zone::Zone(const char* pName) : pName(pName), begin(Now())
+{
+}
+
+mj::profiler::Zone::~Zone()
+{
+  uint64_t end          = Now();
+  ThreadBuffer* pBuffer = GetThreadBuffer();
+  if (pBuffer)
+  {
+    Event* pEvent     = BeginWrite(pBuffer);
+    pEvent->pName     = this->pName;
+    pEvent->timestamp = this->begin;
+    pEvent->duration  = end - this->begin;
+    pEvent->type      = EventType::Zone;
+    EndWrite(pBuffer);
+  }
+}
+
+void mj::profiler::SetThreadName(const char* pName)
+{
+  ThreadBuffer* pBuffer = GetThreadBuffer();
+  if (pBuffer)
+  {
+    snprintf(pBuffer->name, sizeof(pBuffer->name), "%s", pName);
+  }
+}
+
+void mj::profiler::Frame(const char* pName)
+{
+  ThreadBuffer* pBuffer = GetThreadBuffer();
+  if (pBuffer)
+  {
+    Event* pEvent     = BeginWrite(pBuffer);
+    pEvent->pName     = pName;
+    pEvent->timestamp = Now();
+    pEvent->duration  = 0;
+    pEvent->type      = EventType::Frame;
+    EndWrite(pBuffer);
+  }
+}
+
+void mj::profiler::Plot(const char* pName, double value)
+{
+  ThreadBuffer* pBuffer = GetThreadBuffer();
+  if (pBuffer)
+  {
+    Event* pEvent     = BeginWrite(pBuffer);
+    pEvent->pName     = pName;
+    pEvent->timestamp = Now();
+    pEvent->value     = value;
+    pEvent->type      = EventType::Plot;
+    EndWrite(pBuffer);
+  }
+}
+
+/// <summary>
+/// Writes a JSON string, escaping the characters that would break the document
+/// </summary>
+static void WriteString(FILE* pFile, const char* pString)
+{
+  fputc('"', pFile);
+  for (const char* pChar = pString; *pChar; pChar++)
+  {
+    if (*pChar == '"' || *pChar == '\\')
+    {
+      fputc('\\', pFile);
+    }
+    if ((unsigned char)*pChar >= 0x20)
+    {
+      fputc(*pChar, pFile);
+    }
+  }
+  fputc('"', pFile);
+}
+
+bool mj::profiler::WriteChromeTrace(const char* pPath)
+{
+  ZoneScoped;
+
+  FILE* pFile = fopen(pPath, "wb");
+  if (!pFile)
+  {
+    return false;
+  }
+
+  fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", pFile);
+  bool first = true;
+  for (ThreadBuffer* pBuffer = s_pThreads.load(std::memory_order_acquire); pBuffer; pBuffer = pBuffer->pNext)
+  {
+    fprintf(pFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":",
+            first ? "" : ",\n", pBuffer->threadId);
+    WriteString(pFile, pBuffer->name);
+    fputs("}}", pFile);
+    first = false;
+
+    uint64_t end   = pBuffer->numWritten.load(std::memory_order_acquire);
+    uint64_t begin = 0;
+    if (end > EVENTS_PER_THREAD)
+    {
+      begin = end - EVENTS_PER_THREAD + WRAP_MARGIN;
+    }
+
+    for (uint64_t i = begin; i < end; i++)
+    {
+      // The owning thread keeps recording: copy the event, then check that its slot was not reused meanwhile.
+      // Slot i is rewritten once event i + EVENTS_PER_THREAD is being written, which may have torn the copy.
+      Event event = pBuffer->events[i & EVENT_MASK];
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (pBuffer->numWritten.load(std::memory_order_relaxed) >= i + EVENTS_PER_THREAD)
+      {
+        continue;
+      }
+
+      // JSON has no representation for nan or inf
+      if (event.type == EventType::Plot && !isfinite(event.value))
+      {
+        continue;
+      }
+
+      fputs(",\n{\"name\":", pFile);
+      WriteString(pFile, event.pName);
+      switch (event.type)
+      {
+      case EventType::Zone:
+        fprintf(pFile, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f", event.timestamp / 1000.0, event.duration / 1000.0);
+        break;
+      case EventType::Frame:
+        fprintf(pFile, ",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f", event.timestamp / 1000.0);
+        break;
+      case EventType::Plot:
+        fprintf(pFile, ",\"ph\":\"C\",\"ts\":%.3f,\"args\":{\"value\":%g}", event.timestamp / 1000.0, event.value);
+        break;
+      }
+      fprintf(pFile, ",\"pid\":0,\"tid\":%u}", pBuffer->threadId);
+    }
+  }
+  fputs("\n]}\n", pFile);
+
+  bool ok = (ferror(pFile) == 0);
+  fclose(pFile);
+  return ok;
+}
+#endif // MJ_PROFILER_ENABLED
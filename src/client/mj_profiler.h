@@ -0,0 +1,81 @@
+// Profiler - scoped CPU zones with Chrome trace export
+// Should not use pre-compiled headers (for portability)
+//
+// Include this instead of Tracy.hpp. The zone macros map to:
+// - Tracy, when TRACY_ENABLE is defined
+// - The built-in profiler, when only MJ_PROFILE is defined
+// - Nothing otherwise
+//
+// The built-in profiler records zones into a ring buffer per thread without locking.
+// WriteChromeTrace dumps the buffers as JSON for chrome://tracing or https://ui.perfetto.dev
+
+#pragma once
+
+#if defined(TRACY_ENABLE)
+#include "../../3rdparty/tracy/Tracy.hpp"
+#elif defined(MJ_PROFILE)
+#define MJ_PROFILER_ENABLED
+#endif
+
+#ifdef MJ_PROFILER_ENABLED
+#include <stdint.h>
+
+namespace mj
+{
+  namespace profiler
+  {
+    /// <summary>
+    /// Records its lifetime as a zone on the calling thread.
+    /// </summary>
+    class Zone
+    {
+    public:
+      Zone(const char* pName);
+      ~Zone();
+
+    private:
+      const char* pName;
+      uint64_t begin;
+    };
+
+    /// <summary>
+    /// Names the calling thread in the trace. The string is copied.
+    /// </summary>
+    void SetThreadName(const char* pName);
+
+    /// <param name="pName">Must be a string literal or otherwise outlive the profiler</param>
+    void Frame(const char* pName);
+
+    /// <param name="pName">Must be a string literal or otherwise outlive the profiler</param>
+    void Plot(const char* pName, double value);
+
+    /// <summary>
+    /// Writes the recorded events of all threads as Chrome trace JSON.
+    /// Threads may keep recording while this runs, their oldest events can be torn.
+    /// </summary>
+    /// <returns>False if the file could not be written</returns>
+    bool WriteChromeTrace(const char* pPath);
+  } // namespace profiler
+} // namespace mj
+
+#define MJ_PROFILER_CONCAT_(a, b) a##b
+#define MJ_PROFILER_CONCAT(a, b)  MJ_PROFILER_CONCAT_(a, b)
+#define MJ_PROFILER_ZONE(name)    mj::profiler::Zone MJ_PROFILER_CONCAT(mj_ProfilerZone, __LINE__)(name)
+
+// Colors are a Tracy feature and are dropped
+#define ZoneScoped                MJ_PROFILER_ZONE(__FUNCTION__)
+#define ZoneScopedN(name)         MJ_PROFILER_ZONE(name)
+#define ZoneScopedC(color)        MJ_PROFILER_ZONE(__FUNCTION__)
+#define ZoneScopedNC(name, color) MJ_PROFILER_ZONE(name)
+#define FrameMark                 mj::profiler::Frame("Frame")
+#define FrameMarkNamed(name)      mj::profiler::Frame(name)
+#define TracyPlot(name, value)    mj::profiler::Plot(name, (double)(value))
+#elif !defined(TRACY_ENABLE)
+#define ZoneScoped
+#define ZoneScopedN(name)
+#define ZoneScopedC(color)
+#define ZoneScopedNC(name, color)
+#define FrameMark
+#define FrameMarkNamed(name)
+#define TracyPlot(name, value)
+#endif
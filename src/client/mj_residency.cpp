@@ -0,0 +1,184 @@
+// Residency - an LRU cache of texture array layers in the fewer slots of a texture array on the GPU
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_residency.h"
+#include "mj_common.h"
+
+#include <string.h>
+
+bool mj::LayerCache::Init(uint32_t numLayers, uint32_t numSlots)
+{
+  this->head      = NONE;
+  this->tail      = NONE;
+  this->numQueued = 0;
+  this->frame     = 1; // referenced[] starts at 0, never
+  this->stats     = {};
+  for (uint32_t i = 0; i < MAX_LAYERS; i++)
+  {
+    this->slots[i]      = FALLBACK_SLOT;
+    this->referenced[i] = 0;
+    this->queued[i]     = false;
+  }
+
+  bool valid      = (numLayers <= MAX_LAYERS) && (numSlots >= 2) && (numSlots <= MAX_SLOTS);
+  this->numLayers = valid ? numLayers : 0;
+  this->numSlots  = valid ? numSlots : 0;
+
+  // Free slots go at the end of the list, so they are taken before anything is evicted
+  this->layers[FALLBACK_SLOT] = NONE;
+  for (uint32_t slot = 1; slot < this->numSlots; slot++)
+  {
+    this->layers[slot] = NONE;
+    this->PushFront(slot);
+  }
+  this->stats.numSlots = valid ? numSlots - 1 : 0;
+  return valid;
+}
+
+void mj::LayerCache::NewFrame()
+{
+  this->frame++;
+}
+
+void mj::LayerCache::Unlink(uint32_t slot)
+{
+  uint16_t before = this->prev[slot];
+  uint16_t after  = this->next[slot];
+  if (before != NONE)
+  {
+    this->next[before] = after;
+  }
+  else
+  {
+    this->head = after;
+  }
+  if (after != NONE)
+  {
+    this->prev[after] = before;
+  }
+  else
+  {
+    this->tail = before;
+  }
+}
+
+void mj::LayerCache::PushFront(uint32_t slot)
+{
+  this->prev[slot] = NONE;
+  this->next[slot] = this->head;
+  if (this->head != NONE)
+  {
+    this->prev[this->head] = (uint16_t)slot;
+  }
+  else
+  {
+    this->tail = (uint16_t)slot;
+  }
+  this->head = (uint16_t)slot;
+}
+
+uint32_t mj::LayerCache::Reference(uint32_t layer)
+{
+  if (layer >= this->numLayers)
+  {
+    return FALLBACK_SLOT;
+  }
+
+  uint32_t slot = this->slots[layer];
+  if (this->referenced[layer] == this->frame)
+  {
+    return slot; // Counted already
+  }
+  this->referenced[layer] = this->frame;
+
+  if (slot != FALLBACK_SLOT)
+  {
+    this->stats.numHits++;
+    if (this->head != slot)
+    {
+      this->Unlink(slot);
+      this->PushFront(slot);
+    }
+    return slot;
+  }
+
+  this->stats.numMisses++;
+  if (!this->queued[layer])
+  {
+    this->queued[layer]            = true;
+    this->queue[this->numQueued++] = (uint16_t)layer;
+  }
+  return FALLBACK_SLOT;
+}
+
+void mj::LayerCache::Reference(const LayerSet& layers)
+{
+  for (uint32_t i = 0; i < MJ_COUNTOF(layers.bits); i++)
+  {
+    // Layers in ascending order, one bit at a time
+    for (uint64_t bits = layers.bits[i]; bits != 0; bits &= bits - 1)
+    {
+      uint32_t bit = 0;
+      while (!(bits & ((uint64_t)1 << bit)))
+      {
+        bit++;
+      }
+      MJ_DISCARD(this->Reference(i * 64 + bit));
+    }
+  }
+}
+
+uint32_t mj::LayerCache::TakeRequests(uint32_t* pLayers, uint32_t capacity)
+{
+  uint32_t numTaken = this->numQueued < capacity ? this->numQueued : capacity;
+  for (uint32_t i = 0; i < numTaken; i++)
+  {
+    pLayers[i]                   = this->queue[i];
+    this->queued[this->queue[i]] = false;
+  }
+  this->numQueued -= numTaken;
+  memmove(this->queue, this->queue + numTaken, this->numQueued * sizeof(this->queue[0]));
+  return numTaken;
+}
+
+uint32_t mj::LayerCache::Insert(uint32_t layer)
+{
+  if (layer >= this->numLayers || this->referenced[layer] != this->frame)
+  {
+    return FALLBACK_SLOT; // No longer drawn; it is queued again when it is
+  }
+  if (this->slots[layer] != FALLBACK_SLOT)
+  {
+    return this->slots[layer];
+  }
+
+  uint32_t slot    = this->tail;
+  uint16_t evicted = this->layers[slot];
+  if (evicted != NONE)
+  {
+    if (this->referenced[evicted] == this->frame)
+    {
+      return FALLBACK_SLOT; // Every slot is drawn this frame
+    }
+    this->slots[evicted] = FALLBACK_SLOT;
+    this->stats.numEvicted++;
+  }
+
+  this->layers[slot] = (uint16_t)layer;
+  this->slots[layer] = slot;
+  this->Unlink(slot);
+  this->PushFront(slot);
+  this->stats.numInserted++;
+  return slot;
+}
+
+mj::LayerCache::Stats mj::LayerCache::GetStats() const
+{
+  Stats stats      = this->stats;
+  stats.numPending = this->numQueued;
+  for (uint32_t slot = 1; slot < this->numSlots; slot++)
+  {
+    stats.numResident += (this->layers[slot] != NONE) ? 1 : 0;
+  }
+  return stats;
+}
@@ -0,0 +1,116 @@
+// Residency - an LRU cache of texture array layers in the fewer slots of a texture array on the GPU
+// Should not use pre-compiled headers (for portability)
+//
+// Meshes list the layers of the file they use (LayerSet). Every frame the renderer references the layers of
+// what it draws: a resident layer is a hit and becomes the most recently used, any other layer is a miss and
+// is queued for upload, and is drawn with the fallback slot until then. Hits and misses are counted once per
+// layer per frame. Insert() gives a queued layer the slot of the least recently used layer, but never evicts
+// a layer referenced in the same frame, so a budget smaller than one frame needs shows the fallback for the
+// rest instead of evicting and uploading the same layers every frame. GetSlots() maps every layer of the
+// file to its slot, or to the fallback slot, for the vertex shader.
+
+#pragma once
+#include <stdint.h>
+
+namespace mj
+{
+  /// <summary>
+  /// Layers of a texture array file, e.g. those a chunk of level geometry is textured with
+  /// </summary>
+  struct LayerSet
+  {
+    static constexpr uint32_t MAX_LAYERS = 256;
+
+    uint64_t bits[MAX_LAYERS / 64];
+
+    /// <summary>
+    /// Layers past MAX_LAYERS are ignored
+    /// </summary>
+    void Add(uint32_t layer)
+    {
+      if (layer < MAX_LAYERS)
+      {
+        this->bits[layer / 64] |= (uint64_t)1 << (layer % 64);
+      }
+    }
+  };
+
+  class LayerCache
+  {
+  public:
+    static constexpr uint32_t MAX_LAYERS    = LayerSet::MAX_LAYERS;
+    static constexpr uint32_t MAX_SLOTS     = 256;
+    static constexpr uint32_t FALLBACK_SLOT = 0;
+
+    struct Stats
+    {
+      uint64_t numHits;
+      uint64_t numMisses;
+      uint64_t numInserted; // Uploads
+      uint64_t numEvicted;
+      uint32_t numResident;
+      uint32_t numPending; // Queued for upload
+      uint32_t numSlots;   // For layers, without the fallback slot
+    };
+
+    /// <summary>
+    /// Evicts every layer and clears the queue and the stats
+    /// </summary>
+    /// <param name="numLayers">Of the file. Layers past it always use the fallback slot.</param>
+    /// <param name="numSlots">Including the fallback slot</param>
+    /// <returns>False if numLayers or numSlots is out of range; nothing is resident then</returns>
+    bool Init(uint32_t numLayers, uint32_t numSlots);
+
+    /// <summary>
+    /// Starts counting references for a new frame
+    /// </summary>
+    void NewFrame();
+
+    /// <returns>Slot the layer is drawn with this frame</returns>
+    uint32_t Reference(uint32_t layer);
+    void Reference(const LayerSet& layers);
+
+    /// <summary>
+    /// Takes queued layers, in the order they missed
+    /// </summary>
+    /// <returns>Number of layers written to pLayers</returns>
+    uint32_t TakeRequests(uint32_t* pLayers, uint32_t capacity);
+
+    /// <summary>
+    /// Makes a layer resident. The caller uploads it to the returned slot.
+    /// </summary>
+    /// <returns>FALLBACK_SLOT if the layer was not referenced this frame or no slot can be evicted</returns>
+    uint32_t Insert(uint32_t layer);
+
+    /// <summary>
+    /// Slot of every layer, MAX_LAYERS entries
+    /// </summary>
+    const uint32_t* GetSlots() const
+    {
+      return this->slots;
+    }
+
+    Stats GetStats() const;
+
+  private:
+    static constexpr uint16_t NONE = 0xFFFF;
+
+    void Unlink(uint32_t slot);
+    void PushFront(uint32_t slot);
+
+    uint32_t slots[MAX_LAYERS];      // Of every layer, FALLBACK_SLOT if it is not resident
+    uint32_t referenced[MAX_LAYERS]; // Frame of the last reference to every layer
+    bool queued[MAX_LAYERS];
+    uint16_t queue[MAX_LAYERS];
+    uint16_t layers[MAX_SLOTS]; // In every slot, NONE if the slot is free
+    uint16_t prev[MAX_SLOTS];   // LRU list of the slots but the fallback, most recently used first
+    uint16_t next[MAX_SLOTS];
+    uint16_t head      = NONE;
+    uint16_t tail      = NONE;
+    uint32_t numQueued = 0;
+    uint32_t numLayers = 0;
+    uint32_t numSlots  = 0;
+    uint32_t frame     = 0;
+    Stats stats        = {};
+  };
+} // namespace mj
@@ -0,0 +1,201 @@
+// File watcher - reports files that changed on disk, for reloading assets while the game runs
+// Should not use pre-compiled headers (for portability)
+
+#include "mj_watcher.h"
+#include "mj_common.h"
+#include "mj_frame_stats.h"
+#include "mj_profiler.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#ifdef __linux__
+#define MJ_WATCHER_INOTIFY
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+bool mj::FileWatcher::Init()
+{
+  this->Destroy();
+#ifdef MJ_WATCHER_INOTIFY
+  this->handle      = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  this->initialized = this->handle >= 0;
+#else
+  this->initialized = true;
+#endif
+  return this->initialized;
+}
+
+void mj::FileWatcher::Destroy()
+{
+#ifdef MJ_WATCHER_INOTIFY
+  if (this->handle >= 0)
+  {
+    close(this->handle); // Removes the watches
+  }
+#endif
+  this->handle      = -1;
+  this->numFiles    = 0;
+  this->initialized = false;
+}
+
+/// <summary>
+/// Modification time and size, both -1 if the file does not exist. The time is in 100 ns ticks on Windows and
+/// in nanoseconds elsewhere, as whole seconds miss a second save of the same size within the same second.
+/// </summary>
+static void GetFileStatus(const char* pPath, int64_t* pModified, int64_t* pSize)
+{
+  *pModified = -1;
+  *pSize     = -1;
+#ifdef _WIN32
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (GetFileAttributesExA(pPath, GetFileExInfoStandard, &data))
+  {
+    *pModified = (int64_t)(((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime);
+    *pSize     = (int64_t)(((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow);
+  }
+#else
+  struct stat status;
+  if (stat(pPath, &status) == 0)
+  {
+#ifdef __APPLE__
+    const struct timespec& time = status.st_mtimespec;
+#else
+    const struct timespec& time = status.st_mtim;
+#endif
+    *pModified = (int64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+    *pSize     = (int64_t)status.st_size;
+  }
+#endif
+}
+
+bool mj::FileWatcher::Watch(const char* pPath)
+{
+  size_t length = strlen(pPath);
+  if (!this->initialized || length >= MAX_PATH_LENGTH)
+  {
+    return false;
+  }
+  for (uint32_t i = 0; i < this->numFiles; i++)
+  {
+    if (!strcmp(this->files[i].path, pPath))
+    {
+      return true;
+    }
+  }
+  if (this->numFiles == MAX_FILES)
+  {
+    return false;
+  }
+
+  File& file = this->files[this->numFiles];
+  memcpy(file.path, pPath, length + 1);
+  file.pName = file.path;
+  for (const char* pChar = file.path; *pChar; pChar++)
+  {
+    if (*pChar == '/' || *pChar == '\\')
+    {
+      file.pName = pChar + 1;
+    }
+  }
+  file.watch   = -1;
+  file.changed = false;
+  GetFileStatus(file.path, &file.modified, &file.size);
+
+#ifdef MJ_WATCHER_INOTIFY
+  // Watching the directory also catches files that are replaced. The same directory gets the same watch.
+  char directory[MAX_PATH_LENGTH];
+  size_t directoryLength = (size_t)(file.pName - file.path);
+  if (directoryLength > 0)
+  {
+    memcpy(directory, file.path, directoryLength);
+    directory[directoryLength] = '\0';
+  }
+  else
+  {
+    memcpy(directory, ".", 2);
+  }
+  file.watch = inotify_add_watch(this->handle, directory, IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (file.watch < 0)
+  {
+    return false;
+  }
+#endif
+
+  this->numFiles++;
+  return true;
+}
+
+void mj::FileWatcher::Scan()
+{
+  for (uint32_t i = 0; i < this->numFiles; i++)
+  {
+    File& file = this->files[i];
+    MJ_UNINITIALIZED int64_t modified;
+    MJ_UNINITIALIZED int64_t size;
+    GetFileStatus(file.path, &modified, &size);
+    if (modified != file.modified || size != file.size)
+    {
+      file.modified = modified;
+      file.size     = size;
+      file.changed  = file.changed || (size >= 0);
+    }
+  }
+}
+
+uint32_t mj::FileWatcher::Poll(const char** ppChanged, uint32_t capacity)
+{
+  if (!this->initialized)
+  {
+    return 0;
+  }
+  ZoneScoped;
+
+#ifdef MJ_WATCHER_INOTIFY
+  alignas(struct inotify_event) char buffer[4096];
+  for (;;)
+  {
+    ssize_t size = read(this->handle, buffer, sizeof(buffer));
+    if (size <= 0)
+    {
+      break; // EAGAIN: nothing left
+    }
+    for (ssize_t offset = 0; offset < size;)
+    {
+      const struct inotify_event* pEvent = (const struct inotify_event*)(buffer + offset);
+      for (uint32_t i = 0; (i < this->numFiles) && (pEvent->len > 0); i++)
+      {
+        File& file   = this->files[i];
+        file.changed = file.changed || ((file.watch == pEvent->wd) && !strcmp(file.pName, pEvent->name));
+      }
+      offset += sizeof(struct inotify_event) + pEvent->len;
+    }
+  }
+#else
+  double now = mj::stats::Now();
+  if (now - this->lastPoll >= POLL_INTERVAL_MS)
+  {
+    this->lastPoll = now;
+    this->Scan();
+  }
+#endif
+
+  uint32_t numChanged = 0;
+  for (uint32_t i = 0; (i < this->numFiles) && (numChanged < capacity); i++)
+  {
+    if (this->files[i].changed)
+    {
+      this->files[i].changed  = false;
+      ppChanged[numChanged++] = this->files[i].path;
+    }
+  }
+  return numChanged;
+}
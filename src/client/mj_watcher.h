@@ -0,0 +1,63 @@
+// File watcher - reports files that changed on disk, for reloading assets while the game runs
+// Should not use pre-compiled headers (for portability)
+//
+// On Linux the directories of the watched files are watched with inotify, for files that were closed
+// after writing or moved into place (editors often save to a temporary file and rename it). Poll() then
+// costs one non-blocking read() per call. Other platforms compare the modification time and size of
+// every file, at most every POLL_INTERVAL_MS. Either way a file that is being written can be reported
+// before it is complete, so whoever reloads it must validate it and keep what it had if it is invalid.
+
+#pragma once
+#include <stdint.h>
+
+namespace mj
+{
+  class FileWatcher
+  {
+  public:
+    static constexpr uint32_t MAX_FILES       = 16;
+    static constexpr uint32_t MAX_PATH_LENGTH = 256;
+    static constexpr double POLL_INTERVAL_MS  = 250.0;
+
+    ~FileWatcher()
+    {
+      this->Destroy();
+    }
+
+    /// <returns>False if changes cannot be watched, Poll() then reports nothing</returns>
+    bool Init();
+    void Destroy();
+
+    /// <summary>
+    /// Starts reporting changes to a file, which does not have to exist yet. Watching a file twice is fine.
+    /// </summary>
+    /// <returns>False if MAX_FILES are watched already or the path is too long</returns>
+    bool Watch(const char* pPath);
+
+    /// <summary>
+    /// Files that changed since the last call, each once
+    /// </summary>
+    /// <param name="ppChanged">Set to the paths as they were passed to Watch()</param>
+    /// <returns>Number of paths written</returns>
+    uint32_t Poll(const char** ppChanged, uint32_t capacity);
+
+  private:
+    struct File
+    {
+      char path[MAX_PATH_LENGTH];
+      const char* pName; // Part of the path after the directory
+      int32_t watch;     // inotify watch descriptor of the directory
+      int64_t modified;  // Modification time, if polled
+      int64_t size;      // If polled
+      bool changed;
+    };
+
+    void Scan();
+
+    File files[MAX_FILES];
+    uint32_t numFiles = 0;
+    int32_t handle    = -1; // inotify descriptor
+    double lastPoll   = 0.0;
+    bool initialized  = false;
+  };
+} // namespace mj
@@ -17,7 +17,7 @@
 #include <SDL.h>
 #include <SDL_syswm.h>
 
-#include "..\..\3rdparty\tracy\Tracy.hpp"
+#include "mj_profiler.h"
 
 #include <stdio.h>
 #include <stdint.h>
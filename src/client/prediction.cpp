@@ -0,0 +1,115 @@
+// Prediction - client-side movement of the local player ahead of the server
+// Should not use pre-compiled headers (for portability)
+
+#include "prediction.h"
+#include "mj_collision.h"
+#include "mj_profiler.h"
+
+#include <math.h>
+
+void Prediction::Reset(float radius)
+{
+  for (Entry& entry : this->entries)
+  {
+    entry.sequence = 0;
+  }
+  this->position    = mjm::vec3::zero();
+  this->offset      = mjm::vec3::zero();
+  this->radius      = radius;
+  this->sequence    = 0;
+  this->ackSequence = 0;
+  this->valid       = false;
+  this->stats       = {};
+}
+
+/// <summary>
+/// Same as one World::Tick() for a player body
+/// </summary>
+mjm::vec3 Prediction::Move(const mj::Grid& grid, const mjm::vec3& from, const PlayerInput& input, float dt) const
+{
+  return mj::collision::Move(grid, from, GetInputVelocity(input) * dt, this->radius).position;
+}
+
+uint32_t Prediction::Predict(const mj::Grid& grid, const PlayerInput& input, float dt)
+{
+  ZoneScoped;
+  if (this->valid)
+  {
+    this->position = Move(grid, this->position, input, dt);
+  }
+  this->offset = this->offset * expf(-dt / Prediction::SMOOTHING_TIME);
+
+  this->sequence++;
+  Entry& entry   = this->entries[this->sequence % Prediction::NUM_INPUTS];
+  entry.sequence = this->sequence;
+  entry.input    = input;
+  entry.position = this->position;
+  return this->sequence;
+}
+
+void Prediction::Reconcile(const mj::Grid& grid, uint32_t sequence, const mjm::vec3& position, float dt)
+{
+  ZoneScoped;
+  // Duplicate, reordered, or from before Reset()
+  if ((this->valid && (int32_t)(sequence - this->ackSequence) <= 0) || (int32_t)(this->sequence - sequence) < 0)
+  {
+    return;
+  }
+  this->ackSequence = sequence;
+  this->stats.numReconciles++;
+
+  uint32_t numPending = this->sequence - sequence;
+  if (this->valid)
+  {
+    // The acknowledged input left the ring, so there is no prediction to compare with: take the server state
+    // and replay the newest inputs, as the older ones are lost
+    if (numPending >= Prediction::NUM_INPUTS)
+    {
+      this->stats.numStale++;
+    }
+    else
+    {
+      const Entry& acked = this->entries[sequence % Prediction::NUM_INPUTS];
+      if (acked.sequence == sequence && acked.position.x == position.x && acked.position.y == position.y &&
+          acked.position.z == position.z)
+      {
+        return;
+      }
+    }
+  }
+
+  // Mispredicted: replay what the server has not applied yet on top of its state
+  uint32_t numReplayed = numPending < Prediction::NUM_INPUTS ? numPending : Prediction::NUM_INPUTS;
+  mjm::vec3 replayed   = position;
+  for (uint32_t s = this->sequence - numReplayed + 1; s != this->sequence + 1; s++)
+  {
+    Entry& entry   = this->entries[s % Prediction::NUM_INPUTS];
+    replayed       = Move(grid, replayed, entry.input, dt);
+    entry.position = replayed;
+  }
+
+  // The first snapshot only tells where the player is
+  if (!this->valid)
+  {
+    this->position = replayed;
+    this->valid    = true;
+    return;
+  }
+
+  mjm::vec3 error = this->position - replayed;
+  float distance  = sqrtf(mjm::dot(error, error));
+  if (distance > Prediction::SNAP_DISTANCE)
+  {
+    this->offset = mjm::vec3::zero();
+  }
+  else
+  {
+    this->offset += error;
+  }
+  this->position = replayed;
+
+  this->stats.numCorrections++;
+  this->stats.numReplayed += numReplayed;
+  this->stats.maxReplayed = numReplayed > this->stats.maxReplayed ? numReplayed : this->stats.maxReplayed;
+  this->stats.maxError    = distance > this->stats.maxError ? distance : this->stats.maxError;
+}
@@ -0,0 +1,113 @@
+// Prediction - client-side movement of the local player ahead of the server
+// Should not use pre-compiled headers (for portability)
+//
+// The client moves its own player as soon as an input is sampled, with the same code as the server
+// (GetInputVelocity() and mj::collision::Move()), and keeps every input with the position it predicted
+// in a fixed ring of NUM_INPUTS entries. A snapshot tells which input the server applied last and where
+// that left the player. If that matches the prediction for the same input, which is the normal case,
+// nothing else happens. Otherwise the inputs the server has not applied yet are replayed on top of its
+// state, without allocating. At a ping of NUM_INPUTS ticks or more the oldest of those inputs are gone:
+// the player is put where the server has it and only the newest NUM_INPUTS inputs are replayed, so the
+// client still follows the server and a replay never costs more than NUM_INPUTS moves.
+//
+// A correction does not move the rendered player at once: the difference is kept as an offset that
+// fades out over a few ticks, unless it is so large that the player should be seen to teleport.
+
+#pragma once
+#include "world.h"
+
+class Prediction
+{
+public:
+  static constexpr uint32_t NUM_INPUTS  = 64;   // A little over a second at 60 Hz, power of two
+  static constexpr float SMOOTHING_TIME = 0.1f; // Seconds for a correction to fade to 1/e
+  static constexpr float SNAP_DISTANCE  = 2.0f; // Cells, larger corrections are not smoothed
+
+  /// <summary>
+  /// Since Reset()
+  /// </summary>
+  struct Stats
+  {
+    uint32_t numReconciles;
+    uint32_t numCorrections; // Reconciles that found a misprediction and replayed
+    uint32_t numStale;       // Corrections whose acknowledged input had left the ring
+    uint32_t numReplayed;    // Inputs replayed by all corrections
+    uint32_t maxReplayed;    // By a single correction
+    float maxError;          // Largest correction, cells
+  };
+
+  /// <summary>
+  /// Forgets all inputs. The position is unknown until the first Reconcile().
+  /// </summary>
+  /// <param name="radius">Of the player body, as spawned by the server</param>
+  void Reset(float radius);
+
+  /// <summary>
+  /// Moves the player by one tick of input and keeps the input for replays.
+  /// </summary>
+  /// <returns>Sequence number to send the input with, the first one is 1</returns>
+  uint32_t Predict(const mj::Grid& grid, const PlayerInput& input, float dt);
+
+  /// <summary>
+  /// Corrects the prediction with the authoritative state of a snapshot. Older snapshots are ignored.
+  /// </summary>
+  /// <param name="sequence">Last input the server applied, SnapshotMessage::lastSequence</param>
+  /// <param name="position">Of the player after that tick</param>
+  void Reconcile(const mj::Grid& grid, uint32_t sequence, const mjm::vec3& position, float dt);
+
+  /// <summary>
+  /// False until the first Reconcile()
+  /// </summary>
+  bool HasPosition() const
+  {
+    return this->valid;
+  }
+
+  /// <summary>
+  /// Predicted position after the last input
+  /// </summary>
+  const mjm::vec3& GetPosition() const
+  {
+    return this->position;
+  }
+
+  /// <summary>
+  /// Position to render: the prediction plus what is left of earlier corrections
+  /// </summary>
+  mjm::vec3 GetSmoothedPosition() const
+  {
+    return this->position + this->offset;
+  }
+
+  /// <summary>
+  /// Sent inputs that the server has not acknowledged yet
+  /// </summary>
+  uint32_t GetNumPending() const
+  {
+    return this->sequence - this->ackSequence;
+  }
+
+  const Stats& GetStats() const
+  {
+    return this->stats;
+  }
+
+private:
+  struct Entry
+  {
+    uint32_t sequence;
+    PlayerInput input;
+    mjm::vec3 position; // After the input
+  };
+
+  mjm::vec3 Move(const mj::Grid& grid, const mjm::vec3& from, const PlayerInput& input, float dt) const;
+
+  Entry entries[NUM_INPUTS];
+  mjm::vec3 position   = mjm::vec3::zero();
+  mjm::vec3 offset     = mjm::vec3::zero();
+  float radius         = 0.0f;
+  uint32_t sequence    = 0; // Of the newest input
+  uint32_t ackSequence = 0; // Of the newest reconciled snapshot
+  bool valid           = false;
+  Stats stats          = {};
+};
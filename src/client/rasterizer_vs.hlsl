@@ -3,6 +3,12 @@ cbuffer cbPerObject
   float4x4 u_modelViewProj;
 };
 
+// Slot of every layer of the texture array file, see mj::LayerCache. Slot 0 is the fallback layer.
+cbuffer cbLayerSlots : register(b1)
+{
+  uint4 u_layerSlots[64];
+};
+
 struct VS_OUT
 {
   float4 position : SV_POSITION;
@@ -13,6 +19,7 @@ VS_OUT main(float3 a_position : POSITION, float3 a_texcoord0 : TEXCOORD0)
 {
   VS_OUT vsOut;
   vsOut.position = mul(u_modelViewProj, float4(a_position, 1.0));
-  vsOut.texCoord = a_texcoord0;
+  uint layer     = min((uint)max(a_texcoord0.z, 0.0), 255);
+  vsOut.texCoord = float3(a_texcoord0.xy, (float)u_layerSlots[layer / 4][layer % 4]);
   return vsOut;
 }
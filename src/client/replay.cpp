@@ -0,0 +1,64 @@
+// Replay - recorded player inputs and state hashes, one entry per tick
+// Should not use pre-compiled headers (for portability)
+
+#include "replay.h"
+
+bool Replay::Init(uint32_t maxTicks, uint32_t numPlayers)
+{
+  this->pInputs = (PlayerInput*)malloc((size_t)maxTicks * numPlayers * sizeof(PlayerInput));
+  this->pHashes = (uint64_t*)malloc(maxTicks * sizeof(uint64_t));
+  if (!this->pInputs || !this->pHashes)
+  {
+    Destroy();
+    return false;
+  }
+
+  this->maxTicks   = maxTicks;
+  this->numPlayers = numPlayers;
+  Clear();
+  return true;
+}
+
+void Replay::Destroy()
+{
+  free(this->pInputs);
+  free(this->pHashes);
+  this->pInputs    = nullptr;
+  this->pHashes    = nullptr;
+  this->maxTicks   = 0;
+  this->numPlayers = 0;
+  this->numTicks   = 0;
+}
+
+void Replay::Clear()
+{
+  this->numTicks   = 0;
+  this->desyncTick = UINT32_MAX;
+}
+
+bool Replay::Record(const PlayerInput* pInputs, uint64_t hash)
+{
+  if (this->numTicks >= this->maxTicks)
+  {
+    return false;
+  }
+
+  memcpy(this->pInputs + (size_t)this->numTicks * this->numPlayers, pInputs, this->numPlayers * sizeof(PlayerInput));
+  this->pHashes[this->numTicks] = hash;
+  this->numTicks++;
+  return true;
+}
+
+bool Replay::Verify(uint32_t tick, uint64_t hash)
+{
+  if (tick >= this->numTicks || this->pHashes[tick] == hash)
+  {
+    return true;
+  }
+
+  if (tick < this->desyncTick)
+  {
+    this->desyncTick = tick;
+  }
+  return false;
+}
@@ -0,0 +1,62 @@
+// Replay - recorded player inputs and state hashes, one entry per tick
+// Should not use pre-compiled headers (for portability)
+//
+// Since the simulation is deterministic, the inputs of every player per tick are enough to
+// reproduce a game. The state hash after each tick is stored alongside, so playing a replay back
+// (or running in lockstep with a peer) finds the first tick where the states differ.
+
+#pragma once
+#include "world.h"
+
+class Replay
+{
+public:
+  bool Init(uint32_t maxTicks, uint32_t numPlayers);
+  void Destroy();
+
+  void Clear();
+
+  /// <summary>
+  /// Appends a tick: the inputs that were applied (one per player) and the state hash after the tick.
+  /// </summary>
+  /// <returns>False if the replay is full</returns>
+  bool Record(const PlayerInput* pInputs, uint64_t hash);
+
+  const PlayerInput* GetInputs(uint32_t tick) const
+  {
+    return this->pInputs + (size_t)tick * this->numPlayers;
+  }
+
+  /// <summary>
+  /// Forgets the result of earlier playbacks
+  /// </summary>
+  void Rewind()
+  {
+    this->desyncTick = UINT32_MAX;
+  }
+
+  /// <summary>
+  /// Compares the state hash after a tick against the recording. The first mismatch is kept.
+  /// </summary>
+  /// <returns>False on a desync</returns>
+  bool Verify(uint32_t tick, uint64_t hash);
+
+  uint32_t GetNumTicks() const
+  {
+    return this->numTicks;
+  }
+
+  /// <returns>UINT32_MAX if every verified tick matched</returns>
+  uint32_t GetDesyncTick() const
+  {
+    return this->desyncTick;
+  }
+
+private:
+  PlayerInput* pInputs = nullptr;
+  uint64_t* pHashes    = nullptr;
+  uint32_t maxTicks    = 0;
+  uint32_t numPlayers  = 0;
+  uint32_t numTicks    = 0;
+  uint32_t desyncTick  = UINT32_MAX;
+};
@@ -0,0 +1,308 @@
+// SaveGame - snapshots of the simulation state, written to disk in the background
+// Should not use pre-compiled headers (for portability)
+
+#include "savegame.h"
+#include "mj_file.h"
+#include "mj_frame_stats.h"
+#include "mj_hash.h"
+#include "mj_lz.h"
+#include "mj_profiler.h"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#endif
+
+static constexpr uint32_t SAVE_MAGIC   = 0x47534A4D; // MJSG
+static constexpr uint16_t SAVE_VERSION = 1;
+
+bool SaveGame::Init()
+{
+  this->running = true;
+  this->writer  = std::thread(&SaveGame::RunWriter, this);
+  return true;
+}
+
+void SaveGame::Destroy()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->running = false;
+  }
+  this->condition.notify_one();
+  if (this->writer.joinable())
+  {
+    this->writer.join();
+  }
+
+  for (Buffer& buffer : this->buffers)
+  {
+    free(buffer.pData);
+    buffer = {};
+  }
+  free(this->pCompressed);
+  this->pCompressed        = nullptr;
+  this->compressedCapacity = 0;
+  this->nextBuffer         = 0;
+}
+
+bool SaveGame::Save(const char* pPath, const World& world, const mj::Grid& grid, const void* pExtra,
+                    uint32_t extraSize, bool compress)
+{
+  ZoneScoped;
+  double start = mj::stats::Now();
+
+  Buffer& buffer = this->buffers[this->nextBuffer];
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (buffer.pending || !this->running)
+    {
+      this->stats.numSkipped++;
+      return false;
+    }
+  }
+
+  // Grid size, extra state, world
+  uint32_t numCells = grid.width * grid.height;
+  size_t size       = 3 * sizeof(uint32_t) + extraSize + world.GetSaveSize();
+  size_t pathLength = strlen(pPath);
+  if (size > UINT32_MAX || pathLength >= SaveGame::MAX_PATH_LENGTH)
+  {
+    return false;
+  }
+  if (size > buffer.capacity)
+  {
+    uint8_t* pData = (uint8_t*)realloc(buffer.pData, size);
+    if (!pData)
+    {
+      return false;
+    }
+    buffer.pData    = pData;
+    buffer.capacity = size;
+  }
+
+  mj::MemoryBuffer writer(buffer.pData, size);
+  writer.Write(grid.width).Write(grid.height).Write(extraSize).Write(pExtra, extraSize);
+  world.Save(writer);
+  assert(writer.Good() && writer.SizeLeft() == 0);
+  buffer.size     = (uint32_t)size;
+  buffer.gridHash = mj::Hash64(grid.pSolid, numCells);
+  buffer.compress = compress;
+  memcpy(buffer.path, pPath, pathLength + 1);
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    buffer.pending        = true;
+    this->stats.captureMs = (float)(mj::stats::Now() - start);
+  }
+  this->condition.notify_one();
+  this->nextBuffer = (this->nextBuffer + 1) % SaveGame::NUM_BUFFERS;
+  return true;
+}
+
+bool SaveGame::IsWriting()
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  for (const Buffer& buffer : this->buffers)
+  {
+    if (buffer.pending)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+SaveGame::Stats SaveGame::GetStats()
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->stats;
+}
+
+void SaveGame::RunWriter()
+{
+#ifdef MJ_PROFILER_ENABLED
+  mj::profiler::SetThreadName("Save writer");
+#endif
+  for (uint32_t current = 0;; current = (current + 1) % SaveGame::NUM_BUFFERS)
+  {
+    Buffer& buffer = this->buffers[current];
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->condition.wait(lock, [this, &buffer] { return buffer.pending || !this->running; });
+      if (!buffer.pending)
+      {
+        return;
+      }
+    }
+
+    // The buffer belongs to this thread until it is no longer pending
+    MJ_UNINITIALIZED Stats stats;
+    bool written = Write(buffer, &stats);
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    buffer.pending = false;
+    if (written)
+    {
+      this->stats.writeMs  = stats.writeMs;
+      this->stats.rawSize  = stats.rawSize;
+      this->stats.fileSize = stats.fileSize;
+      this->stats.numWritten++;
+    }
+    else
+    {
+      this->stats.numFailed++;
+    }
+  }
+}
+
+/// <summary>
+/// Runs on the writer thread
+/// </summary>
+bool SaveGame::Write(const Buffer& buffer, Stats* pStats)
+{
+  ZoneScoped;
+  double start = mj::stats::Now();
+
+  SaveHeader header;
+  header.magic    = SAVE_MAGIC;
+  header.version  = SAVE_VERSION;
+  header.flags    = 0;
+  header.rawSize  = buffer.size;
+  header.dataSize = buffer.size;
+  header.hash     = mj::Hash64(buffer.pData, buffer.size);
+  header.gridHash = buffer.gridHash;
+
+  const void* pData = buffer.pData;
+  if (buffer.compress)
+  {
+    size_t capacity = mj::lz::GetMaxCompressedSize(buffer.size);
+    if (capacity > this->compressedCapacity)
+    {
+      free(this->pCompressed);
+      this->pCompressed        = (uint8_t*)malloc(capacity);
+      this->compressedCapacity = this->pCompressed ? capacity : 0;
+    }
+
+    // Data that does not compress is stored as it is
+    size_t size = mj::lz::Compress(buffer.pData, buffer.size, this->pCompressed, this->compressedCapacity);
+    if (size > 0 && size < buffer.size)
+    {
+      header.flags |= SAVE_COMPRESSED;
+      header.dataSize = (uint32_t)size;
+      pData           = this->pCompressed;
+    }
+  }
+
+  // Replace the save only once the new one is complete
+  char tempPath[SaveGame::MAX_PATH_LENGTH + 4];
+  snprintf(tempPath, sizeof(tempPath), "%s.tmp", buffer.path);
+  FILE* pFile = fopen(tempPath, "wb");
+  if (!pFile)
+  {
+    return false;
+  }
+  bool written = (fwrite(&header, sizeof(header), 1, pFile) == 1) && //
+                 (fwrite(pData, 1, header.dataSize, pFile) == header.dataSize);
+  written      = (fclose(pFile) == 0) && written;
+#ifdef _WIN32
+  // rename() does not replace existing files on Windows, this does in one step so a crash keeps either save
+  written = written && MoveFileExA(tempPath, buffer.path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+  written = written && (rename(tempPath, buffer.path) == 0);
+#endif
+  if (!written)
+  {
+    MJ_DISCARD(remove(tempPath));
+    return false;
+  }
+
+  pStats->writeMs  = (float)(mj::stats::Now() - start);
+  pStats->rawSize  = header.rawSize;
+  pStats->fileSize = (uint32_t)sizeof(header) + header.dataSize;
+  return true;
+}
+
+/// <summary>
+/// Applies a raw payload, reading every section in place
+/// </summary>
+static bool Apply(void* pPayload, uint32_t size, World& world, const mj::Grid& grid, void* pExtra, uint32_t extraSize)
+{
+  mj::MemoryBuffer reader(pPayload, size);
+  MJ_UNINITIALIZED uint32_t width;
+  MJ_UNINITIALIZED uint32_t height;
+  MJ_UNINITIALIZED uint32_t savedExtraSize;
+  if (!reader.Read(width).Read(height).Good() || (width != grid.width) || (height != grid.height))
+  {
+    return false;
+  }
+  if (!reader.Read(savedExtraSize).Good() || (savedExtraSize != extraSize))
+  {
+    return false;
+  }
+  const uint8_t* pSavedExtra = reader.ReserveArrayUnaligned<uint8_t>(extraSize);
+  if (!reader.Good())
+  {
+    return false;
+  }
+
+  if (!world.Load(reader) || reader.SizeLeft() != 0)
+  {
+    world.Clear();
+    return false;
+  }
+  memcpy(pExtra, pSavedExtra, extraSize);
+  return true;
+}
+
+bool LoadSaveGame(const char* pPath, World& world, const mj::Grid& grid, void* pExtra, uint32_t extraSize)
+{
+  ZoneScoped;
+  MJ_UNINITIALIZED size_t size;
+  uint8_t* pFile = (uint8_t*)mj::ReadFile(pPath, &size);
+  if (!pFile)
+  {
+    return false;
+  }
+
+  MJ_UNINITIALIZED SaveHeader header;
+  bool loaded = false;
+  if (size >= sizeof(header))
+  {
+    memcpy(&header, pFile, sizeof(header));
+    uint8_t* pPayload = pFile + sizeof(header);
+    uint8_t* pRaw     = nullptr;
+    if ((header.magic == SAVE_MAGIC) && (header.version == SAVE_VERSION) &&
+        (header.dataSize == size - sizeof(header)) &&
+        (header.gridHash == mj::Hash64(grid.pSolid, (size_t)grid.width * grid.height)))
+    {
+      // Uncompressed saves are used where they were read to
+      if (header.flags & SAVE_COMPRESSED)
+      {
+        pRaw = (uint8_t*)malloc(header.rawSize);
+        if (pRaw && mj::lz::Decompress(pPayload, header.dataSize, pRaw, header.rawSize))
+        {
+          pPayload = pRaw;
+        }
+        else
+        {
+          pPayload = nullptr;
+        }
+      }
+      else if (header.rawSize != header.dataSize)
+      {
+        pPayload = nullptr;
+      }
+
+      loaded = pPayload && (mj::Hash64(pPayload, header.rawSize) == header.hash) &&
+               Apply(pPayload, header.rawSize, world, grid, pExtra, extraSize);
+    }
+    free(pRaw);
+  }
+
+  free(pFile);
+  return loaded;
+}
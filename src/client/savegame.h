@@ -0,0 +1,117 @@
+// SaveGame - snapshots of the simulation state, written to disk in the background
+// Should not use pre-compiled headers (for portability)
+//
+// Save() copies the world into one contiguous buffer, one copy per component array
+// (World::Save()), and hands it to a writer thread. Nothing is allocated once the buffer has grown to fit,
+// so even a full world takes well under a millisecond on the calling thread. The writer hashes and
+// compresses the buffer (mj_lz.h) and writes it to a temporary file that then replaces the save, so the
+// game never waits on the file system and a crash never leaves half a save behind. Two buffers take
+// turns: a save can be captured while the previous one is still being written.
+//
+// LoadSaveGame() reads the file with a single read. An uncompressed save is applied straight out of
+// that buffer, a compressed one is decompressed into a second buffer first.
+//
+// The grid does not change during play, so it is not saved: the header holds its hash instead and a save
+// only loads on the level it was made on.
+
+#pragma once
+#include "world.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/// <summary>
+/// Start of a save file, followed by the payload: grid size, extra game state and World::Save()
+/// </summary>
+struct SaveHeader
+{
+  uint32_t magic; // MJSG
+  uint16_t version;
+  uint16_t flags;    // SAVE_* flags
+  uint32_t rawSize;  // Of the payload after decompressing
+  uint32_t dataSize; // Of the payload in the file
+  uint64_t hash;     // Hash64() of the raw payload
+  uint64_t gridHash; // Hash64() of the solid cells of the level
+};
+
+enum : uint16_t
+{
+  SAVE_COMPRESSED = 1 << 0,
+};
+
+class SaveGame
+{
+public:
+  static constexpr uint32_t NUM_BUFFERS     = 2;
+  static constexpr uint32_t MAX_PATH_LENGTH = 256;
+
+  struct Stats
+  {
+    float captureMs;     // Of the last Save(), on the calling thread
+    float writeMs;       // Of the last write: hash, compression and file I/O
+    uint32_t rawSize;    // Bytes, of the last write
+    uint32_t fileSize;   // Bytes, of the last write
+    uint32_t numWritten;
+    uint32_t numFailed;  // Writes that could not create or fill the file
+    uint32_t numSkipped; // Saves refused because both buffers were still being written
+  };
+
+  /// <summary>
+  /// Starts the writer thread
+  /// </summary>
+  bool Init();
+
+  /// <summary>
+  /// Finishes the writes that are pending and stops the writer thread
+  /// </summary>
+  void Destroy();
+
+  /// <summary>
+  /// Captures the state and queues it for writing. Never waits for the file system.
+  /// </summary>
+  /// <param name="pExtra">Game state outside the world, restored by LoadSaveGame()</param>
+  /// <returns>False if nothing was saved: both buffers are still being written, or out of memory</returns>
+  bool Save(const char* pPath, const World& world, const mj::Grid& grid, const void* pExtra, uint32_t extraSize,
+            bool compress);
+
+  /// <summary>
+  /// True while a save is captured but not on disk yet
+  /// </summary>
+  bool IsWriting();
+
+  Stats GetStats();
+
+private:
+  struct Buffer
+  {
+    uint8_t* pData;
+    size_t capacity;
+    uint32_t size;
+    uint64_t gridHash;
+    bool compress;
+    bool pending; // Owned by the writer thread until it is written
+    char path[MAX_PATH_LENGTH];
+  };
+
+  void RunWriter();
+  bool Write(const Buffer& buffer, Stats* pStats);
+
+  Buffer buffers[NUM_BUFFERS] = {};
+  uint32_t nextBuffer         = 0; // Captured next, the writer takes them in the same order
+  uint8_t* pCompressed        = nullptr;
+  size_t compressedCapacity   = 0;
+  Stats stats                 = {};
+  bool running                = false;
+  std::mutex mutex; // Guards pending, running and stats
+  std::condition_variable condition;
+  std::thread writer;
+};
+
+/// <summary>
+/// Reads a save written by SaveGame, blocking. The grid must be the one the save was made on.
+/// </summary>
+/// <param name="pExtra">Receives the extra game state, extraSize must match the saved size</param>
+/// <returns>False if the file is missing, corrupt, of another level or does not fit. Only a world that does not
+/// fit is left empty, everything else is unchanged.</returns>
+bool LoadSaveGame(const char* pPath, World& world, const mj::Grid& grid, void* pExtra, uint32_t extraSize);
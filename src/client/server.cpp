@@ -0,0 +1,418 @@
+// Server - authoritative simulation for connected players
+// Should not use pre-compiled headers (for portability)
+
+#include "server.h"
+#include "mj_file.h"
+#include "mj_profiler.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+static constexpr uint32_t LEVEL_FILE_MAGIC  = 0x464D4A4D; // See level.cpp
+static constexpr uint8_t LEVEL_FILE_VERSION = 0;
+static constexpr uint32_t RAW_LEVEL_SIZE    = 64;
+
+uint32_t WriteMessage(const InputMessage& message, void* pBuffer, uint32_t size)
+{
+  mj::MemoryBuffer writer(pBuffer, size);
+  MessageType type = MessageType::Input;
+  writer.Write(type).Write(message.sequence).Write(message.ackTick);
+  writer.Write(message.input.buttons).Write(message.input.yaw);
+  return writer.Good() ? (uint32_t)(writer.Position() - (char*)pBuffer) : 0;
+}
+
+bool ReadMessage(const void* pData, uint32_t size, InputMessage* pMessage)
+{
+  mj::MemoryBuffer reader((void*)pData, size);
+  MJ_UNINITIALIZED MessageType type;
+  reader.Read(type).Read(pMessage->sequence).Read(pMessage->ackTick);
+  return reader.Read(pMessage->input.buttons).Read(pMessage->input.yaw).Good() && (type == MessageType::Input);
+}
+
+uint32_t WriteMessage(const SnapshotMessage& message, const Snapshot& baseline, const Snapshot& snapshot,
+                      void* pBuffer, uint32_t size, Snapshot* pSent, uint32_t* pFirstIndex)
+{
+  mj::MemoryBuffer writer(pBuffer, size);
+  MessageType type   = MessageType::Snapshot;
+  mjm::vec3 position = message.position;
+  writer.Write(type).Write(message.tick).Write(message.baselineTick).Write(message.lastSequence).Write(message.player);
+  writer.Write(position.x).Write(position.y).Write(position.z);
+  if (!writer.Good() || !EncodeSnapshot(baseline, snapshot, writer, pSent, pFirstIndex))
+  {
+    return 0;
+  }
+  return (uint32_t)(writer.Position() - (char*)pBuffer);
+}
+
+const Snapshot* ReadMessage(const void* pData, uint32_t size, SnapshotHistory& history, SnapshotMessage* pMessage)
+{
+  mj::MemoryBuffer reader((void*)pData, size);
+  MJ_UNINITIALIZED MessageType type;
+  reader.Read(type).Read(pMessage->tick).Read(pMessage->baselineTick).Read(pMessage->lastSequence);
+  reader.Read(pMessage->player).Read(pMessage->position.x).Read(pMessage->position.y).Read(pMessage->position.z);
+  if (!reader.Good() || (type != MessageType::Snapshot) || (pMessage->tick == NO_SNAPSHOT))
+  {
+    return nullptr;
+  }
+
+  const Snapshot empty      = {};
+  const Snapshot* pBaseline = &empty;
+  if (pMessage->baselineTick != NO_SNAPSHOT)
+  {
+    // The baseline must not be in the slot that the new snapshot is decoded into
+    uint32_t age = pMessage->tick - pMessage->baselineTick;
+    pBaseline    = history.Find(pMessage->baselineTick);
+    if (!pBaseline || age == 0 || age >= SnapshotHistory::NUM_SNAPSHOTS)
+    {
+      return nullptr;
+    }
+  }
+
+  Snapshot& snapshot = history.Claim(pMessage->tick);
+  if (!DecodeSnapshot(*pBaseline, reader, &snapshot))
+  {
+    snapshot.tick = NO_SNAPSHOT;
+    return nullptr;
+  }
+  return &snapshot;
+}
+
+bool Server::Init(const mj::Grid& grid)
+{
+  this->pGrid      = &grid;
+  this->pClients   = (Client*)calloc(Server::MAX_CLIENTS, sizeof(Client));
+  this->pTickTimes = (float*)calloc(Server::NUM_TICKS, sizeof(float));
+  if (!this->pClients || !this->pTickTimes || !this->world.Init())
+  {
+    Destroy();
+    return false;
+  }
+
+  uint32_t maxEntities     = this->world.entities.GetCapacity();
+  this->snapshot.capacity  = maxEntities;
+  this->snapshot.pEntities = (EntityState*)malloc(maxEntities * sizeof(EntityState));
+  this->relevant.capacity  = MAX_SNAPSHOT_ENTITIES;
+  this->relevant.pEntities = (EntityState*)malloc(MAX_SNAPSHOT_ENTITIES * sizeof(EntityState));
+  if (!this->snapshot.pEntities || !this->relevant.pEntities ||
+      !this->interest.Init(Server::MAX_CLIENTS, maxEntities))
+  {
+    Destroy();
+    return false;
+  }
+
+  this->world.Reset();
+  this->numConnected = 0;
+  this->bytesSent    = 0;
+  this->numTicks     = 0;
+  return true;
+}
+
+void Server::Destroy()
+{
+  for (uint32_t i = 0; this->pClients && i < Server::MAX_CLIENTS; i++)
+  {
+    Disconnect(i);
+  }
+  this->world.Destroy();
+  this->interest.Destroy();
+  free(this->snapshot.pEntities);
+  free(this->relevant.pEntities);
+  this->snapshot = Snapshot();
+  this->relevant = Snapshot();
+  free(this->pClients);
+  free(this->pTickTimes);
+  this->pClients     = nullptr;
+  this->pTickTimes   = nullptr;
+  this->pGrid        = nullptr;
+  this->numConnected = 0;
+}
+
+/// <summary>
+/// Spreads players over the level: the first free cell at a pseudo-random starting point
+/// </summary>
+BlockPos Server::FindSpawn(uint32_t client) const
+{
+  uint32_t numCells = this->pGrid->width * this->pGrid->height;
+  uint32_t start    = (uint32_t)(((uint64_t)client * 2654435761u) % numCells);
+  for (uint32_t i = 0; i < numCells; i++)
+  {
+    uint32_t cell = (start + i) % numCells;
+    BlockPos position;
+    position.x = (int32_t)(cell % this->pGrid->width);
+    position.z = (int32_t)(cell / this->pGrid->width);
+    if (!this->pGrid->IsSolid(position.x, position.z))
+    {
+      return position;
+    }
+  }
+  return BlockPos{ 0, 0 };
+}
+
+uint32_t Server::Connect(mj::net::Loopback* pConnection)
+{
+  for (uint32_t i = 0; i < Server::MAX_CLIENTS; i++)
+  {
+    Client& client = this->pClients[i];
+    if (client.pConnection)
+    {
+      continue;
+    }
+
+    if (!client.snapshots.Init())
+    {
+      return UINT32_MAX;
+    }
+
+    BlockPos spawn     = FindSpawn(i);
+    mjm::vec3 position = mjm::vec3((float)spawn.x + 0.5f, 0.5f, (float)spawn.z + 0.5f);
+    client.player      = this->world.Spawn(EntityKind::Player, position, Server::PLAYER_RADIUS);
+    if (client.player == mj::NULL_ENTITY || !this->interest.AddClient(i, client.player.index))
+    {
+      this->world.Kill(client.player);
+      client.snapshots.Destroy();
+      return UINT32_MAX;
+    }
+
+    client.pConnection    = pConnection;
+    client.input          = PlayerInput{ 0, 0 };
+    client.lastSequence   = 0;
+    client.newestSequence = 0;
+    client.ackTick        = NO_SNAPSHOT;
+    client.firstIndex     = 0;
+    memset(client.sequences, 0, sizeof(client.sequences));
+    this->world.inputs.Data<0>()[this->world.inputs.Add(client.player)] = client.input;
+    this->numConnected++;
+    return i;
+  }
+  return UINT32_MAX;
+}
+
+void Server::Disconnect(uint32_t client)
+{
+  if (client < Server::MAX_CLIENTS && this->pClients[client].pConnection)
+  {
+    this->world.Kill(this->pClients[client].player);
+    this->pClients[client].snapshots.Destroy();
+    this->interest.RemoveClient(client);
+    this->pClients[client].pConnection = nullptr;
+    this->numConnected--;
+  }
+}
+
+/// <summary>
+/// Drains all incoming packets and applies the next input of every client
+/// </summary>
+void Server::Receive()
+{
+  ZoneScoped;
+  uint8_t packet[mj::net::MAX_PACKET_SIZE];
+  for (uint32_t i = 0; i < Server::MAX_CLIENTS; i++)
+  {
+    Client& client = this->pClients[i];
+    if (!client.pConnection)
+    {
+      continue;
+    }
+
+    uint32_t size;
+    while ((size = client.pConnection->toServer.Receive(packet)) > 0)
+    {
+      MJ_UNINITIALIZED InputMessage message;
+      // Packets may arrive out of order on a real network, inputs that were already applied are ignored
+      if (ReadMessage(packet, size, &message) && (int32_t)(message.sequence - client.lastSequence) > 0)
+      {
+        uint32_t slot          = message.sequence % Server::NUM_INPUTS;
+        client.inputs[slot]    = message.input;
+        client.sequences[slot] = message.sequence;
+        if ((int32_t)(message.sequence - client.newestSequence) > 0)
+        {
+          client.newestSequence = message.sequence;
+          client.ackTick        = message.ackTick;
+        }
+      }
+    }
+
+    // One input per tick, so that the client knows exactly which inputs a snapshot includes.
+    // A lost input repeats the previous one, and a client that got too far ahead skips the oldest.
+    uint32_t next = client.lastSequence + 1;
+    if ((int32_t)(client.newestSequence - next) >= (int32_t)Server::NUM_INPUTS)
+    {
+      next = client.newestSequence - (Server::NUM_INPUTS - 1);
+    }
+    if ((int32_t)(client.newestSequence - next) >= 0)
+    {
+      uint32_t buffered = next % Server::NUM_INPUTS;
+      if (client.sequences[buffered] == next)
+      {
+        client.input = client.inputs[buffered];
+      }
+      client.lastSequence = next;
+    }
+
+    uint32_t slot = this->world.inputs.Find(client.player);
+    if (slot != this->world.inputs.INVALID)
+    {
+      this->world.inputs.Data<0>()[slot] = client.input;
+    }
+  }
+}
+
+void Server::Replicate()
+{
+  ZoneScoped;
+  CaptureSnapshot(this->world, &this->snapshot);
+  this->snapshot.tick = this->world.tick;
+  if (this->cullSnapshots)
+  {
+    this->interest.Update(*this->pGrid, this->snapshot);
+  }
+}
+
+void Server::GetClientSnapshot(uint32_t client, Snapshot* pOut) const
+{
+  if (this->cullSnapshots)
+  {
+    this->interest.Filter(client, this->snapshot, pOut);
+  }
+  else
+  {
+    pOut->numEntities = this->snapshot.numEntities < pOut->capacity ? this->snapshot.numEntities : pOut->capacity;
+    memcpy(pOut->pEntities, this->snapshot.pEntities, pOut->numEntities * sizeof(EntityState));
+  }
+}
+
+void Server::Send()
+{
+  ZoneScoped;
+  const Snapshot empty = {};
+  uint8_t packet[mj::net::MAX_PACKET_SIZE];
+  for (uint32_t i = 0; i < Server::MAX_CLIENTS; i++)
+  {
+    Client& client = this->pClients[i];
+    if (!client.pConnection)
+    {
+      continue;
+    }
+
+    // Claiming the slot of this tick overwrites the snapshot from NUM_SNAPSHOTS ticks ago
+    const Snapshot* pBaseline = client.snapshots.Find(client.ackTick);
+    if (!pBaseline || (this->world.tick - pBaseline->tick) >= SnapshotHistory::NUM_SNAPSHOTS)
+    {
+      pBaseline = &empty;
+    }
+
+    SnapshotMessage message;
+    message.tick         = this->world.tick;
+    message.baselineTick = pBaseline->tick;
+    message.lastSequence = client.lastSequence;
+    message.player       = client.player.index;
+    message.position     = mjm::vec3::zero();
+    uint32_t body        = this->world.bodies.Find(client.player);
+    if (body != this->world.bodies.INVALID)
+    {
+      message.position = this->world.bodies.Data<BODY_POSITION>()[body];
+    }
+
+    const Snapshot* pSnapshot = &this->snapshot;
+    if (this->cullSnapshots)
+    {
+      this->interest.Filter(i, this->snapshot, &this->relevant);
+      pSnapshot = &this->relevant;
+    }
+
+    Snapshot& sent = client.snapshots.Claim(this->world.tick);
+    uint32_t size  = WriteMessage(message, *pBaseline, *pSnapshot, packet, sizeof(packet), &sent, &client.firstIndex);
+    if (size > 0 && client.pConnection->toClient.Send(packet, size))
+    {
+      this->bytesSent += size;
+    }
+  }
+}
+
+void Server::Tick()
+{
+  ZoneScoped;
+  double start = mj::stats::Now();
+  Receive();
+  double received = mj::stats::Now();
+  this->world.Tick(*this->pGrid, 1.0f / Server::TICK_RATE);
+  double simulated = mj::stats::Now();
+  Replicate();
+  double replicated = mj::stats::Now();
+  Send();
+  double sent = mj::stats::Now();
+
+  this->lastTimings.receive                            = (float)(received - start);
+  this->lastTimings.simulate                           = (float)(simulated - received);
+  this->lastTimings.replicate                          = (float)(replicated - simulated);
+  this->lastTimings.send                               = (float)(sent - replicated);
+  this->pTickTimes[this->numTicks % Server::NUM_TICKS] = (float)(sent - start);
+  this->numTicks++;
+}
+
+mj::stats::Percentiles Server::GetTickPercentiles() const
+{
+  mj::stats::Percentiles percentiles = {};
+  uint32_t count                     = this->numTicks < Server::NUM_TICKS ? this->numTicks : Server::NUM_TICKS;
+  if (count == 0)
+  {
+    return percentiles;
+  }
+
+  float sorted[Server::NUM_TICKS];
+  memcpy(sorted, this->pTickTimes, count * sizeof(float));
+  std::sort(sorted, sorted + count);
+
+  percentiles.p50 = sorted[(count - 1) * 50 / 100];
+  percentiles.p95 = sorted[(count - 1) * 95 / 100];
+  percentiles.p99 = sorted[(count - 1) * 99 / 100];
+  percentiles.max = sorted[count - 1];
+  return percentiles;
+}
+
+mj::Grid LoadLevelFile(const char* pPath)
+{
+  MJ_UNINITIALIZED size_t size;
+  void* pFile = mj::ReadFile(pPath, &size);
+  if (!pFile)
+  {
+    return mj::Grid();
+  }
+
+  mj::Grid grid;
+  mj::MemoryBuffer reader(pFile, size);
+  MJ_UNINITIALIZED uint32_t magicWord;
+  MJ_UNINITIALIZED uint8_t versionNumber;
+  MJ_UNINITIALIZED uint8_t width;
+  MJ_UNINITIALIZED uint8_t height;
+  if (reader.Read(magicWord).Read(versionNumber).Read(width).Read(height).Good() && //
+      (magicWord == LEVEL_FILE_MAGIC) &&                                            //
+      (versionNumber == LEVEL_FILE_VERSION) &&                                      //
+      (reader.SizeLeft() >= sizeof(block_t) * width * height))
+  {
+    grid = mj::Grid::FromBlocks((const block_t*)reader.Position(), width, height);
+  }
+  else if (size == sizeof(block_t) * RAW_LEVEL_SIZE * RAW_LEVEL_SIZE)
+  {
+    grid = mj::Grid::FromBlocks((const block_t*)pFile, RAW_LEVEL_SIZE, RAW_LEVEL_SIZE);
+  }
+
+  free(pFile);
+  return grid;
+}
+
+mj::Grid LoadDefaultLevel()
+{
+  static const char* s_Paths[] = { "assets/E1M1.bin", "../assets/E1M1.bin", "../../assets/E1M1.bin",
+                                  "../../../assets/E1M1.bin" };
+
+  for (const char* pPath : s_Paths)
+  {
+    mj::Grid grid = LoadLevelFile(pPath);
+    if (grid.IsValid())
+    {
+      return grid;
+    }
+  }
+  return mj::Grid();
+}
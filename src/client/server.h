@@ -0,0 +1,191 @@
+// Server - authoritative simulation for connected players
+// Should not use pre-compiled headers (for portability)
+//
+// The server owns a World and ticks it at a fixed rate, without window, renderer or input devices.
+// Clients send their PlayerInput every tick. Each tick the server applies the next input of every
+// player in sequence order (a late or lost one means the previous input is repeated), runs the world and
+// sends every client a snapshot of the entities relevant to it (see InterestMap), delta-encoded against
+// the newest snapshot that client has acknowledged. The snapshot also tells the client which of its
+// inputs have been applied and where they left its player, for Prediction.
+// Connections are mj::net::Loopback pairs, the in-process stand-in for sockets.
+
+#pragma once
+#include "mj_frame_stats.h" // mj::stats::Percentiles
+#include "interest.h"
+#include "mj_net.h"
+
+enum class MessageType : uint8_t
+{
+  Input,    // Client to server, InputMessage
+  Snapshot, // Server to client, SnapshotMessage
+};
+
+struct InputMessage
+{
+  uint32_t sequence; // Increases by one per client tick
+  uint32_t ackTick;  // Newest snapshot the client has decoded, or NO_SNAPSHOT
+  PlayerInput input;
+};
+
+/// <summary>
+/// Header of a snapshot, followed by the EncodeSnapshot() data
+/// </summary>
+struct SnapshotMessage
+{
+  uint32_t tick;
+  uint32_t baselineTick; // NO_SNAPSHOT if encoded against the empty snapshot
+  uint32_t lastSequence; // Newest input that has been applied
+  uint32_t player;       // Entity index of the receiving client
+  mjm::vec3 position;    // Of that player after this tick, unquantized so that prediction can match it exactly
+};
+
+// Message encoding, through mj::MemoryBuffer
+// Write functions return the encoded size, or 0 if the buffer is too small
+uint32_t WriteMessage(const InputMessage& message, void* pBuffer, uint32_t size);
+bool ReadMessage(const void* pData, uint32_t size, InputMessage* pMessage);
+
+/// <param name="pSent">Receives the snapshot as the client will decode it</param>
+/// <param name="pFirstIndex">See EncodeSnapshot()</param>
+uint32_t WriteMessage(const SnapshotMessage& message, const Snapshot& baseline, const Snapshot& snapshot,
+                      void* pBuffer, uint32_t size, Snapshot* pSent, uint32_t* pFirstIndex);
+
+/// <summary>
+/// Decodes a snapshot into the slot of its tick, against a baseline from the same history
+/// </summary>
+/// <returns>nullptr if the message is invalid or its baseline is no longer in the history</returns>
+const Snapshot* ReadMessage(const void* pData, uint32_t size, SnapshotHistory& history, SnapshotMessage* pMessage);
+
+/// <summary>
+/// Reads the file format of Level::Load, or a raw 64x64 block dump like assets/E1M1.bin, without SDL
+/// </summary>
+/// <returns>Invalid grid if the file could not be read</returns>
+mj::Grid LoadLevelFile(const char* pPath);
+
+/// <summary>
+/// assets/E1M1.bin, searched from the working directory up to three levels above it
+/// </summary>
+mj::Grid LoadDefaultLevel();
+
+class Server
+{
+public:
+  static constexpr uint32_t MAX_CLIENTS = 256;
+  static constexpr float TICK_RATE      = 60.0f;
+  static constexpr float PLAYER_RADIUS  = 0.25f;
+  static constexpr uint32_t NUM_TICKS   = 512; // Tick timings kept for percentiles
+  static constexpr uint32_t NUM_INPUTS  = 8;   // Received ahead of the tick that applies them, per client
+
+  /// <summary>
+  /// Milliseconds spent in each part of the last tick
+  /// </summary>
+  struct TickTimings
+  {
+    float receive;
+    float simulate;
+    float replicate; // Snapshot capture and interest management
+    float send;
+  };
+
+  /// <param name="grid">Level to simulate, must outlive the server</param>
+  bool Init(const mj::Grid& grid);
+  void Destroy();
+
+  /// <summary>
+  /// Spawns a player for a new connection.
+  /// </summary>
+  /// <returns>Client index, or UINT32_MAX if the server is full</returns>
+  uint32_t Connect(mj::net::Loopback* pConnection);
+
+  /// <summary>
+  /// Removes the player of a client. The connection is not touched.
+  /// </summary>
+  void Disconnect(uint32_t client);
+
+  /// <summary>
+  /// Receives inputs, runs one tick and sends the states.
+  /// </summary>
+  void Tick();
+
+  const TickTimings& GetLastTimings() const
+  {
+    return this->lastTimings;
+  }
+
+  /// <summary>
+  /// Whole tick durations over the last NUM_TICKS ticks, in milliseconds
+  /// </summary>
+  mj::stats::Percentiles GetTickPercentiles() const;
+
+  uint32_t GetNumClients() const
+  {
+    return this->numConnected;
+  }
+
+  /// <summary>
+  /// State of the world after the last tick, as it is replicated
+  /// </summary>
+  const Snapshot& GetSnapshot() const
+  {
+    return this->snapshot;
+  }
+
+  /// <summary>
+  /// The part of GetSnapshot() that was sent to a client, before the packet budget
+  /// </summary>
+  void GetClientSnapshot(uint32_t client, Snapshot* pOut) const;
+
+  /// <summary>
+  /// Sends every client all entities when disabled. Enabled by default.
+  /// </summary>
+  void SetInterestManagement(bool enabled)
+  {
+    this->cullSnapshots = enabled;
+  }
+
+  const InterestMap& GetInterest() const
+  {
+    return this->interest;
+  }
+
+  /// <summary>
+  /// Total payload sent to all clients, in bytes
+  /// </summary>
+  uint64_t GetBytesSent() const
+  {
+    return this->bytesSent;
+  }
+
+  World world;
+
+private:
+  struct Client
+  {
+    mj::net::Loopback* pConnection; // nullptr if the slot is free
+    mj::Entity player;
+    PlayerInput input;     // Applied in the last tick
+    uint32_t lastSequence; // Of input
+    uint32_t newestSequence;
+    PlayerInput inputs[Server::NUM_INPUTS]; // Received, by sequence
+    uint32_t sequences[Server::NUM_INPUTS];
+    uint32_t ackTick;
+    uint32_t firstIndex;       // Entity the next snapshot delta starts with when not all of them fit
+    SnapshotHistory snapshots; // As sent, for baselines
+  };
+
+  BlockPos FindSpawn(uint32_t client) const;
+  void Receive();
+  void Replicate();
+  void Send();
+
+  const mj::Grid* pGrid = nullptr;
+  Client* pClients      = nullptr;
+  uint32_t numConnected = 0;
+  Snapshot snapshot; // Whole world
+  Snapshot relevant; // Scratch, one client at a time
+  InterestMap interest;
+  bool cullSnapshots      = true;
+  uint64_t bytesSent      = 0;
+  float* pTickTimes       = nullptr; // Ring buffer, milliseconds
+  uint32_t numTicks       = 0;
+  TickTimings lastTimings = {};
+};
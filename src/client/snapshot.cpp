@@ -0,0 +1,552 @@
+// Snapshot - replicated world state and its delta-compressed encoding
+// Should not use pre-compiled headers (for portability)
+
+#include "snapshot.h"
+#include "mj_net.h"
+#include "mj_profiler.h"
+
+#include <algorithm>
+#include <math.h>
+
+// Delta format: the record count as uint16_t, then per record, by increasing entity index:
+//   index gap (var), operation (2 bits), then
+//   RECORD_UPDATE: per quantized value a zero bit, or a one bit and the zigzag delta (var)
+//   RECORD_CREATE: generation (var), kind (8 bits), values as deltas from 0
+//   RECORD_REMOVE: nothing
+// A var is a 2-bit width class followed by that many bits.
+enum : uint32_t
+{
+  RECORD_UPDATE,
+  RECORD_CREATE,
+  RECORD_REMOVE,
+};
+
+static constexpr uint32_t INDEX_WIDTHS[]  = { 2, 5, 9, 32 };
+static constexpr uint32_t VALUE_WIDTHS[]  = { 4, 8, 14, 24 }; // Deltas between values within SNAPSHOT_LIMIT fit 24 bits
+static constexpr uint32_t NUM_VALUES      = 6;
+static constexpr uint32_t MAX_VALUE_BITS  = 1 + 2 + 24;
+static constexpr uint32_t MAX_RECORD_BITS = (2 + 32) + 2 + (2 + 32) + 8 + NUM_VALUES * MAX_VALUE_BITS;
+static constexpr uint32_t NO_INDEX        = UINT32_MAX;
+
+static int32_t Quantize(float value)
+{
+  float scaled = floorf(value * SNAPSHOT_SCALE + 0.5f);
+  if (scaled > (float)SNAPSHOT_LIMIT)
+  {
+    return SNAPSHOT_LIMIT;
+  }
+  if (scaled < (float)-SNAPSHOT_LIMIT)
+  {
+    return -SNAPSHOT_LIMIT;
+  }
+  return (int32_t)scaled;
+}
+
+static uint32_t GetWidthClass(uint32_t value, const uint32_t (&widths)[4])
+{
+  uint32_t widthClass = 0;
+  while (widthClass < 3 && value >= (1u << widths[widthClass]))
+  {
+    widthClass++;
+  }
+  return widthClass;
+}
+
+static void WriteVar(mj::net::BitWriter& writer, uint32_t value, const uint32_t (&widths)[4])
+{
+  uint32_t widthClass = GetWidthClass(value, widths);
+  writer.Write(widthClass, 2);
+  writer.Write(value, widths[widthClass]);
+}
+
+static uint32_t GetVarBits(uint32_t value, const uint32_t (&widths)[4])
+{
+  return 2 + widths[GetWidthClass(value, widths)];
+}
+
+static uint32_t ReadVar(mj::net::BitReader& reader, const uint32_t (&widths)[4])
+{
+  return reader.Read(widths[reader.Read(2)]);
+}
+
+static uint32_t ZigZag(int32_t value)
+{
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static void WriteDelta(mj::net::BitWriter& writer, int32_t from, int32_t to)
+{
+  if (from == to)
+  {
+    writer.Write(0, 1);
+    return;
+  }
+
+  int32_t delta = to - from;
+  writer.Write(1, 1);
+  WriteVar(writer, ZigZag(delta), VALUE_WIDTHS);
+}
+
+static uint32_t GetDeltaBits(int32_t from, int32_t to)
+{
+  return (from == to) ? 1 : 1 + GetVarBits(ZigZag(to - from), VALUE_WIDTHS);
+}
+
+static int32_t ReadDelta(mj::net::BitReader& reader, int32_t from)
+{
+  if (!reader.Read(1))
+  {
+    return from;
+  }
+
+  uint32_t zigzag = ReadVar(reader, VALUE_WIDTHS);
+  return from + (int32_t)((zigzag >> 1) ^ (0u - (zigzag & 1)));
+}
+
+static void WriteValues(mj::net::BitWriter& writer, const EntityState& from, const EntityState& to)
+{
+  for (uint32_t i = 0; i < 3; i++)
+  {
+    WriteDelta(writer, from.position[i], to.position[i]);
+  }
+  for (uint32_t i = 0; i < 3; i++)
+  {
+    WriteDelta(writer, from.velocity[i], to.velocity[i]);
+  }
+}
+
+static uint32_t GetValuesBits(const EntityState& from, const EntityState& to)
+{
+  uint32_t numBits = 0;
+  for (uint32_t i = 0; i < 3; i++)
+  {
+    numBits += GetDeltaBits(from.position[i], to.position[i]);
+    numBits += GetDeltaBits(from.velocity[i], to.velocity[i]);
+  }
+  return numBits;
+}
+
+static void ReadValues(mj::net::BitReader& reader, EntityState* pState)
+{
+  for (uint32_t i = 0; i < 3; i++)
+  {
+    pState->position[i] = ReadDelta(reader, pState->position[i]);
+  }
+  for (uint32_t i = 0; i < 3; i++)
+  {
+    pState->velocity[i] = ReadDelta(reader, pState->velocity[i]);
+  }
+}
+
+static bool IsSameEntity(const EntityState& a, const EntityState& b)
+{
+  return (a.entity == b.entity) && (a.kind == b.kind);
+}
+
+static bool IsEqual(const EntityState& a, const EntityState& b)
+{
+  return IsSameEntity(a, b) &&                                     //
+         !memcmp(a.position, b.position, sizeof(a.position)) && //
+         !memcmp(a.velocity, b.velocity, sizeof(a.velocity));
+}
+
+bool SnapshotHistory::Init(uint32_t maxEntities)
+{
+  this->pStates = (EntityState*)malloc((size_t)SnapshotHistory::NUM_SNAPSHOTS * maxEntities * sizeof(EntityState));
+  if (!this->pStates)
+  {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < SnapshotHistory::NUM_SNAPSHOTS; i++)
+  {
+    this->snapshots[i].capacity  = maxEntities;
+    this->snapshots[i].pEntities = this->pStates + (size_t)i * maxEntities;
+  }
+  Clear();
+  return true;
+}
+
+void SnapshotHistory::Destroy()
+{
+  free(this->pStates);
+  this->pStates = nullptr;
+  for (Snapshot& snapshot : this->snapshots)
+  {
+    snapshot = Snapshot();
+  }
+}
+
+void SnapshotHistory::Clear()
+{
+  for (Snapshot& snapshot : this->snapshots)
+  {
+    snapshot.tick        = NO_SNAPSHOT;
+    snapshot.numEntities = 0;
+  }
+}
+
+Snapshot& SnapshotHistory::Claim(uint32_t tick)
+{
+  Snapshot& snapshot   = this->snapshots[tick % SnapshotHistory::NUM_SNAPSHOTS];
+  snapshot.tick        = tick;
+  snapshot.numEntities = 0;
+  return snapshot;
+}
+
+const Snapshot* SnapshotHistory::Find(uint32_t tick) const
+{
+  const Snapshot& snapshot = this->snapshots[tick % SnapshotHistory::NUM_SNAPSHOTS];
+  return (tick != NO_SNAPSHOT && snapshot.tick == tick) ? &snapshot : nullptr;
+}
+
+static bool IsLowerIndex(const EntityState& a, const EntityState& b)
+{
+  return a.entity.index < b.entity.index;
+}
+
+void CaptureSnapshot(const World& world, Snapshot* pSnapshot)
+{
+  ZoneScoped;
+  const mj::Entity* pEntities  = world.bodies.GetEntities();
+  const mjm::vec3* pPositions  = world.bodies.Data<BODY_POSITION>();
+  const mjm::vec3* pVelocities = world.bodies.Data<BODY_VELOCITY>();
+  EntityState* pStates         = pSnapshot->pEntities;
+  uint32_t capacity            = pSnapshot->capacity;
+  uint32_t count               = 0;
+  for (uint32_t i = 0; i < world.bodies.Size(); i++)
+  {
+    uint32_t kind = world.kinds.Find(pEntities[i]);
+    if (kind == world.kinds.INVALID || capacity == 0)
+    {
+      continue;
+    }
+
+    EntityState state;
+    state.entity = pEntities[i];
+    state.kind   = world.kinds.Data<0>()[kind];
+    for (uint32_t j = 0; j < 3; j++)
+    {
+      state.position[j] = Quantize(pPositions[i][j]);
+      state.velocity[j] = Quantize(pVelocities[i][j]);
+    }
+
+    // When the snapshot is full, a max-heap on the index keeps the lowest indices
+    if (count < capacity)
+    {
+      pStates[count++] = state;
+      if (count == capacity)
+      {
+        std::make_heap(pStates, pStates + count, IsLowerIndex);
+      }
+    }
+    else if (IsLowerIndex(state, pStates[0]))
+    {
+      std::pop_heap(pStates, pStates + count, IsLowerIndex);
+      pStates[count - 1] = state;
+      std::push_heap(pStates, pStates + count, IsLowerIndex);
+    }
+  }
+
+  std::sort(pStates, pStates + count, IsLowerIndex);
+  pSnapshot->numEntities = count;
+}
+
+mjm::vec3 GetPosition(const EntityState& state)
+{
+  return mjm::vec3((float)state.position[0], (float)state.position[1], (float)state.position[2]) *
+         (1.0f / SNAPSHOT_SCALE);
+}
+
+mjm::vec3 GetVelocity(const EntityState& state)
+{
+  return mjm::vec3((float)state.velocity[0], (float)state.velocity[1], (float)state.velocity[2]) *
+         (1.0f / SNAPSHOT_SCALE);
+}
+
+/// <summary>
+/// Steps through a baseline and a snapshot by entity index
+/// </summary>
+/// <param name="ppOld">Receives the baseline entity at the returned index, nullptr if there is none</param>
+/// <param name="ppNew">Receives the snapshot entity at the returned index, nullptr if there is none</param>
+/// <returns>Next entity index in either, NO_INDEX at the end of both</returns>
+static uint32_t NextIndex(const Snapshot& baseline, uint32_t b, const Snapshot& snapshot, uint32_t s,
+                          const EntityState** ppOld, const EntityState** ppNew)
+{
+  uint32_t oldIndex = b < baseline.numEntities ? baseline.pEntities[b].entity.index : NO_INDEX;
+  uint32_t newIndex = s < snapshot.numEntities ? snapshot.pEntities[s].entity.index : NO_INDEX;
+  uint32_t index    = oldIndex < newIndex ? oldIndex : newIndex;
+  *ppOld            = (index != NO_INDEX && oldIndex == index) ? &baseline.pEntities[b] : nullptr;
+  *ppNew            = (index != NO_INDEX && newIndex == index) ? &snapshot.pEntities[s] : nullptr;
+  return index;
+}
+
+/// <returns>Position of the first entity with at least this index</returns>
+static uint32_t FindIndex(const Snapshot& snapshot, uint32_t index)
+{
+  const EntityState* pBegin = snapshot.pEntities;
+  const EntityState* pEnd   = pBegin + snapshot.numEntities;
+  auto isBefore             = [](const EntityState& state, uint32_t index) { return state.entity.index < index; };
+  return (uint32_t)(std::lower_bound(pBegin, pEnd, index, isBefore) - pBegin);
+}
+
+static uint32_t GetRecordBits(const EntityState* pOld, const EntityState* pNew, uint32_t gap)
+{
+  uint32_t numBits = GetVarBits(gap, INDEX_WIDTHS) + 2;
+  if (!pNew)
+  {
+    return numBits;
+  }
+  if (pOld && IsSameEntity(*pOld, *pNew))
+  {
+    return numBits + GetValuesBits(*pOld, *pNew);
+  }
+  const EntityState empty = {};
+  return numBits + GetVarBits(pNew->entity.generation, INDEX_WIDTHS) + 8 + GetValuesBits(empty, *pNew);
+}
+
+/// <summary>
+/// Adds up the records of the changed entities with an index from first to last (exclusive), while they fit
+/// </summary>
+/// <param name="pNumBits">Bits used so far, the records are added to it</param>
+/// <returns>Index of the first changed entity that does not fit, last if all of them do</returns>
+static uint32_t FitRecords(const Snapshot& baseline, const Snapshot& snapshot, uint32_t first, uint32_t last,
+                           uint32_t maxBits, uint32_t* pNumBits)
+{
+  uint32_t b        = FindIndex(baseline, first);
+  uint32_t s        = FindIndex(snapshot, first);
+  uint32_t previous = 0; // The gap of the first record is counted from 0, which is never less than when encoded
+  for (;;)
+  {
+    MJ_UNINITIALIZED const EntityState* pOld;
+    MJ_UNINITIALIZED const EntityState* pNew;
+    uint32_t index = NextIndex(baseline, b, snapshot, s, &pOld, &pNew);
+    if (index >= last)
+    {
+      return last;
+    }
+    b += pOld ? 1 : 0;
+    s += pNew ? 1 : 0;
+    if (pOld && pNew && IsEqual(*pOld, *pNew))
+    {
+      continue;
+    }
+
+    uint32_t numBits = GetRecordBits(pOld, pNew, index - previous);
+    if (*pNumBits + numBits > maxBits)
+    {
+      return index;
+    }
+    *pNumBits += numBits;
+    previous = index + 1;
+  }
+}
+
+/// <summary>
+/// Writes the record count and, by increasing index, the records of the changed entities with an index below
+/// lowerEnd or from first to upperEnd (exclusive). The other entities keep their baseline state in pSent.
+/// </summary>
+/// <returns>False if it stopped because the next record might not fit in maxBits</returns>
+static bool WriteRecords(const Snapshot& baseline, const Snapshot& snapshot, uint32_t first, uint32_t upperEnd,
+                         uint32_t lowerEnd, uint32_t maxBits, mj::MemoryBuffer& writer, Snapshot* pSent)
+{
+  char* pCount = writer.Position();
+  writer.Skip(sizeof(uint16_t));
+
+  const EntityState empty = {};
+  mj::net::BitWriter bits(writer);
+  bool fits           = true;
+  uint32_t numRecords = 0;
+  uint32_t nextIndex  = 0;
+  uint32_t b          = 0;
+  uint32_t s          = 0;
+  uint32_t numSent    = 0;
+  for (;;)
+  {
+    MJ_UNINITIALIZED const EntityState* pOld;
+    MJ_UNINITIALIZED const EntityState* pNew;
+    uint32_t index = NextIndex(baseline, b, snapshot, s, &pOld, &pNew);
+    if (index == NO_INDEX)
+    {
+      break;
+    }
+
+    // Not within the budget this time: the receiver keeps the baseline up to where the budget applies again
+    if (index >= lowerEnd && (index < first || index >= upperEnd))
+    {
+      uint32_t resume = index < first ? first : NO_INDEX;
+      uint32_t bEnd   = FindIndex(baseline, resume);
+      while (b < bEnd)
+      {
+        pSent->pEntities[numSent++] = baseline.pEntities[b++];
+      }
+      s = FindIndex(snapshot, resume);
+      continue;
+    }
+
+    if (pOld && pNew && IsEqual(*pOld, *pNew))
+    {
+      pSent->pEntities[numSent++] = *pNew;
+      b++;
+      s++;
+      continue;
+    }
+
+    // A new entity grows the snapshot, what is left of the baseline has to fit behind it
+    fits = bits.GetNumBits() + MAX_RECORD_BITS <= maxBits;
+    if (!fits || (!pOld && numSent + (baseline.numEntities - b) >= pSent->capacity))
+    {
+      break;
+    }
+
+    WriteVar(bits, index - nextIndex, INDEX_WIDTHS);
+    nextIndex = index + 1;
+    numRecords++;
+    if (!pNew)
+    {
+      bits.Write(RECORD_REMOVE, 2);
+      b++;
+    }
+    else if (pOld && IsSameEntity(*pOld, *pNew))
+    {
+      bits.Write(RECORD_UPDATE, 2);
+      WriteValues(bits, *pOld, *pNew);
+      pSent->pEntities[numSent++] = *pNew;
+      b++;
+      s++;
+    }
+    else
+    {
+      // Also replaces a different entity in the same slot
+      bits.Write(RECORD_CREATE, 2);
+      WriteVar(bits, pNew->entity.generation, INDEX_WIDTHS);
+      bits.Write((uint32_t)pNew->kind, 8);
+      WriteValues(bits, empty, *pNew);
+      pSent->pEntities[numSent++] = *pNew;
+      b += pOld ? 1 : 0;
+      s++;
+    }
+  }
+  bits.Flush();
+
+  // Not reached: the receiver keeps the baseline
+  while (b < baseline.numEntities)
+  {
+    pSent->pEntities[numSent++] = baseline.pEntities[b++];
+  }
+  pSent->numEntities = numSent;
+
+  uint16_t count = (uint16_t)numRecords;
+  memcpy(pCount, &count, sizeof(count));
+  return fits;
+}
+
+bool EncodeSnapshot(const Snapshot& baseline, const Snapshot& snapshot, mj::MemoryBuffer& writer, Snapshot* pSent,
+                    uint32_t* pFirstIndex)
+{
+  ZoneScoped;
+  if (writer.SizeLeft() < sizeof(uint16_t) || pSent->capacity < baseline.numEntities)
+  {
+    return false;
+  }
+
+  // Every change, as long as there is room for the largest record, which is the normal case
+  uint32_t maxBits       = (uint32_t)(writer.SizeLeft() - sizeof(uint16_t)) * 8;
+  mj::MemoryBuffer start = writer;
+  if (WriteRecords(baseline, snapshot, 0, NO_INDEX, 0, maxBits, writer, pSent))
+  {
+    return writer.Good();
+  }
+
+  // Over the budget: the changes from the first index on get it first, those before it get what is left.
+  // The records are still written by increasing index, which only makes the gaps smaller than counted. The
+  // next delta starts where the budget ran out, so over a few packets every entity gets its turn.
+  writer            = start;
+  uint32_t numBits  = 0;
+  uint32_t first    = *pFirstIndex;
+  uint32_t upperEnd = FitRecords(baseline, snapshot, first, NO_INDEX, maxBits, &numBits);
+  uint32_t lowerEnd = upperEnd == NO_INDEX ? FitRecords(baseline, snapshot, 0, first, maxBits, &numBits) : 0;
+  *pFirstIndex      = upperEnd == NO_INDEX ? lowerEnd : upperEnd;
+  MJ_DISCARD(WriteRecords(baseline, snapshot, first, upperEnd, lowerEnd, UINT32_MAX, writer, pSent));
+  return writer.Good();
+}
+
+bool DecodeSnapshot(const Snapshot& baseline, mj::MemoryBuffer& reader, Snapshot* pSnapshot)
+{
+  ZoneScoped;
+  MJ_UNINITIALIZED uint16_t numRecords;
+  if (!reader.Read(numRecords).Good())
+  {
+    return false;
+  }
+
+  mj::net::BitReader bits(reader);
+  uint32_t nextIndex = 0;
+  uint32_t b         = 0;
+  uint32_t count     = 0;
+  for (uint32_t i = 0; i < numRecords; i++)
+  {
+    uint32_t index     = nextIndex + ReadVar(bits, INDEX_WIDTHS);
+    uint32_t operation = bits.Read(2);
+    if (!bits.Good() || index < nextIndex)
+    {
+      return false;
+    }
+    nextIndex = index + 1;
+
+    while (b < baseline.numEntities && baseline.pEntities[b].entity.index < index && count < pSnapshot->capacity)
+    {
+      pSnapshot->pEntities[count++] = baseline.pEntities[b++];
+    }
+    const EntityState* pOld = nullptr;
+    if (b < baseline.numEntities && baseline.pEntities[b].entity.index == index)
+    {
+      pOld = &baseline.pEntities[b++];
+    }
+    if (count >= pSnapshot->capacity)
+    {
+      return false;
+    }
+
+    EntityState& state = pSnapshot->pEntities[count];
+    switch (operation)
+    {
+    case RECORD_UPDATE:
+      if (!pOld)
+      {
+        return false;
+      }
+      state = *pOld;
+      ReadValues(bits, &state);
+      count++;
+      break;
+    case RECORD_CREATE:
+      state                   = {};
+      state.entity.index      = index;
+      state.entity.generation = ReadVar(bits, INDEX_WIDTHS);
+      state.kind              = (EntityKind)bits.Read(8);
+      ReadValues(bits, &state);
+      count++;
+      break;
+    case RECORD_REMOVE:
+      if (!pOld)
+      {
+        return false;
+      }
+      break;
+    default:
+      return false;
+    }
+  }
+
+  if (count + (baseline.numEntities - b) > pSnapshot->capacity)
+  {
+    return false;
+  }
+  while (b < baseline.numEntities)
+  {
+    pSnapshot->pEntities[count++] = baseline.pEntities[b++];
+  }
+  pSnapshot->numEntities = count;
+  return bits.Good();
+}
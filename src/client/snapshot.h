@@ -0,0 +1,89 @@
+// Snapshot - replicated world state and its delta-compressed encoding
+// Should not use pre-compiled headers (for portability)
+//
+// A snapshot is the state of every replicated entity after one tick, sorted by entity index,
+// with positions and velocities quantized to fixed point so both sides agree on every bit.
+// It is encoded against a baseline: an older snapshot the receiver has acknowledged.
+// Entities equal to the baseline cost nothing, the others are records of bit-packed deltas
+// whose widths follow their magnitude. Without a baseline the empty snapshot is used.
+//
+// The encoder stays within a bit budget. Entities that do not fit keep their baseline state in
+// the snapshot it reports as sent, which is exactly what the receiver decodes, so the sender can
+// use it as a baseline later. The next delta gives the budget to the entities that did not fit
+// first, so none of them is left out for long.
+
+#pragma once
+#include "world.h"
+
+static constexpr uint32_t MAX_SNAPSHOT_ENTITIES = 512;
+static constexpr uint32_t NO_SNAPSHOT           = UINT32_MAX; // Tick of an empty slot, or of no baseline
+static constexpr float SNAPSHOT_SCALE           = 256.0f;     // Fixed point steps per cell
+static constexpr int32_t SNAPSHOT_LIMIT         = (1 << 22) - 1; // Largest quantized magnitude
+
+struct EntityState
+{
+  mj::Entity entity;
+  int32_t position[3]; // 1 / SNAPSHOT_SCALE cells
+  int32_t velocity[3]; // 1 / SNAPSHOT_SCALE cells per second
+  EntityKind kind;
+};
+
+struct Snapshot
+{
+  uint32_t tick          = NO_SNAPSHOT;
+  uint32_t numEntities   = 0;
+  uint32_t capacity      = 0;
+  EntityState* pEntities = nullptr; // Sorted by entity index
+};
+
+/// <summary>
+/// The last NUM_SNAPSHOTS snapshots by tick, for baselines
+/// </summary>
+class SnapshotHistory
+{
+public:
+  static constexpr uint32_t NUM_SNAPSHOTS = 16;
+
+  bool Init(uint32_t maxEntities = MAX_SNAPSHOT_ENTITIES);
+  void Destroy();
+
+  /// <summary>
+  /// Forgets all snapshots
+  /// </summary>
+  void Clear();
+
+  /// <summary>
+  /// Empties the slot of a tick for a new snapshot, overwriting the one from NUM_SNAPSHOTS ticks before.
+  /// </summary>
+  Snapshot& Claim(uint32_t tick);
+
+  /// <returns>nullptr if the snapshot of this tick has been overwritten or was never stored</returns>
+  const Snapshot* Find(uint32_t tick) const;
+
+private:
+  Snapshot snapshots[NUM_SNAPSHOTS];
+  EntityState* pStates = nullptr;
+};
+
+/// <summary>
+/// Quantizes all entities with a body, up to the capacity of the snapshot
+/// </summary>
+void CaptureSnapshot(const World& world, Snapshot* pSnapshot);
+
+mjm::vec3 GetPosition(const EntityState& state);
+mjm::vec3 GetVelocity(const EntityState& state);
+
+/// <summary>
+/// Writes the difference between two snapshots, using at most the space left in the buffer.
+/// </summary>
+/// <param name="pSent">Receives the snapshot that the decoder will produce, may be truncated</param>
+/// <param name="pFirstIndex">Entity index the budget goes to first, receives the first one that did not fit</param>
+/// <returns>False if not even an empty delta fits</returns>
+bool EncodeSnapshot(const Snapshot& baseline, const Snapshot& snapshot, mj::MemoryBuffer& writer, Snapshot* pSent,
+                    uint32_t* pFirstIndex);
+
+/// <summary>
+/// Applies a delta written by EncodeSnapshot to its baseline. The tick is not touched.
+/// </summary>
+/// <returns>False if the data is invalid or the snapshot is too small</returns>
+bool DecodeSnapshot(const Snapshot& baseline, mj::MemoryBuffer& reader, Snapshot* pSnapshot);
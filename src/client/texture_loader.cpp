@@ -0,0 +1,104 @@
+#include "pch.h"
+#include "texture_loader.h"
+#include "mj_frame_stats.h"
+
+bool TextureLoader::Init()
+{
+  this->running = true;
+  this->loader  = std::thread(&TextureLoader::RunLoader, this);
+  return true;
+}
+
+void TextureLoader::Destroy()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->running = false;
+  }
+  this->condition.notify_all();
+  if (this->loader.joinable())
+  {
+    this->loader.join();
+  }
+
+  TextureArrayData::Free(this->loaded);
+  this->ready     = false;
+  this->requested = false;
+}
+
+bool TextureLoader::Request(const char* pPath)
+{
+  size_t pathLength = strlen(pPath);
+  if (pathLength >= TextureLoader::MAX_PATH_LENGTH)
+  {
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    memcpy(this->path, pPath, pathLength + 1);
+    this->requested = true;
+  }
+  this->condition.notify_all();
+  return true;
+}
+
+bool TextureLoader::Take(TextureArrayData* pData)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (!this->ready)
+  {
+    return false;
+  }
+  *pData       = this->loaded;
+  this->loaded = {};
+  this->ready  = false;
+  return true;
+}
+
+TextureLoader::Stats TextureLoader::GetStats()
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->stats;
+}
+
+void TextureLoader::RunLoader()
+{
+#ifdef MJ_PROFILER_ENABLED
+  mj::profiler::SetThreadName("Texture loader");
+#endif
+  for (;;)
+  {
+    MJ_UNINITIALIZED char pathCopy[TextureLoader::MAX_PATH_LENGTH];
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->condition.wait(lock, [this] { return this->requested || !this->running; });
+      if (!this->running)
+      {
+        return;
+      }
+      memcpy(pathCopy, this->path, sizeof(pathCopy));
+      this->requested = false;
+    }
+
+    // The main thread keeps drawing with the current texture array meanwhile
+    double start          = mj::stats::Now();
+    TextureArrayData data = TextureArrayData::Load(pathCopy);
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      if (data.info.numLayers > 0)
+      {
+        TextureArrayData::Free(this->loaded); // Not taken in time
+        this->loaded       = data;
+        this->ready        = true;
+        this->stats.loadMs = (float)(mj::stats::Now() - start);
+        this->stats.numLoaded++;
+      }
+      else
+      {
+        this->stats.numFailed++;
+      }
+    }
+  }
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "graphics.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/// <summary>
+/// Reads and parses the texture array on a background thread, e.g. after it changed on disk. The
+/// resident layers that changed are uploaded on the main thread (Graphics::UpdateTextureArray()), as the
+/// device context is not free-threaded. A request while a texture array is loading loads it again
+/// afterwards, so the last change is never missed.
+/// </summary>
+class TextureLoader
+{
+public:
+  static constexpr uint32_t MAX_PATH_LENGTH = 256;
+
+  struct Stats
+  {
+    float loadMs; // Of the last texture array that was loaded: file and parsing
+    uint32_t numLoaded;
+    uint32_t numFailed; // Missing, corrupt or in a format the game does not support
+  };
+
+  /// <summary>
+  /// Starts the loader thread
+  /// </summary>
+  bool Init();
+
+  /// <summary>
+  /// Finishes the load in progress, frees a texture array that was not taken and stops the loader thread
+  /// </summary>
+  void Destroy();
+
+  /// <summary>
+  /// Starts loading a texture array. One that is ready but not taken yet is replaced once this one loaded.
+  /// </summary>
+  /// <returns>False if the path is too long</returns>
+  bool Request(const char* pPath);
+
+  /// <summary>
+  /// Hands over a loaded texture array, which the caller frees with TextureArrayData::Free()
+  /// </summary>
+  /// <returns>False if none is ready</returns>
+  bool Take(TextureArrayData* pData);
+
+  Stats GetStats();
+
+private:
+  void RunLoader();
+
+  TextureArrayData loaded = {};
+  bool ready              = false; // loaded can be taken
+  bool requested          = false; // path should be loaded
+  bool running            = false;
+  Stats stats             = {};
+  char path[MAX_PATH_LENGTH];
+  std::mutex mutex; // Guards loaded, ready, requested, running, path and stats
+  std::condition_variable condition;
+  std::thread loader;
+};
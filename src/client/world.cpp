@@ -0,0 +1,258 @@
+// World - simulation state of all actors
+// Should not use pre-compiled headers (for portability)
+
+#include "world.h"
+#include "mj_collision.h"
+#include "mj_hash.h"
+#include "mj_jobs.h"
+#include "mj_profiler.h"
+
+// Bodies per job when moving in parallel
+static constexpr uint32_t MOVE_GRAIN_SIZE = 256;
+
+bool World::Init(uint32_t maxEntities)
+{
+  if (this->entities.Init(maxEntities) &&  //
+      this->kinds.Init(maxEntities) &&     //
+      this->bodies.Init(maxEntities) &&    //
+      this->lifetimes.Init(maxEntities) && //
+      this->inputs.Init(maxEntities))
+  {
+    return true;
+  }
+
+  Destroy();
+  return false;
+}
+
+void World::Destroy()
+{
+  this->entities.Destroy();
+  this->kinds.Destroy();
+  this->bodies.Destroy();
+  this->lifetimes.Destroy();
+  this->inputs.Destroy();
+}
+
+void World::Clear()
+{
+  this->entities.Clear();
+  this->kinds.Clear();
+  this->bodies.Clear();
+  this->lifetimes.Clear();
+  this->inputs.Clear();
+  this->tick = 0;
+}
+
+void World::Reset()
+{
+  Clear();
+  this->entities.Reset();
+}
+
+mj::Entity World::Spawn(EntityKind kind, const mjm::vec3& position, float radius)
+{
+  mj::Entity entity = this->entities.Create();
+  if (entity != mj::NULL_ENTITY)
+  {
+    this->kinds.Data<0>()[this->kinds.Add(entity)] = kind;
+
+    uint32_t body                            = this->bodies.Add(entity);
+    this->bodies.Data<BODY_POSITION>()[body] = position;
+    this->bodies.Data<BODY_VELOCITY>()[body] = mjm::vec3::zero();
+    this->bodies.Data<BODY_RADIUS>()[body]   = radius;
+    this->bodies.Data<BODY_BLOCKED>()[body]  = false;
+  }
+  return entity;
+}
+
+void World::Kill(mj::Entity entity)
+{
+  if (this->entities.IsAlive(entity))
+  {
+    this->kinds.Remove(entity);
+    this->bodies.Remove(entity);
+    this->lifetimes.Remove(entity);
+    this->inputs.Remove(entity);
+    this->entities.Destroy(entity);
+  }
+}
+
+/// <summary>
+/// Sine and cosine of a yaw angle using only multiplies and adds, so the result is the same on every platform
+/// </summary>
+static void SinCos(uint16_t yaw, float* pSin, float* pCos)
+{
+  // Quarter turns are exact, the rest is a polynomial over [-1/8, 1/8] turn
+  uint32_t quadrant = (((uint32_t)yaw + 0x2000) >> 14) & 3;
+  int32_t rest      = (int16_t)(uint16_t)(yaw - (quadrant << 14));
+  float x           = (float)rest * (6.28318530718f / 65536.0f);
+  float x2          = x * x;
+  float s           = x * (1.0f + x2 * (-1.0f / 6.0f + x2 * (1.0f / 120.0f + x2 * (-1.0f / 5040.0f))));
+  float c           = 1.0f + x2 * (-0.5f + x2 * (1.0f / 24.0f + x2 * (-1.0f / 720.0f + x2 * (1.0f / 40320.0f))));
+  switch (quadrant)
+  {
+  case 0:
+    *pSin = s;
+    *pCos = c;
+    break;
+  case 1:
+    *pSin = c;
+    *pCos = -s;
+    break;
+  case 2:
+    *pSin = -s;
+    *pCos = -c;
+    break;
+  default:
+    *pSin = -c;
+    *pCos = s;
+    break;
+  }
+}
+
+mjm::vec3 GetInputVelocity(const PlayerInput& input)
+{
+  MJ_UNINITIALIZED float s, c;
+  SinCos(input.yaw, &s, &c);
+
+  float forward = (float)(((input.buttons & INPUT_FORWARD) ? 1 : 0) - ((input.buttons & INPUT_BACKWARD) ? 1 : 0));
+  float right   = (float)(((input.buttons & INPUT_RIGHT) ? 1 : 0) - ((input.buttons & INPUT_LEFT) ? 1 : 0));
+
+  // Forward is (sin, cos), right is (cos, -sin)
+  return mjm::vec3((forward * s + right * c) * World::PLAYER_SPEED, 0.0f,
+                   (forward * c - right * s) * World::PLAYER_SPEED);
+}
+
+/// <summary>
+/// Turns player commands into body velocities
+/// </summary>
+static void ApplyInputs(World& world)
+{
+  ZoneScoped;
+  for (uint32_t i = 0; i < world.inputs.Size(); i++)
+  {
+    uint32_t body = world.bodies.Find(world.inputs.GetEntities()[i]);
+    if (body == world.bodies.INVALID)
+    {
+      continue;
+    }
+
+    world.bodies.Data<BODY_VELOCITY>()[body] = GetInputVelocity(world.inputs.Data<0>()[i]);
+  }
+}
+
+/// <summary>
+/// Moves all bodies by their velocity, colliding with the level. Bodies do not affect each other.
+/// </summary>
+static void MoveBodies(World& world, const mj::Grid& grid, float dt)
+{
+  ZoneScoped;
+  mjm::vec3* pPositions        = world.bodies.Data<BODY_POSITION>();
+  const mjm::vec3* pVelocities = world.bodies.Data<BODY_VELOCITY>();
+  const float* pRadii          = world.bodies.Data<BODY_RADIUS>();
+  bool* pBlocked               = world.bodies.Data<BODY_BLOCKED>();
+
+  mj::jobs::ParallelFor(world.bodies.Size(), MOVE_GRAIN_SIZE, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++)
+    {
+      mj::collision::MoveResult result = mj::collision::Move(grid, pPositions[i], pVelocities[i] * dt, pRadii[i]);
+      pPositions[i]                    = result.position;
+      pBlocked[i]                      = result.hitX || result.hitZ;
+    }
+  });
+}
+
+/// <summary>
+/// Projectiles are destroyed when they hit a wall
+/// </summary>
+static void KillBlockedProjectiles(World& world)
+{
+  ZoneScoped;
+  // Backwards, so removal (swap with last) does not skip elements
+  for (uint32_t i = world.bodies.Size(); i-- > 0;)
+  {
+    if (world.bodies.Data<BODY_BLOCKED>()[i])
+    {
+      mj::Entity entity = world.bodies.GetEntities()[i];
+      uint32_t kind     = world.kinds.Find(entity);
+      if (kind != world.kinds.INVALID && world.kinds.Data<0>()[kind] == EntityKind::Projectile)
+      {
+        world.Kill(entity);
+      }
+    }
+  }
+}
+
+static void ExpireLifetimes(World& world, float dt)
+{
+  ZoneScoped;
+  for (uint32_t i = world.lifetimes.Size(); i-- > 0;)
+  {
+    float& lifetime = world.lifetimes.Data<0>()[i];
+    lifetime -= dt;
+    if (lifetime <= 0.0f)
+    {
+      world.Kill(world.lifetimes.GetEntities()[i]);
+    }
+  }
+}
+
+void World::Tick(const mj::Grid& grid, float dt)
+{
+  ZoneScoped;
+  ApplyInputs(*this);
+  MoveBodies(*this, grid, dt);
+  KillBlockedProjectiles(*this);
+  ExpireLifetimes(*this, dt);
+  this->tick++;
+}
+
+uint64_t World::Hash() const
+{
+  ZoneScoped;
+  uint64_t hash = mj::Hash64(&this->tick, sizeof(this->tick));
+  hash          = this->entities.Hash(hash);
+  hash          = this->kinds.Hash(hash);
+  hash          = this->bodies.Hash(hash);
+  hash          = this->lifetimes.Hash(hash);
+  return this->inputs.Hash(hash);
+}
+
+size_t World::GetSaveSize() const
+{
+  return sizeof(this->tick) +            //
+         this->entities.GetSaveSize() +  //
+         this->kinds.GetSaveSize() +     //
+         this->bodies.GetSaveSize() +    //
+         this->lifetimes.GetSaveSize() + //
+         this->inputs.GetSaveSize();
+}
+
+void World::Save(mj::MemoryBuffer& writer) const
+{
+  ZoneScoped;
+  writer.Write(this->tick);
+  this->entities.Save(writer);
+  this->kinds.Save(writer);
+  this->bodies.Save(writer);
+  this->lifetimes.Save(writer);
+  this->inputs.Save(writer);
+}
+
+bool World::Load(mj::MemoryBuffer& reader)
+{
+  ZoneScoped;
+  if (reader.Read(this->tick).Good() && //
+      this->entities.Load(reader) &&    //
+      this->kinds.Load(reader) &&       //
+      this->bodies.Load(reader) &&      //
+      this->lifetimes.Load(reader) &&   //
+      this->inputs.Load(reader))
+  {
+    return true;
+  }
+
+  Clear();
+  return false;
+}
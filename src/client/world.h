@@ -0,0 +1,128 @@
+// World - simulation state of all actors
+// Should not use pre-compiled headers (for portability)
+//
+// The simulation is deterministic: a tick only reads the world, the grid, the PlayerInput components
+// and a fixed dt, and only uses IEEE add, subtract, multiply, divide, sqrt, floor and ceil, which are
+// exactly rounded everywhere. Equal inputs then give bit-identical states, which Hash() makes cheap
+// to compare across peers and replays. This relies on strict float code generation:
+// no /fp:fast or -ffast-math, and no FMA contraction.
+
+#pragma once
+#include "mj_entities.h"
+#include "mj_grid.h"
+
+enum class EntityKind : uint8_t
+{
+  Player,
+  Enemy,
+  Projectile,
+  Pickup,
+};
+
+/// <summary>
+/// Body component arrays, see World::bodies
+/// </summary>
+enum
+{
+  BODY_POSITION, // mjm::vec3
+  BODY_VELOCITY, // mjm::vec3, cells per second
+  BODY_RADIUS,   // float, half extent of the collision box
+  BODY_BLOCKED,  // bool, set if the last move hit a wall
+};
+
+enum : uint16_t
+{
+  INPUT_FORWARD  = 1 << 0,
+  INPUT_BACKWARD = 1 << 1,
+  INPUT_LEFT     = 1 << 2,
+  INPUT_RIGHT    = 1 << 3,
+};
+
+/// <summary>
+/// Commands of one player for one tick. Everything the simulation reads from outside the world.
+/// </summary>
+struct PlayerInput
+{
+  uint16_t buttons; // INPUT_* flags
+  uint16_t yaw;     // 65536 = full turn, 0 faces +Z, 16384 faces +X
+};
+
+class World
+{
+public:
+  static constexpr uint32_t MAX_ENTITIES = 16384;
+  static constexpr float PLAYER_SPEED    = 3.0f; // Cells per second
+
+  bool Init(uint32_t maxEntities = World::MAX_ENTITIES);
+  void Destroy();
+
+  /// <summary>
+  /// Removes all entities
+  /// </summary>
+  void Clear();
+
+  /// <summary>
+  /// Returns to the state right after Init(), so that two worlds can start in lockstep.
+  /// Handles from before the reset may resolve again, only call it when nothing holds any.
+  /// </summary>
+  void Reset();
+
+  /// <summary>
+  /// Creates an entity with a body.
+  /// </summary>
+  /// <returns>NULL_ENTITY if the world is full</returns>
+  mj::Entity Spawn(EntityKind kind, const mjm::vec3& position, float radius);
+
+  /// <summary>
+  /// Destroys an entity and removes all of its components. Stale handles are ignored.
+  /// </summary>
+  void Kill(mj::Entity entity);
+
+  /// <summary>
+  /// Runs all systems for one fixed simulation step.
+  /// </summary>
+  void Tick(const mj::Grid& grid, float dt);
+
+  /// <summary>
+  /// Hash of the complete simulation state. Equal hashes after the same tick mean the states are equal.
+  /// </summary>
+  uint64_t Hash() const;
+
+  /// <summary>
+  /// Bytes written by Save()
+  /// </summary>
+  size_t GetSaveSize() const;
+
+  /// <summary>
+  /// Writes the complete simulation state, one copy per component array.
+  /// </summary>
+  void Save(mj::MemoryBuffer& writer) const;
+
+  /// <summary>
+  /// Restores a state written by Save() into a world with the same capacity.
+  /// </summary>
+  /// <returns>False if the data does not fit this world, which is then left empty</returns>
+  bool Load(mj::MemoryBuffer& reader);
+
+  mj::EntityPool entities;
+  mj::ComponentPool<EntityKind> kinds;
+  mj::ComponentPool<mjm::vec3, mjm::vec3, float, bool> bodies;
+  /// <summary>
+  /// Seconds left before the entity is killed
+  /// </summary>
+  mj::ComponentPool<float> lifetimes;
+  /// <summary>
+  /// Commands of player-controlled entities, applied at the start of every tick
+  /// </summary>
+  mj::ComponentPool<PlayerInput> inputs;
+  /// <summary>
+  /// Ticks since the last Clear()
+  /// </summary>
+  uint32_t tick = 0;
+};
+
+/// <summary>
+/// Velocity of a player body for one tick of input, in cells per second.
+/// Client-side prediction moves the local player with this too, so both sides compute the same positions.
+/// </summary>
+mjm::vec3 GetInputVelocity(const PlayerInput& input);
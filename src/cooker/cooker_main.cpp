@@ -0,0 +1,554 @@
+// Asset cooker - builds runtime assets from source files, on any platform
+// Usage: cooker texarray -o file [--format F] [--quality Q] [--filter box|kaiser] [--threads N] [--list file]
+//                         [image...]
+//   -o         Output DDS file, e.g. assets/texture_array.dds
+//   --format   bc7 (default), bc3, bc1 or rgba8. See mj_bc.h.
+//   --quality  Block compression effort: fast, normal (default) or best
+//   --filter   Mip filter, kaiser (default) or box. See mj_image.h.
+//   --threads  Worker threads besides the main thread, default one per remaining core
+//   --list     Text file with one image per line, after the images on the command line. Empty lines and
+//              lines starting with # are skipped.
+// texarray assembles TGA or BMP images of the same size into a texture array, layer i being the i-th
+// image, with full mip chains. Images are loaded and mipmapped in parallel, one layer per job, and then
+// compressed one row of blocks per job. The PSNR of the compressed mips is printed.
+//
+// Usage: cooker pack -o file [--root dir] [--store] [--threads N] [--list file] [asset...]
+//   -o         Output pack, e.g. assets/assets.mjp
+//   --root     Directory the assets are read from, default the current one
+//   --store    Stores every asset as it is. By default assets are compressed if that saves an eighth.
+//   --threads  As for texarray
+//   --list     As for texarray
+// pack puts assets into one pack file (mj_pack.h), each under its path relative to the root, e.g.
+// "texture_array.dds". Assets are read and compressed in parallel, one asset per job. The written pack
+// is opened again and every entry checked against its asset.
+#include "mj_bc.h"
+#include "mj_common.h"
+#include "mj_dds.h"
+#include "mj_file.h"
+#include "mj_frame_stats.h"
+#include "mj_image.h"
+#include "mj_jobs.h"
+#include "mj_pack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static constexpr const char* USAGE =
+    "Usage: cooker texarray -o file [--format bc7|bc3|bc1|rgba8] [--quality fast|normal|best]\n"
+    "                       [--filter box|kaiser] [--threads N] [--list file] [image...]\n"
+    "       cooker pack -o file [--root dir] [--store] [--threads N] [--list file] [asset...]\n";
+
+/// <summary>
+/// Adds the lines of a list file to the paths. The paths point into the returned text.
+/// </summary>
+/// <returns>The text, nullptr if the file could not be read</returns>
+static char* ReadList(const char* pPath, mj::ArrayList<const char*>& paths)
+{
+  MJ_UNINITIALIZED size_t size;
+  char* pText = (char*)mj::ReadFile(pPath, &size);
+  if (!pText)
+  {
+    return nullptr;
+  }
+
+  for (char* pLine = strtok(pText, "\r\n"); pLine; pLine = strtok(nullptr, "\r\n"))
+  {
+    if (pLine[0] != '#')
+    {
+      MJ_DISCARD(paths.EmplaceSingle(pLine));
+    }
+  }
+  return pText;
+}
+
+static bool ParseFormat(const char* pName, mj::dds::Format* pFormat)
+{
+  static const struct
+  {
+    const char* pName;
+    mj::dds::Format format;
+  } s_Formats[] = {
+    { "rgba8", mj::dds::Format::RGBA8 }, //
+    { "bc1", mj::dds::Format::BC1 },     //
+    { "bc3", mj::dds::Format::BC3 },     //
+    { "bc7", mj::dds::Format::BC7 },     //
+  };
+  for (const auto& entry : s_Formats)
+  {
+    if (!strcmp(pName, entry.pName))
+    {
+      *pFormat = entry.format;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ParseQuality(const char* pName, mj::bc::Quality* pQuality)
+{
+  static const char* s_Names[] = { "fast", "normal", "best" };
+  for (uint32_t i = 0; i < MJ_COUNTOF(s_Names); i++)
+  {
+    if (!strcmp(pName, s_Names[i]))
+    {
+      *pQuality = (mj::bc::Quality)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+/// <summary>
+/// Compresses every mip of every layer, one row of blocks per job
+/// </summary>
+/// <param name="pChains">numLayers RGBA8 mip chains</param>
+/// <param name="pBlocks">numLayers * dds::GetLayerSize(format, ...) bytes</param>
+static void Compress(mj::dds::Format format, mj::bc::Quality quality, const uint8_t* pChains, uint32_t width,
+                     uint32_t height, uint32_t numMips, uint32_t numLayers, uint8_t* pBlocks)
+{
+  size_t chainSize = mj::dds::GetLayerSize(mj::dds::Format::RGBA8, width, height, numMips);
+  size_t layerSize = mj::dds::GetLayerSize(format, width, height, numMips);
+  uint32_t numRows = 0; // Per layer
+  for (uint32_t mip = 0; mip < numMips; mip++)
+  {
+    numRows += ((height >> mip) + 3) / 4;
+  }
+
+  mj::jobs::ParallelFor(numRows * numLayers, 1, [=](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++)
+    {
+      const uint8_t* pSrc = pChains + (i / numRows) * chainSize;
+      uint8_t* pDst       = pBlocks + (i / numRows) * layerSize;
+      uint32_t row        = i % numRows;
+      uint32_t mipWidth   = width;
+      uint32_t mipHeight  = height;
+      while (row >= (mipHeight + 3) / 4)
+      {
+        row -= (mipHeight + 3) / 4;
+        pSrc += mj::dds::GetMipSize(mj::dds::Format::RGBA8, mipWidth, mipHeight);
+        pDst += mj::dds::GetMipSize(format, mipWidth, mipHeight);
+        mipWidth  = mipWidth > 1 ? mipWidth / 2 : 1;
+        mipHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+      }
+
+      // The last row of a mip smaller than a block repeats its texels
+      uint32_t rowHeight = (mipHeight - row * 4 < 4) ? mipHeight - row * 4 : 4;
+      mj::bc::Encode(format, pSrc + (size_t)row * 4 * mipWidth * 4, mipWidth, rowHeight, quality,
+                     pDst + row * mj::dds::GetMipSize(format, mipWidth, 1));
+    }
+  });
+}
+
+/// <summary>
+/// Decodes the compressed mips of every layer and compares them to the originals
+/// </summary>
+/// <param name="pErrors">Squared error per layer, over all mips</param>
+static void Measure(mj::dds::Format format, const uint8_t* pChains, const uint8_t* pBlocks, uint32_t width,
+                    uint32_t height, uint32_t numMips, uint32_t numLayers, uint64_t* pErrors)
+{
+  size_t chainSize = mj::dds::GetLayerSize(mj::dds::Format::RGBA8, width, height, numMips);
+  size_t layerSize = mj::dds::GetLayerSize(format, width, height, numMips);
+  mj::jobs::ParallelFor(numLayers, 1, [=](uint32_t begin, uint32_t end) {
+    uint8_t* pDecoded = (uint8_t*)malloc((size_t)width * height * 4);
+    for (uint32_t layer = begin; pDecoded && layer < end; layer++)
+    {
+      const uint8_t* pSrc = pChains + layer * chainSize;
+      const uint8_t* pMip = pBlocks + layer * layerSize;
+      uint32_t mipWidth   = width;
+      uint32_t mipHeight  = height;
+      pErrors[layer]      = 0;
+      for (uint32_t mip = 0; mip < numMips; mip++)
+      {
+        size_t size = mj::dds::GetMipSize(mj::dds::Format::RGBA8, mipWidth, mipHeight);
+        mj::bc::Decode(format, pMip, mipWidth, mipHeight, pDecoded);
+        pErrors[layer] += mj::bc::GetSquaredError(pSrc, pDecoded, size);
+        pSrc += size;
+        pMip += mj::dds::GetMipSize(format, mipWidth, mipHeight);
+        mipWidth  = mipWidth > 1 ? mipWidth / 2 : 1;
+        mipHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+      }
+    }
+    free(pDecoded);
+  });
+}
+
+static int CookTextureArray(int argc, char** argv)
+{
+  const char* pOutPath    = nullptr;
+  const char* pListPath   = nullptr;
+  mj::mips::Filter filter = mj::mips::Filter::Kaiser;
+  mj::dds::Format format  = mj::dds::Format::BC7;
+  mj::bc::Quality quality = mj::bc::Quality::Normal;
+  uint32_t numWorkers     = 0;
+  mj::ArrayList<const char*> paths;
+  for (int i = 0; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "-o") && i + 1 < argc)
+    {
+      pOutPath = argv[++i];
+    }
+    else if (!strcmp(argv[i], "--filter") && i + 1 < argc)
+    {
+      filter = !strcmp(argv[++i], "box") ? mj::mips::Filter::Box : mj::mips::Filter::Kaiser;
+    }
+    else if (!strcmp(argv[i], "--format") && i + 1 < argc)
+    {
+      if (!ParseFormat(argv[++i], &format))
+      {
+        printf("Unknown format %s\n%s", argv[i], USAGE);
+        return 1;
+      }
+    }
+    else if (!strcmp(argv[i], "--quality") && i + 1 < argc)
+    {
+      if (!ParseQuality(argv[++i], &quality))
+      {
+        printf("Unknown quality %s\n%s", argv[i], USAGE);
+        return 1;
+      }
+    }
+    else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+    {
+      numWorkers = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    }
+    else if (!strcmp(argv[i], "--list") && i + 1 < argc)
+    {
+      pListPath = argv[++i];
+    }
+    else
+    {
+      MJ_DISCARD(paths.EmplaceSingle(argv[i]));
+    }
+  }
+
+  char* pList = pListPath ? ReadList(pListPath, paths) : nullptr;
+  if (pListPath && !pList)
+  {
+    printf("Could not read %s\n", pListPath);
+    return 1;
+  }
+  if (!pOutPath || paths.Size() == 0)
+  {
+    printf("%s", USAGE);
+    free(pList);
+    return 1;
+  }
+
+  mj::jobs::Init(numWorkers);
+  uint32_t numLayers = paths.Size();
+  mj::Image* pImages = (mj::Image*)calloc(numLayers, sizeof(mj::Image));
+  uint8_t* pData     = nullptr; // RGBA8 mip chains
+  uint8_t* pBlocks   = nullptr; // What is written, pData if not compressed
+  bool success       = false;
+  double start       = mj::stats::Now();
+  if (pImages)
+  {
+    const char** ppPaths = paths.Get();
+    mj::jobs::ParallelFor(numLayers, 1, [pImages, ppPaths](uint32_t begin, uint32_t end) {
+      for (uint32_t i = begin; i < end; i++)
+      {
+        pImages[i] = mj::Image::Load(ppPaths[i]);
+      }
+    });
+
+    // Every layer has the size of the first one
+    success = true;
+    for (uint32_t i = 0; i < numLayers; i++)
+    {
+      if (!pImages[i].IsValid())
+      {
+        printf("Could not load %s, only TGA and BMP images are supported\n", ppPaths[i]);
+        success = false;
+      }
+      else if (pImages[0].IsValid() &&
+               (pImages[i].width != pImages[0].width || pImages[i].height != pImages[0].height))
+      {
+        printf("%s is %ux%u, the first image is %ux%u\n", ppPaths[i], pImages[i].width, pImages[i].height,
+               pImages[0].width, pImages[0].height);
+        success = false;
+      }
+    }
+
+    // D3D11 wants block-compressed textures in whole blocks
+    if (success && mj::dds::IsCompressed(format) && ((pImages[0].width % 4) || (pImages[0].height % 4)))
+    {
+      printf("Block-compressed layers must be a multiple of 4 wide and high, not %ux%u\n", pImages[0].width,
+             pImages[0].height);
+      success = false;
+    }
+  }
+  double loaded = mj::stats::Now();
+
+  uint32_t width    = success ? pImages[0].width : 0;
+  uint32_t height   = success ? pImages[0].height : 0;
+  uint32_t numMips  = mj::mips::GetNumMips(width, height);
+  size_t chainSize  = mj::mips::GetChainSize(width, height, numMips);
+  size_t layerSize  = mj::dds::GetLayerSize(format, width, height, numMips);
+  double mipmapped  = loaded;
+  double compressed = loaded;
+  double written    = loaded;
+  uint64_t* pErrors = nullptr;
+  if (success)
+  {
+    pData   = (uint8_t*)malloc(chainSize * numLayers);
+    pBlocks = mj::dds::IsCompressed(format) ? (uint8_t*)malloc(layerSize * numLayers) : pData;
+    pErrors = (uint64_t*)calloc(numLayers, sizeof(uint64_t));
+    if (pData && pBlocks && pErrors)
+    {
+      mj::jobs::ParallelFor(numLayers, 1, [=](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+          uint8_t* pChain = pData + i * chainSize;
+          memcpy(pChain, pImages[i].pPixels, (size_t)width * height * 4);
+          mj::mips::Generate(pChain, width, height, numMips, filter);
+        }
+      });
+      mipmapped  = mj::stats::Now();
+      compressed = mipmapped;
+      if (mj::dds::IsCompressed(format))
+      {
+        Compress(format, quality, pData, width, height, numMips, numLayers, pBlocks);
+        compressed = mj::stats::Now();
+      }
+      success = mj::dds::WriteArray(pOutPath, format, width, height, numMips, numLayers, pBlocks);
+      written = mj::stats::Now();
+      if (!success)
+      {
+        printf("Could not write %s\n", pOutPath);
+      }
+      else if (mj::dds::IsCompressed(format))
+      {
+        Measure(format, pData, pBlocks, width, height, numMips, numLayers, pErrors);
+      }
+    }
+    else
+    {
+      printf("Out of memory\n");
+      success = false;
+    }
+  }
+
+  if (success)
+  {
+    printf("%s: %u layers of %ux%u with %u mips, %s filter, %u threads\n", pOutPath, numLayers, width, height,
+           numMips, filter == mj::mips::Filter::Box ? "box" : "kaiser", mj::jobs::GetNumThreads());
+    printf("load %.1f ms, mips %.1f ms, compress %.1f ms, write %.1f ms, %.1f KB (%.1f KB as RGBA8)\n",
+           loaded - start, mipmapped - loaded, compressed - mipmapped, written - compressed,
+           layerSize * numLayers / 1024.0, chainSize * numLayers / 1024.0);
+  }
+  if (success && mj::dds::IsCompressed(format))
+  {
+    uint64_t totalError = 0;
+    uint32_t worst      = 0;
+    for (uint32_t i = 0; i < numLayers; i++)
+    {
+      totalError += pErrors[i];
+      worst = pErrors[i] > pErrors[worst] ? i : worst;
+    }
+    printf("PSNR %.2f dB over all mips, lowest %.2f dB for %s\n", mj::bc::GetPsnr(totalError, chainSize * numLayers),
+           mj::bc::GetPsnr(pErrors[worst], chainSize), paths.Get()[worst]);
+  }
+
+  for (uint32_t i = 0; pImages && i < numLayers; i++)
+  {
+    mj::Image::Free(pImages[i]);
+  }
+  if (pBlocks != pData)
+  {
+    free(pBlocks);
+  }
+  free(pImages);
+  free(pData);
+  free(pErrors);
+  free(pList);
+  mj::jobs::Shutdown();
+  return success ? 0 : 1;
+}
+
+/// <summary>
+/// An asset of a pack, read and prepared by a job
+/// </summary>
+struct PackAsset
+{
+  void* pData; // nullptr if the file could not be read
+  size_t size;
+  mj::pack::Input input;
+  bool prepared;
+};
+
+/// <returns>True if every asset can be found in the pack and reads back as it was</returns>
+static bool CheckPack(const char* pPath, const PackAsset* pAssets, const char** ppNames, uint32_t numAssets)
+{
+  mj::pack::Pack pack;
+  if (!pack.Open(pPath) || pack.GetNumEntries() != numAssets)
+  {
+    return false;
+  }
+  bool success = true;
+  for (uint32_t i = 0; i < numAssets && success; i++)
+  {
+    const mj::pack::Entry* pEntry = pack.Find(ppNames[i]);
+    void* pCopy                   = malloc(pAssets[i].size + 1);
+
+    success = pEntry && pCopy && pack.Verify(pEntry) && (pEntry->rawSize == pAssets[i].size) && //
+              pack.Read(pEntry, pCopy) && (memcmp(pCopy, pAssets[i].pData, pAssets[i].size) == 0);
+    free(pCopy);
+  }
+  return success;
+}
+
+static int CookPack(int argc, char** argv)
+{
+  const char* pOutPath  = nullptr;
+  const char* pListPath = nullptr;
+  const char* pRoot     = nullptr;
+  bool compress         = true;
+  uint32_t numWorkers   = 0;
+  mj::ArrayList<const char*> names;
+  for (int i = 0; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "-o") && i + 1 < argc)
+    {
+      pOutPath = argv[++i];
+    }
+    else if (!strcmp(argv[i], "--root") && i + 1 < argc)
+    {
+      pRoot = argv[++i];
+    }
+    else if (!strcmp(argv[i], "--store"))
+    {
+      compress = false;
+    }
+    else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+    {
+      numWorkers = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    }
+    else if (!strcmp(argv[i], "--list") && i + 1 < argc)
+    {
+      pListPath = argv[++i];
+    }
+    else
+    {
+      MJ_DISCARD(names.EmplaceSingle(argv[i]));
+    }
+  }
+
+  char* pList = pListPath ? ReadList(pListPath, names) : nullptr;
+  if (pListPath && !pList)
+  {
+    printf("Could not read %s\n", pListPath);
+    return 1;
+  }
+  if (!pOutPath || names.Size() == 0)
+  {
+    printf("%s", USAGE);
+    free(pList);
+    return 1;
+  }
+
+  mj::jobs::Init(numWorkers);
+  uint32_t numAssets   = names.Size();
+  const char** ppNames = names.Get();
+  PackAsset* pAssets   = (PackAsset*)calloc(numAssets, sizeof(PackAsset));
+  bool success         = false;
+  double start         = mj::stats::Now();
+  if (pAssets)
+  {
+    mj::jobs::ParallelFor(numAssets, 1, [=](uint32_t begin, uint32_t end) {
+      for (uint32_t i = begin; i < end; i++)
+      {
+        char path[512];
+        snprintf(path, sizeof(path), "%s%s%s", pRoot ? pRoot : "", pRoot ? "/" : "", ppNames[i]);
+        PackAsset& asset = pAssets[i];
+        asset.pData      = mj::ReadFile(path, &asset.size);
+        asset.prepared =
+            asset.pData && mj::pack::Prepare(ppNames[i], asset.pData, asset.size, compress, &asset.input);
+      }
+    });
+
+    success = true;
+    for (uint32_t i = 0; i < numAssets; i++)
+    {
+      if (!pAssets[i].prepared)
+      {
+        printf(pAssets[i].pData ? "%s is too large\n" : "Could not read %s\n", ppNames[i]);
+        success = false;
+      }
+    }
+  }
+  else
+  {
+    printf("Out of memory\n");
+  }
+  double prepared = mj::stats::Now();
+
+  mj::pack::Input* pInputs = success ? (mj::pack::Input*)malloc(numAssets * sizeof(mj::pack::Input)) : nullptr;
+  double written           = prepared;
+  if (pInputs)
+  {
+    // Write() sorts the inputs, the assets stay in command line order for the check
+    for (uint32_t i = 0; i < numAssets; i++)
+    {
+      pInputs[i] = pAssets[i].input;
+    }
+    const char* pCollision = nullptr;
+    success                = mj::pack::Write(pOutPath, pInputs, numAssets, &pCollision);
+    written                = mj::stats::Now();
+    if (pCollision)
+    {
+      printf("%s has the same name hash as another asset\n", pCollision);
+    }
+    else if (!success)
+    {
+      printf("Could not write %s\n", pOutPath);
+    }
+    else if (!CheckPack(pOutPath, pAssets, ppNames, numAssets))
+    {
+      printf("%s does not read back as written\n", pOutPath);
+      success = false;
+    }
+  }
+
+  if (success)
+  {
+    size_t rawSize         = 0;
+    size_t packedSize      = 0;
+    uint32_t numCompressed = 0;
+    for (uint32_t i = 0; i < numAssets; i++)
+    {
+      rawSize += pAssets[i].size;
+      packedSize += pAssets[i].input.entry.size;
+      numCompressed += (pAssets[i].input.entry.flags & mj::pack::ENTRY_LZ) ? 1 : 0;
+    }
+    printf("%s: %u assets, %u compressed, %u threads\n", pOutPath, numAssets, numCompressed,
+           mj::jobs::GetNumThreads());
+    printf("read and compress %.1f ms, write %.1f ms, %.1f KB of data (%.1f KB uncompressed)\n", prepared - start,
+           written - prepared, packedSize / 1024.0, rawSize / 1024.0);
+  }
+
+  for (uint32_t i = 0; pAssets && i < numAssets; i++)
+  {
+    mj::pack::FreeInput(&pAssets[i].input);
+    free(pAssets[i].pData);
+  }
+  free(pInputs);
+  free(pAssets);
+  free(pList);
+  mj::jobs::Shutdown();
+  return success ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc >= 2 && !strcmp(argv[1], "texarray"))
+  {
+    return CookTextureArray(argc - 2, argv + 2);
+  }
+  if (argc >= 2 && !strcmp(argv[1], "pack"))
+  {
+    return CookPack(argc - 2, argv + 2);
+  }
+  printf("%s", USAGE);
+  return 1;
+}
@@ -0,0 +1,146 @@
+// Dedicated server - runs the simulation without window, renderer or input devices
+// Usage: server [level] [--clients N] [--script file] [--ticks N] [--fast]
+//   level      Level file (*.mjm) or raw 64x64 block dump, default assets/E1M1.bin
+//   --clients  In-process bots playing over loopback connections (default 8), see bot.h
+//   --script   Bot script, see LoadBotScript(). Without one the bots walk randomly.
+//   --ticks    Stop after this many ticks (default: run until interrupted)
+//   --fast     Do not wait for the next tick, to measure the maximum tick rate
+#include "bot.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+static constexpr uint32_t MAX_CATCH_UP_TICKS = 8;
+static constexpr uint32_t MAX_SCRIPT_STEPS   = 256;
+
+static volatile sig_atomic_t s_Running = 1;
+
+int main(int argc, char** argv)
+{
+  const char* pLevelPath  = nullptr;
+  const char* pScriptPath = nullptr;
+  uint32_t numClients     = 8;
+  uint32_t maxTicks       = 0;
+  bool fast               = false;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--clients") && i + 1 < argc)
+    {
+      numClients = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    }
+    else if (!strcmp(argv[i], "--script") && i + 1 < argc)
+    {
+      pScriptPath = argv[++i];
+    }
+    else if (!strcmp(argv[i], "--ticks") && i + 1 < argc)
+    {
+      maxTicks = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    }
+    else if (!strcmp(argv[i], "--fast"))
+    {
+      fast = true;
+    }
+    else
+    {
+      pLevelPath = argv[i];
+    }
+  }
+  if (numClients > Server::MAX_CLIENTS)
+  {
+    numClients = Server::MAX_CLIENTS;
+  }
+
+  mj::Grid grid = pLevelPath ? LoadLevelFile(pLevelPath) : LoadDefaultLevel();
+  if (!grid.IsValid())
+  {
+    printf("Could not load %s\n", pLevelPath ? pLevelPath : "assets/E1M1.bin, run the server from the repository root");
+    return 1;
+  }
+
+  BotStep script[MAX_SCRIPT_STEPS];
+  uint32_t numSteps = pScriptPath ? LoadBotScript(pScriptPath, script, MAX_SCRIPT_STEPS) : 0;
+  if (pScriptPath && numSteps == 0)
+  {
+    printf("Could not load bot script %s\n", pScriptPath);
+    return 1;
+  }
+
+  Server server;
+  Bot* pBots = (Bot*)calloc(numClients, sizeof(Bot));
+  if (!pBots || !server.Init(grid))
+  {
+    printf("Out of memory\n");
+    return 1;
+  }
+
+  uint32_t numConnected = 0;
+  for (uint32_t i = 0; i < numClients; i++)
+  {
+    if (pBots[numConnected].Init(server, 0x9E3779B9 + i, script, numSteps))
+    {
+      numConnected++;
+    }
+  }
+  printf("Serving a %ux%u level at %.0f Hz to %u clients\n", grid.width, grid.height, Server::TICK_RATE, numConnected);
+
+  MJ_DISCARD(signal(SIGINT, [](int) { s_Running = 0; }));
+
+  using Clock            = std::chrono::steady_clock;
+  using Seconds          = std::chrono::duration<double>;
+  Clock::duration period = std::chrono::duration_cast<Clock::duration>(Seconds(1.0 / Server::TICK_RATE));
+  Clock::time_point next = Clock::now();
+  Clock::time_point last = next;
+  uint64_t lastBytes     = 0;
+  for (uint32_t tick = 0; s_Running && (maxTicks == 0 || tick < maxTicks); tick++)
+  {
+    for (uint32_t i = 0; i < numConnected; i++)
+    {
+      pBots[i].SendInput();
+    }
+    server.Tick();
+    for (uint32_t i = 0; i < numConnected; i++)
+    {
+      pBots[i].Receive();
+    }
+
+    // Once per second of game time
+    if ((tick + 1) % (uint32_t)Server::TICK_RATE == 0)
+    {
+      Clock::time_point now              = Clock::now();
+      double seconds                     = Seconds(now - last).count();
+      mj::stats::Percentiles percentiles = server.GetTickPercentiles();
+      printf("tick %7u  %5.0f ticks/s  clients %3u  entities %5u  tick ms p50 %.3f p95 %.3f p99 %.3f max %.3f  "
+             "out %.1f KB/s\n",
+             server.world.tick, Server::TICK_RATE / seconds, server.GetNumClients(),
+             server.world.entities.GetNumAlive(), percentiles.p50, percentiles.p95, percentiles.p99, percentiles.max,
+             (server.GetBytesSent() - lastBytes) / seconds / 1024.0);
+      last      = now;
+      lastBytes = server.GetBytesSent();
+    }
+
+    if (!fast)
+    {
+      // Drop time that cannot be caught up with, instead of running a burst of ticks
+      next += period;
+      Clock::time_point now = Clock::now();
+      if (now - next > MAX_CATCH_UP_TICKS * period)
+      {
+        next = now;
+      }
+      std::this_thread::sleep_until(next);
+    }
+  }
+
+  for (uint32_t i = 0; i < numConnected; i++)
+  {
+    pBots[i].Destroy(server);
+  }
+  free(pBots);
+  server.Destroy();
+  mj::Grid::Free(grid);
+  return 0;
+}